@@ -0,0 +1,228 @@
+/* This software is distributed under the following license:
+ * http://sflow.net/license.html
+ */
+
+package main
+
+// Binary framing for the pipe to hsflowd,  used instead of "data>"
+// JSON lines when hsflowd sets HSFLOWD_CONTAINERD_FRAMES=1 in our
+// environment.  The layout is described in ../util_containerd.h.
+// Records are batched,  and written out as one frame per pass of
+// the event loop.
+
+import (
+	"bufio"
+	"encoding/binary"
+	"io"
+	"strings"
+)
+
+const (
+	framesEnv     = "HSFLOWD_CONTAINERD_FRAMES"
+	frameMagic    = 0x68736364 // "hscd"
+	frameVersion  = 1
+	frameHdrLen   = 12
+	frameMaxLen   = 65536
+	frameRecHdr   = 4
+	frameMaxRecs  = 0xffff
+	frameMaxStr   = 4096
+	recContainer  = 1
+	recStats      = 2
+	recGone       = 3
+	nvidiaVisible = "NVIDIA_VISIBLE_DEVICES="
+)
+
+// stats fields,  in mask bit order
+const (
+	statState = 1 << iota
+	statCpuTime
+	statCpuCount
+	statMemory
+	statMaxMemory
+	statRdReq
+	statRdBytes
+	statWrReq
+	statWrBytes
+	statErrs
+)
+
+// what was last sent for a container
+type frameSent struct {
+	handle    uint32
+	announced bool
+	names     [10]string
+	pid       uint32
+	stats     [10]uint64
+}
+
+type frameWriter struct {
+	w          *bufio.Writer
+	recs       []byte
+	nrecs      int
+	nextHandle uint32
+}
+
+func newFrameWriter(w io.Writer) *frameWriter {
+	return &frameWriter{
+		w:    bufio.NewWriterSize(w, frameHdrLen+frameMaxLen),
+		recs: make([]byte, 0, frameMaxLen),
+	}
+}
+
+func put16(b []byte, v uint16) []byte {
+	return append(b, byte(v>>8), byte(v))
+}
+
+func put32(b []byte, v uint32) []byte {
+	return append(b, byte(v>>24), byte(v>>16), byte(v>>8), byte(v))
+}
+
+func put64(b []byte, v uint64) []byte {
+	return put32(put32(b, uint32(v>>32)), uint32(v))
+}
+
+func putStr(b []byte, s string) []byte {
+	if len(s) > frameMaxStr {
+		s = s[:frameMaxStr]
+	}
+	return append(put16(b, uint16(len(s))), s...)
+}
+
+// record appends one record to the batch,  starting a new frame if
+// it will not fit in this one.
+func (fw *frameWriter) record(recType uint16, body []byte) error {
+	if len(fw.recs)+frameRecHdr+len(body) > frameMaxLen || fw.nrecs == frameMaxRecs {
+		if err := fw.flush(); err != nil {
+			return err
+		}
+	}
+	fw.recs = put16(fw.recs, recType)
+	fw.recs = put16(fw.recs, uint16(len(body)))
+	fw.recs = append(fw.recs, body...)
+	fw.nrecs++
+	return nil
+}
+
+func (fw *frameWriter) flush() error {
+	if fw.nrecs == 0 {
+		return nil
+	}
+	hdr := make([]byte, 0, frameHdrLen)
+	hdr = put32(hdr, frameMagic)
+	hdr = put16(hdr, frameVersion)
+	hdr = put16(hdr, uint16(fw.nrecs))
+	hdr = put32(hdr, uint32(len(fw.recs)))
+	fw.w.Write(hdr)
+	fw.w.Write(fw.recs)
+	fw.recs = fw.recs[:0]
+	fw.nrecs = 0
+	return fw.w.Flush()
+}
+
+func gpusFromEnv(env []string) string {
+	gpus := ""
+	for _, ev := range env {
+		if strings.HasPrefix(ev, nvidiaVisible) {
+			gpus = ev[len(nvidiaVisible):]
+		}
+	}
+	return gpus
+}
+
+// container sends the CONTAINER record if this is a new container
+// or if anything in it has changed.
+func (fw *frameWriter) container(sfc *SFlowContainer) error {
+	sent := &sfc.sent
+	if sent.handle == 0 {
+		fw.nextHandle++
+		sent.handle = fw.nextHandle
+	}
+	names := sfc.Metrics.Names
+	// hsflowd knows the container by Id alone
+	cur := [10]string{
+		sfc.Id,
+		names.Hostname,
+		names.ContainerName,
+		names.ContainerType,
+		names.SandboxName,
+		names.SandboxNamespace,
+		names.CgroupsPath,
+		names.Image,
+		names.ImageName,
+		gpusFromEnv(sfc.Env),
+	}
+	if sent.announced && sent.pid == sfc.Pid && sent.names == cur {
+		return nil
+	}
+	body := make([]byte, 0, 256)
+	body = put32(body, sent.handle)
+	body = put32(body, sfc.Pid)
+	for _, s := range cur {
+		body = putStr(body, s)
+	}
+	if err := fw.record(recContainer, body); err != nil {
+		return err
+	}
+	sent.announced = true
+	sent.pid = sfc.Pid
+	sent.names = cur
+	// and the next STATS must be complete
+	sent.stats = [10]uint64{}
+	sent.stats[0] = ^uint64(0)
+	return nil
+}
+
+// stats sends the STATS record with just the fields that changed.  It
+// is sent even if none did,  since hsflowd sends a counter sample for
+// each one.
+func (fw *frameWriter) stats(sfc *SFlowContainer) error {
+	if err := fw.container(sfc); err != nil {
+		return err
+	}
+	m := &sfc.Metrics
+	cur := [10]uint64{
+		uint64(m.Cpu.VirDomainState),
+		m.Cpu.CpuTime,
+		uint64(m.Cpu.CpuCount),
+		m.Mem.Memory,
+		m.Mem.MaxMemory,
+		uint64(m.Dsk.Rd_req),
+		m.Dsk.Rd_bytes,
+		uint64(m.Dsk.Wr_req),
+		m.Dsk.Wr_bytes,
+		uint64(m.Dsk.Errs),
+	}
+	const wide = statCpuTime | statMemory | statMaxMemory | statRdBytes | statWrBytes
+	sent := &sfc.sent
+	// a new container has all-ones in the first slot,  which no
+	// real state matches
+	full := sent.stats[0] == ^uint64(0)
+	mask := uint32(0)
+	body := make([]byte, 8, 8+len(cur)*8)
+	for ii, val := range cur {
+		if full || val != sent.stats[ii] {
+			bit := uint32(1) << uint(ii)
+			mask |= bit
+			if wide&bit != 0 {
+				body = put64(body, val)
+			} else {
+				body = put32(body, uint32(val))
+			}
+		}
+	}
+	binary.BigEndian.PutUint32(body[0:], sent.handle)
+	binary.BigEndian.PutUint32(body[4:], mask)
+	if err := fw.record(recStats, body); err != nil {
+		return err
+	}
+	sent.stats = cur
+	return nil
+}
+
+// gone tells hsflowd that a container it was told about was deleted.
+func (fw *frameWriter) gone(sfc *SFlowContainer) error {
+	if !sfc.sent.announced {
+		return nil
+	}
+	return fw.record(recGone, put32(make([]byte, 0, 4), sfc.sent.handle))
+}
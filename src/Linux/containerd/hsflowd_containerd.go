@@ -71,6 +71,7 @@ type SFlowContainer struct {
 	metricsCountdown int
 	mark             bool
 	pollNow          bool
+	sent             frameSent
 	Metrics          struct {
 		Names struct {
 			Image            string
@@ -84,7 +85,7 @@ type SFlowContainer struct {
 		}
 		Cpu struct {
 			VirDomainState uint32
-			CpuTime        uint32
+			CpuTime        uint64
 			CpuCount       uint32
 		}
 		Mem struct {
@@ -120,6 +121,7 @@ type CMonitor struct {
 	dbg          int
 	dbgLogger    *log.Logger
 	dataLogger   *log.Logger
+	frames       *frameWriter
 }
 
 func main() {
@@ -144,6 +146,11 @@ func main() {
 		dbgLogger:    log.New(os.Stdout, "debug>", log.Ldate|log.Ltime|log.Lshortfile),
 		dataLogger:   log.New(os.Stdout, "data>", 0),
 	}
+	if os.Getenv(framesEnv) == "1" {
+		// stdout is all frames,  so the debug goes to stderr
+		cm.dbgLogger.SetOutput(os.Stderr)
+		cm.frames = newFrameWriter(os.Stdout)
+	}
 
 	if err := cm.readConfig("/etc/hsflowd.auto"); err != nil {
 		cm.fatal(err)
@@ -298,6 +305,9 @@ func (cm CMonitor) loadContainers(ctx context.Context, client *containerd.Client
 		if sft.mark {
 			// TODO: announce? Maybe we missed an event?
 			cm.log(1, "delete task on mark and sweep: ", k)
+			if cm.frames != nil {
+				cm.frames.gone(sft)
+			}
 			delete(cm.sfcontainers, k)
 		}
 	}
@@ -341,7 +351,7 @@ func (cm CMonitor) pollMetrics(ctx context.Context, client *containerd.Client, s
 		sfc.Metrics.Cpu.CpuCount = uint32(len(data.CPU.Usage.PerCPU))
 		// cpu units are in nS - see github containerd/metrics/cgrops/v1
 		// hsflowd mod_containerd expects nS, so we can use directly.
-		sfc.Metrics.Cpu.CpuTime = uint32(data.CPU.Usage.Total)
+		sfc.Metrics.Cpu.CpuTime = data.CPU.Usage.Total
 		sfc.Metrics.Mem.Memory = data.Memory.Usage.Usage
 		sfc.Metrics.Mem.MaxMemory = data.Memory.Usage.Max
 		for _, ioentry := range data.Blkio.IoServiceBytesRecursive {
@@ -380,7 +390,7 @@ func (cm CMonitor) pollMetrics(ctx context.Context, client *containerd.Client, s
 		data2 = v
 		cm.log(1, data2)
 		sfc.Metrics.Cpu.CpuCount = uint32(len(data.CPU.Usage.PerCPU))
-		sfc.Metrics.Cpu.CpuTime = uint32(data2.CPU.UsageUsec) // nS (see for v1 above)
+		sfc.Metrics.Cpu.CpuTime = data2.CPU.UsageUsec * 1000 // uS -> nS (see for v1 above)
 		sfc.Metrics.Mem.Memory = data.Memory.Usage.Usage
 		sfc.Metrics.Mem.MaxMemory = data.Memory.Usage.Max
 		for _, ioentry := range data.Blkio.IoServiceBytesRecursive {
@@ -419,14 +429,20 @@ func (cm CMonitor) pollMetrics(ctx context.Context, client *containerd.Client, s
 		return errors.New("unexpected metrics type")
 	}
 
-	mjson, err := json.Marshal(sfc)
-	if err != nil {
-		return err
+	if cm.frames != nil {
+		if err := cm.frames.stats(sfc); err != nil {
+			return err
+		}
+	} else {
+		mjson, err := json.Marshal(sfc)
+		if err != nil {
+			return err
+		}
+		cm.dataLog(string(mjson))
 	}
-	cm.dataLog(string(mjson))
 	if cm.dbg >= 1 {
 		// also pretty-print
-		mjson, err = json.MarshalIndent(sfc, "", "   ")
+		mjson, _ := json.MarshalIndent(sfc, "", "   ")
 		cm.log(0, string(mjson))
 	}
 	return nil
@@ -627,5 +643,12 @@ func (cm CMonitor) monitorContainers(ctx context.Context) error {
 			}
 			ttick = time.Now()
 		}
+
+		if cm.frames != nil {
+			// one frame for everything from this pass
+			if err := cm.frames.flush(); err != nil {
+				return err
+			}
+		}
 	}
 }
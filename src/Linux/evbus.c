@@ -179,8 +179,10 @@ extern "C" {
       UTArrayAdd(evt->actions, act);
       evt->actionsChanged = YES;
     }
-    if(my_strequal(evt->name, EVEVENT_DECI)) {
-      // shorten select timeout so we can deliver deciTicks
+    if(my_strequal(evt->name, EVEVENT_DECI)
+       || my_strequal(evt->name, EVEVENT_LOOP)) {
+      // shorten select timeout so we can deliver deciTicks,
+      // and so that a loop pass happens at least that often
       evt->bus->select_mS = EVBUS_SELECT_MS_DECI;
     }
   }
@@ -330,6 +332,102 @@ extern "C" {
     my_free(sock);
   }
 
+  /*_________________---------------------------__________________
+    _________________  dispatch instrumentation __________________
+    -----------------___________________________------------------
+    Only used when root->instrument is set. The time recorded
+    for an action is inclusive of any events it sends locally.
+  */
+
+  static uint64_t timespecDiff_nS(struct timespec *t1, struct timespec *t2) {
+    int64_t nS = ((int64_t)(t2->tv_sec - t1->tv_sec) * 1000000000)
+      + (t2->tv_nsec - t1->tv_nsec);
+    return (nS > 0) ? nS : 0;
+  }
+
+  static int statsBin(uint64_t nS) {
+    uint64_t uS = nS / 1000;
+    int bin = 0;
+    while(uS
+	  && bin < (EV_STATS_HIST_BINS - 1)) {
+      uS >>= 1;
+      bin++;
+    }
+    return bin;
+  }
+
+  void EVStatsStart(struct timespec *wall, struct timespec *cpu) {
+    clock_gettime(CLOCK_MONOTONIC, wall);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, cpu);
+  }
+
+  void EVStatsEnd(EVStats *stats, struct timespec *wall0, struct timespec *cpu0) {
+    struct timespec wall1, cpu1;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu1);
+    clock_gettime(CLOCK_MONOTONIC, &wall1);
+    uint64_t wall_nS = timespecDiff_nS(wall0, &wall1);
+    uint64_t cpu_nS = timespecDiff_nS(cpu0, &cpu1);
+    stats->calls++;
+    stats->wall_nS += wall_nS;
+    stats->cpu_nS += cpu_nS;
+    stats->wall_hist[statsBin(wall_nS)]++;
+    stats->cpu_hist[statsBin(cpu_nS)]++;
+  }
+
+  void EVInstrument(EVMod *mod, bool flag) {
+    mod->root->instrument = flag;
+  }
+
+  void EVStatsWalk(EVMod *mod, EVStatsCB statsCB, void *magic) {
+    EVBus *bus;
+    SEMLOCK_DO(mod->root->sync) {
+      UTHASH_WALK(mod->root->buses, bus) {
+	EVEvent *evt;
+	UTARRAY_WALK(bus->eventList, evt) {
+	  EVAction *act;
+	  UTARRAY_WALK(evt->actions, act) {
+	    if(act->stats.calls)
+	      (*statsCB)(bus, evt, act->module, NULL, &act->stats, magic);
+	  }
+	}
+	EVSocket *sock;
+	UTARRAY_WALK(bus->sockets, sock) {
+	  if(sock->stats.calls)
+	    (*statsCB)(bus, NULL, sock->module, sock, &sock->stats, magic);
+	}
+      }
+    }
+  }
+
+  static void statsPrintCB(EVBus *bus, EVEvent *evt, EVMod *mod, EVSocket *sock, EVStats *stats, void *magic) {
+    FILE *out = (FILE *)magic;
+    char where[32];
+    if(sock)
+      snprintf(where, 32, "fd=%d", sock->fd);
+    fprintf(out, "%-8s %-22s %-16s calls=%"PRIu64" wall_uS=%"PRIu64" cpu_uS=%"PRIu64" wall_hist=",
+	    bus->name,
+	    evt ? evt->name : where,
+	    mod->name,
+	    stats->calls,
+	    stats->wall_nS / 1000,
+	    stats->cpu_nS / 1000);
+    for(int ii = 0; ii < EV_STATS_HIST_BINS; ii++)
+      fprintf(out, "%s%u", ii ? "," : "", stats->wall_hist[ii]);
+    fprintf(out, " cpu_hist=");
+    for(int ii = 0; ii < EV_STATS_HIST_BINS; ii++)
+      fprintf(out, "%s%u", ii ? "," : "", stats->cpu_hist[ii]);
+    fprintf(out, "\n");
+  }
+
+  void EVStatsPrint(EVMod *mod, FILE *out) {
+    if(!mod->root->instrument) {
+      fprintf(out, "event instrumentation is off\n");
+      return;
+    }
+    EVStatsWalk(mod, statsPrintCB, out);
+    fflush(out);
+  }
+
   int EVEventTx(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
     int sent = 0;
     if(evt->bus == EVCurrentBus()) {
@@ -343,7 +441,14 @@ extern "C" {
 	}
       }
       UTARRAY_WALK(evt->actions_run, act) {
-	(*act->actionCB)(act->module, evt, data, dataLen);
+	if(mod->root->instrument) {
+	  struct timespec wall0, cpu0;
+	  EVStatsStart(&wall0, &cpu0);
+	  (*act->actionCB)(act->module, evt, data, dataLen);
+	  EVStatsEnd(&act->stats, &wall0, &cpu0);
+	}
+	else
+	  (*act->actionCB)(act->module, evt, data, dataLen);
 	sent++;
       }
     }
@@ -423,8 +528,16 @@ extern "C" {
       if(FD_ISSET(bus->pipe[0], &readfds))
 	busRxPipe(bus, bus->pipe[0]);
       UTARRAY_WALK(bus->sockets_run, sock) {
-	if(FD_ISSET(sock->fd, &readfds))
-	  (*sock->readCB)(sock->module, sock, sock->magic);
+	if(FD_ISSET(sock->fd, &readfds)) {
+	  if(bus->root->instrument) {
+	    struct timespec wall0, cpu0;
+	    EVStatsStart(&wall0, &cpu0);
+	    (*sock->readCB)(sock->module, sock, sock->magic);
+	    EVStatsEnd(&sock->stats, &wall0, &cpu0);
+	  }
+	  else
+	    (*sock->readCB)(sock->module, sock, sock->magic);
+	}
       }
     }
     else if(nfds < 0) {
@@ -466,6 +579,29 @@ extern "C" {
     }
   }
 
+  /*_________________---------------------------__________________
+    _________________     busAccountCPU         __________________
+    -----------------___________________________------------------
+    Called once per pass through the busRun() loop, after the
+    socket and tick/deci dispatch.  The thread CPU clock does not
+    advance while we are blocked in pselect(),  so the delta since
+    the last pass is the CPU spent dispatching on this bus.
+  */
+
+  static void busAccountCPU(EVBus *bus) {
+    struct timespec cpu_now;
+    if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_now) == -1)
+      return;
+    if(bus->cpu_last.tv_sec
+       || bus->cpu_last.tv_nsec) {
+      int64_t delta = ((int64_t)(cpu_now.tv_sec - bus->cpu_last.tv_sec) * 1000000000)
+	+ (cpu_now.tv_nsec - bus->cpu_last.tv_nsec);
+      if(delta > 0)
+	bus->cpu_nS += delta;
+    }
+    bus->cpu_last = cpu_now;
+  }
+
   static void *busRun(void *magic) {
 #ifdef GPROF
     myDebug(1, "GPROF ProfilerRegisterThread()");
@@ -480,6 +616,7 @@ extern "C" {
     EVEvent *tick = EVGetEvent(bus, EVEVENT_TICK);
     EVEvent *tock = EVGetEvent(bus, EVEVENT_TOCK);
     EVEvent *deci = EVGetEvent(bus, EVEVENT_DECI);
+    EVEvent *loop = EVGetEvent(bus, EVEVENT_LOOP);
     EVEvent *final = EVGetEvent(bus, EVEVENT_FINAL);
     EVEvent *end = EVGetEvent(bus, EVEVENT_END);
 
@@ -495,6 +632,7 @@ extern "C" {
       }
 
       busRead(bus);
+      EVEventTx(mod, loop, NULL, 0);
 
       // Detect tick/deci boundaries.
       // These tick/tock/deci events used to skip if something
@@ -508,6 +646,9 @@ extern "C" {
 	  EVEventTx(mod, tock, NULL, 0);
 	}
       }
+
+      if(bus->root->measureCPU)
+	busAccountCPU(bus);
     }
     return NULL;
   }
@@ -515,6 +656,14 @@ extern "C" {
   int EVBusRunningTime_mS(EVBus *bus) {
     return EVTimeDiff_mS(&bus->tstart, &bus->now);
   }
+
+  void EVMeasureCPU(EVMod *mod, bool flag) {
+    mod->root->measureCPU = flag;
+  }
+
+  uint64_t EVBusCPU_nS(EVBus *bus) {
+    return bus->cpu_nS;
+  }
   
   void EVBusRunThread(EVBus *bus, size_t stacksize) {
     // Set a more conservative stacksize here - partly because
@@ -616,6 +765,13 @@ extern "C" {
   }
 
   pid_t EVBusExec(EVMod *mod, EVBus *bus, void *magic, char **cmd, EVReadCB readCB)
+  {
+    return EVBusExecEnv(mod, bus, magic, cmd, NULL, readCB);
+  }
+
+  // as EVBusExec,  but env is a NULL-terminated list of "name=value"
+  // strings to add to the child's environment.
+  pid_t EVBusExecEnv(EVMod *mod, EVBus *bus, void *magic, char **cmd, char **env, EVReadCB readCB)
   {
     int outPipe[2];
     int errPipe[2];
@@ -640,6 +796,9 @@ extern "C" {
       // clean up
       while(close(outPipe[1]) == -1 && errno == EINTR);
       while(close(errPipe[1]) == -1 && errno == EINTR);
+      // extra environment
+      for(char **ev = env; ev && *ev; ev++)
+	putenv(*ev);
       // and exec
       if(execv(cmd[0], cmd) == -1) {
 	myLog(LOG_ERR, "execv() failed : errno=%d (%s)", errno, strerror(errno));
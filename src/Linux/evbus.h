@@ -37,6 +37,8 @@ extern "C" {
     UTHash *sockets;
     struct _EVMod *rootModule;
     pthread_mutex_t *sync;
+    bool measureCPU;
+    bool instrument;
   } EVRoot;
 
 #define EVMOD_ROOT "_root"
@@ -54,6 +56,18 @@ extern "C" {
 
   struct _EVSocket; // fwd decl
 
+  // optional dispatch instrumentation (see EVInstrument).
+  // Histogram bin 0 is <1uS, bin N is [2^(N-1), 2^N) uS
+  // and the last bin catches everything longer.
+#define EV_STATS_HIST_BINS 24
+  typedef struct _EVStats {
+    uint64_t calls;
+    uint64_t wall_nS;
+    uint64_t cpu_nS;
+    uint32_t wall_hist[EV_STATS_HIST_BINS];
+    uint32_t cpu_hist[EV_STATS_HIST_BINS];
+  } EVStats;
+
   typedef struct _EVLogMsg {
     char *msg;
     uint32_t logTime;
@@ -79,6 +93,9 @@ extern "C" {
     pthread_t *thread;
     int childCount;
     UTHash *msgs;
+    // thread CPU consumed by this bus (when root->measureCPU is set)
+    uint64_t cpu_nS;
+    struct timespec cpu_last;
     bool socketsChanged:1;
     bool running:1;
     bool stop:1;
@@ -97,6 +114,7 @@ extern "C" {
     UTStrBuf *iobuf;
     UTStrBuf *ioline;
     bool errOut;
+    EVStats stats;
   } EVSocket;
 
   struct _EVAction; // fwd decl
@@ -115,12 +133,14 @@ extern "C" {
   typedef struct _EVAction {
     EVMod *module;
     EVActionCB actionCB;
+    EVStats stats;
   } EVAction;
 
 #define EVEVENT_START "_start"
 #define EVEVENT_TICK "_tick"
 #define EVEVENT_TOCK "_tock"
 #define EVEVENT_DECI "_deci"
+#define EVEVENT_LOOP "_loop" // after every pass through select()
 #define EVEVENT_FINAL "_final"
 #define EVEVENT_END "_end"
 #define EVEVENT_HANDSHAKE "_handshake"
@@ -161,6 +181,7 @@ extern "C" {
 
   void EVSocketReadLines(EVMod *mod, EVSocket *sock, EVSocketReadLineCB lineCB, bool tail, void *magic);
   pid_t EVBusExec(EVMod *mod, EVBus *bus, void *magic, char **cmd, EVReadCB readCB);
+  pid_t EVBusExecEnv(EVMod *mod, EVBus *bus, void *magic, char **cmd, char **env, EVReadCB readCB);
 
   // Use a more conservative stacksize here - partly because
   // we don't need more,  but mostly because Debian was refusing
@@ -175,6 +196,16 @@ extern "C" {
   void EVBusRunThread(EVBus *bus, size_t stacksize);
   void EVBusRun(EVBus *bus);
   int EVBusRunningTime_mS(EVBus *bus);
+  void EVMeasureCPU(EVMod *mod, bool flag);
+  uint64_t EVBusCPU_nS(EVBus *bus);
+  void EVInstrument(EVMod *mod, bool flag);
+  // sock is NULL for event actions, evt is NULL for socket reads
+  typedef void (*EVStatsCB)(EVBus *bus, EVEvent *evt, EVMod *mod, EVSocket *sock, EVStats *stats, void *magic);
+  void EVStatsWalk(EVMod *mod, EVStatsCB statsCB, void *magic);
+  void EVStatsPrint(EVMod *mod, FILE *out);
+  // for timing other code paths into an EVStats of your own
+  void EVStatsStart(struct timespec *wall, struct timespec *cpu);
+  void EVStatsEnd(EVStats *stats, struct timespec *wall0, struct timespec *cpu0);
   void EVBusStop(EVBus *bus);
   EVBus *EVCurrentBus(void);
   void EVCurrentBusSet(EVBus *bus);
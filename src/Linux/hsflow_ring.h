@@ -0,0 +1,423 @@
+/* This software is distributed under the following license:
+ * http://sflow.net/license.html
+ */
+
+#ifndef HSFLOW_RING_H
+#define HSFLOW_RING_H 1
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+  /* Shared-memory ring for sending app samples, rtmetric and rtflow
+     records to hsflowd (mod_json) without a syscall or any JSON.
+
+     hsflowd creates the ring when configured with e.g.
+       json { ring = /hsflowd_json }
+     and drains it on every pass through its packet-bus loop (at least
+     every 60mS or so).  Any number of processes or threads may write
+     to it at once,  but the ring is not open to every local user:  a
+     writer can read the other writers' records,  and could crash
+     hsflowd by truncating the ring.  It is created mode 0600 (only
+     hsflowd's own user,  normally root,  can write to it),  or 0660
+     with its group set to e.g. "hsflowd" by
+       json { ring = /hsflowd_json ringGroup = hsflowd }
+     in which case the writing programs must run in that group.  Only
+     put trusted programs in it.  Example:
+
+       hsflow_ring *ring = hsflow_ring_attach("/hsflowd_json");
+       uint64_t pos;
+       hsflow_ring_slot *slot = hsflow_ring_reserve(ring, HSFLOW_RING_RTMETRIC, &pos);
+       if(slot) {
+         hsflow_ring_rt *rt = (hsflow_ring_rt *)slot->body;
+         hsflow_ring_rt_init(rt, "web1", 0);
+         hsflow_ring_rt_uint32(rt, "requests", HSFLOW_RTMETRIC_COUNTER32, nreq);
+         hsflow_ring_rt_double(rt, "load", HSFLOW_RTMETRIC_GAUGEDOUBLE, load);
+         hsflow_ring_commit(ring, slot, pos);
+       }
+
+     hsflow_ring_reserve() returns NULL when the ring is full, and the
+     record is counted in ring->hdr->dropped.  Every reserved slot must be
+     committed promptly:  hsflowd abandons a slot that stays reserved for
+     more than a couple of seconds so that a dead producer cannot stall
+     the ring.  The abandoned slot goes back into use,  so a producer that
+     was only stalled may still be writing into it after another producer
+     has reserved it,  and can corrupt that record.  Its own commit then
+     fails (and counts as dropped),  but it cannot undo those writes.
+     hsflowd only bounds the damage:  it copies the whole slot out before
+     handing it back,  takes the record length from inside the body (the
+     slot header has no length that a late commit could overwrite),  and
+     checks every record as if it came off the network.
+
+     The ring is a bounded MPSC queue with a sequence number in each slot
+     (after Dmitry Vyukov's bounded MPMC queue).  Producers claim a
+     position by CAS on head,  fill the slot and then publish it by
+     setting its sequence number to position+1.  The consumer reads
+     slots in order from tail and hands each one back by setting its
+     sequence number to position+slots.
+
+     Records are in host byte order,  except for the rtmetric / rtflow
+     fields which are already XDR (as they go into the sFlow datagram)
+     so that hsflowd only has to check them and copy them.
+  */
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+
+#define HSFLOW_RING_MAGIC 0x6873726e // "hsrn"
+#define HSFLOW_RING_VERSION 2
+#define HSFLOW_RING_SLOT_BYTES 1024
+#define HSFLOW_RING_CACHELINE 64
+
+  typedef struct _hsflow_ring_hdr {
+    uint32_t magic; // set last by hsflowd,  when the ring is ready
+    uint32_t version;
+    uint32_t slots; // a power of 2
+    uint32_t slot_bytes;
+    uint64_t dropped; // full ring or abandoned slot
+    uint64_t head __attribute__((aligned(HSFLOW_RING_CACHELINE))); // next position to reserve
+    uint64_t tail __attribute__((aligned(HSFLOW_RING_CACHELINE))); // next position hsflowd reads
+  } __attribute__((aligned(HSFLOW_RING_CACHELINE))) hsflow_ring_hdr;
+
+  // record types
+#define HSFLOW_RING_APP_SAMPLE 1
+#define HSFLOW_RING_RTMETRIC 2
+#define HSFLOW_RING_RTFLOW 3
+
+  typedef struct _hsflow_ring_slot {
+    uint64_t seq;
+    uint32_t type;
+    uint32_t pad; // no length:  it comes from the body
+    char body[HSFLOW_RING_SLOT_BYTES - 16];
+  } hsflow_ring_slot;
+
+  /*_________________---------------------------__________________
+    _________________      app sample           __________________
+    -----------------___________________________------------------
+    As the "flow_sample" JSON message.  String fields are NUL-terminated
+    (the lengths are as SFLAPP_MAX_* in sflow.h) and empty means absent.
+  */
+
+#define HSFLOW_RING_APP_LEN 32
+#define HSFLOW_RING_OPERATION_LEN 32
+#define HSFLOW_RING_ATTRIBUTES_LEN 255
+#define HSFLOW_RING_STATUS_LEN 32
+#define HSFLOW_RING_ACTOR_LEN 64
+
+  // flags
+#define HSFLOW_RING_APP_CLIENT 1
+#define HSFLOW_RING_APP_SOCKET4 2
+#define HSFLOW_RING_APP_SOCKET6 4
+
+  typedef struct _hsflow_ring_app_sample {
+    uint32_t sampling_rate; // 0 means 1
+    uint32_t status; // EnumSFLAPPStatus
+    uint64_t req_bytes;
+    uint64_t resp_bytes;
+    uint32_t duration_uS;
+    uint16_t service_port;
+    uint16_t flags;
+    struct {
+      uint32_t protocol;
+      uint8_t local_ip[4];
+      uint8_t remote_ip[4];
+      uint16_t local_port;
+      uint16_t remote_port;
+    } socket4;
+    struct {
+      uint32_t protocol;
+      uint8_t local_ip[16];
+      uint8_t remote_ip[16];
+      uint16_t local_port;
+      uint16_t remote_port;
+    } socket6;
+    char application[HSFLOW_RING_APP_LEN + 1];
+    char operation[HSFLOW_RING_OPERATION_LEN + 1];
+    char attributes[HSFLOW_RING_ATTRIBUTES_LEN + 1];
+    char status_descr[HSFLOW_RING_STATUS_LEN + 1];
+    char parent_application[HSFLOW_RING_APP_LEN + 1];
+    char parent_operation[HSFLOW_RING_OPERATION_LEN + 1];
+    char parent_attributes[HSFLOW_RING_ATTRIBUTES_LEN + 1];
+    char actor_initiator[HSFLOW_RING_ACTOR_LEN + 1];
+    char actor_target[HSFLOW_RING_ACTOR_LEN + 1];
+  } hsflow_ring_app_sample;
+
+  /*_________________---------------------------__________________
+    _________________    rtmetric / rtflow      __________________
+    -----------------___________________________------------------
+    As the "rtmetric" and "rtflow" JSON messages.  Each field is
+    XDR-encoded:  name (uint32 length, bytes padded to 4),  uint32 type
+    and then the value:  uint32 or uint64 for the integer types,  IEEE
+    float or double,  or a string (uint32 length, bytes padded to 4).
+    rtflow mac,  ip and ip6 values are 6, 4 and 16 opaque bytes (the mac
+    padded to 8).  Names are up to 64 of [A-Za-z0-9_-],  and the
+    datasource may not start with a digit.
+  */
+
+#define HSFLOW_RING_KEY_LEN 64
+#define HSFLOW_RING_VAL_LEN 255
+
+  // rtmetric types
+#define HSFLOW_RTMETRIC_STRING 0
+#define HSFLOW_RTMETRIC_COUNTER32 1
+#define HSFLOW_RTMETRIC_COUNTER64 2
+#define HSFLOW_RTMETRIC_GAUGE32 3
+#define HSFLOW_RTMETRIC_GAUGE64 4
+#define HSFLOW_RTMETRIC_GAUGEFLOAT 5
+#define HSFLOW_RTMETRIC_GAUGEDOUBLE 6
+
+  // rtflow types
+#define HSFLOW_RTFLOW_STRING 0
+#define HSFLOW_RTFLOW_MAC 1
+#define HSFLOW_RTFLOW_IP 2
+#define HSFLOW_RTFLOW_IP6 3
+#define HSFLOW_RTFLOW_INT32 4
+#define HSFLOW_RTFLOW_INT64 5
+#define HSFLOW_RTFLOW_FLOAT 6
+#define HSFLOW_RTFLOW_DOUBLE 7
+
+  typedef struct _hsflow_ring_rt {
+    char datasource[HSFLOW_RING_KEY_LEN + 4]; // NUL-terminated
+    uint32_t sampling_rate; // rtflow only, 0 means 1
+    uint32_t num_fields;
+    uint32_t fields_len; // bytes of fields
+    uint32_t fields[];
+  } hsflow_ring_rt;
+
+#define HSFLOW_RING_RT_MAX_FIELDS_LEN (sizeof(((hsflow_ring_slot *)0)->body) - sizeof(hsflow_ring_rt))
+
+  /*_________________---------------------------__________________
+    _________________      producer API         __________________
+    -----------------___________________________------------------
+  */
+
+  typedef struct _hsflow_ring {
+    hsflow_ring_hdr *hdr;
+    hsflow_ring_slot *slots;
+    size_t map_len;
+  } hsflow_ring;
+
+  static inline hsflow_ring *hsflow_ring_attach_to(hsflow_ring *ring, const char *shm_name) {
+    int fd = shm_open(shm_name, O_RDWR, 0);
+    if(fd < 0)
+      return NULL;
+    struct stat st;
+    void *map = MAP_FAILED;
+    if(fstat(fd, &st) == 0
+       && (size_t)st.st_size > sizeof(hsflow_ring_hdr))
+      map = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+      return NULL;
+    hsflow_ring_hdr *hdr = (hsflow_ring_hdr *)map;
+    if(__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != HSFLOW_RING_MAGIC
+       || hdr->version != HSFLOW_RING_VERSION
+       || hdr->slot_bytes != sizeof(hsflow_ring_slot)
+       || sizeof(hsflow_ring_hdr) + ((size_t)hdr->slots * sizeof(hsflow_ring_slot)) > (size_t)st.st_size) {
+      munmap(map, st.st_size);
+      return NULL;
+    }
+    ring->hdr = hdr;
+    ring->slots = (hsflow_ring_slot *)(hdr + 1);
+    ring->map_len = st.st_size;
+    return ring;
+  }
+
+  // returns NULL if hsflowd has not created the ring (yet)
+  static inline hsflow_ring *hsflow_ring_attach(const char *shm_name) {
+    static __thread hsflow_ring ring; // one mapping per thread is fine too
+    return hsflow_ring_attach_to(&ring, shm_name);
+  }
+
+  static inline void hsflow_ring_detach(hsflow_ring *ring) {
+    if(ring && ring->hdr) {
+      munmap(ring->hdr, ring->map_len);
+      ring->hdr = NULL;
+    }
+  }
+
+  static inline hsflow_ring_slot *hsflow_ring_reserve(hsflow_ring *ring, uint32_t type, uint64_t *p_pos) {
+    hsflow_ring_hdr *hdr = ring->hdr;
+    uint64_t pos = __atomic_load_n(&hdr->head, __ATOMIC_RELAXED);
+    for(;;) {
+      hsflow_ring_slot *slot = &ring->slots[pos & (hdr->slots - 1)];
+      uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+      int64_t dif = (int64_t)(seq - pos);
+      if(dif == 0) {
+	if(__atomic_compare_exchange_n(&hdr->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	  slot->type = type;
+	  *p_pos = pos;
+	  return slot;
+	}
+	// pos was reloaded by the failed CAS
+      }
+      else if(dif < 0) {
+	// full
+	__atomic_fetch_add(&hdr->dropped, 1, __ATOMIC_RELAXED);
+	return NULL;
+      }
+      else
+	pos = __atomic_load_n(&hdr->head, __ATOMIC_RELAXED);
+    }
+  }
+
+  // returns 0 if hsflowd gave up waiting for this slot.  Nothing is
+  // written to the slot unless the CAS succeeds.
+  static inline int hsflow_ring_commit(hsflow_ring *ring, hsflow_ring_slot *slot, uint64_t pos) {
+    uint64_t expected = pos;
+    if(__atomic_compare_exchange_n(&slot->seq, &expected, pos + 1, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+      return 1;
+    __atomic_fetch_add(&ring->hdr->dropped, 1, __ATOMIC_RELAXED);
+    return 0;
+  }
+
+  /*_________________---------------------------__________________
+    _________________   rtmetric/rtflow fields  __________________
+    -----------------___________________________------------------
+    Appending a field that would not fit in the slot returns 0 and
+    leaves the record as it was.
+  */
+
+  static inline void hsflow_ring_rt_init(hsflow_ring_rt *rt, const char *datasource, uint32_t sampling_rate) {
+    memset(rt, 0, sizeof(*rt));
+    strncpy(rt->datasource, datasource, HSFLOW_RING_KEY_LEN);
+    rt->sampling_rate = sampling_rate;
+  }
+
+  static inline uint32_t hsflow_ring_rt_len(hsflow_ring_rt *rt) {
+    return sizeof(*rt) + rt->fields_len;
+  }
+
+  static inline uint32_t *hsflow_ring_rt_field(hsflow_ring_rt *rt, const char *name, uint32_t type, uint32_t val_len) {
+    uint32_t name_len = strlen(name);
+    uint32_t need = 4 + ((name_len + 3) & ~3) + 4 + ((val_len + 3) & ~3);
+    if(name_len > HSFLOW_RING_KEY_LEN
+       || rt->fields_len + need > HSFLOW_RING_RT_MAX_FIELDS_LEN)
+      return NULL;
+    uint32_t *p = rt->fields + (rt->fields_len >> 2);
+    memset(p, 0, need);
+    *p++ = htonl(name_len);
+    memcpy(p, name, name_len);
+    p += (name_len + 3) >> 2;
+    *p++ = htonl(type);
+    rt->fields_len += need;
+    rt->num_fields++;
+    return p;
+  }
+
+  static inline int hsflow_ring_rt_uint32(hsflow_ring_rt *rt, const char *name, uint32_t type, uint32_t val) {
+    uint32_t *p = hsflow_ring_rt_field(rt, name, type, 4);
+    if(p) p[0] = htonl(val);
+    return (p != NULL);
+  }
+
+  static inline int hsflow_ring_rt_uint64(hsflow_ring_rt *rt, const char *name, uint32_t type, uint64_t val) {
+    uint32_t *p = hsflow_ring_rt_field(rt, name, type, 8);
+    if(p) {
+      p[0] = htonl((uint32_t)(val >> 32));
+      p[1] = htonl((uint32_t)val);
+    }
+    return (p != NULL);
+  }
+
+  static inline int hsflow_ring_rt_float(hsflow_ring_rt *rt, const char *name, uint32_t type, float val) {
+    uint32_t val32;
+    memcpy(&val32, &val, 4);
+    return hsflow_ring_rt_uint32(rt, name, type, val32);
+  }
+
+  static inline int hsflow_ring_rt_double(hsflow_ring_rt *rt, const char *name, uint32_t type, double val) {
+    uint64_t val64;
+    memcpy(&val64, &val, 8);
+    return hsflow_ring_rt_uint64(rt, name, type, val64);
+  }
+
+  static inline int hsflow_ring_rt_string(hsflow_ring_rt *rt, const char *name, const char *val) {
+    uint32_t val_len = strlen(val);
+    if(val_len > HSFLOW_RING_VAL_LEN)
+      return 0;
+    // rtmetric and rtflow both use type 0 for string
+    uint32_t *p = hsflow_ring_rt_field(rt, name, HSFLOW_RTMETRIC_STRING, 4 + val_len);
+    if(p) {
+      p[0] = htonl(val_len);
+      memcpy(p + 1, val, val_len);
+    }
+    return (p != NULL);
+  }
+
+  // rtflow mac, ip and ip6
+  static inline int hsflow_ring_rt_bytes(hsflow_ring_rt *rt, const char *name, uint32_t type, const void *val, uint32_t val_len) {
+    uint32_t *p = hsflow_ring_rt_field(rt, name, type, val_len);
+    if(p) memcpy(p, val, val_len);
+    return (p != NULL);
+  }
+
+  /*_________________---------------------------__________________
+    _________________     XDR datagrams         __________________
+    -----------------___________________________------------------
+    The same rtmetric and rtflow records can be sent to the json UDP
+    port without JSON.  The datagram is HSFLOW_XDR_MAGIC and
+    HSFLOW_XDR_VERSION followed by one or more samples exactly as they
+    appear in the sFlow datagram:  tag,  length and then datasource
+    (XDR string),  [rtflow: sampling_rate and a reserved 0],  the number
+    of fields and the fields.  All in network byte order.  hsflowd
+    checks each sample and copies it into the sFlow datagram as it is.
+
+       hsflow_xdr x;
+       hsflow_xdr_init(&x);
+       hsflow_xdr_add(&x, HSFLOW_RING_RTMETRIC, rt); // rt filled in as above
+       send(soc, x.xdr, x.len, 0);
+  */
+
+#define HSFLOW_XDR_MAGIC 0x68737864 // "hsxd",  never the start of a JSON message
+#define HSFLOW_XDR_VERSION 1
+#define HSFLOW_XDR_TAG_RTMETRIC ((4300 << 12) + 1002)
+#define HSFLOW_XDR_TAG_RTFLOW ((4300 << 12) + 1003)
+#define HSFLOW_XDR_MAX_BYTES 8192
+
+  typedef struct _hsflow_xdr {
+    uint32_t len; // bytes
+    uint32_t xdr[HSFLOW_XDR_MAX_BYTES >> 2];
+  } hsflow_xdr;
+
+  static inline void hsflow_xdr_init(hsflow_xdr *x) {
+    x->xdr[0] = htonl(HSFLOW_XDR_MAGIC);
+    x->xdr[1] = htonl(HSFLOW_XDR_VERSION);
+    x->len = 8;
+  }
+
+  // type is HSFLOW_RING_RTMETRIC or HSFLOW_RING_RTFLOW.  Returns 0 if
+  // the datagram is full:  send it,  hsflow_xdr_init() and add again.
+  static inline int hsflow_xdr_add(hsflow_xdr *x, uint32_t type, hsflow_ring_rt *rt) {
+    int rtflow = (type == HSFLOW_RING_RTFLOW);
+    uint32_t ds_len = strnlen(rt->datasource, HSFLOW_RING_KEY_LEN);
+    uint32_t body_len = 4 + ((ds_len + 3) & ~3) + (rtflow ? 8 : 0) + 4 + rt->fields_len;
+    if(x->len + 8 + body_len > HSFLOW_XDR_MAX_BYTES)
+      return 0;
+    uint32_t *p = x->xdr + (x->len >> 2);
+    *p++ = htonl(rtflow ? HSFLOW_XDR_TAG_RTFLOW : HSFLOW_XDR_TAG_RTMETRIC);
+    *p++ = htonl(body_len);
+    *p++ = htonl(ds_len);
+    p[ds_len >> 2] = 0; // padding
+    memcpy(p, rt->datasource, ds_len);
+    p += (ds_len + 3) >> 2;
+    if(rtflow) {
+      *p++ = htonl(rt->sampling_rate ? rt->sampling_rate : 1);
+      *p++ = 0; // reserved
+    }
+    *p++ = htonl(rt->num_fields);
+    memcpy(p, rt->fields, rt->fields_len);
+    x->len += 8 + body_len;
+    return 1;
+  }
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+#endif /* HSFLOW_RING_H */
@@ -77,7 +77,9 @@ extern "C" {
     HSPOBJ_DBUS,
     HSPOBJ_SYSTEMD,
     HSPOBJ_EAPI,
-    HSPOBJ_PORT
+    HSPOBJ_PORT,
+    HSPOBJ_GOVERNOR,
+    HSPOBJ_PROMETHEUS
   } EnumHSPObject;
 
   static const char *HSPObjectNames[] = {
@@ -107,7 +109,9 @@ extern "C" {
     "dbus",
     "systemd",
     "eapi",
-    "port"
+    "port",
+    "governor",
+    "prometheus"
   };
 
   static void copyApplicationSettings(HSPSFlowSettings *from, HSPSFlowSettings *to);
@@ -1329,12 +1333,30 @@ extern "C" {
 	  case HSPTOKEN_CHECK_ADAPTORS:
 	    if((tok = expectInteger32(sp, tok, &sp->checkAdaptorListSecs, 1, 3600)) == NULL) return NO;
 	    break;
+	  case HSPTOKEN_SFP_THREADS:
+	    if((tok = expectInteger32(sp, tok, &sp->sfp.threads, 0, HSP_SFP_MAX_THREADS)) == NULL) return NO;
+	    break;
+	  case HSPTOKEN_SFP_REFRESH:
+	    if((tok = expectInteger32(sp, tok, &sp->sfp.refreshSecs, 1, 3600)) == NULL) return NO;
+	    break;
 	  case HSPTOKEN_REFRESH_VMS:
 	    if((tok = expectInteger32(sp, tok, &sp->refreshVMListSecs, 60, 3600)) == NULL) return NO;
 	    break;
 	  case HSPTOKEN_FORGET_VMS:
 	    if((tok = expectInteger32(sp, tok, &sp->forgetVMSecs, 60, 0xFFFFFFFF)) == NULL) return NO;
 	    break;
+	  case HSPTOKEN_INSTRUMENT:
+	    if((tok = expectONOFF(sp, tok, &sp->instrument)) == NULL) return NO;
+	    break;
+	  case HSPTOKEN_POLL_BUDGET:
+	    if((tok = expectInteger32(sp, tok, &sp->pollBudget_mS, 0, 1000)) == NULL) return NO;
+	    break;
+	  case HSPTOKEN_POLL_IDLE:
+	    if((tok = expectInteger32(sp, tok, &sp->pollIdle, 0, 1000)) == NULL) return NO;
+	    break;
+	  case HSPTOKEN_POLL_IDLE_MAX:
+	    if((tok = expectInteger32(sp, tok, &sp->pollIdleMax, 1, 3600)) == NULL) return NO;
+	    break;
 	    // ======================================================================
 	  case HSPTOKEN_DNS_SD:
 	    if((tok = expectToken(sp, tok, HSPTOKEN_STARTOBJ)) == NULL) return NO;
@@ -1465,6 +1487,7 @@ extern "C" {
 	  case HSPTOKEN_SYSTEMD:
 	    if((tok = expectToken(sp, tok, HSPTOKEN_STARTOBJ)) == NULL) return NO;
 	    sp->systemd.systemd = YES;
+	    sp->systemd.cgroup2 = YES;
 	    level[++depth] = HSPOBJ_SYSTEMD;
 	    break;
 	  case HSPTOKEN_EAPI:
@@ -1472,6 +1495,19 @@ extern "C" {
 	    sp->eapi.eapi = YES;
 	    level[++depth] = HSPOBJ_EAPI;
 	    break;
+	  case HSPTOKEN_GOVERNOR:
+	    if((tok = expectToken(sp, tok, HSPTOKEN_STARTOBJ)) == NULL) return NO;
+	    sp->governor.governor = YES;
+	    sp->governor.cpu = HSP_GOVERNOR_DEFAULT_CPU;
+	    sp->governor.interval = HSP_GOVERNOR_DEFAULT_INTERVAL;
+	    level[++depth] = HSPOBJ_GOVERNOR;
+	    break;
+	  case HSPTOKEN_PROMETHEUS:
+	    if((tok = expectToken(sp, tok, HSPTOKEN_STARTOBJ)) == NULL) return NO;
+	    sp->prometheus.prometheus = YES;
+	    sp->prometheus.port = HSP_PROMETHEUS_DEFAULT_PORT;
+	    level[++depth] = HSPOBJ_PROMETHEUS;
+	    break;
 	  case HSPTOKEN_SAMPLING:
 	  case HSPTOKEN_PACKETSAMPLINGRATE:
 	    if((tok = expectInteger32(sp, tok, &sp->sFlowSettings_file->samplingRate, 0, HSP_MAX_SAMPLING_N)) == NULL) return NO;
@@ -1604,6 +1640,9 @@ extern "C" {
 	    case HSPTOKEN_FORGET_VMS:
 	      if((tok = expectInteger32(sp, tok, &sp->kvm.forgetVMSecs, 60, 0xFFFFFFFF)) == NULL) return NO;
 	      break;
+	    case HSPTOKEN_URI:
+	      if((tok = expectString(sp, tok, &sp->kvm.uri, "uri")) == NULL) return NO;
+	      break;
 	    default:
 	      unexpectedToken(sp, tok, level[depth]);
 	      return NO;
@@ -1834,6 +1873,15 @@ extern "C" {
 	      if((tok = expectInteger32(sp, tok, &pc->sampling_n, 0, HSP_MAX_SAMPLING_N)) == NULL) return NO;
 	      pc->sampling_n_set = YES;
 	      break;
+	    case HSPTOKEN_FILE:
+	      if((tok = expectFile(sp, tok, &pc->file)) == NULL) return NO;
+	      break;
+	    case HSPTOKEN_RATE:
+	      if((tok = expectInteger32(sp, tok, &pc->rate, 0, 100000000)) == NULL) return NO;
+	      break;
+	    case HSPTOKEN_LOOP:
+	      if((tok = expectONOFF(sp, tok, &pc->loop)) == NULL) return NO;
+	      break;
 	    default:
 	      unexpectedToken(sp, tok, level[depth]);
 	      return NO;
@@ -1915,6 +1963,19 @@ extern "C" {
 	      // expect a file name such as "/tmp/hsflowd_json_fifo" that was created using mkfifo(1)
 	      if((tok = expectFile(sp, tok, &sp->json.FIFO)) == NULL) return NO;
 	      break;
+	    case HSPTOKEN_THREADS:
+	      if((tok = expectInteger32(sp, tok, &sp->json.threads, 0, HSP_JSON_MAX_THREADS)) == NULL) return NO;
+	      break;
+	    case HSPTOKEN_RING:
+	      // shared-memory name such as "/hsflowd_json"
+	      if((tok = expectString(sp, tok, &sp->json.ring, "shm name")) == NULL) return NO;
+	      break;
+	    case HSPTOKEN_RING_GROUP:
+	      if((tok = expectString(sp, tok, &sp->json.ringGroup, "group name")) == NULL) return NO;
+	      break;
+	    case HSPTOKEN_RTMETRIC_WINDOW:
+	      if((tok = expectInteger32(sp, tok, &sp->json.rtmetricWindow, 0, HSP_JSON_MAX_RTMETRIC_WINDOW)) == NULL) return NO;
+	      break;
 	    default:
 	      unexpectedToken(sp, tok, level[depth]);
 	      return NO;
@@ -2036,6 +2097,9 @@ extern "C" {
 	    case HSPTOKEN_CGROUP_TRAFFIC:
 	      if((tok = expectONOFF(sp, tok, &sp->systemd.markTraffic)) == NULL) return NO;
 	      break;
+	    case HSPTOKEN_CGROUP2:
+	      if((tok = expectONOFF(sp, tok, &sp->systemd.cgroup2)) == NULL) return NO;
+	      break;
 	    default:
 	      unexpectedToken(sp, tok, level[depth]);
 	      return NO;
@@ -2055,6 +2119,41 @@ extern "C" {
 	  }
 	  break;
 
+	case HSPOBJ_GOVERNOR:
+	  {
+	    switch(tok->stok) {
+	    case HSPTOKEN_CPU:
+	      if((tok = expectDouble(sp, tok, &sp->governor.cpu, 0.01, 100.0)) == NULL) return NO;
+	      break;
+	    case HSPTOKEN_INTERVAL:
+	      if((tok = expectInteger32(sp, tok, &sp->governor.interval, 1, 3600)) == NULL) return NO;
+	      break;
+	    default:
+	      unexpectedToken(sp, tok, level[depth]);
+	      return NO;
+	      break;
+	    }
+	  }
+	  break;
+
+	case HSPOBJ_PROMETHEUS:
+	  {
+	    switch(tok->stok) {
+	    case HSPTOKEN_TCPPORT:
+	      // 0 means unix socket only
+	      if((tok = expectInteger32(sp, tok, &sp->prometheus.port, 0, 65535)) == NULL) return NO;
+	      break;
+	    case HSPTOKEN_PATH:
+	      if((tok = expectString(sp, tok, &sp->prometheus.path, "unix socket path")) == NULL) return NO;
+	      break;
+	    default:
+	      unexpectedToken(sp, tok, level[depth]);
+	      return NO;
+	      break;
+	    }
+	  }
+	  break;
+
 	default:
 	  parseError(sp, tok, "unexpected state", "");
 	}
@@ -6,6 +6,7 @@
 extern "C" {
 #endif
 
+#define HSP_TIMING_NAMES 1
 #include "hsflowd.h"
 #include "cpu_utils.h"
 #include "cJSON.h"
@@ -26,7 +27,6 @@ extern "C" {
 
   static void openCollectorSockets(HSP *sp, HSPSFlowSettings *settings);
   static bool installSFlowSettings(HSP *sp, HSPSFlowSettings *settings);
-  static bool updatePollingInterval(HSP *sp);
   static void openLogFile(HSP *sp);
   
   /*_________________---------------------------__________________
@@ -50,6 +50,65 @@ extern "C" {
     myLog(LOG_ERR, "sflow agent error: %s", msg);
   }
 
+  /*_________________---------------------------__________________
+    _________________    telemetryLatency       __________________
+    -----------------___________________________------------------
+    Bump one of a run of decade bins (10uS, 100uS ... 10S, inf)
+    followed by a running total in uS.
+  */
+
+  void telemetryLatency(HSP *sp, EnumHSPTelemetry bin0, struct timespec *t1, struct timespec *t2) {
+    int64_t nS = ((int64_t)(t2->tv_sec - t1->tv_sec) * 1000000000)
+      + (t2->tv_nsec - t1->tv_nsec);
+    uint64_t uS = (nS > 0) ? (nS / 1000) : 0;
+    uint64_t limit = 10;
+    int bin = 0;
+    for(; bin < 7; bin++, limit *= 10) {
+      if(uS <= limit)
+	break;
+    }
+    sp->telemetry[bin0 + bin]++;
+    sp->telemetry[bin0 + 8] += uS;
+  }
+
+  /*_________________---------------------------__________________
+    _________________     timingStart/End       __________________
+    -----------------___________________________------------------
+    No locking: apart from one-off calls at startup, the timed
+    code paths all run on the poll bus.
+  */
+
+  void timingStart(HSP *sp, struct timespec *wall0, struct timespec *cpu0) {
+    if(sp->instrument)
+      EVStatsStart(wall0, cpu0);
+  }
+
+  void timingEnd(HSP *sp, EnumHSPTiming tm, struct timespec *wall0, struct timespec *cpu0) {
+    if(sp->instrument)
+      EVStatsEnd(&sp->timing[tm], wall0, cpu0);
+  }
+
+  static void timingPrint(HSP *sp, FILE *out) {
+    for(int ii = 0; ii < HSP_TIMING_NUM; ii++) {
+      EVStats *stats = &sp->timing[ii];
+      if(stats->calls == 0)
+	continue;
+      fprintf(out, "timing   %-22s calls=%"PRIu64" wall_uS=%"PRIu64" cpu_uS=%"PRIu64" mean_wall_uS=%"PRIu64" mean_cpu_uS=%"PRIu64"\n",
+	      HSPTimingNames[ii],
+	      stats->calls,
+	      stats->wall_nS / 1000,
+	      stats->cpu_nS / 1000,
+	      stats->wall_nS / stats->calls / 1000,
+	      stats->cpu_nS / stats->calls / 1000);
+    }
+    UTBatchRead *br = sp->pollBatch;
+    fprintf(out, "timing   pollBatch batches=%"PRIu64" reads=%"PRIu64" missed=%"PRIu64"\n",
+	    br->batches,
+	    br->reads,
+	    br->missed);
+    fflush(out);
+  }
+
   static void agentCB_sendPkt(void *magic, SFLAgent *agent, SFLReceiver *receiver, u_char *pkt, uint32_t pktLen)
   {
     HSP *sp = (HSP *)magic;
@@ -66,6 +125,16 @@ extern "C" {
       return;
 
     sp->telemetry[HSP_TELEMETRY_DATAGRAMS]++;
+
+    // how long did the first sample sit in this datagram?  The
+    // agent 'now' comes from bus->now so use the same clock here.
+    time_t first_S, first_nS;
+    sfl_receiver_get_firstSampleTime(receiver, &first_S, &first_nS);
+    struct timespec ts_first = { .tv_sec = first_S, .tv_nsec = first_nS };
+    struct timespec ts_now;
+    EVClockMono(&ts_now);
+    telemetryLatency(sp, HSP_TELEMETRY_DATAGRAM_FILL_10US, &ts_first, &ts_now);
+
     if(debug(2)) {
       myDebug(2, "mS=%u agentCB_sendPkt() sending datagram: %u",
 	      EVBusRunningTime_mS(EVCurrentBus()),
@@ -439,10 +508,14 @@ extern "C" {
   static void agentCB_getCounters_request(void *magic, SFLPoller *poller, SFL_COUNTERS_SAMPLE_TYPE *cs)
   {
     HSP *sp = (HSP *)poller->magic;
-    UTArrayAdd(sp->pollActions, poller);
-    UTArrayAdd(sp->pollActions, agentCB_getCounters);
+    addPollAction(sp, poller, agentCB_getCounters, 0);
     // Note readPackets.c uses this mechanism too (for switch port
     // pollers), but other mods use their own array.
+    if(poller == sp->poller) {
+      hspProcFilesPrefetch(sp->pollBatch);
+      // the host counters will want every interface refreshed
+      sp->nio_due_full = YES;
+    }
   }
 
   /*_________________---------------------------__________________
@@ -684,6 +757,226 @@ extern "C" {
     }
   }
 
+  /*_________________---------------------------__________________
+    _________________    adaptive polling       __________________
+    -----------------___________________________------------------
+    Opt-in with pollIdle=N.  When a virtual interface or docker
+    container poller comes due it is given a cheap activity
+    fingerprint: the packet counts already held for its interfaces
+    plus the number of packet samples taken on them,  and for a
+    container its cgroup v2 cpu and memory totals too.  (containerd
+    and k8s are left alone:  their helper has already collected the
+    stats by the time we see them.)  After N due times with no change
+    it starts skipping,  doubling its effective interval each time
+    up to pollIdleMax seconds,  and any change puts it straight back
+    to the base interval.  A skipped poll sends nothing,  so the
+    counter-sample sequence numbers stay contiguous and a collector
+    never sees a discontinuity that was not there.
+  */
+
+  uint64_t adaptorActivity(HSP *sp, SFLAdaptor *adaptor) {
+    // the container end of a veth pair is not in the global namespace,
+    // so its counters and samples are found on the peer.
+    SFLAdaptor *global = adaptorByPeerIndex(sp, adaptor->ifIndex) ?: adaptor;
+    HSPAdaptorNIO *nio = ADAPTOR_NIO(global);
+    return nio->nio.pkts_in + nio->nio.pkts_out + nio->samples;
+  }
+
+  bool pollBackoff(HSP *sp, HSPPollBackoff *bo, SFLPoller *poller, uint64_t activity) {
+    if(sp->pollIdle == 0)
+      return NO;
+    if(activity != bo->activity) {
+      if(bo->skip)
+	myDebug(2, "pollBackoff: dsIndex=%u active again", SFL_DS_INDEX(poller->dsi));
+      bo->activity = activity;
+      bo->idle = 0;
+      bo->skip = 0;
+      bo->skipped = 0;
+      return NO;
+    }
+    if(bo->skipped < bo->skip) {
+      bo->skipped++;
+      return YES;
+    }
+    bo->skipped = 0;
+    if(++bo->idle >= sp->pollIdle) {
+      uint32_t interval = sfl_poller_get_sFlowCpInterval(poller) ?: 1;
+      uint32_t maxSkip = sp->pollIdleMax / interval;
+      if(maxSkip)
+	maxSkip--;
+      bo->skip = (bo->skip * 2) + 1;
+      if(bo->skip > maxSkip)
+	bo->skip = maxSkip;
+      myDebug(2, "pollBackoff: dsIndex=%u idle=%u skip=%u",
+	      SFL_DS_INDEX(poller->dsi),
+	      bo->idle,
+	      bo->skip);
+    }
+    return NO;
+  }
+
+  // A container with no cgroup v2 stats to go by is never judged
+  // idle:  it could be busy without touching the network.
+  bool pollBackoffVM(HSP *sp, HSPVMState *state, HSPCgroup *cg) {
+    if(sp->pollIdle == 0
+       || state->poller == NULL
+       || cg == NULL)
+      return NO;
+    HSPCgroupStats *st = hspCgroupStats(sp, cg);
+    if(st == NULL
+       || !st->gotCPU)
+      return NO;
+    uint64_t activity = st->cpu_uS + st->mem;
+    SFLAdaptor *ad;
+    ADAPTORLIST_WALK(state->interfaces, ad)
+      activity += adaptorActivity(sp, ad);
+    return pollBackoff(sp, &state->backoff, state->poller, activity);
+  }
+
+  /*_________________---------------------------__________________
+    _________________    poll actions           __________________
+    -----------------___________________________------------------
+    The pollers that come due on a tick are queued here and run in
+    slots: as many as fit in pollBudget mS (going by the average
+    cost so far) on the tick itself,  and the rest on the deci ticks
+    after it.  Anything still left when the next tick comes is run
+    then,  before the new ones.
+  */
+
+  void addPollAction(HSP *sp, SFLPoller *poller, getCountersFn_t getCountersFn, uint32_t group) {
+    UTArrayAdd(sp->pollActions, poller);
+    UTArrayAdd(sp->pollActions, getCountersFn);
+    UTArrayAdd(sp->pollActions, (void *)(uintptr_t)group);
+  }
+
+  static uint32_t pollActionGroup(HSP *sp, uint32_t idx) {
+    return (uint32_t)(uintptr_t)UTArrayAt(sp->pollActions, (idx * HSP_POLL_ACTION_N) + 2);
+  }
+
+  // Move the members of each group up to sit with the first one,  so
+  // that a slot boundary can only fall between groups.
+  static void groupPollActions(HSP *sp) {
+    uint32_t nActions = UTArrayN(sp->pollActions) / HSP_POLL_ACTION_N;
+    bool grouped = NO;
+    for(uint32_t ii = 0; ii < nActions; ii++) {
+      if(pollActionGroup(sp, ii)) {
+	grouped = YES;
+	break;
+      }
+    }
+    if(!grouped)
+      return;
+    UTArray *sorted = UTArrayNew(UTARRAY_DFLT);
+    bool *taken = (bool *)my_calloc(nActions * sizeof(bool));
+    for(uint32_t ii = 0; ii < nActions; ii++) {
+      if(taken[ii])
+	continue;
+      uint32_t group = pollActionGroup(sp, ii);
+      for(uint32_t jj = ii; jj < nActions; jj++) {
+	if(jj == ii
+	   || (group
+	       && !taken[jj]
+	       && pollActionGroup(sp, jj) == group)) {
+	  taken[jj] = YES;
+	  for(uint32_t kk = 0; kk < HSP_POLL_ACTION_N; kk++)
+	    UTArrayAdd(sorted, UTArrayAt(sp->pollActions, (jj * HSP_POLL_ACTION_N) + kk));
+	}
+	if(group == 0)
+	  break;
+      }
+    }
+    UTArrayReset(sp->pollActions);
+    UTArrayAddAll(sp->pollActions, sorted);
+    UTArrayFree(sorted);
+    my_free(taken);
+  }
+
+  static void runPollActions(HSP *sp, bool all) {
+    uint32_t nActions = UTArrayN(sp->pollActions) / HSP_POLL_ACTION_N;
+    uint32_t first = sp->pollActionsNext;
+    if(first >= nActions)
+      return;
+    uint32_t last = nActions;
+    if(!all
+       && sp->pollBudget_mS
+       && sp->pollActionCost_nS) {
+      uint64_t fit = ((uint64_t)sp->pollBudget_mS * 1000000) / sp->pollActionCost_nS;
+      if(fit < (nActions - first)) {
+	last = first + (fit ?: 1);
+	// don't split a group
+	while(last < nActions
+	      && pollActionGroup(sp, last)
+	      && pollActionGroup(sp, last) == pollActionGroup(sp, last - 1))
+	  last++;
+      }
+    }
+    sp->pollActionsNext = last;
+
+    struct timespec slot0, slot1, tm_wall0, tm_cpu0;
+    // (EVClockMono() is too coarse for this)
+    clock_gettime(CLOCK_MONOTONIC, &slot0);
+    timingStart(sp, &tm_wall0, &tm_cpu0);
+
+    // the interface pollers in this slot share one /proc/net/dev read
+    for(uint32_t ii = first; ii < last; ii++) {
+      SFLPoller *poller = (SFLPoller *)UTArrayAt(sp->pollActions, ii * HSP_POLL_ACTION_N);
+      // interface pollers have the device name as userData (see getPoller)
+      if(poller->dsi.ds_class == SFL_DSCLASS_IFINDEX
+	 && poller->userData) {
+	SFLAdaptor *adaptor = adaptorByName(sp, (char *)poller->userData);
+	if(adaptor) {
+	  HSPAdaptorNIO *adaptorNIO = ADAPTOR_NIO(adaptor);
+	  if(adaptorNIO->procNetDev
+	     && !adaptorNIO->nio_due) {
+	    adaptorNIO->nio_due = YES;
+	    sp->nio_due++;
+	  }
+	}
+      }
+    }
+    time_t clk = sp->pollBus->now.tv_sec;
+    bool fullRefresh = sp->nio_due_full
+      || (sp->nio_polling_secs && clk >= sp->next_nio_poll);
+    updateNioCountersDue(sp, fullRefresh);
+    sp->nio_due_full = NO;
+
+    for(uint32_t ii = first; ii < last; ii++) {
+      SFLPoller *poller = (SFLPoller *)UTArrayAt(sp->pollActions, ii * HSP_POLL_ACTION_N);
+      getCountersFn_t cb = (getCountersFn_t)UTArrayAt(sp->pollActions, (ii * HSP_POLL_ACTION_N) + 1);
+      SFL_COUNTERS_SAMPLE_TYPE cs;
+      memset(&cs, 0, sizeof(cs));
+      (cb)((void *)sp, poller, &cs);
+    }
+
+    // feed the per-action cost back in for sizing the next slot
+    clock_gettime(CLOCK_MONOTONIC, &slot1);
+    uint64_t slot_nS = EVTimeDiff_nS(&slot0, &slot1);
+    uint64_t cost_nS = (slot_nS / (last - first)) ?: 1;
+    sp->pollActionCost_nS = sp->pollActionCost_nS
+      ? ((sp->pollActionCost_nS * 7) + cost_nS) / 8
+      : cost_nS;
+    timingEnd(sp, HSP_TIMING_POLL_ACTIONS, &tm_wall0, &tm_cpu0);
+  }
+
+  /*_________________---------------------------__________________
+    _________________     pollBatchDone         __________________
+    -----------------___________________________------------------
+    The tick's batch reads are for the poll actions too,  so the
+    round can only end once the tock has passed (the modules read
+    theirs there) and the last slot has run.  Ending it at the tock
+    would make the actions deferred to the deci slots read all their
+    files again,  one at a time.
+  */
+
+  static void pollBatchDone(HSP *sp) {
+    if(sp->pollActionsNext < UTArrayN(sp->pollActions) / HSP_POLL_ACTION_N) {
+      sp->pollBatchPending = YES;
+      return;
+    }
+    UTBatchReadDone(sp->pollBatch);
+    sp->pollBatchPending = NO;
+  }
+
   /*_________________---------------------------__________________
     _________________       tick                __________________
     -----------------___________________________------------------
@@ -699,8 +992,19 @@ extern "C" {
 
     time_t clk = evt->bus->now.tv_sec;
 
-    // reset the pollActions
+    if(sp->dumpEVStats) {
+      sp->dumpEVStats = NO;
+      EVStatsPrint(mod, getDebugOut());
+      if(sp->instrument)
+	timingPrint(sp, getDebugOut());
+    }
+
+    // finish last second's poll actions,  then reset
+    runPollActions(sp, YES);
+    if(sp->pollBatchPending)
+      pollBatchDone(sp);
     UTArrayReset(sp->pollActions);
+    sp->pollActionsNext = 0;
 
     // send a tick to the sFlow agent. This will be passed on
     // to the samplers, pollers and receiver.  If the poller is
@@ -746,15 +1050,20 @@ extern "C" {
     // So we don't need to worry about them being freed under
     // our feet below.
 
-    // now we can execute them without holding on to the semaphore
-    for(uint32_t ii = 0; ii < UTArrayN(sp->pollActions); ii += 2) {
-      SFLPoller *poller = (SFLPoller *)UTArrayAt(sp->pollActions, ii);
-      getCountersFn_t cb = (getCountersFn_t)UTArrayAt(sp->pollActions, ii+1);
-      SFL_COUNTERS_SAMPLE_TYPE cs;
-      memset(&cs, 0, sizeof(cs));
-      (cb)((void *)sp, poller, &cs);
+    // The poller callbacks may have queued up file reads (the host
+    // /proc files, container cgroups).  Do them all together now.
+    if(UTArrayN(sp->pollBatch->files)) {
+      struct timespec tm_wall0, tm_cpu0;
+      timingStart(sp, &tm_wall0, &tm_cpu0);
+      UTBatchReadRun(sp->pollBatch);
+      timingEnd(sp, HSP_TIMING_POLL_BATCH, &tm_wall0, &tm_cpu0);
     }
 
+    // now we can execute them without holding on to the semaphore,
+    // or at least the first slot's worth of them (see runPollActions)
+    groupPollActions(sp);
+    runPollActions(sp, NO);
+
     // possibly poll the nio counters to avoid 32-bit rollover
     if(sp->nio_polling_secs &&
        clk >= sp->next_nio_poll) {
@@ -778,6 +1087,9 @@ extern "C" {
       refreshAdaptorsAndAgentAddress(sp);
     }
 
+    // close cgroups that the container modules stopped asking about
+    hspCgroupSweep(sp);
+
     // rewrite the output if the config has changed
     if(sp->outputRevisionNo != sp->revisionNo) {
       syncOutputFile(sp);
@@ -786,6 +1098,22 @@ extern "C" {
 
   }
 
+  /*_________________---------------------------__________________
+    _________________       deci                __________________
+    -----------------___________________________------------------
+  */
+
+  static void evt_poll_deci(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    if(sp->pollActionsNext < UTArrayN(sp->pollActions) / HSP_POLL_ACTION_N) {
+      runPollActions(sp, NO);
+      if(sp->pollBatchPending)
+	pollBatchDone(sp);
+      // the tock flush has already happened for this second
+      flushCounters(mod);
+    }
+  }
+
   /*_________________---------------------------__________________
     _________________    flushCounters          __________________
     -----------------___________________________------------------
@@ -817,6 +1145,9 @@ extern "C" {
 
   static void evt_poll_tock(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
     HSP *sp = (HSP *)EVROOTDATA(mod);
+    // the modules have had their chance to use this tick's batch reads,
+    // but the poll actions may still have slots to run
+    pollBatchDone(sp);
     // we registered for this event after the other modules were loaded,  so
     // unless they delay their registration for some reason we can assume
     // that this is the last tock() action.  (Could add another event to the
@@ -892,6 +1223,72 @@ extern "C" {
     }
   }
 
+  /*_________________---------------------------__________________
+    _________________     mount points          __________________
+    -----------------___________________________------------------
+    Set once from the command line, before any threads start,
+    so no locking is needed to read them.
+  */
+
+  static char *HSPFSNames[HSP_FS_NUM] = { "proc", "sys", "etc", "var" };
+  static char *HSPFSPrefix[HSP_FS_NUM] = { PROCFS_STR, SYSFS_STR, ETCFS_STR, VARFS_STR };
+
+  char *hspFS(EnumHSPFS fs) {
+    return HSPFSPrefix[fs];
+  }
+
+  char *hspFSPath(char *buf, size_t bufLen, EnumHSPFS fs, char *fmt, ...) {
+    int len = snprintf(buf, bufLen, "%s", HSPFSPrefix[fs]);
+    if(len < bufLen) {
+      va_list args;
+      va_start(args, fmt);
+      vsnprintf(buf + len, bufLen - len, fmt, args);
+      va_end(args);
+    }
+    return buf;
+  }
+
+  // Open on first use, then re-read.  Returns NULL if the file
+  // could not be read this time.  The mount points must not change
+  // after the first call, which is why -F is command-line only.
+  // ppf must be static - it is remembered so that the host poller
+  // can batch these reads (see hspProcFilesPrefetch).
+  static UTArray *HSPProcFiles;
+
+  UTProcFile *hspProcFileRead(UTProcFile **ppf, EnumHSPFS fs, char *name, size_t bufLen, size_t maxLen) {
+    if(*ppf == NULL) {
+      char path[HSP_MAX_PATHLEN];
+      *ppf = UTProcFileNew(hspFSPath(path, HSP_MAX_PATHLEN, fs, "%s", name), bufLen, maxLen);
+      if(HSPProcFiles == NULL)
+	HSPProcFiles = UTArrayNew(UTARRAY_DFLT);
+      UTArrayAdd(HSPProcFiles, ppf);
+    }
+    return UTProcFileRead(*ppf) ? *ppf : NULL;
+  }
+
+  void hspProcFilesPrefetch(UTBatchRead *br) {
+    if(HSPProcFiles == NULL)
+      return;
+    UTProcFile **ppf;
+    UTARRAY_WALK(HSPProcFiles, ppf)
+      UTBatchReadAdd(br, *ppf);
+  }
+
+  static bool setFS(char *arg) {
+    // expect <name>=<path>, e.g. proc=/tmp/fixture/proc
+    char *eq = strchr(arg, '=');
+    if(eq == NULL)
+      return NO;
+    for(int ii = 0; ii < HSP_FS_NUM; ii++) {
+      if(my_strlen(HSPFSNames[ii]) == (eq - arg)
+	 && strncmp(arg, HSPFSNames[ii], eq - arg) == 0) {
+	HSPFSPrefix[ii] = eq + 1;
+	return YES;
+      }
+    }
+    return NO;
+  }
+
   /*_________________---------------------------__________________
     _________________     setDefaults           __________________
     -----------------___________________________------------------
@@ -899,13 +1296,17 @@ extern "C" {
 
   static void setDefaults(HSP *sp)
   {
-    sp->configFile = HSP_DEFAULT_CONFIGFILE;
-    sp->outputFile = HSP_DEFAULT_OUTPUTFILE;
-    sp->pidFile = HSP_DEFAULT_PIDFILE;
+    // configFile, outputFile and pidFile defaults depend on
+    // the mount points, so they are filled in after the
+    // command line has been read (see setFSDefaults)
     sp->crashFile = NULL;
     sp->dropPriv = YES;
     sp->refreshAdaptorListSecs = HSP_REFRESH_ADAPTORS;
     sp->checkAdaptorListSecs = HSP_CHECK_ADAPTORS;
+    sp->pollBudget_mS = HSP_POLL_BUDGET_MS;
+    sp->pollIdleMax = HSP_POLL_IDLE_MAX;
+    sp->sfp.threads = HSP_SFP_THREADS;
+    sp->sfp.refreshSecs = HSP_SFP_REFRESH_SECS;
     sp->refreshVMListSecs = HSP_REFRESH_VMS;
     sp->forgetVMSecs = HSP_FORGET_VMS;
     sp->modulesPath = STRINGIFY_DEF(HSP_MOD_DIR);
@@ -919,7 +1320,7 @@ extern "C" {
 
   static void instructions(char *command)
   {
-    fprintf(stderr,"Usage: %s [-dvP] [-p PIDFile] [-u UUID] [-m machine_id] [-f CONFIGFile] [-l MODULESDir] [-D LOGFile] [-L LOGBytes]\n", command);
+    fprintf(stderr,"Usage: %s [-dvP] [-p PIDFile] [-u UUID] [-m machine_id] [-f CONFIGFile] [-l MODULESDir] [-D LOGFile] [-L LOGBytes] [-F MOUNT=PATH]\n", command);
     fprintf(stderr,"\n\
              -d:  do not daemonize, and log to stdout/LOGFile (repeat for more debug details)\n\
      -D LOGFile:  debug logging goes to this file\n\
@@ -930,7 +1331,9 @@ extern "C" {
         -u UUID:  specify UUID as unique ID for this host\n\
   -f CONFIGFile:  specify config file (default is " HSP_DEFAULT_CONFIGFILE ")\n\
   -l MODULESDir:  specify modules directory (default is " STRINGIFY_DEF(HSP_MOD_DIR) ")\n \
-   -c CRASHFile:  specify file to write crash info to (default is stderr)\n");
+   -c CRASHFile:  specify file to write crash info to (default is stderr)\n\
+  -F MOUNT=PATH:  override a mount point, where MOUNT is proc, sys, etc or var\n\
+                 (defaults are " PROCFS_STR ", " SYSFS_STR ", " ETCFS_STR " and " VARFS_STR ")\n");
   fprintf(stderr, "=============== More Information ============================================\n");
   fprintf(stderr, "| sFlow standard        - http://www.sflow.org                              |\n");
   fprintf(stderr, "| sFlowTrend (FREE)     - http://www.inmon.com/products/sFlowTrend.php      |\n");
@@ -939,6 +1342,17 @@ extern "C" {
     exit(EXIT_FAILURE);
   }
 
+  static void setFSDefaults(HSP *sp)
+  {
+    char path[HSP_MAX_PATHLEN];
+    if(sp->configFile == NULL)
+      sp->configFile = my_strdup(hspFSPath(path, HSP_MAX_PATHLEN, HSP_FS_ETC, "/hsflowd.conf"));
+    if(sp->outputFile == NULL)
+      sp->outputFile = my_strdup(hspFSPath(path, HSP_MAX_PATHLEN, HSP_FS_ETC, "/hsflowd.auto"));
+    if(sp->pidFile == NULL)
+      sp->pidFile = my_strdup(hspFSPath(path, HSP_MAX_PATHLEN, HSP_FS_VAR, "/run/hsflowd.pid"));
+  }
+
   /*_________________---------------------------__________________
     _________________   processCommandLine      __________________
     -----------------___________________________------------------
@@ -947,7 +1361,7 @@ extern "C" {
   static void processCommandLine(HSP *sp, int argc, char *argv[])
   {
     int in;
-    while ((in = getopt(argc, argv, "dvPp:f:l:o:u:m:?hc:D:L:")) != -1) {
+    while ((in = getopt(argc, argv, "dvPp:f:l:o:u:m:?hc:D:L:F:")) != -1) {
       switch(in) {
       case 'v':
 	printf("%s version %s\n", argv[0], STRINGIFY_DEF(HSP_VERSION));
@@ -967,6 +1381,12 @@ extern "C" {
       case 'c': sp->crashFile = optarg; break;
       case 'D': sp->logFile = optarg; break;
       case 'L': sp->logBytes = optarg; break;
+      case 'F':
+	if(setFS(optarg) == NO) {
+	  fprintf(stderr, "bad mount point (expected proc|sys|etc|var=PATH): %s\n", optarg);
+	  instructions(*argv);
+	}
+	break;
       case 'u':
 	if(parseUUID(optarg, sp->uuid) == NO) {
 	  fprintf(stderr, "bad UUID format: %s\n", optarg);
@@ -1046,6 +1466,8 @@ extern "C" {
 #if (__GLIBC__ >= 2 && __GLIBC_MINOR__ >= 13)
       malloc_info(0, getDebugOut());
 #endif
+      // event stats are dumped from the poll thread at the next tick
+      sp->dumpEVStats = YES;
       break;
     case SIGUSR2:
       myLog(LOG_INFO,"Received SIGUSR2");
@@ -1154,7 +1576,7 @@ extern "C" {
       // switch namespace now
       // (1) open /var/run/netns/<namespace>
       char topath[HSP_MAX_NETNS_PATH];
-      snprintf(topath, HSP_MAX_NETNS_PATH, VARFS_STR "/run/netns/%s", coll->namespace);
+      snprintf(topath, HSP_MAX_NETNS_PATH, "%s/run/netns/%s", hspFS(HSP_FS_VAR), coll->namespace);
       int nsfd = open(topath, O_RDONLY | O_CLOEXEC);
       if(nsfd < 0) {
 	myLog(LOG_ERR, "cannot open %s : %s", topath, strerror(errno));
@@ -1442,7 +1864,7 @@ extern "C" {
     -----------------___________________________------------------
   */
 
-  static bool updatePollingInterval(HSP *sp) {
+  bool updatePollingInterval(HSP *sp) {
     if(sp->sFlowSettings == NULL) {
       // don't set actualPollingInterval until we have a config
       // -- e.g. in case it is set to 0 rather than the default.
@@ -1459,6 +1881,13 @@ extern "C" {
       myDebug(1, "override polling interval to min: %u", pollingInterval);
     }
 
+    // mod_governor may be stretching it out to shed load
+    if(pollingInterval > 0
+       && sp->governor.pollingFactor > 1) {
+      pollingInterval *= sp->governor.pollingFactor;
+      myDebug(1, "governor stretched polling interval to: %u", pollingInterval);
+    }
+
     if(pollingInterval != sp->actualPollingInterval) {
       // store for all to use
       sp->actualPollingInterval = pollingInterval;
@@ -1860,6 +2289,7 @@ extern "C" {
 
     // read the command line
     processCommandLine(sp, argc, argv);
+    setFSDefaults(sp);
 
     // log file may have been specified
     openLogFile(sp);
@@ -2154,9 +2584,19 @@ extern "C" {
     // initialize event bus
     sp->rootModule = EVInit(sp);
 
+    // optional per-event and per-socket dispatch accounting
+    if(sp->instrument)
+      EVInstrument(sp->rootModule, YES);
+
     // convenience ptr to the poll-bus
     sp->pollBus = EVGetBus(sp->rootModule, HSPBUS_POLL, YES);
 
+    // batched reads for counter polling
+    sp->pollBatch = UTBatchReadNew();
+
+    // worker buses for the optical module EEPROM reads
+    initSFPWorkers(sp);
+
     // Events are going to be exchanged through this bus even before we start it running,
     // so have to make sure EVCurrentBus() is correct. Otherwise all events will be queued
     // as inter-thread events (changing the execution sequence).  For example, it is
@@ -2236,9 +2676,15 @@ extern "C" {
       EVLoadModule(sp->rootModule, "mod_systemd", sp->modulesPath);
     if(sp->eapi.eapi)
       EVLoadModule(sp->rootModule, "mod_eapi", sp->modulesPath);
+    if(sp->governor.governor)
+      EVLoadModule(sp->rootModule, "mod_governor", sp->modulesPath);
+    if(sp->prometheus.prometheus)
+      EVLoadModule(sp->rootModule, "mod_prometheus", sp->modulesPath);
 
     EVEventRx(sp->rootModule, EVGetEvent(sp->pollBus, EVEVENT_TICK), evt_poll_tick);
     EVEventRx(sp->rootModule, EVGetEvent(sp->pollBus, EVEVENT_TOCK), evt_poll_tock);
+    if(sp->pollBudget_mS)
+      EVEventRx(sp->rootModule, EVGetEvent(sp->pollBus, EVEVENT_DECI), evt_poll_deci);
 
     if(sp->DNSSD.DNSSD) {
       EVLoadModule(sp->rootModule, "mod_dnssd", sp->modulesPath);
@@ -81,11 +81,27 @@ extern "C" {
     linkedlist = obj; \
   } while(0)
 
+  // PROCFS etc. are the compile-time defaults for these mount
+  // points. Use hspFS() or hspFSPath() to get the runtime value,
+  // which may be overridden with -F on the command line.
 #define PROCFS_STR STRINGIFY_DEF(PROCFS)
 #define SYSFS_STR STRINGIFY_DEF(SYSFS)
 #define ETCFS_STR STRINGIFY_DEF(ETCFS)
 #define VARFS_STR STRINGIFY_DEF(VARFS)
 
+  typedef enum {
+    HSP_FS_PROC=0,
+    HSP_FS_SYS,
+    HSP_FS_ETC,
+    HSP_FS_VAR,
+    HSP_FS_NUM
+  } EnumHSPFS;
+
+  char *hspFS(EnumHSPFS fs);
+  char *hspFSPath(char *buf, size_t bufLen, EnumHSPFS fs, char *fmt, ...);
+  UTProcFile *hspProcFileRead(UTProcFile **ppf, EnumHSPFS fs, char *name, size_t bufLen, size_t maxLen);
+  void hspProcFilesPrefetch(UTBatchRead *br);
+
 #define HSP_DAEMON_NAME "hsflowd"
 #define HSP_DEFAULT_PIDFILE VARFS_STR "/run/hsflowd.pid"
 #define HSP_DEFAULT_CONFIGFILE ETCFS_STR "/hsflowd.conf"
@@ -109,6 +125,12 @@ extern "C" {
 #define HSP_FORGET_VMS 180
 #define HSP_REFRESH_ADAPTORS 180
 #define HSP_CHECK_ADAPTORS 10
+#define HSP_SFP_THREADS 1
+#define HSP_SFP_MAX_THREADS 16
+#define HSP_SFP_REFRESH_SECS 60
+#define HSP_SFP_REQUEST_TIMEOUT 300
+#define HSP_JSON_MAX_THREADS 16
+#define HSP_JSON_MAX_RTMETRIC_WINDOW 3600
 #define HSP_RETRY_COLLECTOR_SOCKET 7
 
 #define HSP_MAX_PATHLEN 256
@@ -173,6 +195,10 @@ extern "C" {
     bool speed_set;
     uint32_t sampling_n;
     bool sampling_n_set;
+    // offline replay (benchmarking)
+    char *file;
+    uint32_t rate;
+    bool loop;
   } HSPPcap;
 
   typedef struct _HSPPort {
@@ -245,6 +271,14 @@ extern "C" {
     uint8_t has_minor:1;
   } HSPGpuID;
 
+  // adaptive polling state for one data source (see pollBackoff)
+  typedef struct _HSPPollBackoff {
+    uint64_t activity; // last fingerprint
+    uint32_t idle;     // due times without change
+    uint32_t skip;     // current number of due times to skip
+    uint32_t skipped;
+  } HSPPollBackoff;
+
   typedef struct _HSPVMState {
     char uuid[16];
     EnumVMType vmType;
@@ -256,6 +290,7 @@ extern "C" {
     UTStringArray *disks;
     UTArray *gpus;
     SFLPoller *poller;
+    HSPPollBackoff backoff;
   } HSPVMState;
 
   typedef enum { IPSP_NONE=0,
@@ -319,6 +354,8 @@ extern "C" {
     bool opxPort:1;
     bool vm_or_container:1;
     bool modinfo_tested:1;
+    bool sfp_pending:1;
+    bool nio_due:1;
     bool ethtool_GDRVINFO:1;
     bool ethtool_GMODULEINFO:1;
     bool ethtool_GLINKSETTINGS:1;
@@ -359,6 +396,7 @@ extern "C" {
     uint32_t modinfo_type;
     uint32_t modinfo_len;
     SFLSFP_counters sfp;
+    time_t sfp_requested; // refreshed by the sfp worker buses
     // LACP/bonding data
     SFLLACP_counters lacp;
     // switch ports that are sending individual interface
@@ -368,9 +406,13 @@ extern "C" {
     SFLSampler *sampler;
     uint32_t sampling_n;
     uint32_t sampling_n_set;
+    uint32_t samples; // packet samples taken (written on the packet bus)
+    HSPPollBackoff backoff;
     uint32_t netlink_drops;
     // allow psample to apply subsampling if n is unexpected
     uint32_t subSampleCount;
+    // and the same for mod_governor when it is shedding load
+    uint32_t governorSubSampleCount;
     // allow mod_xen to write regex-extracted fields here
     int xen_domid;
     int xen_netid;
@@ -398,6 +440,8 @@ extern "C" {
 #define HSPBUS_POLL "poll" // main thread
 #define HSPBUS_CONFIG "config" // DNS-SD
 #define HSPBUS_PACKET "packet" // pcap,ulog,nflog,json,tcp,psample packet processing
+#define HSPBUS_SFP "sfp" // sfp0,sfp1,... optical module EEPROM reads
+#define HSPBUS_JSON "json" // json0,json1,... sharded JSON UDP readers
 
 // The generic start,tick,tock,final,end events are defined in evbus.h
 #define HSPEVENT_HOST_COUNTER_SAMPLE "csample"   // (csample *) building counter-sample
@@ -416,12 +460,17 @@ extern "C" {
 #define HSPEVENT_INTF_SPEED "intf_speed"         // (adaptor *) interface speed change
 #define HSPEVENT_INTFS_CHANGED "intfs_changed"   // some interface(s) changed
 #define HSPEVENT_UPDATE_NIO "update_nio"         // (adaptor *) nio counter refresh
+#define HSPEVENT_SFP_REQUEST "sfp_request"       // (HSPSFPRead *) read optical module EEPROM
+#define HSPEVENT_SFP_RESULT "sfp_result"         // (HSPSFPRead *) optical module stats read
 
   typedef struct _HSPPendingSample {
     SFL_FLOW_SAMPLE_TYPE *fs;
     SFLSampler *sampler;
     int refCount;
     UTArray *ptrsToFree;
+    // CLOCK_MONOTONIC at creation and at final release
+    struct timespec ts_created;
+    struct timespec ts_released;
     // cgroup (e.g. if looked up by INET_DIAG)
     uint64_t cgroup_id;
     // header decode
@@ -474,6 +523,32 @@ extern "C" {
     HSP_TELEMETRY_COUNTER_SAMPLES_SUPPRESSED,
     HSP_TELEMETRY_EVENT_SAMPLES,
     HSP_TELEMETRY_EVENT_SAMPLES_SUPPRESSED,
+    HSP_TELEMETRY_GOVERNOR_CPU_USECS,
+    HSP_TELEMETRY_GOVERNOR_CPU_PPM,
+    HSP_TELEMETRY_GOVERNOR_LEVEL,
+    HSP_TELEMETRY_GOVERNOR_ESCALATIONS,
+    HSP_TELEMETRY_GOVERNOR_RELAXATIONS,
+    HSP_TELEMETRY_GOVERNOR_SAMPLES_SHED,
+    // flow-sample queueing latency, creation to release (log-scale bins)
+    HSP_TELEMETRY_SAMPLE_LATENCY_10US,
+    HSP_TELEMETRY_SAMPLE_LATENCY_100US,
+    HSP_TELEMETRY_SAMPLE_LATENCY_1MS,
+    HSP_TELEMETRY_SAMPLE_LATENCY_10MS,
+    HSP_TELEMETRY_SAMPLE_LATENCY_100MS,
+    HSP_TELEMETRY_SAMPLE_LATENCY_1S,
+    HSP_TELEMETRY_SAMPLE_LATENCY_10S,
+    HSP_TELEMETRY_SAMPLE_LATENCY_INF,
+    HSP_TELEMETRY_SAMPLE_LATENCY_USECS,
+    // datagram fill latency, first sample to send (log-scale bins)
+    HSP_TELEMETRY_DATAGRAM_FILL_10US,
+    HSP_TELEMETRY_DATAGRAM_FILL_100US,
+    HSP_TELEMETRY_DATAGRAM_FILL_1MS,
+    HSP_TELEMETRY_DATAGRAM_FILL_10MS,
+    HSP_TELEMETRY_DATAGRAM_FILL_100MS,
+    HSP_TELEMETRY_DATAGRAM_FILL_1S,
+    HSP_TELEMETRY_DATAGRAM_FILL_10S,
+    HSP_TELEMETRY_DATAGRAM_FILL_INF,
+    HSP_TELEMETRY_DATAGRAM_FILL_USECS,
     HSP_TELEMETRY_NUM_COUNTERS
   } EnumHSPTelemetry;
 
@@ -488,10 +563,97 @@ extern "C" {
     "flow_samples_suppressed",
     "counter_samples_suppressed",
     "event_samples",
-    "event_samples_suppressed"
+    "event_samples_suppressed",
+    "governor_cpu_usecs",
+    "governor_cpu_ppm",
+    "governor_level",
+    "governor_escalations",
+    "governor_relaxations",
+    "governor_samples_shed",
+    "sample_latency_10us",
+    "sample_latency_100us",
+    "sample_latency_1ms",
+    "sample_latency_10ms",
+    "sample_latency_100ms",
+    "sample_latency_1s",
+    "sample_latency_10s",
+    "sample_latency_inf",
+    "sample_latency_usecs",
+    "datagram_fill_10us",
+    "datagram_fill_100us",
+    "datagram_fill_1ms",
+    "datagram_fill_10ms",
+    "datagram_fill_100ms",
+    "datagram_fill_1s",
+    "datagram_fill_10s",
+    "datagram_fill_inf",
+    "datagram_fill_usecs"
   };
 #endif
 
+  // timers for the counter-polling code paths that scale with the
+  // size of the host (interfaces, disks, processes), recorded when
+  // instrument=on and dumped on SIGUSR1 with the event-bus stats.
+  typedef enum {
+    HSP_TIMING_READ_INTERFACES=0,
+    HSP_TIMING_UPDATE_NIO,
+    HSP_TIMING_READ_DISK,
+    HSP_TIMING_SYSTEMD_PROCS,
+    HSP_TIMING_CGROUP_STATS,
+    HSP_TIMING_POLL_BATCH,
+    HSP_TIMING_POLL_ACTIONS,
+    HSP_TIMING_NUM
+  } EnumHSPTiming;
+
+#ifdef HSP_TIMING_NAMES
+  static const char *HSPTimingNames[] = {
+    "readInterfaces",
+    "updateNioCounters",
+    "readDiskCounters",
+    "systemdProcesses",
+    "cgroupStats",
+    "pollBatch",
+    "pollActions"
+  };
+#endif
+
+  // cgroup v1 controllers that the container modules look for
+  // (the v2 unified hierarchy is found separately)
+  typedef enum {
+    HSP_CGROUP_V1_SYSTEMD=0,
+    HSP_CGROUP_V1_CPUACCT,
+    HSP_CGROUP_V1_MEMORY,
+    HSP_CGROUP_V1_BLKIO,
+    HSP_CGROUP_V1_DEVICES,
+    HSP_CGROUP_V1_NUM
+  } EnumHSPCgroupV1;
+
+  // how often the container modules re-check /proc/<pid>/cgroup
+#define HSP_CGROUP_REFRESH_TIMEOUT 600
+
+  // totals for one cgroup v2 directory, as the kernel reports them
+  typedef struct _HSPCgroupStats {
+    uint64_t cpu_uS;   // cpu.stat usage_usec
+    uint64_t mem;      // memory.current
+    uint64_t mem_max;  // memory.max (0 if "max")
+    SFLHost_vrt_dsk_counters dsk; // io.stat summed over devices
+    bool gotCPU:1;
+    bool gotMem:1;
+    bool gotIO:1;
+  } HSPCgroupStats;
+
+  typedef struct _HSPCgroup {
+    uint64_t ino; // same as the cgroup_id from sock_diag or bpf
+    char *path; // relative to the cgroup2 mount
+    UTProcFile *pf_cpu;
+    UTProcFile *pf_mem;
+    UTProcFile *pf_mem_max;
+    UTProcFile *pf_io;
+    time_t lastRead;
+    time_t lastUsed;
+    HSPCgroupStats stats;
+  } HSPCgroup;
+
   typedef enum {
     HSP_VNODE_PRIORITY_SYSTEMD=1,
     HSP_VNODE_PRIORITY_DOCKER,
@@ -546,11 +708,16 @@ extern "C" {
       bool json;
       uint32_t port;
       char *FIFO;
+      uint32_t threads; // 0 = read UDP on the packet bus
+      char *ring; // shm_open() name,  see hsflow_ring.h
+      char *ringGroup; // writers' group,  NULL = only our own user
+      uint32_t rtmetricWindow; // seconds,  0 = send every rtmetric
     } json;
     struct {
       bool kvm;
       uint32_t refreshVMListSecs;
       uint32_t forgetVMSecs;
+      char *uri; // libvirt connection,  NULL for the default
     } kvm;
     struct {
       bool xen;
@@ -671,14 +838,53 @@ extern "C" {
       char *cgroup_procs;
       char *cgroup_acct;
       bool markTraffic;
+      bool cgroup2; // use cgroup v2 accounting when mounted
     } systemd;
     struct {
       bool eapi;
     } eapi;
+    struct {
+      bool governor;
+      double cpu; // budget as % of one core
+#define HSP_GOVERNOR_DEFAULT_CPU 2.0
+      uint32_t interval; // seconds between decisions
+#define HSP_GOVERNOR_DEFAULT_INTERVAL 10
+      // load-shedding state, set by mod_governor and
+      // consulted on the sample, poll and annotation paths
+      uint32_t level;
+      uint32_t subSampling;
+      uint32_t headerBytes;
+      uint32_t pollingFactor;
+      bool pauseAnnotators;
+    } governor;
+    struct {
+      bool prometheus;
+      uint32_t port; // 127.0.0.1 only
+#define HSP_PROMETHEUS_DEFAULT_PORT 9117
+      char *path; // unix socket
+    } prometheus;
 
     // hardware sampling flag
     bool hardwareSampling;
 
+    // event-bus dispatch instrumentation (dumped on SIGUSR1)
+    bool instrument;
+    bool dumpEVStats;
+    EVStats timing[HSP_TIMING_NUM];
+
+    // counter-polling reads that are batched together on each tick
+    UTBatchRead *pollBatch;
+
+    // shared cgroup accounting (see readCgroupCounters.c)
+    struct {
+      bool mountsRead;
+      char *v2_mount;
+      char *v1_mount[HSP_CGROUP_V1_NUM];
+      UTHash *byIno;
+      UTHash *byPath;
+      time_t lastSweep;
+    } cgroups;
+
     // daemon setup
     char *configFile;
     bool configOK;
@@ -707,8 +913,21 @@ extern "C" {
     UTHash *adaptorsByMac;
     bool allowDeleteAdaptor;
 
-    // poll actions for tick-tock cycle
+    // poll actions for tick-tock cycle,  stored as (poller, getCountersFn,
+    // group) triples.  They are run in slots of up to pollBudget mS,  the
+    // first on the tick and the rest on the deci ticks that follow,  and
+    // actions with the same non-zero group always share a slot.
     UTArray *pollActions;
+#define HSP_POLL_ACTION_N 3
+    uint32_t pollActionsNext;
+    bool pollBatchPending; // tock has passed but slots remain (see pollBatchDone)
+    uint32_t pollBudget_mS;
+#define HSP_POLL_BUDGET_MS 20
+    uint64_t pollActionCost_nS; // moving average
+    // adaptive polling (0 == off)
+    uint32_t pollIdle;
+    uint32_t pollIdleMax;
+#define HSP_POLL_IDLE_MAX 300
 
     // have to poll the NIO counters fast enough to avoid 32-bit rollover
     // of the bytes counters.  On a 10Gbps interface they can wrap in
@@ -717,6 +936,9 @@ extern "C" {
     // if it finds evidence that the counters are already 64-bit in the OS,
     // or if it decides that all interface speeds are limited to 1Gbps or less.
     time_t nio_last_update;
+    // interface pollers due on this tick share one /proc/net/dev pass
+    uint32_t nio_due;
+    bool nio_due_full;
     time_t nio_polling_secs;
 #define HSP_NIO_POLLING_SECS_32BIT 3
     time_t next_nio_poll;
@@ -735,6 +957,15 @@ extern "C" {
     uint32_t checkAdaptorListSecs; // poll interval
     time_t next_checkAdaptorList; // deadline
 
+    // optical module EEPROM reads are slow,  so they are handed
+    // to a pool of worker buses (see readNioCounters.c)
+    struct {
+      uint32_t threads; // 0 == read inline on the poll bus
+      uint32_t refreshSecs; // staleness before a re-read
+      UTArray *requestEvents; // one per sfp worker bus
+      EVEvent *resultEvent;
+    } sfp;
+
     bool refreshVMList; // request flag
     uint32_t refreshVMListSecs; // poll interval (default)
     uint32_t forgetVMSecs; // age-out idle VM or container (default)
@@ -798,10 +1029,28 @@ extern "C" {
   void syncBondPolling(HSP *sp);
   bool accumulateNioCounters(HSP *sp, SFLAdaptor *adaptor, SFLHost_nio_counters *ctrs, HSP_ethtool_counters *et_ctrs);
   void updateNioCounters(HSP *sp, SFLAdaptor *adaptor);
+  void updateNioCountersDue(HSP *sp, bool full);
+  void addPollAction(HSP *sp, SFLPoller *poller, getCountersFn_t getCountersFn, uint32_t group);
+  uint64_t adaptorActivity(HSP *sp, SFLAdaptor *adaptor);
+  bool pollBackoff(HSP *sp, HSPPollBackoff *bo, SFLPoller *poller, uint64_t activity);
+  bool pollBackoffVM(HSP *sp, HSPVMState *state, HSPCgroup *cg);
+  void initSFPWorkers(HSP *sp);
   int readHidCounters(HSP *sp, SFLHost_hid_counters *hid, char *hbuf, int hbufLen, char *rbuf, int rbufLen);
   int configSwitchPorts(HSP *sp);
+  char *hspCgroupV2Mount(HSP *sp);
+  char *hspCgroupV1Mount(HSP *sp, EnumHSPCgroupV1 ctrl);
+  HSPCgroup *hspCgroup(HSP *sp, char *path);
+  HSPCgroup *hspCgroupByIno(HSP *sp, uint64_t ino);
+  HSPCgroupStats *hspCgroupStats(HSP *sp, HSPCgroup *cg);
+  void hspCgroupPrefetch(HSP *sp, char *path);
+  bool hspCgroupOfPid(pid_t pid, char *controller, char **p_path);
+  void hspCgroupSweep(HSP *sp);
   int readTcpipCounters(HSP *sp, SFLHost_ip_counters *c_ip, SFLHost_icmp_counters *c_icmp, SFLHost_tcp_counters *c_tcp, SFLHost_udp_counters *c_udp);
   void flushCounters(EVMod *mod);
+  bool updatePollingInterval(HSP *sp);
+  void telemetryLatency(HSP *sp, EnumHSPTelemetry bin0, struct timespec *t1, struct timespec *t2);
+  void timingStart(HSP *sp, struct timespec *wall0, struct timespec *cpu0);
+  void timingEnd(HSP *sp, EnumHSPTiming tm, struct timespec *wall0, struct timespec *cpu0);
 
   // sum bond counters from their components
   void setSynthesizeBondCounters(EVMod *mod, bool val);
@@ -861,6 +1110,7 @@ extern "C" {
   void releasePendingSample(HSP *sp, HSPPendingSample *ps);
   int decodePendingSample(HSPPendingSample *ps);
   SFLPoller *forceCounterPolling(HSP *sp, SFLAdaptor *adaptor);
+  void updateSamplerHeaderBytes(HSP *sp);
 
   // VM lifecycle
   HSPVMState *getVM(EVMod *mod, char *uuid, bool create, size_t objSize, EnumVMType vmType, getCountersFn_t getCountersFn);
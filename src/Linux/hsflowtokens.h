@@ -35,10 +35,16 @@ HSPTOKEN_DATA( HSPTOKEN_JSON, "json", HSPTOKENTYPE_OBJ, NULL)
 HSPTOKEN_DATA( HSPTOKEN_JSONPORT, "jsonPort", HSPTOKENTYPE_ATTRIB, "json { udpPort=[n] }")
 HSPTOKEN_DATA( HSPTOKEN_JSONFIFO, "jsonFIFO", HSPTOKENTYPE_ATTRIB, "json { fifo=[path] }")
 HSPTOKEN_DATA( HSPTOKEN_FIFO, "fifo", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_THREADS, "threads", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_RING, "ring", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_RING_GROUP, "ringGroup", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_RTMETRIC_WINDOW, "rtmetricWindow", HSPTOKENTYPE_ATTRIB, NULL)
 HSPTOKEN_DATA( HSPTOKEN_AGENTCIDR, "agent.cidr", HSPTOKENTYPE_ATTRIB, NULL)
 HSPTOKEN_DATA( HSPTOKEN_DATAGRAMBYTES, "datagramBytes", HSPTOKENTYPE_ATTRIB, NULL)
 HSPTOKEN_DATA( HSPTOKEN_REFRESH_ADAPTORS, "refreshAdaptors", HSPTOKENTYPE_ATTRIB, NULL)
 HSPTOKEN_DATA( HSPTOKEN_CHECK_ADAPTORS, "checkAdaptors", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_SFP_THREADS, "sfpThreads", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_SFP_REFRESH, "sfpRefresh", HSPTOKENTYPE_ATTRIB, NULL)
 HSPTOKEN_DATA( HSPTOKEN_REFRESH_VMS, "refreshVMs", HSPTOKENTYPE_ATTRIB, NULL)
 HSPTOKEN_DATA( HSPTOKEN_SAMPLINGDIRECTION, "samplingDirection", HSPTOKENTYPE_ATTRIB, "psample { ingress=[on/off] egress=[on|off] }")
 HSPTOKEN_DATA( HSPTOKEN_FORGET_VMS, "forgetVMs", HSPTOKENTYPE_ATTRIB, NULL)
@@ -73,6 +79,7 @@ HSPTOKEN_DATA( HSPTOKEN_PORT, "port", HSPTOKENTYPE_OBJ, NULL)
 HSPTOKEN_DATA( HSPTOKEN_CGROUP_PROCS, "cgroup_procs", HSPTOKENTYPE_ATTRIB, NULL)
 HSPTOKEN_DATA( HSPTOKEN_CGROUP_ACCT, "cgroup_acct", HSPTOKENTYPE_ATTRIB, NULL)
 HSPTOKEN_DATA( HSPTOKEN_CGROUP_TRAFFIC, "markTraffic", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_CGROUP2, "cgroup2", HSPTOKENTYPE_ATTRIB, NULL)
 HSPTOKEN_DATA( HSPTOKEN_NAMESPACE, "namespace", HSPTOKENTYPE_ATTRIB, NULL)
 HSPTOKEN_DATA( HSPTOKEN_HOSTNAME, "hostname", HSPTOKENTYPE_ATTRIB, NULL)
 HSPTOKEN_DATA( HSPTOKEN_DROPMON, "dropmon", HSPTOKENTYPE_OBJ, NULL)
@@ -92,3 +99,17 @@ HSPTOKEN_DATA( HSPTOKEN_INGRESS, "ingress", HSPTOKENTYPE_ATTRIB, NULL)
 HSPTOKEN_DATA( HSPTOKEN_EGRESS, "egress", HSPTOKENTYPE_ATTRIB, NULL)
 HSPTOKEN_DATA( HSPTOKEN_K8S, "k8s", HSPTOKENTYPE_OBJ, NULL)
 HSPTOKEN_DATA( HSPTOKEN_WAITREADY, "waitReady", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_GOVERNOR, "governor", HSPTOKENTYPE_OBJ, NULL)
+HSPTOKEN_DATA( HSPTOKEN_CPU, "cpu", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_INTERVAL, "interval", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_INSTRUMENT, "instrument", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_POLL_BUDGET, "pollBudget", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_POLL_IDLE, "pollIdle", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_POLL_IDLE_MAX, "pollIdleMax", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_PROMETHEUS, "prometheus", HSPTOKENTYPE_OBJ, NULL)
+HSPTOKEN_DATA( HSPTOKEN_TCPPORT, "TCPPort", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_PATH, "path", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_FILE, "file", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_RATE, "rate", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_LOOP, "loop", HSPTOKENTYPE_ATTRIB, NULL)
+HSPTOKEN_DATA( HSPTOKEN_URI, "uri", HSPTOKENTYPE_ATTRIB, NULL)
@@ -24,7 +24,8 @@ extern "C" {
   // (there can be more than this - my_readline will chop for us)
 #define MAX_PROC_LINE_CHARS 320
 
-#include "cJSON.h"
+#include "util_json.h"
+#include "util_containerd.h"
 
   typedef struct _HSPVMState_CONTAINERD {
     HSPVMState vm; // superclass: must come first
@@ -57,6 +58,7 @@ extern "C" {
 
 #define HSP_CONTAINERD_READER "/usr/sbin/hsflowd_containerd"
 #define HSP_CONTAINERD_DATAPREFIX "data>"
+#define HSP_CONTAINERD_READ_BUFSZ 8192
 
 #define HSP_CONTAINERD_MAX_FNAME_LEN 255
 #define HSP_CONTAINERD_MAX_LINELEN 512
@@ -81,7 +83,89 @@ extern "C" {
   } HSPVNIC;
 
 #define HSP_VNIC_REFRESH_TIMEOUT 300
-#define HSP_CGROUP_REFRESH_TIMEOUT 600
+
+  // the fields we take from each "data>" line (see SFlowContainer
+  // in containerd/hsflowd_containerd.go)
+  typedef enum {
+    HSP_CONTAINERD_F_ID=0,
+    HSP_CONTAINERD_F_PID,
+    HSP_CONTAINERD_F_ENV,
+    HSP_CONTAINERD_F_METRICS,
+    HSP_CONTAINERD_F_CGROUPSPATH,
+    HSP_CONTAINERD_F_IMAGE,
+    HSP_CONTAINERD_F_IMAGENAME,
+    HSP_CONTAINERD_F_HOSTNAME,
+    HSP_CONTAINERD_F_CONTAINERNAME,
+    HSP_CONTAINERD_F_CONTAINERTYPE,
+    HSP_CONTAINERD_F_SANDBOXNAME,
+    HSP_CONTAINERD_F_SANDBOXNAMESPACE,
+    HSP_CONTAINERD_F_CPU,
+    HSP_CONTAINERD_F_CPUTIME,
+    HSP_CONTAINERD_F_CPUCOUNT,
+    HSP_CONTAINERD_F_MEM,
+    HSP_CONTAINERD_F_MEMORY,
+    HSP_CONTAINERD_F_MAXMEMORY,
+    HSP_CONTAINERD_F_DSK,
+    HSP_CONTAINERD_F_RD_REQ,
+    HSP_CONTAINERD_F_WR_REQ,
+    HSP_CONTAINERD_F_RD_BYTES,
+    HSP_CONTAINERD_F_WR_BYTES,
+    HSP_CONTAINERD_F_NUM
+  } EnumHSPContainerdField;
+
+  static char *HSP_CONTAINERD_FIELDS[] = {
+    "Id",
+    "Pid",
+    "Env[]",
+    "Metrics",
+    "Metrics.Names.CgroupsPath",
+    "Metrics.Names.Image",
+    "Metrics.Names.ImageName",
+    "Metrics.Names.Hostname",
+    "Metrics.Names.ContainerName",
+    "Metrics.Names.ContainerType",
+    "Metrics.Names.SandboxName",
+    "Metrics.Names.SandboxNamespace",
+    "Metrics.Cpu",
+    "Metrics.Cpu.CpuTime",
+    "Metrics.Cpu.CpuCount",
+    "Metrics.Mem",
+    "Metrics.Mem.Memory",
+    "Metrics.Mem.MaxMemory",
+    "Metrics.Dsk",
+    "Metrics.Dsk.Rd_req",
+    "Metrics.Dsk.Wr_req",
+    "Metrics.Dsk.Rd_bytes",
+    "Metrics.Dsk.Wr_bytes",
+  };
+
+  typedef struct _HSPContainerdData {
+    char *id;
+    pid_t pid;
+    char *hostname;
+    char *containerName;
+    char *containerType;
+    char *sandboxName;
+    char *sandboxNamespace;
+    char *gpuEnv;
+    uint64_t cpuTime; // nS
+    uint32_t cpuCount;
+    uint64_t memory;
+    uint64_t maxMemory;
+    SFLHost_vrt_dsk_counters dsk;
+    bool gotPid:1;
+    bool gotMetrics:1;
+    bool gotHostname:1;
+    bool gotCpu:1;
+    bool gotMem:1;
+    bool gotDsk:1;
+  } HSPContainerdData;
+
+  typedef enum {
+    HSP_CONTAINERD_LINE_PREFIX=0,
+    HSP_CONTAINERD_LINE_DATA,
+    HSP_CONTAINERD_LINE_SKIP
+  } EnumHSPContainerdLineState;
 
   typedef struct _HSP_mod_CONTAINERD {
     EVBus *pollBus;
@@ -98,6 +182,11 @@ extern "C" {
     UTHash *vnicByIP;
     uint32_t configRevisionNo;
     pid_t readerPid;
+    UTJSONParser *stream;
+    HSPContainerdData data;
+    EnumHSPContainerdLineState lineState;
+    uint32_t prefixMatched;
+    UTCtrdReader *frames;
   } HSP_mod_CONTAINERD;
 
 #define HSP_CONTAINERD_MAX_STATS_LINELEN 512
@@ -270,7 +359,7 @@ extern "C" {
 
       // open /proc/<nspid>/ns/net
       char topath[HSP_CONTAINERD_MAX_FNAME_LEN+1];
-      snprintf(topath, HSP_CONTAINERD_MAX_FNAME_LEN, PROCFS_STR "/%u/ns/net", nspid);
+      snprintf(topath, HSP_CONTAINERD_MAX_FNAME_LEN, "%s/%u/ns/net", hspFS(HSP_FS_PROC), nspid);
       int nsfd = open(topath, O_RDONLY | O_CLOEXEC);
       if(nsfd < 0) {
 	fprintf(stderr, "cannot open %s : %s", topath, strerror(errno));
@@ -311,7 +400,9 @@ extern "C" {
 	exit(EXIT_FAILURE);
       }
 
-      FILE *procFile = fopen(PROCFS_STR "/net/dev", "r");
+      char fsbuf[HSP_MAX_PATHLEN];
+
+      FILE *procFile = fopen(hspFSPath(fsbuf, HSP_MAX_PATHLEN, HSP_FS_PROC, "/net/dev"), "r");
       if(procFile) {
 	struct ifreq ifr;
 	memset(&ifr, 0, sizeof(ifr));
@@ -665,36 +756,8 @@ extern "C" {
   */
 
   static void updateContainerCgroupPaths(EVMod *mod, HSPVMState_CONTAINERD *container) {
-    HSPVMState *vm = &container->vm;
-    if(vm) {
-      // open /proc/<pid>/cgroup
-      char cgpath[HSP_CONTAINERD_MAX_FNAME_LEN+1];
-      snprintf(cgpath, HSP_CONTAINERD_MAX_FNAME_LEN, PROCFS_STR "/%u/cgroup", container->pid);
-      FILE *procFile = fopen(cgpath, "r");
-      if(procFile) {
-	char line[MAX_PROC_LINE_CHARS];
-	int truncated;
-	while(my_readline(procFile, line, MAX_PROC_LINE_CHARS, &truncated) != EOF) {
-	  if(!truncated) {
-	    // expect lines like 3:devices:<long_path>
-	    int entryNo;
-	    char type[MAX_PROC_LINE_CHARS];
-	    char path[MAX_PROC_LINE_CHARS];
-	    if(sscanf(line, "%d:%[^:]:%[^:]", &entryNo, type, path) == 3) {
-	      if(my_strequal(type, "devices")) {
-		if(!my_strequal(container->cgroup_devices, path)) {
-		  if(container->cgroup_devices)
-		    my_free(container->cgroup_devices);
-		  container->cgroup_devices = my_strdup(path);
-		  myDebug(1, "containerd: container(%s)->cgroup_devices=%s", container->name, container->cgroup_devices);
-		}
-	      }
-	    }
-	  }
-	}
-	fclose(procFile);
-      }
-    }
+    if(hspCgroupOfPid(container->pid, "devices", &container->cgroup_devices))
+      myDebug(1, "containerd: container(%s)->cgroup_devices=%s", container->name, container->cgroup_devices);
   }
 
   /*_________________---------------------------__________________
@@ -779,51 +842,42 @@ extern "C" {
     UTArrayReset(arr);
   }
 
-  static void readContainerGPUsFromEnv(EVMod *mod, HSPVMState_CONTAINERD *container, cJSON *jenv) {
-    // look through env vars for evidence of GPUs assigned to this container
-    int entries = cJSON_GetArraySize(jenv);
+  // gpu_uuids is the value of NVIDIA_VISIBLE_DEVICES from the container's env,
+  // e.g. "GPU-<uuid>,GPU-<uuid>"
+  static void readContainerGPUsFromEnv(EVMod *mod, HSPVMState_CONTAINERD *container, char *gpu_uuids) {
     UTArray *arr = container->vm.gpus;
-    for(int ii = 0; ii < entries; ii++) {
-      cJSON *varval = cJSON_GetArrayItem(jenv, ii);
-      if(varval) {
-	char *vvstr = varval->valuestring;
-	int vlen = strlen(HSP_NVIDIA_VIS_DEV_ENV);
-	if(vvstr
-	   && my_strnequal(vvstr, HSP_NVIDIA_VIS_DEV_ENV, vlen)
-	   && vvstr[vlen] == '=') {
-	  myDebug(2, "parsing GPU env: %s", vvstr);
-	  char *gpu_uuids = vvstr + vlen + 1;
-	  clearContainerGPUs(mod, container);
-	  // (re)populate
-	  char *str;
-	  char buf[128];
-	  while((str = parseNextTok(&gpu_uuids, ",", NO, 0, YES, buf, 128)) != NULL) {
-	    myDebug(2, "parsing GPU uuidstr: %s", str);
-	    // expect GPU-<uuid>
-	    if(my_strnequal(str, "GPU-", 4)) {
-	      HSPGpuID *gpu = my_calloc(sizeof(HSPGpuID));
-	      if(parseUUID(str + 4, gpu->uuid)) {
-		gpu->has_uuid = YES;
-		myDebug(2, "adding GPU uuid to container: %s", container->name);
-		UTArrayAdd(arr, gpu);
-		container->gpu_env = YES;
-	      }
-	      else {
-		myDebug(2, "GPU uuid parse failed");
-		my_free(gpu);
-	      }
-	    }
-	  }
+    myDebug(2, "parsing GPU env: %s", gpu_uuids);
+    clearContainerGPUs(mod, container);
+    // (re)populate
+    char *str;
+    char buf[128];
+    while((str = parseNextTok(&gpu_uuids, ",", NO, 0, YES, buf, 128)) != NULL) {
+      myDebug(2, "parsing GPU uuidstr: %s", str);
+      // expect GPU-<uuid>
+      if(my_strnequal(str, "GPU-", 4)) {
+	HSPGpuID *gpu = my_calloc(sizeof(HSPGpuID));
+	if(parseUUID(str + 4, gpu->uuid)) {
+	  gpu->has_uuid = YES;
+	  myDebug(2, "adding GPU uuid to container: %s", container->name);
+	  UTArrayAdd(arr, gpu);
+	  container->gpu_env = YES;
+	}
+	else {
+	  myDebug(2, "GPU uuid parse failed");
+	  my_free(gpu);
 	}
       }
     }
   }
-  
 
   static void readContainerGPUsFromDev(EVMod *mod, HSPVMState_CONTAINERD *container) {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    char *devices = hspCgroupV1Mount(sp, HSP_CGROUP_V1_DEVICES);
+    if(devices == NULL)
+      return;
     // look through devices to see if individial GPUs are exposed
     char path[HSP_MAX_PATHLEN];
-    sprintf(path, SYSFS_STR "/fs/cgroup/devices/%s/devices.list", container->cgroup_devices);
+    snprintf(path, HSP_MAX_PATHLEN, "%s/%s/devices.list", devices, container->cgroup_devices);
     FILE *procFile = fopen(path, "r");
     if(procFile) {
       UTArray *arr = container->vm.gpus;
@@ -871,27 +925,15 @@ extern "C" {
   }
 
   /*_________________---------------------------__________________
-    _________________       logField            __________________
+    _________________     readContainerData     __________________
     -----------------___________________________------------------
+    Each line from hsflowd_containerd that starts with "data>" is one
+    JSON record for one container.  It is parsed as it is read,  picking
+    out just the fields below (see util_json.h),  and applied when the
+    record is complete.
   */
 
-  static void logField(int debugLevel, char *msg, cJSON *obj, char *field)
-  {
-    if(debug(debugLevel)) {
-      cJSON *fieldObj = cJSON_GetObjectItem(obj, field);
-      char *str = fieldObj ? cJSON_Print(fieldObj) : NULL;
-      myLog(LOG_INFO, "%s %s=%s", msg, field, str ?: "<not found>");
-      if(str)
-	my_free(str);
-    }
-  }
-
-  /*_________________---------------------------__________________
-    _________________     readContainerJSON     __________________
-    -----------------___________________________------------------
-  */
-
-  static void readContainerJSON(EVMod *mod, cJSON *top, void *magic) {
+  static void readContainerData(EVMod *mod, HSPContainerdData *data) {
     HSP_mod_CONTAINERD *mdata = (HSP_mod_CONTAINERD *)mod->data;
     HSP *sp = (HSP *)EVROOTDATA(mod);
     if(sp->sFlowSettings == NULL) {
@@ -899,50 +941,27 @@ extern "C" {
       return;
     }
     HSPVMState_CONTAINERD *container = NULL;
-    cJSON *jid = cJSON_GetObjectItem(top, "Id");
-
-    if(jid)
-      container = getContainer(mod, jid->valuestring, YES, NO);
+    if(my_strlen(data->id))
+      container = getContainer(mod, data->id, YES, NO);
     if(container == NULL)
       return;
 
-    cJSON *jpid = cJSON_GetObjectItem(top, "Pid");
-    if(jpid)
-      container->pid = (pid_t)jpid->valueint;
-    
-    cJSON *jmetrics = cJSON_GetObjectItem(top, "Metrics");
-    if(!jmetrics)
+    if(data->gotPid)
+      container->pid = data->pid;
+
+    if(!data->gotMetrics)
       return;
 
     bool isSandbox = NO;
-    cJSON *jnames = cJSON_GetObjectItem(jmetrics, "Names");
-    if(jnames) {
-      cJSON *jcgpth = cJSON_GetObjectItem(jnames, "CgroupsPath");
-      if(jcgpth) {
-	myDebug(1, "cgroupspath=%s\n", jcgpth->valuestring);
-      }
-      logField(1, " ", jnames, "Image");
-      logField(1, " ", jnames, "Hostname");
-      logField(1, " ", jnames, "ContainerName");
-      logField(1, " ", jnames, "ContainerType");
-      logField(1, " ", jnames, "SandboxName");
-      logField(1, " ", jnames, "SandboxNamespace");
-      logField(1, " ", jnames, "ImageName");
-    }
-    
+
     // TODO: skip "k8s_POD_*" containers
     // (or make that a config setting)
     // But maybe that doesn't happen with containerd?  Not
     // seeing them here.
 
-    setContainerName(mod, container, jid->valuestring);
-    
-    cJSON *jn = cJSON_GetObjectItem(jnames, "ContainerName");
-    cJSON *jt = cJSON_GetObjectItem(jnames, "ContainerType");
-    cJSON *jhn = cJSON_GetObjectItem(jnames, "Hostname");
-    cJSON *jsn = cJSON_GetObjectItem(jnames, "SandboxName");
-    cJSON *jsns = cJSON_GetObjectItem(jnames, "SandboxNamespace");
-    if(jhn) {
+    setContainerName(mod, container, data->id);
+
+    if(data->gotHostname) {
       // From kubernetes/pgk/kubelet/dockershim/naming.go
       // Sandbox
       // k8s_POD_{s.name}_{s.namespace}_{s.uid}_{s.attempt}
@@ -952,11 +971,11 @@ extern "C" {
       // Match the Kubernetes docker_inspect output by combining these strings into
       // the form k8s_<containername>_<sandboxname>_<sandboxnamespace>_<sandboxuser>_<c.attempt>
       // pull out name, hostname, sandboxname and sandboxnamespace
-      char *jn_s = (jn && strlen(jn->valuestring)) ? jn->valuestring : NULL;
-      char *jt_s = (jt && strlen(jt->valuestring)) ? jt->valuestring : NULL;
-      char *jhn_s = (jhn && strlen(jhn->valuestring)) ? jhn->valuestring : NULL;
-      char *jsn_s = (jsn && strlen(jsn->valuestring)) ? jsn->valuestring : NULL;
-      char *jsns_s = (jsns && strlen(jsns->valuestring)) ? jsns->valuestring : NULL;
+      char *jn_s = my_strlen(data->containerName) ? data->containerName : NULL;
+      char *jt_s = my_strlen(data->containerType) ? data->containerType : NULL;
+      char *jhn_s = my_strlen(data->hostname) ? data->hostname : NULL;
+      char *jsn_s = my_strlen(data->sandboxName) ? data->sandboxName : NULL;
+      char *jsns_s = my_strlen(data->sandboxNamespace) ? data->sandboxNamespace : NULL;
       // container name can be empty, so if it ends up being the
       // same as the sandbox name or hostname then we leave it out to save space (and to
       // prevent the combination of namespace.containername from exploding unexpectedly)
@@ -978,50 +997,20 @@ extern "C" {
       if(my_strequal(jt_s, "sandbox"))
 	isSandbox = YES;
     }
-    
-    cJSON *jcpu = cJSON_GetObjectItem(jmetrics, "Cpu");
-    if(jcpu) {
+
+    if(data->gotCpu) {
       // TODO: get status from data.  With containerd it is the Process Status string
       container->state = SFL_VIR_DOMAIN_RUNNING;
-      
-      cJSON *jcputime = cJSON_GetObjectItem(jcpu, "CpuTime");
-      if(jcputime) {
-	container->cpu_total = jcputime->valuedouble;
-      }
-      cJSON *jcpucount = cJSON_GetObjectItem(jcpu, "CpuCount");
-      if(jcpucount)
-	container->cpu_count = jcpucount->valueint;
+      container->cpu_total = data->cpuTime;
+      container->cpu_count = data->cpuCount;
     }
-    cJSON *jmem = cJSON_GetObjectItem(jmetrics, "Mem");
-    if(jmem) {
-      cJSON *jm = cJSON_GetObjectItem(jmem, "Memory");
-      if(jm)
-	container->mem_usage = jm->valuedouble; // TODO: units?
-      cJSON *jmm = cJSON_GetObjectItem(jmem, "MaxMemory");
-      if(jmm)
-	container->memoryLimit = jmm->valuedouble; // TODO: units?
-    }
-    
-    cJSON *jnet = cJSON_GetObjectItem(jmetrics, "Net");
-    if(jnet) {
-    }
-    cJSON *jdsk = cJSON_GetObjectItem(jmetrics, "Dsk");
-    if(jdsk) {
-      cJSON *jrd_req = cJSON_GetObjectItem(jdsk, "Rd_req");
-      cJSON *jwr_req = cJSON_GetObjectItem(jdsk, "Wr_req");
-      cJSON *jrd_bytes = cJSON_GetObjectItem(jdsk, "Rd_bytes");
-      cJSON *jwr_bytes = cJSON_GetObjectItem(jdsk, "Wr_bytes");
-      if(jrd_req)
-	container->dsk.rd_req = jrd_req->valuedouble;
-      if(jwr_req)
-	container->dsk.wr_req = jwr_req->valuedouble;
-      if(jrd_bytes)
-	container->dsk.rd_bytes = jrd_bytes->valuedouble;
-      if(jwr_bytes)
-	container->dsk.wr_bytes = jwr_bytes->valuedouble;
+    if(data->gotMem) {
+      container->mem_usage = data->memory; // TODO: units?
+      container->memoryLimit = data->maxMemory; // TODO: units?
     }
+    if(data->gotDsk)
+      container->dsk = data->dsk;
 
-    
     // now that we have the pid,  we can probe for the MAC and peer-ifIndex
     // see if spacing the VNIC refresh reduces load
     time_t now_mono = mdata->pollBus->now.tv_sec;
@@ -1049,10 +1038,9 @@ extern "C" {
       updateContainerCgroupPaths(mod, container);
     }
 
-    cJSON *jenv = cJSON_GetObjectItem(jmetrics, "Env");
-    if(jenv
+    if(data->gpuEnv
        && container->gpu_dev == NO)
-      readContainerGPUsFromEnv(mod, container, jenv);
+      readContainerGPUsFromEnv(mod, container, data->gpuEnv);
 
     if(container->cgroup_devices)
       readContainerGPUsFromDev(mod, container);
@@ -1063,17 +1051,202 @@ extern "C" {
     if(containerDone(mod, container))
       removeAndFreeVM_CONTAINERD(mod, container);
   }
-  
-  static void readContainerData(EVMod *mod, char *str, void *magic) {
-    // HSP_mod_CONTAINERD *mdata = (HSP_mod_CONTAINERD *)mod->data;
+
+  static void setContainerDataStr(char **p_str, UTJSONValue *val) {
+    if(*p_str)
+      my_free(*p_str);
+    *p_str = (val->type == UTJSON_STRING) ? my_strdup(val->str) : NULL;
+  }
+
+  static void resetContainerData(HSPContainerdData *data) {
+    if(data->id) my_free(data->id);
+    if(data->hostname) my_free(data->hostname);
+    if(data->containerName) my_free(data->containerName);
+    if(data->containerType) my_free(data->containerType);
+    if(data->sandboxName) my_free(data->sandboxName);
+    if(data->sandboxNamespace) my_free(data->sandboxNamespace);
+    if(data->gpuEnv) my_free(data->gpuEnv);
+    memset(data, 0, sizeof(*data));
+  }
+
+  static void containerDataField(void *magic, UTJSONParser *jp, int field, UTJSONValue *val) {
+    EVMod *mod = (EVMod *)magic;
+    HSP_mod_CONTAINERD *mdata = (HSP_mod_CONTAINERD *)mod->data;
+    HSPContainerdData *data = &mdata->data;
+    uint64_t val64 = UTJSONU64(val);
+    switch(field) {
+    case HSP_CONTAINERD_F_ID:
+      setContainerDataStr(&data->id, val);
+      break;
+    case HSP_CONTAINERD_F_PID:
+      data->pid = (pid_t)val64;
+      data->gotPid = YES;
+      break;
+    case HSP_CONTAINERD_F_ENV: {
+      // look through env vars for evidence of GPUs assigned to this container
+      int vlen = strlen(HSP_NVIDIA_VIS_DEV_ENV);
+      if(val->type == UTJSON_STRING
+	 && my_strnequal(val->str, HSP_NVIDIA_VIS_DEV_ENV, vlen)
+	 && val->str[vlen] == '=') {
+	if(data->gpuEnv)
+	  my_free(data->gpuEnv);
+	data->gpuEnv = my_strdup(val->str + vlen + 1);
+      }
+      break;
+    }
+    case HSP_CONTAINERD_F_METRICS:
+      data->gotMetrics = YES;
+      break;
+    case HSP_CONTAINERD_F_CGROUPSPATH:
+      myDebug(1, "cgroupspath=%s", val->str ?: "");
+      break;
+    case HSP_CONTAINERD_F_IMAGE:
+    case HSP_CONTAINERD_F_IMAGENAME:
+      myDebug(1, "  %s=%s", val->key, val->str ?: "");
+      break;
+    case HSP_CONTAINERD_F_HOSTNAME:
+      myDebug(1, "  %s=%s", val->key, val->str ?: "");
+      setContainerDataStr(&data->hostname, val);
+      data->gotHostname = YES;
+      break;
+    case HSP_CONTAINERD_F_CONTAINERNAME:
+      myDebug(1, "  %s=%s", val->key, val->str ?: "");
+      setContainerDataStr(&data->containerName, val);
+      break;
+    case HSP_CONTAINERD_F_CONTAINERTYPE:
+      myDebug(1, "  %s=%s", val->key, val->str ?: "");
+      setContainerDataStr(&data->containerType, val);
+      break;
+    case HSP_CONTAINERD_F_SANDBOXNAME:
+      myDebug(1, "  %s=%s", val->key, val->str ?: "");
+      setContainerDataStr(&data->sandboxName, val);
+      break;
+    case HSP_CONTAINERD_F_SANDBOXNAMESPACE:
+      myDebug(1, "  %s=%s", val->key, val->str ?: "");
+      setContainerDataStr(&data->sandboxNamespace, val);
+      break;
+    case HSP_CONTAINERD_F_CPU: data->gotCpu = YES; break;
+    case HSP_CONTAINERD_F_CPUTIME: data->cpuTime = val64; break;
+    case HSP_CONTAINERD_F_CPUCOUNT: data->cpuCount = (uint32_t)val64; break;
+    case HSP_CONTAINERD_F_MEM: data->gotMem = YES; break;
+    case HSP_CONTAINERD_F_MEMORY: data->memory = val64; break;
+    case HSP_CONTAINERD_F_MAXMEMORY: data->maxMemory = val64; break;
+    case HSP_CONTAINERD_F_DSK: data->gotDsk = YES; break;
+    case HSP_CONTAINERD_F_RD_REQ: data->dsk.rd_req = (uint32_t)val64; break;
+    case HSP_CONTAINERD_F_WR_REQ: data->dsk.wr_req = (uint32_t)val64; break;
+    case HSP_CONTAINERD_F_RD_BYTES: data->dsk.rd_bytes = val64; break;
+    case HSP_CONTAINERD_F_WR_BYTES: data->dsk.wr_bytes = val64; break;
+    default:
+      // end of the record
+      readContainerData(mod, data);
+      resetContainerData(data);
+      break;
+    }
+  }
+
+  // Feed the data lines straight from the read buffer to the parser.
+  // A line may be split across reads,  so the position in the current
+  // line is carried over in mdata.
+  static void readContainerStream(EVMod *mod, char *buf, int len) {
+    HSP_mod_CONTAINERD *mdata = (HSP_mod_CONTAINERD *)mod->data;
     int prefixLen = strlen(HSP_CONTAINERD_DATAPREFIX);
-    if(memcmp(str, HSP_CONTAINERD_DATAPREFIX, prefixLen) == 0) {
-      cJSON *top = cJSON_Parse(str + prefixLen);
-      readContainerJSON(mod, top, magic);
-      cJSON_Delete(top);
+    int pos = 0;
+    while(pos < len) {
+      char *eol = memchr(buf + pos, '\n', len - pos);
+      int end = eol ? (eol - buf) : len;
+      // match the prefix at the start of the line
+      while(mdata->lineState == HSP_CONTAINERD_LINE_PREFIX
+	    && pos < end) {
+	if(buf[pos] != HSP_CONTAINERD_DATAPREFIX[mdata->prefixMatched])
+	  mdata->lineState = HSP_CONTAINERD_LINE_SKIP;
+	else {
+	  pos++;
+	  if(++mdata->prefixMatched == prefixLen) {
+	    mdata->lineState = HSP_CONTAINERD_LINE_DATA;
+	    UTJSONReset(mdata->stream);
+	    resetContainerData(&mdata->data);
+	  }
+	}
+      }
+      if(mdata->lineState == HSP_CONTAINERD_LINE_DATA
+	 && end > pos
+	 && !UTJSONError(mdata->stream)
+	 && !UTJSONFeed(mdata->stream, buf + pos, end - pos))
+	myDebug(1, "readContainerStream: JSON error (%s)", UTJSONError(mdata->stream));
+      pos = end;
+      if(eol) {
+	// next line
+	pos++;
+	mdata->lineState = HSP_CONTAINERD_LINE_PREFIX;
+	mdata->prefixMatched = 0;
+      }
     }
   }
-  
+
+  /*_________________---------------------------__________________
+    _________________    readContainerFrame     __________________
+    -----------------___________________________------------------
+    The same,  for a helper that writes binary frames (see
+    util_containerd.h).  A STATS record carries a complete poll,  so
+    it maps onto one "data>" line.
+  */
+
+  static void readContainerFrame(void *magic, EnumUTCtrdRec recType, UTCtrdContainer *ctr) {
+    EVMod *mod = (EVMod *)magic;
+    if(!my_strlen(ctr->id))
+      return;
+    HSPContainerdData data = { .id = ctr->id, .pid = ctr->pid, .gotPid = YES };
+    switch(recType) {
+    case UTCTRD_REC_CONTAINER:
+      myDebug(1, "container id=%s image=%s imageName=%s cgroupspath=%s",
+	      ctr->id,
+	      ctr->image,
+	      ctr->imageName,
+	      ctr->cgroupsPath);
+      readContainerData(mod, &data);
+      break;
+    case UTCTRD_REC_STATS:
+      // strings are borrowed from the reader,  so no resetContainerData()
+      data.gotMetrics = YES;
+      data.gotHostname = YES;
+      data.hostname = ctr->hostname;
+      data.containerName = ctr->containerName;
+      data.containerType = ctr->containerType;
+      data.sandboxName = ctr->sandboxName;
+      data.sandboxNamespace = ctr->sandboxNamespace;
+      data.gpuEnv = my_strlen(ctr->gpus) ? ctr->gpus : NULL;
+      if(ctr->statsMask & UTCTRD_STAT_CPU) {
+	data.gotCpu = YES;
+	data.cpuTime = ctr->cpuTime;
+	data.cpuCount = ctr->cpuCount;
+      }
+      if(ctr->statsMask & UTCTRD_STAT_MEM) {
+	data.gotMem = YES;
+	data.memory = ctr->memory;
+	data.maxMemory = ctr->maxMemory;
+      }
+      if(ctr->statsMask & UTCTRD_STAT_DSK) {
+	data.gotDsk = YES;
+	data.dsk.rd_req = ctr->rd_req;
+	data.dsk.rd_bytes = ctr->rd_bytes;
+	data.dsk.wr_req = ctr->wr_req;
+	data.dsk.wr_bytes = ctr->wr_bytes;
+	data.dsk.errs = ctr->errs;
+      }
+      readContainerData(mod, &data);
+      break;
+    case UTCTRD_REC_GONE: {
+      HSPVMState_CONTAINERD *container = getContainer(mod, ctr->id, NO, NO);
+      if(container) {
+	myDebug(1, "container gone: %s", ctr->id);
+	container->state = SFL_VIR_DOMAIN_SHUTOFF;
+	removeAndFreeVM_CONTAINERD(mod, container);
+      }
+      break;
+    }
+    }
+  }
+
   static void readContainerCB(EVMod *mod, EVSocket *sock, EnumEVSocketReadStatus status, void *magic) {
     // HSP_mod_CONTAINERD *mdata = (HSP_mod_CONTAINERD *)mod->data;
     switch(status) {
@@ -1082,11 +1255,12 @@ extern "C" {
     case EVSOCKETREAD_STR:
       // UTStrBuf_chomp(sock->ioline);
       myDebug(1, "readContainerCB: %s", UTSTRBUF_STR(sock->ioline));
-      readContainerData(mod, UTSTRBUF_STR(sock->ioline), magic);
       UTStrBuf_reset(sock->ioline);
       break;
     case EVSOCKETREAD_EOF:
+      // the reader has gone (see readerReset)
       myDebug(1, "readContainerCB EOF");
+      EVSocketClose(mod, sock, YES);
       break;
     case EVSOCKETREAD_BADF:
       myDebug(1, "readContainerCB BADF");
@@ -1096,7 +1270,7 @@ extern "C" {
       break;
     }
   }
-  
+
   /*_________________---------------------------__________________
     _________________    evt_flow_sample        __________________
     -----------------___________________________------------------
@@ -1199,8 +1373,43 @@ extern "C" {
     -----------------___________________________------------------
   */
 
+  // A frame that will not decode leaves the stream out of step,  so
+  // kill the reader and let the next tock start a fresh one.
+  static void readerReset(EVMod *mod, EVSocket *sock) {
+    HSP_mod_CONTAINERD *mdata = (HSP_mod_CONTAINERD *)mod->data;
+    if(mdata->readerPid > 0)
+      kill(mdata->readerPid, SIGKILL);
+    // reaps the child too
+    EVSocketClose(mod, sock, YES);
+    UTCtrdFree(mdata->frames);
+    mdata->frames = UTCtrdNew(readContainerFrame, mod);
+    mdata->readerPid = 0;
+  }
+
   static void readCB(EVMod *mod, EVSocket *sock, void *magic) {
-    EVSocketReadLines(mod, sock, readContainerCB, YES, magic);
+    HSP_mod_CONTAINERD *mdata = (HSP_mod_CONTAINERD *)mod->data;
+    if(sock->errOut) {
+      // just log what the reader says on stderr
+      EVSocketReadLines(mod, sock, readContainerCB, YES, magic);
+      return;
+    }
+    char buf[HSP_CONTAINERD_READ_BUFSZ];
+    int cc;
+    while((cc = read(sock->fd, buf, HSP_CONTAINERD_READ_BUFSZ)) < 0
+	  && errno == EINTR);
+    if(cc > 0) {
+      if(UTCtrdMode(mdata->frames, buf, cc) == UTCTRD_MODE_TEXT)
+	readContainerStream(mod, buf, cc);
+      else if(!UTCtrdFeed(mdata->frames, buf, cc)) {
+	myLog(LOG_ERR, "hsflowd_containerd: %s (restarting reader)", UTCtrdError(mdata->frames));
+	readerReset(mod, sock);
+      }
+    }
+    else if(cc == 0
+	    || errno != EAGAIN) {
+      myDebug(1, "readCB: %s", cc ? strerror(errno) : "EOF");
+      EVSocketClose(mod, sock, YES);
+    }
   }
 
   static void evt_cfg_done(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
@@ -1228,7 +1437,9 @@ extern "C" {
       // char *cmd[] = { HSP_CONTAINERD_READER, "--debugLevel", level,  NULL };
       // but can always debug reader separately, so just invoke it like this:
       char *cmd[] = { HSP_CONTAINERD_READER, NULL };
-      mdata->readerPid = EVBusExec(mod, mdata->pollBus, mdata, cmd, readCB);
+      // ask for binary frames.  An older reader will ignore this.
+      char *env[] = { HSP_CTRD_FRAMES_ENV, NULL };
+      mdata->readerPid = EVBusExecEnv(mod, mdata->pollBus, mdata, cmd, env, readCB);
     }
   }
 
@@ -1262,6 +1473,8 @@ extern "C" {
     mdata->hostnameCount = UTHASH_NEW(HSPContainerNameCount, name, UTHASH_SKEY);
     mdata->pollActions = UTHASH_NEW(HSPVMState_CONTAINERD, id, UTHASH_IDTY);
     mdata->cgroupPathIdx = -1;
+    mdata->stream = UTJSONNew(HSP_CONTAINERD_FIELDS, HSP_CONTAINERD_F_NUM, containerDataField, mod);
+    mdata->frames = UTCtrdNew(readContainerFrame, mod);
     
     // register call-backs
     mdata->pollBus = EVGetBus(mod, HSPBUS_POLL, YES);
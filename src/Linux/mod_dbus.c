@@ -57,6 +57,8 @@ static const char* introspect_xml =
 "		<method name=\"Get\">\n"
 "                     <arg name=\"field\" type=\"s\" direction=\"in\"/>\n"
 "		</method>\n"
+"		<method name=\"GetEventStats\">\n"
+"		</method>\n"
 "	</interface>\n"
 "	<interface name=\"" HSP_DBUS_INTF_SWITCHPORT "\">\n"
 "		<method name=\"GetAll\">\n"
@@ -260,6 +262,56 @@ static const char* introspect_xml =
   }
 
 
+  /*_________________---------------------------__________________
+    _________________ m_telemetry_GetEventStats __________________
+    -----------------___________________________------------------
+    One (bus, event|fd, module, calls, wall_nS, cpu_nS, wall_hist,
+    cpu_hist) struct for every action or socket that has been
+    dispatched.  Empty unless "instrument=on" is configured.
+  */
+
+  static void addEventStats(EVBus *bus, EVEvent *evt, EVMod *mod, EVSocket *sock, EVStats *stats, void *magic) {
+    DBusMessageIter *it = (DBusMessageIter *)magic;
+    DBusMessageIter it2, it3;
+    char fdbuf[32];
+    char *where = fdbuf;
+    if(evt)
+      where = evt->name;
+    else
+      snprintf(fdbuf, 32, "fd=%d", sock->fd);
+    const uint32_t *wall_hist = stats->wall_hist;
+    const uint32_t *cpu_hist = stats->cpu_hist;
+    dbus_message_iter_open_container(it, DBUS_TYPE_STRUCT, NULL, &it2);
+    dbus_message_iter_append_basic(&it2, DBUS_TYPE_STRING, &bus->name);
+    dbus_message_iter_append_basic(&it2, DBUS_TYPE_STRING, &where);
+    dbus_message_iter_append_basic(&it2, DBUS_TYPE_STRING, &mod->name);
+    dbus_message_iter_append_basic(&it2, DBUS_TYPE_UINT64, &stats->calls);
+    dbus_message_iter_append_basic(&it2, DBUS_TYPE_UINT64, &stats->wall_nS);
+    dbus_message_iter_append_basic(&it2, DBUS_TYPE_UINT64, &stats->cpu_nS);
+    dbus_message_iter_open_container(&it2, DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32_AS_STRING, &it3);
+    dbus_message_iter_append_fixed_array(&it3, DBUS_TYPE_UINT32, &wall_hist, EV_STATS_HIST_BINS);
+    dbus_message_iter_close_container(&it2, &it3);
+    dbus_message_iter_open_container(&it2, DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32_AS_STRING, &it3);
+    dbus_message_iter_append_fixed_array(&it3, DBUS_TYPE_UINT32, &cpu_hist, EV_STATS_HIST_BINS);
+    dbus_message_iter_close_container(&it2, &it3);
+    dbus_message_iter_close_container(it, &it2);
+  }
+
+  static DBusHandlerResult m_telemetry_GetEventStats(EVMod *mod, DBusMessage *msg) {
+    DBusMessage *reply = dbus_message_new_method_return(msg);
+    if (!reply)
+      return DBUS_HANDLER_RESULT_NEED_MEMORY;
+    DBusMessageIter it1, it2;
+    dbus_message_iter_init_append(reply, &it1);
+    if(!dbus_message_iter_open_container(&it1, DBUS_TYPE_ARRAY, "(ssstttauau)", &it2))
+      return DBUS_HANDLER_RESULT_NEED_MEMORY;
+    EVStatsWalk(mod, addEventStats, &it2);
+    dbus_message_iter_close_container(&it1, &it2);
+    send_reply(mod, reply);
+    dbus_message_unref(reply);
+    return DBUS_HANDLER_RESULT_HANDLED;
+  }
+
   /*_________________---------------------------__________________
     _________________     addSwitchPort         __________________
     -----------------___________________________------------------
@@ -370,6 +422,7 @@ static DBusHandlerResult dbusCB(DBusConnection *connection, DBusMessage *msg, vo
       if(!strcmp("GetAgent", method)) return m_telemetry_GetAgent(mod, msg);
       if(!strcmp("GetAll", method)) return m_telemetry_GetAll(mod, msg);
       if(!strcmp("Get", method)) return m_telemetry_Get(mod, msg);
+      if(!strcmp("GetEventStats", method)) return m_telemetry_GetEventStats(mod, msg);
     }
     else if(!strcmp(HSP_DBUS_INTF_SWITCHPORT, iface)) {
       if(!strcmp("GetAll", method)) return m_switchport_GetAll(mod, msg);
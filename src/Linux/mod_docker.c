@@ -24,6 +24,7 @@ extern "C" {
 #define MAX_PROC_LINE_CHARS 320
 
 #include "cJSON.h"
+#include "util_json.h"
 
 #define HSP_DOCKER_WAITQ 1
 
@@ -130,6 +131,7 @@ extern "C" {
     time_t last_vnic;
     time_t last_cgroup;
     char *cgroup_devices;
+    char *cgroup_v2; // unified hierarchy path, if the host has one
     // we now populate stats here too
     uint32_t cpu_count;
     double cpu_count_dbl;
@@ -142,14 +144,6 @@ extern "C" {
   struct _HSPDockerRequest; // fwd decl
   typedef void (*HSPDockerCB)(EVMod *mod, UTStrBuf *buf, cJSON *obj, struct _HSPDockerRequest *req);
 
-  typedef enum {
-    HSPDOCKERREQ_HEADERS=0,
-    HSPDOCKERREQ_LENGTH,
-    HSPDOCKERREQ_CONTENT,
-    HSPDOCKERREQ_ENDCONTENT,
-    HSPDOCKERREQ_ERR
-  } HSPDockerRequestState;
-
   typedef enum {
     HSP_REQTYPE_UNKNOWN=0,
     HSP_REQTYPE_EVENTS,
@@ -166,37 +160,160 @@ extern "C" {
     UTStrBuf *request;
     UTStrBuf *response;
     HSPDockerCB jsonCB;
-    HSPDockerRequestState state;
-    int contentLength;
-    int chunkLength;
     char *id;
     time_t sendTime;
-    EVSocket *sock;
+    struct _HSPDockerConn *conn;
+    uint32_t retries;
+    bool lost:1;
 #ifdef HSP_DOCKER_WAITQ
     time_t goTime_S;
 #endif
   } HSPDockerRequest;
 
+  // HTTP/1.1 response parsing is per connection,  since a response
+  // can arrive split across reads or several can arrive in one.
+  typedef enum {
+    HSPDOCKERCONN_STATUS=0,
+    HSPDOCKERCONN_HEADERS,
+    HSPDOCKERCONN_BODY,
+    HSPDOCKERCONN_CHUNK_LEN,
+    HSPDOCKERCONN_CHUNK,
+    HSPDOCKERCONN_CHUNK_END,
+    HSPDOCKERCONN_TRAILER,
+    HSPDOCKERCONN_EOF_BODY
+  } HSPDockerConnState;
+
+  // The event feed and the stats responses are the high-volume ones,
+  // so they go through a streaming parser that picks out just these
+  // fields as the body is read (see util_json.h).  The others are
+  // parsed with cJSON once the whole body is in.
+  typedef enum {
+    HSP_DOCKER_EVF_STATUS=0,
+    HSP_DOCKER_EVF_ID,
+    HSP_DOCKER_EVF_TYPE,
+    HSP_DOCKER_EVF_NAME,
+    HSP_DOCKER_EVF_NUM
+  } EnumHSPDockerEventField;
+
+  static char *HSP_DOCKER_EVENT_FIELDS[] = {
+    "status",
+    "id",
+    "Type",
+    "Actor.Attributes.name",
+  };
+
+  typedef enum {
+    HSP_DOCKER_STF_CPU=0,
+    HSP_DOCKER_STF_MEM,
+    HSP_DOCKER_STF_MEM_LIMIT,
+    HSP_DOCKER_STF_NET,
+    HSP_DOCKER_STF_RX_BYTES,
+    HSP_DOCKER_STF_RX_PACKETS,
+    HSP_DOCKER_STF_RX_DROPPED,
+    HSP_DOCKER_STF_RX_ERRORS,
+    HSP_DOCKER_STF_TX_BYTES,
+    HSP_DOCKER_STF_TX_PACKETS,
+    HSP_DOCKER_STF_TX_DROPPED,
+    HSP_DOCKER_STF_TX_ERRORS,
+    HSP_DOCKER_STF_DSK,
+    HSP_DOCKER_STF_BYTES,
+    HSP_DOCKER_STF_BYTES_OP,
+    HSP_DOCKER_STF_BYTES_VAL,
+    HSP_DOCKER_STF_REQS,
+    HSP_DOCKER_STF_REQS_OP,
+    HSP_DOCKER_STF_REQS_VAL,
+    HSP_DOCKER_STF_NUM
+  } EnumHSPDockerStatsField;
+
+  static char *HSP_DOCKER_STATS_FIELDS[] = {
+    "cpu_stats.cpu_usage.total_usage",
+    "memory_stats.usage",
+    "memory_stats.limit",
+    "networks",
+    "networks.*.rx_bytes",
+    "networks.*.rx_packets",
+    "networks.*.rx_dropped",
+    "networks.*.rx_errors",
+    "networks.*.tx_bytes",
+    "networks.*.tx_packets",
+    "networks.*.tx_dropped",
+    "networks.*.tx_errors",
+    "blkio_stats",
+    "blkio_stats.io_service_bytes_recursive[]",
+    "blkio_stats.io_service_bytes_recursive[].op",
+    "blkio_stats.io_service_bytes_recursive[].value",
+    "blkio_stats.io_serviced_recursive[]",
+    "blkio_stats.io_serviced_recursive[].op",
+    "blkio_stats.io_serviced_recursive[].value",
+  };
+
+#define HSP_DOCKER_MAX_EVENT_FIELD 256
+
+  typedef struct _HSPDockerEvent {
+    char status[HSP_DOCKER_MAX_EVENT_FIELD];
+    char id[HSP_DOCKER_MAX_EVENT_FIELD];
+    char type[HSP_DOCKER_MAX_EVENT_FIELD];
+    char name[HSP_DOCKER_MAX_EVENT_FIELD];
+  } HSPDockerEvent;
+
+  typedef struct _HSPDockerStats {
+    uint64_t cpu_total;
+    uint64_t mem_usage;
+    uint64_t memoryLimit;
+    SFLHost_nio_counters net;
+    SFLHost_vrt_dsk_counters dsk;
+    char op[16]; // current blkio entry
+    uint64_t value;
+    bool gotCPU:1;
+    bool gotMem:1;
+    bool gotLimit:1;
+    bool gotNet:1;
+    bool gotDsk:1;
+  } HSPDockerStats;
+
+  typedef struct _HSPDockerConn {
+    EVMod *mod;
+    EVSocket *sock;
+    UTQ(HSPDockerRequest) inflight; // pipelined,  answered in order
+    uint32_t nInflight;
+    bool events:1; // dedicated to the event feed
+    bool closing:1; // server said "Connection: close"
+    bool chunked:1;
+    HSPDockerConnState state;
+    int status;
+    int64_t contentLength;
+    int64_t remaining; // bytes left in body or chunk
+    UTStrBuf *rbuf; // unparsed input
+    uint32_t responses;
+    UTJSONParser *stream;
+    HSPDockerEvent event;
+    HSPDockerStats stats;
+  } HSPDockerConn;
+
   typedef struct _HSPDockerNameCount {
     char *name;
     uint32_t count;
   } HSPDockerNameCount;
 
-#define HSP_DOCKER_SOCK  VARFS_STR "/run/docker.sock"
-#define HSP_DOCKER_MAX_CONCURRENT 15
+#define HSP_DOCKER_SOCK  "/run/docker.sock" // under VARFS
+  // requests share a small pool of keep-alive connections, with up
+  // to HSP_DOCKER_PIPELINE outstanding on each.  The engine answers
+  // the requests on one connection in turn,  so a slow stats call
+  // holds up the ones behind it: prefer another connection first.
+#define HSP_DOCKER_CONNECTIONS 4
+#define HSP_DOCKER_PIPELINE 4
+#define HSP_DOCKER_MAX_CONCURRENT (HSP_DOCKER_CONNECTIONS * HSP_DOCKER_PIPELINE)
+#define HSP_DOCKER_MAX_RETRIES 2
   // note: used to set Host: HSP_DOCKER_SOCK but started to see
   // "malformed host header" errors so switched to Host: http
   // which emulates the request that curl(1) sends.
-#define HSP_DOCKER_HTTP " HTTP/1.1\nHost: http\n\n"
-  // HTTP 1.1 keeps the connection open by default, so to keep the
-  // transaction socket-logic the same below we now add the "Connection: close" header.
-#define HSP_DOCKER_HTTP_CLOSE " HTTP/1.1\nHost: http\nConnection: close\n\n"
+#define HSP_DOCKER_HTTP " HTTP/1.1\r\nHost: http\r\n\r\n"
 #define HSP_DOCKER_API "v1.24"
 #define HSP_DOCKER_REQ_EVENTS "GET /" HSP_DOCKER_API "/events?filters={\"type\":[\"container\"]}" HSP_DOCKER_HTTP
-#define HSP_DOCKER_REQ_CONTAINERS "GET /" HSP_DOCKER_API "/containers/json" HSP_DOCKER_HTTP_CLOSE
-#define HSP_DOCKER_REQ_INSPECT_ID "GET /" HSP_DOCKER_API "/containers/%s/json" HSP_DOCKER_HTTP_CLOSE
-#define HSP_DOCKER_REQ_STATS_ID "GET /" HSP_DOCKER_API "/containers/%s/stats?stream=false" HSP_DOCKER_HTTP_CLOSE
-#define HSP_CONTENT_LENGTH_REGEX "^Content-Length: ([0-9]+)$"
+#define HSP_DOCKER_REQ_CONTAINERS "GET /" HSP_DOCKER_API "/containers/json" HSP_DOCKER_HTTP
+#define HSP_DOCKER_REQ_INSPECT_ID "GET /" HSP_DOCKER_API "/containers/%s/json" HSP_DOCKER_HTTP
+#define HSP_DOCKER_REQ_STATS_ID "GET /" HSP_DOCKER_API "/containers/%s/stats?stream=false" HSP_DOCKER_HTTP
+#define HSP_DOCKER_READ_INCBYTES 4096
   
 #define HSP_DOCKER_MAX_FNAME_LEN 255
 #define HSP_DOCKER_MAX_LINELEN 512
@@ -220,7 +337,6 @@ extern "C" {
   } HSPVNIC;
 
 #define HSP_VNIC_REFRESH_TIMEOUT 300
-#define HSP_CGROUP_REFRESH_TIMEOUT 600
 
   typedef struct _HSP_mod_DOCKER {
     EVBus *pollBus;
@@ -243,8 +359,11 @@ extern "C" {
     int32_t currentRequests;
     int32_t lostRequests;
     int32_t statsWaitRequests;
+    uint32_t cgroupStats;
     UTHash *reqsBySeqNo;
-    regex_t *contentLengthPattern;
+    UTArray *conns;
+    HSPDockerConn *eventsConn;
+    uint32_t connsOpened;
     uint32_t countdownToResync;
     uint32_t countdownToRecheck;
     int cgroupPathIdx;
@@ -270,6 +389,7 @@ extern "C" {
   static void serviceWaitQ(EVMod *mod);
 #endif
   static void serviceLostRequests(EVMod *mod);
+  static void dockerStreamField(void *magic, UTJSONParser *jp, int field, UTJSONValue *val);
   static HSPDockerRequest *containerStatsRequest(EVMod *mod, HSPVMState_DOCKER *container);
   static const char *containerStateName(EnumHSPContainerState st);
 
@@ -438,7 +558,7 @@ extern "C" {
 
       // open /proc/<nspid>/ns/net
       char topath[HSP_DOCKER_MAX_FNAME_LEN+1];
-      snprintf(topath, HSP_DOCKER_MAX_FNAME_LEN, PROCFS_STR "/%u/ns/net", nspid);
+      snprintf(topath, HSP_DOCKER_MAX_FNAME_LEN, "%s/%u/ns/net", hspFS(HSP_FS_PROC), nspid);
       int nsfd = open(topath, O_RDONLY | O_CLOEXEC);
       if(nsfd < 0) {
 	fprintf(stderr, "cannot open %s : %s", topath, strerror(errno));
@@ -479,7 +599,9 @@ extern "C" {
 	exit(EXIT_FAILURE);
       }
 
-      FILE *procFile = fopen(PROCFS_STR "/net/dev", "r");
+      char fsbuf[HSP_MAX_PATHLEN];
+
+      FILE *procFile = fopen(hspFSPath(fsbuf, HSP_MAX_PATHLEN, HSP_FS_PROC, "/net/dev"), "r");
       if(procFile) {
 	struct ifreq ifr;
 	memset(&ifr, 0, sizeof(ifr));
@@ -711,8 +833,12 @@ extern "C" {
   static void agentCB_getCounters_DOCKER_request(void *magic, SFLPoller *poller, SFL_COUNTERS_SAMPLE_TYPE *cs)
   {
     EVMod *mod = (EVMod *)magic;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
     HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
     HSPVMState_DOCKER *container = (HSPVMState_DOCKER *)poller->userData;
+    HSPCgroup *cg = container->cgroup_v2 ? hspCgroup(sp, container->cgroup_v2) : NULL;
+    if(pollBackoffVM(sp, &container->vm, cg))
+      return;
     UTHashAdd(mdata->pollActions, container);
   }
 
@@ -777,6 +903,8 @@ extern "C" {
     }
     if(container->dup_name) mdata->dup_names--;
     if(container->dup_hostname) mdata->dup_hostnames--;
+    if(container->cgroup_devices) my_free(container->cgroup_devices);
+    if(container->cgroup_v2) my_free(container->cgroup_v2);
     removeAndFreeVM(mod, &container->vm);
   }
 
@@ -841,50 +969,97 @@ extern "C" {
   */
 
   static void updateContainerCgroupPaths(EVMod *mod, HSPVMState_DOCKER *container) {
-    HSPVMState *vm = &container->vm;
-    if(vm) {
-      // open /proc/<pid>/cgroup
-      char cgpath[HSP_DOCKER_MAX_FNAME_LEN+1];
-      snprintf(cgpath, HSP_DOCKER_MAX_FNAME_LEN, PROCFS_STR "/%u/cgroup", container->pid);
-      FILE *procFile = fopen(cgpath, "r");
-      if(procFile) {
-	char line[MAX_PROC_LINE_CHARS];
-	int truncated;
-	while(my_readline(procFile, line, MAX_PROC_LINE_CHARS, &truncated) != EOF) {
-	  if(!truncated) {
-	    // expect lines like 3:devices:<long_path>
-	    int entryNo;
-	    char type[MAX_PROC_LINE_CHARS];
-	    char path[MAX_PROC_LINE_CHARS];
-	    if(sscanf(line, "%d:%[^:]:%[^:]", &entryNo, type, path) == 3) {
-	      if(my_strequal(type, "devices")) {
-		if(!my_strequal(container->cgroup_devices, path)) {
-		  if(container->cgroup_devices)
-		    my_free(container->cgroup_devices);
-		  container->cgroup_devices = my_strdup(path);
-		  myDebug(1, "docker: container(%s)->cgroup_devices=%s", container->name, container->cgroup_devices);
-		}
-	      }
-	    }
-	  }
-	}
-	fclose(procFile);
-      }
+    if(hspCgroupOfPid(container->pid, "devices", &container->cgroup_devices))
+      myDebug(1, "docker: container(%s)->cgroup_devices=%s", container->name, container->cgroup_devices);
+    if(hspCgroupV2Mount(EVROOTDATA(mod))
+       && hspCgroupOfPid(container->pid, "", &container->cgroup_v2))
+      myDebug(1, "docker: container(%s)->cgroup_v2=%s", container->name, container->cgroup_v2);
+  }
+
+  /*_________________-----------------------------__________________
+    _________________  readContainerCgroupStats   __________________
+    -----------------_____________________________------------------
+    Fill in the cpu, mem and dsk counters from the container's cgroup v2
+    directory, and the net counters from the global-namespace peers of
+    its interfaces, so that a running container can be polled without
+    asking dockerd for /stats (which can take a second to answer).
+    Returns NO if there is no cgroup v2 path to read,  in which case the
+    caller falls back on the API.  The peers' own pollers need not be
+    due on this tick,  so evt_tock() refreshes them first (see
+    refreshPeerCounters).
+  */
+
+  static bool readContainerCgroupStats(EVMod *mod, HSPVMState_DOCKER *container) {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    if(container->cgroup_v2 == NULL
+       || container->state != HSP_CS_running)
+      return NO;
+    HSPCgroup *cg = hspCgroup(sp, container->cgroup_v2);
+    HSPCgroupStats *st = cg ? hspCgroupStats(sp, cg) : NULL;
+    if(st == NULL
+       || !st->gotCPU)
+      return NO;
+    container->cpu_total = st->cpu_uS * 1000; // same nS as the API total_usage
+    if(st->gotMem) {
+      container->mem_usage = st->mem;
+      if(st->mem_max)
+	container->memoryLimit = st->mem_max;
+    }
+    if(st->gotIO)
+      container->dsk = st->dsk;
+    // the peer's transmit is the container's receive
+    memset(&container->net, 0, sizeof(container->net));
+    SFLAdaptor *adaptor;
+    ADAPTORLIST_WALK(container->vm.interfaces, adaptor) {
+      SFLAdaptor *peer = adaptorByPeerIndex(sp, adaptor->ifIndex);
+      if(peer == NULL)
+	continue;
+      SFLHost_nio_counters *nio = &ADAPTOR_NIO(peer)->nio;
+      container->net.bytes_in += nio->bytes_out;
+      container->net.pkts_in += nio->pkts_out;
+      container->net.errs_in += nio->errs_out;
+      container->net.drops_in += nio->drops_out;
+      container->net.bytes_out += nio->bytes_in;
+      container->net.pkts_out += nio->pkts_in;
+      container->net.errs_out += nio->errs_in;
+      container->net.drops_out += nio->drops_in;
     }
+    return YES;
   }
 
   /*_________________---------------------------__________________
-    _________________   buildRegexPatterns      __________________
+    _________________  refreshPeerCounters      __________________
     -----------------___________________________------------------
+    Mark the veth peers of the containers about to be read from the
+    cgroup so that they are all brought up to date in one pass over
+    /proc/net/dev (see updateNioCountersDue).
   */
-  static void buildRegexPatterns(EVMod *mod) {
+
+  static void refreshPeerCounters(EVMod *mod) {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
     HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
-    if(mdata->contentLengthPattern) {
-      // rebuild regex so it can clean up memory usage
-      regfree(mdata->contentLengthPattern);
-      my_free(mdata->contentLengthPattern);
+    time_t clk = sp->pollBus->now.tv_sec;
+    HSPVMState_DOCKER *container;
+    UTHASH_WALK(mdata->pollActions, container) {
+      if(container->cgroup_v2 == NULL
+	 || container->state != HSP_CS_running)
+	continue;
+      SFLAdaptor *adaptor;
+      ADAPTORLIST_WALK(container->vm.interfaces, adaptor) {
+	SFLAdaptor *peer = adaptorByPeerIndex(sp, adaptor->ifIndex);
+	if(peer == NULL)
+	  continue;
+	HSPAdaptorNIO *nio = ADAPTOR_NIO(peer);
+	if(nio->procNetDev
+	   && !nio->nio_due
+	   && nio->last_update != clk) {
+	  nio->nio_due = YES;
+	  sp->nio_due++;
+	}
+      }
     }
-    mdata->contentLengthPattern = UTRegexCompile(HSP_CONTENT_LENGTH_REGEX);
+    if(sp->nio_due)
+      updateNioCountersDue(sp, NO);
   }
 
   /*_________________---------------------------__________________
@@ -896,16 +1071,19 @@ extern "C" {
     HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
 
     if(mdata->currentRequests || mdata->queuedRequests || mdata->waitingRequests) {
-      myDebug(1, "docker currentRequests=%d, queuedRequests=%d, waitingRequests=%d, generatedRequests=%d, lostRequests=%d, statsWaitRequests=%d containers=%d, names=%d, hostnames=%d",
+      myDebug(1, "docker currentRequests=%d, queuedRequests=%d, waitingRequests=%d, generatedRequests=%d, lostRequests=%d, statsWaitRequests=%d cgroupStats=%u containers=%d, names=%d, hostnames=%d, connections=%u, connectionsOpened=%u",
 	      mdata->currentRequests,
 	      mdata->queuedRequests,
 	      mdata->waitingRequests,
 	      mdata->generatedRequests,
 	      mdata->lostRequests,
 	      mdata->statsWaitRequests,
+	      mdata->cgroupStats,
 	      UTHashN(mdata->vmsByID),
 	      UTHashN(mdata->nameCount),
-	      UTHashN(mdata->hostnameCount));
+	      UTHashN(mdata->hostnameCount),
+	      UTArrayN(mdata->conns),
+	      mdata->connsOpened);
     }
 
     if(mdata->countdownToResync) {
@@ -915,9 +1093,7 @@ extern "C" {
     }
     if(mdata->countdownToRecheck) {
       if(--mdata->countdownToRecheck == 0) {
-	// ebuild regex patterns periodically
-	buildRegexPatterns(mod);
-	// and check for missed containers
+	// check for missed containers
 	myDebug(1, "docker container recheck");
 	dockerContainerCapture(mod);
       }
@@ -937,7 +1113,10 @@ extern "C" {
     // But each pollAction now needs another step while we request and wait
     // for the container stats query.  So now we initiate the stats query
     // here and finally call getCounters_DOCKER when we have the answer.
+    // (Unless the counters can be read from the cgroup,  in which case
+    // getCounters_DOCKER is called right away.)
     if(!mdata->dockerFlush) {
+      refreshPeerCounters(mod);
       HSPVMState_DOCKER *container;
       UTHASH_WALK(mdata->pollActions, container) {
 	// getCounters_DOCKER(mod, container);
@@ -1119,9 +1298,13 @@ extern "C" {
   
 
   static void readContainerGPUsFromDev(EVMod *mod, HSPVMState_DOCKER *container) {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    char *devices = hspCgroupV1Mount(sp, HSP_CGROUP_V1_DEVICES);
+    if(devices == NULL)
+      return;
     // look through devices to see if individial GPUs are exposed
     char path[HSP_MAX_PATHLEN];
-    sprintf(path, SYSFS_STR "/fs/cgroup/devices/%s/devices.list", container->cgroup_devices);
+    snprintf(path, HSP_MAX_PATHLEN, "%s/%s/devices.list", devices, container->cgroup_devices);
     FILE *procFile = fopen(path, "r");
     if(procFile) {
       UTArray *arr = container->vm.gpus;
@@ -1263,8 +1446,16 @@ extern "C" {
     // for the normal polling interval to come around,  but if that is something like
     // 60 seconds then it's a long time for us to not be reporting any gauges.
     // So we introduced the waitQ,  which causes us to wait just a few seconds
-    // before sending the first stats request:
-    if(container->stats_wait) {
+    // before sending the first stats request.  If the counters can be read
+    // from the cgroup instead then just bring the first poll forward to the
+    // same point:
+    if(readContainerCgroupStats(mod, container)) {
+      SFLPoller *poller = container->vm.poller;
+      if(poller
+	 && poller->countersCountdown > HSP_DOCKER_WAIT_STATS)
+	poller->countersCountdown = HSP_DOCKER_WAIT_STATS;
+    }
+    else if(container->stats_wait) {
       // don't send it - already one outstanding
       mdata->statsWaitRequests++;
     }
@@ -1297,7 +1488,7 @@ extern "C" {
     container->inspect_tx = YES;
   }
   
-  static void dockerAPI_stats(EVMod *mod, UTStrBuf *buf, cJSON *jcont, HSPDockerRequest *req) {
+  static void dockerAPI_stats(EVMod *mod, HSPDockerRequest *req, HSPDockerStats *st) {
     // Example output
     /*
 {
@@ -1532,11 +1723,6 @@ extern "C" {
 }
     */
     myDebug(1, "dockerAPI_stats");
-  
-    cJSON *jcpu = cJSON_GetObjectItem(jcont, "cpu_stats");
-    cJSON *jmem = cJSON_GetObjectItem(jcont, "memory_stats");
-    cJSON *jnet = cJSON_GetObjectItem(jcont, "networks");
-    cJSON *jdsk = cJSON_GetObjectItem(jcont, "blkio_stats");
 
     // since the stats request does not include the container id we
     // stashed it in the request object. We could have stashed the
@@ -1552,111 +1738,18 @@ extern "C" {
     // clear the stats_wait flag so that the next stats request will be allowed
     container->stats_wait=NO;
 
-    if(jcpu) {
-      cJSON *jcpu_usage = cJSON_GetObjectItem(jcpu, "cpu_usage");
-      cJSON *jcpu_total = cJSON_GetObjectItem(jcpu_usage, "total_usage");
-      if(jcpu_total)
-	container->cpu_total = (uint64_t)jcpu_total->valuedouble;
-    }
-
-    if(jmem) {
-      cJSON *jmem_usage = cJSON_GetObjectItem(jmem, "usage");
-      if(jmem_usage)
-	container->mem_usage = (uint64_t)jmem_usage->valuedouble;
-      // memory limit seems to appear here when it doesn't appear in the "inspect" step:
-      cJSON *jmem_limit = cJSON_GetObjectItem(jmem, "limit");
-      if(jmem_limit)
-	container->memoryLimit = (uint64_t)jmem_limit->valuedouble;
-    }
-
-    if(jnet) {
-      // clear and accumulate over what may be multiple devices
-      memset(&container->net, 0, sizeof(container->net));
-      for(cJSON *dev = jnet->child; dev; dev = dev->next) {
-	cJSON *dev_bytes_in = cJSON_GetObjectItem(dev, "rx_bytes");
-	if(dev_bytes_in)
-	  container->net.bytes_in += (uint64_t)dev_bytes_in->valuedouble;
-
-	cJSON *dev_pkts_in = cJSON_GetObjectItem(dev, "rx_packets");
-	if(dev_pkts_in)
-	  container->net.pkts_in += (uint64_t)dev_pkts_in->valuedouble;
-
-	cJSON *dev_drops_in = cJSON_GetObjectItem(dev, "rx_dropped");
-	if(dev_drops_in)
-	  container->net.drops_in += (uint64_t)dev_drops_in->valuedouble;
-
-	cJSON *dev_errs_in = cJSON_GetObjectItem(dev, "rx_errors");
-	if(dev_errs_in)
-	  container->net.errs_in += (uint64_t)dev_errs_in->valuedouble;
-
-	cJSON *dev_bytes_out = cJSON_GetObjectItem(dev, "tx_bytes");
-	if(dev_bytes_out)
-	  container->net.bytes_out += (uint64_t)dev_bytes_out->valuedouble;
-
-	cJSON *dev_pkts_out = cJSON_GetObjectItem(dev, "tx_packets");
-	if(dev_pkts_out)
-	  container->net.pkts_out += (uint64_t)dev_pkts_out->valuedouble;
-
-	cJSON *dev_drops_out = cJSON_GetObjectItem(dev, "tx_dropped");
-	if(dev_drops_out)
-	  container->net.drops_out += (uint64_t)dev_drops_out->valuedouble;
-
-	cJSON *dev_errs_out = cJSON_GetObjectItem(dev, "tx_errors");
-	if(dev_errs_out)
-	  container->net.errs_out += (uint64_t)dev_errs_out->valuedouble;
-      }
-    }
-
-    if(jdsk) {
-      // clear and accumulate over what may be multiple devices
-      memset(&container->dsk, 0, sizeof(container->dsk));
-      cJSON *jbytesArray = cJSON_GetObjectItem(jdsk, "io_service_bytes_recursive");
-      if(jbytesArray) {
-	int entries = cJSON_GetArraySize(jbytesArray);
-	for(int ii = 0; ii < entries; ii++) {
-	  cJSON *jbytes = cJSON_GetArrayItem(jbytesArray, ii);
-	  if(jbytes) {
-	    cJSON *value = cJSON_GetObjectItem(jbytes, "value");
-	    if(value) {
-	      uint64_t val64 = (uint64_t)value->valuedouble;
-	      if(val64 > 0) {
-		cJSON *operation = cJSON_GetObjectItem(jbytes, "op");
-		if(operation) {
-		  if(my_strequal(operation->valuestring, "Read"))
-		    container->dsk.rd_bytes += val64;
-		  else if(my_strequal(operation->valuestring, "Write"))
-		    container->dsk.wr_bytes += val64;
-		  // ignore "Sync" and "Async"
-		}
-	      }
-	    }
-	  }
-	}
-      }
-      cJSON *jreqArray = cJSON_GetObjectItem(jdsk, "io_serviced_recursive");
-      if(jreqArray) {
-	int entries = cJSON_GetArraySize(jreqArray);
-	for(int ii = 0; ii < entries; ii++) {
-	  cJSON *jreq = cJSON_GetArrayItem(jreqArray, ii);
-	  if(jreq) {
-	    cJSON *value = cJSON_GetObjectItem(jreq, "value");
-	    if(value) {
-	      uint64_t val64 = (uint64_t)value->valuedouble;
-	      if(val64 > 0) {
-		cJSON *operation = cJSON_GetObjectItem(jreq, "op");
-		if(operation) {
-		  if(my_strequal(operation->valuestring, "Read"))
-		    container->dsk.rd_req += val64;
-		  else if(my_strequal(operation->valuestring, "Write"))
-		    container->dsk.wr_req += val64;
-		  // ignore "Sync" and "Async"
-		}
-	      }
-	    }
-	  }
-	}
-      }
-    }
+    if(st->gotCPU)
+      container->cpu_total = st->cpu_total;
+    if(st->gotMem)
+      container->mem_usage = st->mem_usage;
+    // memory limit seems to appear here when it doesn't appear in the "inspect" step:
+    if(st->gotLimit)
+      container->memoryLimit = st->memoryLimit;
+    // these were accumulated over what may be multiple devices
+    if(st->gotNet)
+      container->net = st->net;
+    if(st->gotDsk)
+      container->dsk = st->dsk;
 
     container->stats_rx = YES;
     // now (finally) we get to send the counter sample
@@ -1670,7 +1763,7 @@ extern "C" {
     // build the request (but do not send it)
     UTStrBuf *req = UTStrBuf_new();
     UTStrBuf_printf(req, HSP_DOCKER_REQ_STATS_ID, container->id);
-    HSPDockerRequest *reqObj = dockerRequest(mod, req, dockerAPI_stats, HSP_REQTYPE_STATS);
+    HSPDockerRequest *reqObj = dockerRequest(mod, req, NULL, HSP_REQTYPE_STATS);
     reqObj->id = my_strdup(container->id);
     UTStrBuf_free(req);
     return reqObj;
@@ -1678,7 +1771,12 @@ extern "C" {
 
   static void getContainerStats(EVMod *mod, HSPVMState_DOCKER *container) {
     HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
-    if(container->stats_wait) {
+    if(readContainerCgroupStats(mod, container)) {
+      // no need to involve dockerd
+      mdata->cgroupStats++;
+      getCounters_DOCKER(mod, container);
+    }
+    else if(container->stats_wait) {
       // don't send it - already one outstanding
       mdata->statsWaitRequests++;
     }
@@ -1691,60 +1789,41 @@ extern "C" {
     }
   }
 
-  static void dockerAPI_event(EVMod *mod, UTStrBuf *buf, cJSON *top, HSPDockerRequest *req) {
+  static void dockerAPI_event(EVMod *mod, HSPDockerEvent *event) {
     HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
     myDebug(1, "dockerAPI_event");
     if(mdata->dockerSync == NO) {
       // just take a copy and queue it for now
-      UTArrayAdd(mdata->eventQueue, UTStrBuf_copy(buf));
+      HSPDockerEvent *qev = (HSPDockerEvent *)my_calloc(sizeof(HSPDockerEvent));
+      *qev = *event;
+      UTArrayAdd(mdata->eventQueue, qev);
       return;
     }
-    
-    cJSON *status = cJSON_GetObjectItem(top, "status");
-    cJSON *id = cJSON_GetObjectItem(top, "id");
 
-    if(status == NULL
-       || status->valuestring == NULL
-       || my_strlen(status->valuestring) == 0) {
+    if(my_strlen(event->status) == 0) {
       myDebug(1, "ignoring event with no status");
       return;
     }
 
-    if(id == NULL
-       || id->valuestring == NULL
-       || my_strlen(id->valuestring) == 0) {
+    if(my_strlen(event->id) == 0) {
       myDebug(1, "ignoring event with no id");
       return;
     }
 
     // if it has a type, then it must be "container"
-    cJSON *type = cJSON_GetObjectItem(top, "Type");
-    if(type
-       && type->valuestring
-       && !my_strequal(type->valuestring, "container")) {
-      myDebug(1, "ignoring event for type %s", type->valuestring);
+    if(event->type[0]
+       && !my_strequal(event->type, "container")) {
+      myDebug(1, "ignoring event for type %s", event->type);
       return;
     }
 
-    // provisional name in case we don't get one below
-    char *containerName = id->valuestring;
-
-    // get name from Actor.Attributes.name
-    cJSON *actor = cJSON_GetObjectItem(top, "Actor");
-    if(actor) {
-      cJSON *attributes = cJSON_GetObjectItem(actor, "Attributes");
-      if(attributes) {
-	cJSON *ctname = cJSON_GetObjectItem(attributes, "name");
-	if(ctname
-	   && ctname->valuestring)
-	  containerName = ctname->valuestring;
-      }
-    }
+    // name from Actor.Attributes.name,  or the id if there wasn't one
+    char *containerName = event->name[0] ? event->name : event->id;
 
     HSPVMState_DOCKER *container;
-    EnumHSPContainerEvent ev = containerEvent(status->valuestring);
+    EnumHSPContainerEvent ev = containerEvent(event->status);
     if(ev == HSP_EV_UNKNOWN) {
-      myDebug(1, "unrecognized event status: %s", status->valuestring);
+      myDebug(1, "unrecognized event status: %s", event->status);
       return;
     }
 
@@ -1797,7 +1876,7 @@ extern "C" {
 
     // find container object. If it is now in the running state
     // then we will also create it here if it is not found
-    container = getContainer(mod, id->valuestring, (st == HSP_CS_running), NO);
+    container = getContainer(mod, event->id, (st == HSP_CS_running), NO);
     if(container) {
       if(st != HSP_CS_UNKNOWN
 	 && st != container->state) {
@@ -1878,14 +1957,10 @@ extern "C" {
 
     // mark as sync'd and replay queued events
     mdata->dockerSync = YES;
-    UTStrBuf *qbuf;
-    UTARRAY_WALK(mdata->eventQueue, qbuf) {
-      cJSON *top = cJSON_Parse(UTSTRBUF_STR(qbuf));
-      if(top) {
-	dockerAPI_event(mod, qbuf, top, req);
-	cJSON_Delete(top);
-      }
-      UTStrBuf_free(qbuf);
+    HSPDockerEvent *qev;
+    UTARRAY_WALK(mdata->eventQueue, qev) {
+      dockerAPI_event(mod, qev);
+      my_free(qev);
     }
     UTArrayReset(mdata->eventQueue);
   }
@@ -1904,106 +1979,462 @@ extern "C" {
     }
   }
 
-  static void processDockerJSON(EVMod *mod, HSPDockerRequest *req, UTStrBuf *buf) {
-    cJSON *top = cJSON_Parse(UTSTRBUF_STR(buf));
-    if(top) {
-      logJSON(4, "processDockerJSON:", top);
-      (*req->jsonCB)(mod, buf, top, req);
-      cJSON_Delete(top);
+  /*_________________---------------------------__________________
+    _________________   API connection pool     __________________
+    -----------------___________________________------------------
+    Requests are pipelined over a few keep-alive HTTP/1.1 connections
+    (plus one more for the event feed,  which never completes).  The
+    responses on a connection come back in the order the requests were
+    written,  so each connection keeps a queue of the ones in flight
+    and the response parser works on bytes,  not lines,  so that it
+    does not matter how the body is split into reads or chunks.
+  */
+
+  static void readDockerAPI(EVMod *mod, EVSocket *sock, void *magic);
+
+  static HSPDockerConn *dockerConnOpen(EVMod *mod, bool events) {
+    HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
+    char sockPath[HSP_MAX_PATHLEN];
+    int fd = UTUnixDomainSocket(hspFSPath(sockPath, HSP_MAX_PATHLEN, HSP_FS_VAR, HSP_DOCKER_SOCK));
+    if(fd < 0)
+      return NULL;
+    HSPDockerConn *conn = (HSPDockerConn *)my_calloc(sizeof(HSPDockerConn));
+    conn->mod = mod;
+    conn->events = events;
+    conn->rbuf = UTStrBuf_new();
+    if(events)
+      conn->stream = UTJSONNew(HSP_DOCKER_EVENT_FIELDS, HSP_DOCKER_EVF_NUM, dockerStreamField, conn);
+    else
+      conn->stream = UTJSONNew(HSP_DOCKER_STATS_FIELDS, HSP_DOCKER_STF_NUM, dockerStreamField, conn);
+    conn->sock = EVBusAddSocket(mod, mdata->pollBus, fd, readDockerAPI, conn);
+    mdata->connsOpened++;
+    if(events)
+      mdata->eventsConn = conn;
+    else
+      UTArrayAdd(mdata->conns, conn);
+    myDebug(1, "docker connection open fd=%d events=%u pool=%u",
+	    fd,
+	    events,
+	    UTArrayN(mdata->conns));
+    return conn;
+  }
+
+  // Called when a request has timed out,  or could not be sent after
+  // HSP_DOCKER_MAX_RETRIES attempts.
+  static void dockerRequestLost(EVMod *mod, HSPDockerRequest *req) {
+    myDebug(1, "docker request lost seqNo=%d req=<%s>", req->seqNo, UTSTRBUF_STR(req->request));
+    if(req->reqType == HSP_REQTYPE_CONTAINERS) {
+      // nothing to do here - another will be sent at the RECHECK time
+      return;
+    }
+    // it must be a container-specific request
+    assert(req->id);
+    HSPVMState_DOCKER *container = getContainer(mod, req->id, NO, NO);
+    if(container) {
+      // container is still around
+      if(containerDone(mod, container)) {
+	// we got the event to say it was done. I suppose we might retry if this
+	// was an attempt to get the final stats reckoning, but seems safer to just let it go.
+	removeAndFreeVM_DOCKER(mod, container);
+      }
+      else if(req->reqType == HSP_REQTYPE_STATS) {
+	// unblock the stats_wait flag so another can be sent on the next polling cycle.
+	container->stats_wait = NO;
+      }
+      else if(req->reqType == HSP_REQTYPE_INSPECT) {
+	// retransmit this request so we don't end up with a half-discovered container
+	inspectContainer(mod, container);
+      }
+      else {
+	myDebug(1, "docker unexpected request type=%d", req->reqType);
+      }
     }
   }
 
-  // Assume headers include:
-  // Content-Type: Application/JSON
-  // Transfer-Encoding: chunked
-  //
-  // Assume that the chunks of JSON content do not have CR or LF characters within them
-  // (if they ever do then we can add another "within chunk" state and append lines to
-  // the response result there).
-  static void processDockerResponse(EVMod *mod, EVSocket *sock, HSPDockerRequest *req) {
+  // If requeue is set,  requests that were written but not answered go
+  // back to the front of the requestQ (in order) to be sent again.
+  // Otherwise they are just dropped,  as when flushing everything.
+  static void dockerConnClose(EVMod *mod, HSPDockerConn *conn, bool requeue) {
     HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
-    char *line = UTSTRBUF_STR(sock->ioline);
-    myDebug(2, "processDockerResponse (state=%u) got answer (seqNo=%d len=%u): <%s>",
-	    req->state,
-	    req->seqNo,
-	    UTSTRBUF_LEN(sock->ioline),
-	    line);
-    switch(req->state) {
-
-    case HSPDOCKERREQ_HEADERS:
-      UTStrBuf_chomp(sock->ioline);
-      if(UTRegexExtractInt(mdata->contentLengthPattern, line, 1, &req->contentLength, NULL, NULL)) {
-	myDebug(1, "processDockerResponse seqNo=%d contentLength=%d", req->seqNo,  req->contentLength);
+    myDebug(1, "docker connection close events=%u inflight=%u responses=%u",
+	    conn->events,
+	    conn->nInflight,
+	    conn->responses);
+    if(conn->sock)
+      EVSocketClose(mod, conn->sock, YES);
+    conn->sock = NULL;
+    if(conn->events)
+      mdata->eventsConn = NULL;
+    else
+      UTArrayDel(mdata->conns, conn);
+    HSPDockerRequest *req;
+    while(!UTQ_EMPTY(conn->inflight)) {
+      UTQ_REMOVE_TAIL(conn->inflight, req);
+      req->conn = NULL;
+      req->sendTime = 0;
+      if(req->reqType == HSP_REQTYPE_EVENTS) {
+	dockerRequestFree(mod, req);
+	continue;
       }
-      else if(UTSTRBUF_LEN(sock->ioline) == 0) {
-	req->state = req->contentLength
-	  ? HSPDOCKERREQ_CONTENT
-	  : HSPDOCKERREQ_LENGTH;
+      assert(mdata->currentRequests > 0);
+      --mdata->currentRequests;
+      if(!requeue) {
+	dockerRequestFree(mod, req);
       }
-      break;
-
-    case HSPDOCKERREQ_ENDCONTENT:
-      UTStrBuf_chomp(sock->ioline);
-      if(UTSTRBUF_LEN(sock->ioline) == 0)
-	req->state = HSPDOCKERREQ_LENGTH;
-      break;
-      
-    case HSPDOCKERREQ_LENGTH: {
-      UTStrBuf_chomp(sock->ioline);
-      char *endp = NULL;
-      req->chunkLength = strtol(line, &endp, 16); // hex
-      if(*endp != '\0') {
-	// failed to consume the whole string - must be an error.
-	myDebug(1, "Docker error: <%s> for request(seqNo=%d): <%s>",
-		line, req->seqNo, UTSTRBUF_STR(req->request));
-	req->state = HSPDOCKERREQ_ERR;
+      else if(!req->lost
+	      && req->retries++ < HSP_DOCKER_MAX_RETRIES) {
+	UTQ_ADD_HEAD(mdata->requestQ, req);
+	mdata->queuedRequests++;
       }
       else {
-	req->state = req->chunkLength
-	  ? HSPDOCKERREQ_CONTENT
-	  : HSPDOCKERREQ_ENDCONTENT;
+	if(!req->lost)
+	  dockerRequestLost(mod, req);
+	mdata->lostRequests++;
+	dockerRequestFree(mod, req);
       }
+    }
+    conn->nInflight = 0;
+    UTStrBuf_free(conn->rbuf);
+    UTJSONFree(conn->stream);
+    my_free(conn);
+  }
+
+  static void dockerConnCloseAll(EVMod *mod) {
+    HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
+    if(mdata->eventsConn)
+      dockerConnClose(mod, mdata->eventsConn, NO);
+    while(UTArrayN(mdata->conns))
+      dockerConnClose(mod, (HSPDockerConn *)UTArrayAt(mdata->conns, 0), NO);
+  }
+
+  // Choose the connection with the fewest requests in flight, opening
+  // another if they are all busy and the pool is not full.  Returns
+  // NULL if there is no room for another request right now.
+  static HSPDockerConn *dockerConnPick(EVMod *mod) {
+    HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
+    HSPDockerConn *best = NULL;
+    HSPDockerConn *conn;
+    UTARRAY_WALK(mdata->conns, conn) {
+      if(conn->closing
+	 || conn->nInflight >= HSP_DOCKER_PIPELINE)
+	continue;
+      if(best == NULL
+	 || conn->nInflight < best->nInflight)
+	best = conn;
+    }
+    if((best == NULL || best->nInflight)
+       && UTArrayN(mdata->conns) < HSP_DOCKER_CONNECTIONS) {
+      HSPDockerConn *fresh = dockerConnOpen(mod, NO);
+      if(fresh)
+	best = fresh;
+    }
+    return best;
+  }
+
+  /*_________________---------------------------__________________
+    _________________   streamed responses      __________________
+    -----------------___________________________------------------
+  */
+
+  static bool dockerStreamed(HSPDockerRequest *req) {
+    return (req->reqType == HSP_REQTYPE_EVENTS
+	    || req->reqType == HSP_REQTYPE_STATS);
+  }
+
+  static void dockerEventField(EVMod *mod, HSPDockerConn *conn, int field, UTJSONValue *val) {
+    HSPDockerEvent *event = &conn->event;
+    switch(field) {
+    case HSP_DOCKER_EVF_STATUS:
+      UTJSONStrCopy(val, event->status, HSP_DOCKER_MAX_EVENT_FIELD);
+      break;
+    case HSP_DOCKER_EVF_ID:
+      UTJSONStrCopy(val, event->id, HSP_DOCKER_MAX_EVENT_FIELD);
+      break;
+    case HSP_DOCKER_EVF_TYPE:
+      UTJSONStrCopy(val, event->type, HSP_DOCKER_MAX_EVENT_FIELD);
+      break;
+    case HSP_DOCKER_EVF_NAME:
+      UTJSONStrCopy(val, event->name, HSP_DOCKER_MAX_EVENT_FIELD);
+      break;
+    default:
+      // end of one event
+      dockerAPI_event(mod, event);
+      memset(event, 0, sizeof(*event));
       break;
     }
+  }
 
-    case HSPDOCKERREQ_CONTENT: {
-      int clen = req->chunkLength ?: req->contentLength;
-      if(clen != UTSTRBUF_LEN(sock->ioline)) {
-	myLog(LOG_ERR, "ERROR req->chunkLength=%d req->contentLength=%d len(sock->ioline)=%d",
-	      req->chunkLength,
-	      req->contentLength,
-	      UTSTRBUF_LEN(sock->ioline));
-	myLog(LOG_ERR, "request (seqno=%d)=<%s>", req->seqNo, UTSTRBUF_STR(req->request));
-	myLog(LOG_ERR, "sock->ioline content=<%s>", UTSTRBUF_STR(sock->ioline));
+  static void dockerStatsField(EVMod *mod, HSPDockerConn *conn, int field, UTJSONValue *val) {
+    HSPDockerStats *st = &conn->stats;
+    uint64_t val64 = UTJSONU64(val);
+    switch(field) {
+    case HSP_DOCKER_STF_CPU: st->cpu_total = val64; st->gotCPU = YES; break;
+    case HSP_DOCKER_STF_MEM: st->mem_usage = val64; st->gotMem = YES; break;
+    case HSP_DOCKER_STF_MEM_LIMIT: st->memoryLimit = val64; st->gotLimit = YES; break;
+    case HSP_DOCKER_STF_NET: st->gotNet = YES; break;
+    case HSP_DOCKER_STF_RX_BYTES: st->net.bytes_in += val64; break;
+    case HSP_DOCKER_STF_RX_PACKETS: st->net.pkts_in += val64; break;
+    case HSP_DOCKER_STF_RX_DROPPED: st->net.drops_in += val64; break;
+    case HSP_DOCKER_STF_RX_ERRORS: st->net.errs_in += val64; break;
+    case HSP_DOCKER_STF_TX_BYTES: st->net.bytes_out += val64; break;
+    case HSP_DOCKER_STF_TX_PACKETS: st->net.pkts_out += val64; break;
+    case HSP_DOCKER_STF_TX_DROPPED: st->net.drops_out += val64; break;
+    case HSP_DOCKER_STF_TX_ERRORS: st->net.errs_out += val64; break;
+    case HSP_DOCKER_STF_DSK: st->gotDsk = YES; break;
+    case HSP_DOCKER_STF_BYTES_OP:
+    case HSP_DOCKER_STF_REQS_OP:
+      UTJSONStrCopy(val, st->op, sizeof(st->op));
+      break;
+    case HSP_DOCKER_STF_BYTES_VAL:
+    case HSP_DOCKER_STF_REQS_VAL:
+      st->value = val64;
+      break;
+    case HSP_DOCKER_STF_BYTES:
+    case HSP_DOCKER_STF_REQS: {
+      // end of one {"op":..,"value":..} entry.
+      // ignore "Sync" and "Async"
+      bool bytes = (field == HSP_DOCKER_STF_BYTES);
+      if(my_strequal(st->op, "Read")) {
+	if(bytes) st->dsk.rd_bytes += st->value;
+	else st->dsk.rd_req += st->value;
       }
-      assert(clen == UTSTRBUF_LEN(sock->ioline)); // assume no newlines in chunk (failing here!)
-      if(req->reqType == HSP_REQTYPE_EVENTS)
-	processDockerJSON(mod, req, sock->ioline);
-      else {
-	if(req->response == NULL)
-	  req->response = UTStrBuf_new();
-	UTStrBuf_append_n(req->response, line, UTSTRBUF_LEN(sock->ioline));
+      else if(my_strequal(st->op, "Write")) {
+	if(bytes) st->dsk.wr_bytes += st->value;
+	else st->dsk.wr_req += st->value;
       }
-      req->state = HSPDOCKERREQ_ENDCONTENT;
+      st->op[0] = '\0';
+      st->value = 0;
       break;
     }
-      
-    case HSPDOCKERREQ_ERR:
-      // TODO: just wait for EOF, or should we force the socket to close?
-      myDebug(1, "processDockerResponse seqNo=%d got error", req->seqNo);
+    default: {
+      // end of the response
+      HSPDockerRequest *req = UTQ_HEAD(conn->inflight);
+      if(req)
+	dockerAPI_stats(mod, req, st);
+      memset(st, 0, sizeof(*st));
       break;
     }
+    }
+  }
+
+  static void dockerStreamField(void *magic, UTJSONParser *jp, int field, UTJSONValue *val) {
+    HSPDockerConn *conn = (HSPDockerConn *)magic;
+    HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)conn->mod->data;
+    if(mdata->dockerFlush)
+      return;
+    if(conn->events)
+      dockerEventField(conn->mod, conn, field, val);
+    else
+      dockerStatsField(conn->mod, conn, field, val);
+  }
+
+  static void dockerStreamFeed(EVMod *mod, HSPDockerConn *conn, HSPDockerRequest *req, char *buf, size_t len) {
+    if(UTJSONError(conn->stream))
+      return; // ignore the rest of this response
+    if(!UTJSONFeed(conn->stream, buf, len))
+      myDebug(1, "docker: JSON error (%s) in response to seqNo=%d",
+	      UTJSONError(conn->stream),
+	      req->seqNo);
+  }
+
+  static void processDockerJSON(EVMod *mod, HSPDockerRequest *req, UTStrBuf *buf) {
+    cJSON *top = cJSON_Parse(UTSTRBUF_STR(buf));
+    if(top) {
+      logJSON(4, "processDockerJSON:", top);
+      (*req->jsonCB)(mod, buf, top, req);
+      cJSON_Delete(top);
+    }
+  }
+
+  static void dockerResponseDone(EVMod *mod, HSPDockerConn *conn) {
+    HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
+    HSPDockerRequest *req;
+    UTQ_REMOVE_HEAD(conn->inflight, req);
+    conn->nInflight--;
+    conn->responses++;
+    conn->state = HSPDOCKERCONN_STATUS;
+    myDebug(1, "docker response seqNo=%d status=%d len=%u",
+	    req->seqNo,
+	    conn->status,
+	    req->response ? UTSTRBUF_LEN(req->response) : 0);
+    // error responses carry a JSON message too,  and the callbacks
+    // expect to see them.
+    if(!mdata->dockerFlush
+       && req->response
+       && req->jsonCB)
+      processDockerJSON(mod, req, req->response);
+    if(req->reqType != HSP_REQTYPE_EVENTS) {
+      assert(mdata->currentRequests > 0);
+      --mdata->currentRequests;
+    }
+    dockerRequestFree(mod, req);
+  }
+
+  // Consume as much of conn->rbuf as possible.  Returns NO on a protocol
+  // error,  in which case the connection must be closed.
+  static bool dockerParse(EVMod *mod, HSPDockerConn *conn) {
+    char *buf = UTSTRBUF_STR(conn->rbuf);
+    size_t len = UTSTRBUF_LEN(conn->rbuf);
+    size_t pos = 0;
+    bool ok = YES;
+    while(ok
+	  && pos < len) {
+      HSPDockerRequest *req = UTQ_HEAD(conn->inflight);
+      if(req == NULL) {
+	myDebug(1, "docker: unexpected data on idle connection");
+	ok = NO;
+	break;
+      }
+
+      if(conn->state == HSPDOCKERCONN_BODY
+	 || conn->state == HSPDOCKERCONN_CHUNK
+	 || conn->state == HSPDOCKERCONN_EOF_BODY) {
+	size_t n = len - pos;
+	if(conn->state != HSPDOCKERCONN_EOF_BODY
+	   && n > conn->remaining)
+	  n = conn->remaining;
+	if(dockerStreamed(req))
+	  dockerStreamFeed(mod, conn, req, buf + pos, n);
+	else {
+	  if(req->response == NULL)
+	    req->response = UTStrBuf_new();
+	  UTStrBuf_append_n(req->response, buf + pos, n);
+	}
+	pos += n;
+	if(conn->state == HSPDOCKERCONN_EOF_BODY)
+	  continue;
+	conn->remaining -= n;
+	if(conn->remaining == 0) {
+	  if(conn->state == HSPDOCKERCONN_BODY)
+	    dockerResponseDone(mod, conn);
+	  else {
+	    // Each chunk of the event feed is one JSON event,  so
+	    // if one was garbled we can pick up again at the next.
+	    if(conn->events
+	       && UTJSONError(conn->stream))
+	      UTJSONReset(conn->stream);
+	    conn->state = HSPDOCKERCONN_CHUNK_END;
+	  }
+	}
+	continue;
+      }
+
+      // everything else is line-oriented
+      char *eol = memchr(buf + pos, '\n', len - pos);
+      if(eol == NULL)
+	break; // wait for more
+      *eol = '\0';
+      char *line = buf + pos;
+      pos = (eol - buf) + 1;
+      size_t llen = my_strlen(line);
+      if(llen
+	 && line[llen - 1] == '\r')
+	line[--llen] = '\0';
+      myDebug(3, "docker line (state=%u seqNo=%d): <%s>", conn->state, req->seqNo, line);
+
+      switch(conn->state) {
+      case HSPDOCKERCONN_STATUS:
+	if(llen == 0)
+	  break;
+	conn->status = 0;
+	conn->chunked = NO;
+	conn->contentLength = -1;
+	UTJSONReset(conn->stream);
+	memset(&conn->event, 0, sizeof(conn->event));
+	memset(&conn->stats, 0, sizeof(conn->stats));
+	if(sscanf(line, "HTTP/%*u.%*u %d", &conn->status) != 1) {
+	  myDebug(1, "docker: bad status line <%s> for request(seqNo=%d): <%s>",
+		  line, req->seqNo, UTSTRBUF_STR(req->request));
+	  ok = NO;
+	}
+	else
+	  conn->state = HSPDOCKERCONN_HEADERS;
+	break;
+
+      case HSPDOCKERCONN_HEADERS:
+	if(llen == 0) {
+	  // end of headers
+	  if(conn->status >= 100
+	     && conn->status < 200)
+	    conn->state = HSPDOCKERCONN_STATUS;
+	  else if(conn->chunked)
+	    conn->state = HSPDOCKERCONN_CHUNK_LEN;
+	  else if(conn->contentLength > 0) {
+	    conn->remaining = conn->contentLength;
+	    conn->state = HSPDOCKERCONN_BODY;
+	  }
+	  else if(conn->contentLength == 0
+		  || conn->status == 204
+		  || conn->status == 304)
+	    dockerResponseDone(mod, conn);
+	  else {
+	    // no length given: the body runs until the server closes
+	    conn->closing = YES;
+	    conn->state = HSPDOCKERCONN_EOF_BODY;
+	  }
+	}
+	else if(!strncasecmp(line, "Content-Length:", 15))
+	  conn->contentLength = strtoll(line + 15, NULL, 10);
+	else if(!strncasecmp(line, "Transfer-Encoding:", 18)
+		&& strcasestr(line + 18, "chunked"))
+	  conn->chunked = YES;
+	else if(!strncasecmp(line, "Connection:", 11)
+		&& strcasestr(line + 11, "close"))
+	  conn->closing = YES;
+	break;
+
+      case HSPDOCKERCONN_CHUNK_LEN: {
+	char *endp = NULL;
+	conn->remaining = strtoll(line, &endp, 16); // hex
+	if(endp == line
+	   || conn->remaining < 0
+	   || (*endp != '\0' && *endp != ';')) {
+	  // failed to consume the whole string - must be an error.
+	  myDebug(1, "docker: bad chunk length <%s> for request(seqNo=%d): <%s>",
+		  line, req->seqNo, UTSTRBUF_STR(req->request));
+	  ok = NO;
+	}
+	else
+	  conn->state = conn->remaining
+	    ? HSPDOCKERCONN_CHUNK
+	    : HSPDOCKERCONN_TRAILER;
+	break;
+      }
+
+      case HSPDOCKERCONN_CHUNK_END:
+	conn->state = HSPDOCKERCONN_CHUNK_LEN;
+	break;
+
+      case HSPDOCKERCONN_TRAILER:
+	if(llen == 0)
+	  dockerResponseDone(mod, conn);
+	break;
+
+      default:
+	break;
+      }
+    }
+    UTStrBuf_snip_prefix(conn->rbuf, pos);
+    return ok;
   }
 
+  static bool dockerAPISend(EVMod *mod, HSPDockerRequest *req);
+
   static void serviceRequestQ(EVMod *mod) {
     HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
     while(mdata->currentRequests < HSP_DOCKER_MAX_CONCURRENT
+	  && !mdata->dockerFlush
 	  && !UTQ_EMPTY(mdata->requestQ)) {
       // see if we have another request queued
       HSPDockerRequest *nextReq;
       UTQ_REMOVE_HEAD(mdata->requestQ, nextReq);
       --mdata->queuedRequests;
-      dockerAPIRequest(mod, nextReq);
+      if(!dockerAPISend(mod, nextReq)) {
+	// no room - put it back and try again later
+	UTQ_ADD_HEAD(mdata->requestQ, nextReq);
+	mdata->queuedRequests++;
+	break;
+      }
     }
   }
 
@@ -2054,142 +2485,141 @@ extern "C" {
 	// assume queued
 	reqs_queued++;
       }
-      else if((now - req->sendTime) > HSP_DOCKER_REQ_TIMEOUT) {
+      else if(!req->lost
+	      && (now - req->sendTime) > HSP_DOCKER_REQ_TIMEOUT) {
 	// timeout - the engine seems to have ignored this request. Have to free the resources and possibly resubmit.
 	reqs_lost++;
-	myDebug(1, "serviceLostRequests: req lost seqNo=%d req=<%s>", req->seqNo, UTSTRBUF_STR(req->request));
-
-	if(req->reqType == HSP_REQTYPE_CONTAINERS) {
-	  // nothing to do here - another will be sent at the RECHECK time
-	}
-	else {
-	  // it must be a container-specific request
-	  assert(req->id);
-	  HSPVMState_DOCKER *container = getContainer(mod, req->id, NO, NO);
-	  if(container) {
-	    // container is still around
-	    if(containerDone(mod, container)) {
-	      // we got the event to say it was done. I suppose we might retry if this
-	      // was an attempt to get the final stats reckoning, but seems safer to just let it go.
-	      removeAndFreeVM_DOCKER(mod, container);
-	    }
-	    else if(req->reqType == HSP_REQTYPE_STATS) {
-	      // unblock the stats_wait flag so another can be sent on the next polling cycle.
-	      container->stats_wait = NO;
-	    }
-	    else if(req->reqType == HSP_REQTYPE_INSPECT) {
-	      // retransmit this request so we don't end up with a half-discovered container
-	      inspectContainer(mod, container);
-	    }
-	    else {
-	      myDebug(1, "docker unexpected request type=%d", req->reqType);
-	    }
+	req->lost = YES;
+	dockerRequestLost(mod, req);
+      }
+    }
+    if(reqs_lost == 0)
+      return;
+    // A lost request holds up everything pipelined behind it on the same
+    // connection,  so close that connection and send the others again.
+    for(;;) {
+      HSPDockerConn *conn, *lostConn = NULL;
+      UTARRAY_WALK(mdata->conns, conn) {
+	UTQ_WALK(conn->inflight, req) {
+	  if(req->lost) {
+	    lostConn = conn;
+	    break;
 	  }
 	}
-
-	// if the request was really sent out correctly then it will have a socket as well as a sendTime
-	if(req->sock) {
-	  // close the socket to save file descriptors - may flush something through so make
-	  // sure we do this before freeing the request
-	  EVSocketClose(mod, req->sock, YES);
-	  dockerRequestFree(mod, req);
-	  --mdata->currentRequests;
-	  mdata->lostRequests++;
-	}
+	if(lostConn)
+	  break;
       }
+      if(lostConn == NULL)
+	break;
+      dockerConnClose(mod, lostConn, YES);
     }
   }
-    
-  static void readDockerCB(EVMod *mod, EVSocket *sock, EnumEVSocketReadStatus status, void *magic) {
+
+  static void readDockerAPI(EVMod *mod, EVSocket *sock, void *magic) {
     HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
-    HSPDockerRequest *req = (HSPDockerRequest *)magic;
-    switch(status) {
-    case EVSOCKETREAD_AGAIN:
-      break;
-    case EVSOCKETREAD_STR:
-      myDebug(1, "new string for request seqNo=%d=<%s>", req->seqNo, UTSTRBUF_STR(req->request));
-      if(!mdata->dockerFlush) {
-	processDockerResponse(mod, sock, req);
-	UTStrBuf_reset(sock->ioline);
-      }
-      break;
-    case EVSOCKETREAD_EOF:
-      myDebug(1, "EOF for request seqNo=%d=<%s>", req->seqNo, UTSTRBUF_STR(req->request));
-      if(!mdata->dockerFlush) {
-	if(req->response)
-	  processDockerJSON(mod, req, req->response);
+    HSPDockerConn *conn = (HSPDockerConn *)magic;
+    UTStrBuf_need(conn->rbuf, HSP_DOCKER_READ_INCBYTES);
+    int cc;
+    while((cc = read(sock->fd,
+		     UTSTRBUF_STR(conn->rbuf) + UTSTRBUF_LEN(conn->rbuf),
+		     HSP_DOCKER_READ_INCBYTES)) < 0
+	  && errno == EINTR);
+    if(cc > 0) {
+      UTSTRBUF_LEN(conn->rbuf) += cc;
+      if(dockerParse(mod, conn)) {
+	if(conn->closing
+	   && conn->state == HSPDOCKERCONN_STATUS) {
+	  // server is closing after that response - anything
+	  // else in flight will have to be sent again
+	  dockerConnClose(mod, conn, YES);
+	}
+	serviceRequestQ(mod);
+	return;
       }
-      // fall through
-    case EVSOCKETREAD_BADF:
-    case EVSOCKETREAD_ERR:
-      // clean up
-      myDebug(1, "request done seqNo=%d=<%s>", req->seqNo, UTSTRBUF_STR(req->request));
+    }
+    else if(cc == 0) {
+      myDebug(1, "docker connection EOF events=%u inflight=%u", conn->events, conn->nInflight);
+      if(conn->state == HSPDOCKERCONN_EOF_BODY)
+	dockerResponseDone(mod, conn);
+    }
+    else {
+      myLog(LOG_ERR, "readDockerAPI(): %s", strerror(errno));
+    }
 
-      if(req->reqType == HSP_REQTYPE_EVENTS) {
-	// we lost the event feed - need to flush and resync
-	mdata->dockerFlush = YES;
-      }
-      else {
-	assert(mdata->currentRequests > 0);
-	--mdata->currentRequests;
-      }
+    bool events = conn->events;
+    dockerConnClose(mod, conn, YES);
+    if(events
+       && !mdata->dockerFlush) {
+      // we lost the event feed - need to flush and resync
+      mdata->dockerFlush = YES;
+      dockerConnCloseAll(mod);
+      mdata->dockerFlush = NO;
+      mdata->countdownToResync = HSP_DOCKER_WAIT_EVENTDROP;
+    }
+    else
+      serviceRequestQ(mod);
+  }
 
-      // free the request - (it's not in any other collection)
-      dockerRequestFree(mod, req);
-      req = NULL;
-      
-      if(mdata->dockerFlush &&
-	 mdata->currentRequests == 0) {
-	// no outstanding requests - flush is done
-	mdata->dockerFlush = NO;
-	mdata->countdownToResync = HSP_DOCKER_WAIT_EVENTDROP;
+  // Returns NO if there was no connection with room for it.
+  static bool dockerAPISend(EVMod *mod, HSPDockerRequest *req) {
+    HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
+    HSPDockerConn *conn = NULL;
+    if(req->reqType == HSP_REQTYPE_EVENTS) {
+      if(mdata->eventsConn)
+	dockerConnClose(mod, mdata->eventsConn, NO);
+      conn = dockerConnOpen(mod, YES);
+    }
+    else
+      conn = dockerConnPick(mod);
+    if(conn == NULL) {
+      if(req->reqType == HSP_REQTYPE_EVENTS
+	 || UTArrayN(mdata->conns) == 0) {
+	// looks like docker was stopped
+	// wait longer before retrying
+	mdata->dockerFlush = YES;
+	mdata->countdownToResync = HSP_DOCKER_WAIT_NOSOCKET;
       }
-
-      // see if we have another request queued
-    if(!mdata->dockerFlush)
-      serviceRequestQ(mod);
+      return NO;
     }
-  }
-    
-  static void readDockerAPI(EVMod *mod, EVSocket *sock, void *magic) {
-    EVSocketReadLines(mod, sock, readDockerCB, NO, magic);
+    char *cmd = UTSTRBUF_STR(req->request);
+    ssize_t len = UTSTRBUF_LEN(req->request);
+    myDebug(1, "dockerAPIRequest(%s) seqNo=%d, fd=%d inflight=%u", cmd, req->seqNo, conn->sock->fd, conn->nInflight);
+    int cc;
+    // simulate random loss
+    //if(sfl_random(100) > 80) cc = len; else
+    // the engine may have closed an idle connection,  so don't take SIGPIPE
+    while((cc = send(conn->sock->fd, cmd, len, MSG_NOSIGNAL)) != len && errno == EINTR);
+    if(cc != len) {
+      myLog(LOG_ERR, "dockerAPIRequest - write(%s) returned %d != %u: %s",
+	    cmd, cc, len, strerror(errno));
+      // We may be inside a callback for a response on this same
+      // connection,  so leave it to readDockerAPI() to close it.
+      conn->closing = YES;
+      return NO;
+    }
+    req->conn = conn;
+    UTQ_ADD_TAIL(conn->inflight, req);
+    conn->nInflight++;
+    if(req->reqType != HSP_REQTYPE_EVENTS) {
+      req->sendTime = EVCurrentBus()->now.tv_sec;
+      mdata->currentRequests++;
+    }
+    return YES;
   }
 
   static void dockerAPIRequest(EVMod *mod, HSPDockerRequest *req) {
     HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
-    if(mdata->currentRequests >= HSP_DOCKER_MAX_CONCURRENT) {
+    if(mdata->currentRequests >= HSP_DOCKER_MAX_CONCURRENT
+       || !UTQ_EMPTY(mdata->requestQ)
+       || !dockerAPISend(mod, req)) {
       // just queue it
+      if(req->reqType == HSP_REQTYPE_EVENTS) {
+	// will be sent again on resync
+	dockerRequestFree(mod, req);
+	return;
+      }
       UTQ_ADD_TAIL(mdata->requestQ, req);
       mdata->queuedRequests++;
-      return;
-    }
-    char *cmd = UTSTRBUF_STR(req->request);
-    ssize_t len = UTSTRBUF_LEN(req->request);
-    int fd = UTUnixDomainSocket(HSP_DOCKER_SOCK);
-    myDebug(1, "dockerAPIRequest(%s) seqNo=%d, fd==%d", cmd, req->seqNo, fd);
-    if(fd < 0)  {
-      // looks like docker was stopped
-      // wait longer before retrying
-      mdata->dockerFlush = YES;
-      mdata->countdownToResync = HSP_DOCKER_WAIT_NOSOCKET;
-    }
-    else {
-      req->sock = EVBusAddSocket(mod, mdata->pollBus, fd, readDockerAPI, req);
-
-      int cc;
-      // simulate random loss
-      //if(sfl_random(100) > 80) cc = len; else
-      while((cc = write(fd, cmd, len)) != len && errno == EINTR);
-      if(cc == len) {
-	if(req->reqType != HSP_REQTYPE_EVENTS) {
-	  req->sendTime = EVCurrentBus()->now.tv_sec;
-	  mdata->currentRequests++;
-	}
-      }
-      else {
-	myLog(LOG_ERR, "dockerAPIRequest - write(%s) returned %d != %u: %s",
-	      cmd, cc, len, strerror(errno));
-      }
     }
   }
   
@@ -2216,6 +2646,8 @@ extern "C" {
   static void dockerClearAll(EVMod *mod) {
     HSP_mod_DOCKER *mdata = (HSP_mod_DOCKER *)mod->data;
     // clear everything out:
+    // 0. connections, and the requests in flight on them
+    dockerConnCloseAll(mod);
     // 1. pollActions
     UTHashReset(mdata->pollActions);
     // 2. containers
@@ -2223,9 +2655,9 @@ extern "C" {
     UTHASH_WALK(mdata->vmsByID, container)
       removeAndFreeVM_DOCKER(mod, container);
     // 3. event queue
-    UTStrBuf *qbuf;
-    UTARRAY_WALK(mdata->eventQueue, qbuf)
-      UTStrBuf_free(qbuf);
+    HSPDockerEvent *qev;
+    UTARRAY_WALK(mdata->eventQueue, qev)
+      my_free(qev);
     UTArrayReset(mdata->eventQueue);
     // 4. request queue
     HSPDockerRequest *req, *nx;
@@ -2271,7 +2703,7 @@ extern "C" {
     // start the event monitor before we capture the current state.  Events will be queued until we have
     // read all the current containers, then replayed.  At that point we will be "in sync".
     UTStrBuf *req = UTStrBuf_wrap(HSP_DOCKER_REQ_EVENTS);
-    dockerAPIRequest(mod, dockerRequest(mod, req, dockerAPI_event, HSP_REQTYPE_EVENTS));
+    dockerAPIRequest(mod, dockerRequest(mod, req, NULL, HSP_REQTYPE_EVENTS));
     UTStrBuf_free(req);
     dockerContainerCapture(mod);
   }
@@ -2364,7 +2796,7 @@ extern "C" {
 
     requestVNodeRole(mod, HSP_VNODE_PRIORITY_DOCKER);
 
-    buildRegexPatterns(mod);
+    mdata->conns = UTArrayNew(UTARRAY_PACK);
     mdata->vmsByUUID = UTHASH_NEW(HSPVMState_DOCKER, vm.uuid, UTHASH_DFLT);
     mdata->vmsByID = UTHASH_NEW(HSPVMState_DOCKER, id, UTHASH_SKEY);
     mdata->nameCount = UTHASH_NEW(HSPDockerNameCount, name, UTHASH_SKEY);
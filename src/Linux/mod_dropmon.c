@@ -922,7 +922,9 @@ That would allow everything to stay on the stack as it does here, which has nice
       SFLADD_ELEMENT(&discard, &rnElem);
     }
 
+    EVBus *bus = EVCurrentBus();
     SEMLOCK_DO(sp->sync_agent) {
+      sfl_agent_set_now(sp->agent, bus->now.tv_sec, bus->now.tv_nsec);
       sfl_notifier_writeEventSample(notifier, &discard);
       sp->telemetry[HSP_TELEMETRY_EVENT_SAMPLES]++;
     }
@@ -42,7 +42,7 @@ extern "C" {
     int chunkLength;
   } HSPEapiRequest;
 
-#define HSP_EAPI_SOCK  VARFS_STR "/run/command-api.sock"
+#define HSP_EAPI_SOCK  "/run/command-api.sock" // under VARFS
 #define HSP_EAPI_HTTP "HTTP/1.0\nHost: localhost\n"
 #define HSP_EAPI_CONTENT "Content-Type: application/json\nContent-Length: %u\n\n"
 #define HSP_EAPI_REQ_FMT "POST / " HSP_EAPI_HTTP HSP_EAPI_CONTENT "%s"
@@ -335,10 +335,11 @@ Expecting something like:
     HSP_mod_Eapi *mdata = (HSP_mod_Eapi *)mod->data;
     char *cmd = UTSTRBUF_STR(req->request);
     ssize_t len = UTSTRBUF_LEN(req->request);
-    int fd = UTUnixDomainSocket(HSP_EAPI_SOCK);
+    char sockPath[HSP_MAX_PATHLEN];
+    int fd = UTUnixDomainSocket(hspFSPath(sockPath, HSP_MAX_PATHLEN, HSP_FS_VAR, HSP_EAPI_SOCK));
     myDebug(1, "eapiRequest(%s) fd==%d", cmd, fd);
     if(fd < 0)  {
-      myLog(LOG_ERR, "eapiRequest - cannot open unixsocket: %s", HSP_EAPI_SOCK);
+      myLog(LOG_ERR, "eapiRequest - cannot open unixsocket: %s", sockPath);
     }
     else {
       EVBusAddSocket(mod, mdata->configBus, fd, readEapi, req);
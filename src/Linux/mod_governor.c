@@ -0,0 +1,190 @@
+/* This software is distributed under the following license:
+ * http://sflow.net/license.html
+ */
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+  /*
+    CPU-budget governor.  Configure with:
+
+    governor { cpu=2.0 interval=10 }
+
+    where cpu is the budget as a percentage of one core, summed
+    over all the bus threads.  Every interval seconds we compare
+    the thread CPU consumed (as measured in evbus.c) with the
+    budget and move one step up or down the load-shedding ladder:
+
+    1-3: sub-sample packet samples by 2, 4, 8
+    4:   trim headerBytes
+    5:   stretch counter-polling interval
+    6:   pause optional annotators (mod_tcp diag lookups)
+  */
+
+#include "hsflowd.h"
+
+  typedef enum {
+    HSP_GOVERNOR_LEVEL_NONE=0,
+    HSP_GOVERNOR_LEVEL_SUBSAMPLE_2,
+    HSP_GOVERNOR_LEVEL_SUBSAMPLE_4,
+    HSP_GOVERNOR_LEVEL_SUBSAMPLE_8,
+    HSP_GOVERNOR_LEVEL_HEADERBYTES,
+    HSP_GOVERNOR_LEVEL_POLLING,
+    HSP_GOVERNOR_LEVEL_ANNOTATORS,
+    HSP_GOVERNOR_NUM_LEVELS
+  } EnumGovernorLevel;
+
+  static const char *GovernorLevelNames[] = {
+    "none",
+    "subsample_2",
+    "subsample_4",
+    "subsample_8",
+    "headerBytes",
+    "polling",
+    "annotators"
+  };
+
+#define HSP_GOVERNOR_HEADER_BYTES 64
+#define HSP_GOVERNOR_POLLING_FACTOR 2
+  // only step down again when well under budget,
+  // otherwise we will just oscillate
+#define HSP_GOVERNOR_RELAX_FRACTION 0.5
+
+  static char *GovernedBuses[] = {
+    HSPBUS_POLL,
+    HSPBUS_PACKET,
+    HSPBUS_CONFIG
+  };
+#define HSP_GOVERNOR_NUM_BUSES (sizeof(GovernedBuses) / sizeof(char *))
+
+  typedef struct _HSP_mod_GOVERNOR {
+    EVBus *pollBus;
+    time_t next_decision;
+    struct timespec last_wall;
+    uint64_t last_cpu_nS[HSP_GOVERNOR_NUM_BUSES];
+    uint64_t last_total_nS;
+  } HSP_mod_GOVERNOR;
+
+  /*_________________---------------------------__________________
+    _________________      applyLevel           __________________
+    -----------------___________________________------------------
+  */
+
+  static void applyLevel(EVMod *mod, EnumGovernorLevel level) {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+
+    uint32_t subSampling = 1;
+    if(level >= HSP_GOVERNOR_LEVEL_SUBSAMPLE_8)
+      subSampling = 8;
+    else if(level >= HSP_GOVERNOR_LEVEL_SUBSAMPLE_4)
+      subSampling = 4;
+    else if(level >= HSP_GOVERNOR_LEVEL_SUBSAMPLE_2)
+      subSampling = 2;
+    sp->governor.subSampling = subSampling;
+
+    uint32_t headerBytes = (level >= HSP_GOVERNOR_LEVEL_HEADERBYTES) ? HSP_GOVERNOR_HEADER_BYTES : 0;
+    if(headerBytes != sp->governor.headerBytes) {
+      sp->governor.headerBytes = headerBytes;
+      updateSamplerHeaderBytes(sp);
+    }
+
+    uint32_t pollingFactor = (level >= HSP_GOVERNOR_LEVEL_POLLING) ? HSP_GOVERNOR_POLLING_FACTOR : 1;
+    if(pollingFactor != sp->governor.pollingFactor) {
+      sp->governor.pollingFactor = pollingFactor;
+      updatePollingInterval(sp);
+    }
+
+    sp->governor.pauseAnnotators = (level >= HSP_GOVERNOR_LEVEL_ANNOTATORS);
+
+    sp->governor.level = level;
+    sp->telemetry[HSP_TELEMETRY_GOVERNOR_LEVEL] = level;
+  }
+
+  /*_________________---------------------------__________________
+    _________________       evt_tick            __________________
+    -----------------___________________________------------------
+  */
+
+  static void evt_tick(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
+    HSP_mod_GOVERNOR *mdata = (HSP_mod_GOVERNOR *)mod->data;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+
+    time_t now = mdata->pollBus->now.tv_sec;
+    if(now < mdata->next_decision)
+      return;
+    mdata->next_decision = now + sp->governor.interval;
+
+    // the interval is only approximate, so measure the wall-clock time too
+    bool first = (mdata->last_wall.tv_sec == 0);
+    int wall_mS = EVTimeDiff_mS(&mdata->last_wall, &mdata->pollBus->now);
+    mdata->last_wall = mdata->pollBus->now;
+
+    uint64_t total_nS = 0;
+    for(int ii = 0; ii < HSP_GOVERNOR_NUM_BUSES; ii++) {
+      EVBus *bus = EVGetBus(mod, GovernedBuses[ii], NO);
+      if(bus == NULL)
+	continue;
+      uint64_t cpu_nS = EVBusCPU_nS(bus);
+      if(!first
+	 && wall_mS > 0)
+	myDebug(1, "governor: bus %s cpu_ppm=%"PRIu64,
+		GovernedBuses[ii],
+		(cpu_nS - mdata->last_cpu_nS[ii]) / wall_mS);
+      mdata->last_cpu_nS[ii] = cpu_nS;
+      total_nS += cpu_nS;
+    }
+    uint64_t delta_nS = total_nS - mdata->last_total_nS;
+    mdata->last_total_nS = total_nS;
+    sp->telemetry[HSP_TELEMETRY_GOVERNOR_CPU_USECS] = total_nS / 1000;
+
+    if(first
+       || wall_mS <= 0)
+      return;
+
+    // nS per mS is parts-per-million of one core
+    uint64_t ppm = delta_nS / wall_mS;
+    uint64_t budget_ppm = sp->governor.cpu * 10000;
+    sp->telemetry[HSP_TELEMETRY_GOVERNOR_CPU_PPM] = ppm;
+
+    EnumGovernorLevel level = sp->governor.level;
+    if(ppm > budget_ppm
+       && level < (HSP_GOVERNOR_NUM_LEVELS - 1)) {
+      level++;
+      sp->telemetry[HSP_TELEMETRY_GOVERNOR_ESCALATIONS]++;
+    }
+    else if(ppm < (budget_ppm * HSP_GOVERNOR_RELAX_FRACTION)
+	    && level > HSP_GOVERNOR_LEVEL_NONE) {
+      level--;
+      sp->telemetry[HSP_TELEMETRY_GOVERNOR_RELAXATIONS]++;
+    }
+    else
+      return;
+
+    myLog(LOG_INFO, "governor: cpu_ppm=%"PRIu64" budget_ppm=%"PRIu64" level %s -> %s",
+	  ppm,
+	  budget_ppm,
+	  GovernorLevelNames[sp->governor.level],
+	  GovernorLevelNames[level]);
+    applyLevel(mod, level);
+  }
+
+  /*_________________---------------------------__________________
+    _________________    module init            __________________
+    -----------------___________________________------------------
+  */
+
+  void mod_governor(EVMod *mod) {
+    mod->data = my_calloc(sizeof(HSP_mod_GOVERNOR));
+    HSP_mod_GOVERNOR *mdata = (HSP_mod_GOVERNOR *)mod->data;
+    // turn on thread CPU accounting for all buses
+    EVMeasureCPU(mod, YES);
+    applyLevel(mod, HSP_GOVERNOR_LEVEL_NONE);
+    // register call-backs
+    mdata->pollBus = EVGetBus(mod, HSPBUS_POLL, YES);
+    EVEventRx(mod, EVGetEvent(mdata->pollBus, EVEVENT_TICK), evt_tick);
+  }
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
@@ -7,11 +7,17 @@ extern "C" {
 #endif
 
 #include "hsflowd.h"
+#include <math.h>
 
 #include "cJSON.h"
+#include "cJSON_Arena.h"
+#include "hsflow_ring.h"
 #define HSP_MAX_JSON_MSG_BYTES 10000
 #define HSP_READJSON_BATCH 100
+#define HSP_JSON_MMSG_BATCH 16 // datagrams per recvmmsg()
 #define HSP_JSON_RCV_BUF 2000000
+#define HSP_JSON_RING_SLOTS 4096 // 4MB
+#define HSP_JSON_RING_ABANDON 2 // seconds a slot may stay reserved
 
   typedef enum {
     RTMetricType_string = 0,
@@ -60,16 +66,43 @@ extern "C" {
     SFLCounters_sample_element counters;
   } HSPApplication;
 
+  // One per bus that reads JSON,  so the parse arena and the
+  // recvmmsg() buffers are only ever touched by that bus's thread.
+  typedef struct _HSPJSONReader {
+    EVBus *bus;
+    cJSON_Arena *arena;
+    struct mmsghdr *mmsgs;
+    struct iovec *iovs;
+    char *bufs;
+  } HSPJSONReader;
+
   typedef struct _HSP_mod_JSON {
     EVBus *pollBus;
     EVBus *packetBus;
     int json_soc;
     int json_soc6;
     int json_fifo;
+    UTArray *readers;
+    // the applications are shared by all the reader threads,  and
+    // with the packetBus which sends their counters and times them out
+    pthread_mutex_t *sync_apps;
     UTHash *applicationHT;
     UTQ(HSPApplication) timeoutQ;
     UTArray *pollActions;
     time_t next_app_timeout_check;
+    // shared-memory ring,  drained on the packetBus.  The header is
+    // writable by every producer,  so the consumer keeps its own copy
+    // of the geometry and the read position.
+    hsflow_ring ring;
+    uint32_t ring_slots;
+    uint64_t ring_tail;
+    uint64_t ring_wait_pos;
+    time_t ring_wait_since;
+    uint64_t ring_dropped;
+    // rtmetric aggregation,  fed from all the reader buses
+    pthread_mutex_t *sync_rtm;
+    UTHash *rtmDatasourceHT;
+    time_t next_rtm_window;
   } HSP_mod_JSON;
 
   /*_________________---------------------------__________________
@@ -164,7 +197,6 @@ extern "C" {
 
   static HSPApplication *addApplication(EVMod *mod, char *application, uint16_t servicePort)
   {
-    HSP_mod_JSON *mdata = (HSP_mod_JSON *)mod->data;
     HSP *sp = (HSP *)EVROOTDATA(mod);
 
     // assigning dsIndex:
@@ -214,7 +246,7 @@ extern "C" {
     aa->counters.counterBlock.app.application.len = my_strlen(aa->application);
     // start off assuming that the application is going to send it's own counters
     aa->json_counters = YES;
-    aa->last_json_counters = mdata->packetBus->now.tv_sec;
+    aa->last_json_counters = EVCurrentBus()->now.tv_sec;
     // sampler
     SEMLOCK_DO(sp->sync_agent) {
       aa->sampler = sfl_agent_addSampler(sp->agent, &dsi);
@@ -420,13 +452,41 @@ extern "C" {
     myDebug(2, "sendAppSample (sampling_n=%d)", sampling_n);
     // and send it out
     EVBus *bus = EVCurrentBus();
-    sfl_agent_set_now(sp->agent, bus->now.tv_sec, bus->now.tv_nsec);
     SEMLOCK_DO(sp->sync_agent) {
+      sfl_agent_set_now(sp->agent, bus->now.tv_sec, bus->now.tv_nsec);
       sfl_sampler_writeFlowSample(app->sampler, &fs);
       sp->telemetry[HSP_TELEMETRY_FLOW_SAMPLES]++;
     }
   }
 
+  /*_________________---------------------------__________________
+    _________________      appSampling          __________________
+    -----------------___________________________------------------
+    Count a transaction that the application reported with its own
+    sampling_n,  and decide whether to sample it too.  Returns the
+    effective sampling_n,  or 0 to skip it.
+  */
+
+  static uint32_t appSampling(HSPApplication *application, uint32_t sampling_n, EnumSFLAPPStatus status)
+  {
+    // update my version of the counters - even if we are not going to send them
+    // because the application is sending them anyway.  It will be a good cross-check
+    int ii = (uint)status;
+    uint32_t *errorCounterArray = &application->counters.counterBlock.app.status_OK;
+    errorCounterArray[ii] += sampling_n;
+
+    // decide if we are going to sample this transaction, based
+    // on the ratio of sampling_n to the configured sampling rate
+    // in the sampler.
+    uint32_t config_sampling_n = sfl_sampler_get_sFlowFsPacketSamplingRate(application->sampler);
+    uint32_t sub_sampling_n = config_sampling_n / sampling_n;
+    if(sub_sampling_n == 0) sub_sampling_n = 1;
+    if(sub_sampling_n == 1
+       || sfl_random(sub_sampling_n * 16) <= 16)
+      return sampling_n * sub_sampling_n;
+    return 0;
+  }
+
   /*_________________---------------------------__________________
     _________________      readJSON_flowSample  __________________
     -----------------___________________________------------------
@@ -434,7 +494,6 @@ extern "C" {
 
 static void readJSON_flowSample(EVMod *mod, cJSON *fs)
   {
-    HSP_mod_JSON *mdata = (HSP_mod_JSON *)mod->data;
     HSP *sp = (HSP *)EVROOTDATA(mod);
 
     if(getDebug() > 1) logJSON(fs, "got flow sample");
@@ -448,7 +507,7 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
       HSPApplication *application = getApplication(mod, app->valuestring, service_port);
       if(application) {
 	// remember that we heard from this application
-	application->last_json = mdata->packetBus->now.tv_sec;
+	application->last_json = EVCurrentBus()->now.tv_sec;
 
 	cJSON *opn = cJSON_GetObjectItem(fs, "app_operation");
 	if(opn) {
@@ -461,21 +520,8 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
 	    }
 	  }
 
-	  // update my version of the counters - even if we are not going to send them
-	  // because the application is sending them anyway.  It will be a good cross-check
-	  int ii = (uint)status;
-	  uint32_t *errorCounterArray = &application->counters.counterBlock.app.status_OK;
-	  errorCounterArray[ii] += sampling_n;
-
-	  // decide if we are going to sample this transaction, based
-	  // on the ratio of sampling_n to the configured sampling rate
-	  // in the sampler.
-	  uint32_t config_sampling_n = sfl_sampler_get_sFlowFsPacketSamplingRate(application->sampler);
-	  uint32_t sub_sampling_n = config_sampling_n / sampling_n;
-	  if(sub_sampling_n == 0) sub_sampling_n = 1;
-	  uint32_t effective_sampling_n = sampling_n * sub_sampling_n;
-	  if(sub_sampling_n == 1
-	     || sfl_random(sub_sampling_n * 16) <= 16) {
+	  uint32_t effective_sampling_n = appSampling(application, sampling_n, status);
+	  if(effective_sampling_n) {
 	    // sample this one
 
 	    // extract operation fields
@@ -592,7 +638,6 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
 
   static void readJSON_counterSample(EVMod *mod, cJSON *cs)
   {
-    HSP_mod_JSON *mdata = (HSP_mod_JSON *)mod->data;
     HSP *sp = (HSP *)EVROOTDATA(mod);
 
     if(getDebug() > 1) logJSON(cs, "got counter sample");
@@ -602,9 +647,9 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
       HSPApplication *application = getApplication(mod, app_name->valuestring, service_port);
       if(application) {
 	// remember that we heard from this application
-	application->last_json = mdata->packetBus->now.tv_sec;
+	application->last_json = EVCurrentBus()->now.tv_sec;
 	// and remember that the application sent these counters
-	application->last_json_counters = mdata->packetBus->now.tv_sec;
+	application->last_json_counters = EVCurrentBus()->now.tv_sec;
 
 	SFL_COUNTERS_SAMPLE_TYPE csample = { 0 };
 	// app_operations
@@ -739,6 +784,25 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
     xdr_enc_bytes(buf, (u_char *)str, len);
   }
 
+  /*_________________---------------------------__________________
+    _________________     sendEncoded           __________________
+    -----------------___________________________------------------
+    Send one pre-encoded (rtmetric or rtflow) sample.
+  */
+
+  static void sendEncoded(HSP *sp, SFLReceiver *receiver, uint32_t *xdr, uint32_t len, int telemetry)
+  {
+    EVBus *bus = EVCurrentBus();
+    SEMLOCK_DO(sp->sync_agent) {
+      sfl_agent_set_now(sp->agent, bus->now.tv_sec, bus->now.tv_nsec);
+      sfl_receiver_writeEncoded(receiver,
+				1,
+				xdr,
+				len);
+      sp->telemetry[telemetry]++;
+    }
+  }
+
   /*_________________---------------------------__________________
     _________________    rtmetric types         __________________
     -----------------___________________________------------------
@@ -852,6 +916,556 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
     return rtmetric_len_ok(str);
   }
 
+  /*_________________---------------------------__________________
+    _________________   rtmetric_key_ok         __________________
+    -----------------___________________________------------------
+    As rtmetric_len_ok(),  for a key that is not NUL-terminated.
+  */
+
+  static bool rtmetric_key_ok(char *str, uint32_t len) {
+    if(len == 0
+       || len > HSP_MAX_RTMETRIC_KEY_LEN)
+      return NO;
+    for(uint32_t ii = 0; ii < len; ii++) {
+      int ch = str[ii];
+      if(ch != '-' &&
+	 ch != '_' &&
+	 !isalnum(ch))
+	return NO;
+    }
+    return YES;
+  }
+
+  /*_________________---------------------------__________________
+    _________________    xdr_rt_val_quads       __________________
+    -----------------___________________________------------------
+    Size of an XDR-encoded rtmetric or rtflow value,  or 0 if the type
+    is unknown or the value does not fit in the avail quads left.
+  */
+
+  static uint32_t xdr_rt_val_quads(uint32_t type, uint32_t *val, uint32_t avail, bool rtflow)
+  {
+    uint32_t val_quads = 0;
+    if(type == RTMetricType_string) {
+      // same for rtflow
+      if(avail == 0)
+	return 0;
+      uint32_t val_len = ntohl(val[0]);
+      if(val_len > HSP_MAX_RTMETRIC_VAL_LEN)
+	return 0;
+      val_quads = 1 + ((val_len + 3) >> 2);
+    }
+    else if(rtflow) {
+      switch(type) {
+      case RTFlowType_mac: val_quads = 2; break;
+      case RTFlowType_ip: val_quads = 1; break;
+      case RTFlowType_ip6: val_quads = 4; break;
+      case RTFlowType_int32: val_quads = 1; break;
+      case RTFlowType_int64: val_quads = 2; break;
+      case RTFlowType_float: val_quads = 1; break;
+      case RTFlowType_double: val_quads = 2; break;
+      }
+    }
+    else {
+      switch(type) {
+      case RTMetricType_counter32: val_quads = 1; break;
+      case RTMetricType_counter64: val_quads = 2; break;
+      case RTMetricType_gauge32: val_quads = 1; break;
+      case RTMetricType_gauge64: val_quads = 2; break;
+      case RTMetricType_gaugeFloat: val_quads = 1; break;
+      case RTMetricType_gaugeDouble: val_quads = 2; break;
+      }
+    }
+    return (val_quads <= avail) ? val_quads : 0;
+  }
+
+  /*_________________---------------------------__________________
+    _________________    xdr_rt_fields_ok       __________________
+    -----------------___________________________------------------
+    Check rtmetric or rtflow fields that arrive already XDR-encoded
+    (see hsflow_ring.h),  so that they can be copied into the sample
+    as they are.  The checks are the ones that readJSON_rtmetric()
+    and readJSON_rtflow() apply.
+  */
+
+  static bool xdr_rt_fields_ok(uint32_t *fields, uint32_t len, uint32_t num_fields, bool rtflow)
+  {
+    if(num_fields == 0
+       || (len & 3))
+      return NO;
+    uint32_t quads = len >> 2;
+    uint32_t q = 0;
+    for(uint32_t ff = 0; ff < num_fields; ff++) {
+      // name
+      if(q >= quads)
+	return NO;
+      uint32_t name_len = ntohl(fields[q++]);
+      uint32_t name_quads = (name_len + 3) >> 2;
+      if(name_len > HSP_MAX_RTMETRIC_KEY_LEN
+	 || (q + name_quads + 1) > quads
+	 || !rtmetric_key_ok((char *)(fields + q), name_len)) {
+	myDebug(1, "invalid %s key", rtflow ? "rtflow" : "rtmetric");
+	return NO;
+      }
+      q += name_quads;
+      // type and value
+      uint32_t type = ntohl(fields[q++]);
+      uint32_t val_quads = xdr_rt_val_quads(type, fields + q, quads - q, rtflow);
+      if(val_quads == 0) {
+	myDebug(1, "%s bad type %u or value", rtflow ? "rtflow" : "rtmetric", type);
+	return NO;
+      }
+      q += val_quads;
+    }
+    // nothing left over
+    return (q == quads);
+  }
+
+  /*_________________---------------------------__________________
+    _________________  rtmetric aggregation     __________________
+    -----------------___________________________------------------
+    With json { rtmetricWindow=N } rtmetric updates are not sent one by
+    one.  Each datasource/metric keeps the last value, count, sum, min
+    and max over the window,  and gauges also feed a quantile sketch.
+    At the end of the window every datasource that was updated sends
+    one summary rtmetric (split if it will not fit in a datagram):
+      <name>        last value,  as it was sent
+      <name>_count  updates in the window (gauge32,  not for strings)
+    and for gauges:
+      <name>_min, <name>_max             (same type as <name>)
+      <name>_sum, _p50, _p90, _p99       (gaugeDouble)
+    A name too long to take the suffixes only gets the last value.
+
+    The sketch has log-spaced bins (as DDSketch) so quantiles are within
+    about 2% of the true value.  Each sign has a window of
+    HSP_RTM_SKETCH_BINS bins centred on the first value of the time window.
+    It slides down for smaller values while there are empty bins at the
+    top,  and up for larger values,  lumping the smallest together,  so
+    high quantiles stay accurate.  It is recentred for every time window,
+    so one spike does not lump the values that follow it.
+  */
+
+#define HSP_RTM_SKETCH_BINS 256
+#define HSP_RTM_SKETCH_GAMMA 1.04 // (gamma-1)/(gamma+1) = 2% error
+#define HSP_RTM_IDLE_WINDOWS 10 // forget metrics not updated for this many windows
+#define HSP_RTM_DATAGRAM_HDR 64 // room for the sFlow datagram header
+
+  typedef struct _HSPSketchStore {
+    int32_t base; // index of bins[0]
+    uint32_t count; // 0 => recentre on the next value
+    uint32_t bins[HSP_RTM_SKETCH_BINS];
+  } HSPSketchStore;
+
+  typedef struct _HSPSketch {
+    uint32_t count;
+    uint32_t zeros;
+    HSPSketchStore *pos;
+    HSPSketchStore *neg; // by magnitude
+  } HSPSketch;
+
+  typedef struct _HSPRTMetric {
+    char *name;
+    uint32_t name_len;
+    uint32_t type;
+    uint32_t count;
+    uint32_t idle_windows;
+    double sum;
+    double min;
+    double max;
+    uint32_t last_quads;
+    uint32_t last[1 + ((HSP_MAX_RTMETRIC_VAL_LEN + 3) >> 2)]; // XDR
+    HSPSketch sketch;
+  } HSPRTMetric;
+
+  typedef struct _HSPRTDatasource {
+    char *dsname;
+    UTHash *metrics;
+    uint32_t updates;
+    uint32_t idle_windows;
+  } HSPRTDatasource;
+
+  static void sketchStoreAdd(HSPSketchStore **p_store, int32_t idx)
+  {
+    HSPSketchStore *store = *p_store;
+    if(store == NULL)
+      store = *p_store = (HSPSketchStore *)my_calloc(sizeof(HSPSketchStore));
+    if(store->count++ == 0)
+      store->base = idx - (HSP_RTM_SKETCH_BINS / 2);
+    if(idx < store->base) {
+      // slide the window down as far as the empty bins at the top allow
+      int32_t top = HSP_RTM_SKETCH_BINS - 1;
+      while(top > 0 && store->bins[top] == 0)
+	top--;
+      int32_t shift = store->base - idx;
+      int32_t room = HSP_RTM_SKETCH_BINS - 1 - top;
+      if(shift > room)
+	shift = room;
+      if(shift > 0) {
+	memmove(store->bins + shift, store->bins, (HSP_RTM_SKETCH_BINS - shift) * sizeof(uint32_t));
+	memset(store->bins, 0, shift * sizeof(uint32_t));
+	store->base -= shift;
+      }
+      // still below the window: lumped into the lowest bin
+      if(idx < store->base)
+	idx = store->base;
+    }
+    else if(idx >= (store->base + HSP_RTM_SKETCH_BINS)) {
+      // slide the window up
+      int32_t shift = idx - (store->base + HSP_RTM_SKETCH_BINS - 1);
+      uint32_t lumped = 0;
+      int32_t nlump = (shift < HSP_RTM_SKETCH_BINS) ? shift : HSP_RTM_SKETCH_BINS;
+      for(int32_t ii = 0; ii < nlump; ii++)
+	lumped += store->bins[ii];
+      if(nlump < HSP_RTM_SKETCH_BINS)
+	memmove(store->bins, store->bins + nlump, (HSP_RTM_SKETCH_BINS - nlump) * sizeof(uint32_t));
+      memset(store->bins + HSP_RTM_SKETCH_BINS - nlump, 0, nlump * sizeof(uint32_t));
+      store->bins[0] += lumped;
+      store->base += shift;
+    }
+    store->bins[idx - store->base]++;
+  }
+
+  static void sketchAdd(HSPSketch *sk, double val)
+  {
+    sk->count++;
+    if(val == 0.0) {
+      sk->zeros++;
+      return;
+    }
+    int32_t idx = (int32_t)ceil(log(fabs(val)) / log(HSP_RTM_SKETCH_GAMMA));
+    sketchStoreAdd(val > 0 ? &sk->pos : &sk->neg, idx);
+  }
+
+  static double sketchValue(int32_t idx)
+  {
+    return 2.0 * pow(HSP_RTM_SKETCH_GAMMA, idx) / (HSP_RTM_SKETCH_GAMMA + 1.0);
+  }
+
+  static double sketchQuantile(HSPSketch *sk, double q)
+  {
+    uint32_t rank = (uint32_t)(q * (sk->count - 1));
+    uint32_t seen = 0;
+    if(sk->neg) {
+      for(int32_t ii = HSP_RTM_SKETCH_BINS - 1; ii >= 0; ii--) {
+	seen += sk->neg->bins[ii];
+	if(seen > rank)
+	  return -sketchValue(sk->neg->base + ii);
+      }
+    }
+    seen += sk->zeros;
+    if(seen > rank)
+      return 0.0;
+    if(sk->pos) {
+      for(int32_t ii = 0; ii < HSP_RTM_SKETCH_BINS; ii++) {
+	seen += sk->pos->bins[ii];
+	if(seen > rank)
+	  return sketchValue(sk->pos->base + ii);
+      }
+    }
+    return 0.0;
+  }
+
+  // a bin is a range of values,  so keep the answer within what was seen
+  static double rtmQuantile(HSPRTMetric *metric, double q)
+  {
+    double val = sketchQuantile(&metric->sketch, q);
+    if(val < metric->min) return metric->min;
+    if(val > metric->max) return metric->max;
+    return val;
+  }
+
+  static void sketchReset(HSPSketch *sk)
+  {
+    sk->count = sk->zeros = 0;
+    // keep the stores,  but recentre them on the next value
+    if(sk->pos) {
+      sk->pos->count = 0;
+      memset(sk->pos->bins, 0, sizeof(sk->pos->bins));
+    }
+    if(sk->neg) {
+      sk->neg->count = 0;
+      memset(sk->neg->bins, 0, sizeof(sk->neg->bins));
+    }
+  }
+
+  static void rtmFreeMetric(HSPRTMetric *metric)
+  {
+    my_free(metric->sketch.pos);
+    my_free(metric->sketch.neg);
+    my_free(metric->name);
+    my_free(metric);
+  }
+
+  static bool rtmIsGauge(uint32_t type)
+  {
+    return (type == RTMetricType_gauge32
+	    || type == RTMetricType_gauge64
+	    || type == RTMetricType_gaugeFloat
+	    || type == RTMetricType_gaugeDouble);
+  }
+
+  static double xdr_rtm_value(uint32_t type, uint32_t *val)
+  {
+    uint64_t val64;
+    uint32_t val32;
+    float valf;
+    double vald;
+    switch(type) {
+    case RTMetricType_counter32:
+    case RTMetricType_gauge32:
+      return ntohl(val[0]);
+    case RTMetricType_counter64:
+    case RTMetricType_gauge64:
+      val64 = ((uint64_t)ntohl(val[0]) << 32) + ntohl(val[1]);
+      return (double)val64;
+    case RTMetricType_gaugeFloat:
+      val32 = ntohl(val[0]);
+      memcpy(&valf, &val32, 4);
+      return valf;
+    case RTMetricType_gaugeDouble:
+      val64 = ((uint64_t)ntohl(val[0]) << 32) + ntohl(val[1]);
+      memcpy(&vald, &val64, 8);
+      return vald;
+    }
+    return 0.0;
+  }
+
+  static void xdr_enc_rtm_num(XDRBuf *buf, uint32_t type, double val)
+  {
+    switch(type) {
+    case RTMetricType_counter32:
+    case RTMetricType_gauge32:
+      xdr_enc_int32(buf, (uint32_t)val);
+      break;
+    case RTMetricType_counter64:
+    case RTMetricType_gauge64:
+      xdr_enc_int64(buf, (uint64_t)val);
+      break;
+    case RTMetricType_gaugeFloat:
+      xdr_enc_float(buf, (float)val);
+      break;
+    case RTMetricType_gaugeDouble:
+      xdr_enc_dbl(buf, val);
+      break;
+    }
+  }
+
+  static void xdr_enc_rtm_field(XDRBuf *buf, HSPRTMetric *metric, char *suffix, uint32_t type, double val)
+  {
+    char name[HSP_MAX_RTMETRIC_KEY_LEN + 1];
+    int len = snprintf(name, sizeof(name), "%s_%s", metric->name, suffix);
+    xdr_enc_str(buf, name, len);
+    xdr_enc_int32(buf, type);
+    xdr_enc_rtm_num(buf, type, val);
+  }
+
+  /*_________________---------------------------__________________
+    _________________    aggregateRTMetric      __________________
+    -----------------___________________________------------------
+    Fold in one rtmetric sample that has already been encoded (and
+    checked).  Called with sync_rtm held.
+  */
+
+  static void aggregateRTMetric(EVMod *mod, uint32_t *xdr)
+  {
+    HSP_mod_JSON *mdata = (HSP_mod_JSON *)mod->data;
+    uint32_t *p = xdr + 2; // after tag and length
+    char key[HSP_MAX_RTMETRIC_KEY_LEN + 1];
+
+    uint32_t dsname_len = ntohl(*p++);
+    memcpy(key, p, dsname_len);
+    key[dsname_len] = '\0';
+    p += (dsname_len + 3) >> 2;
+    HSPRTDatasource search_ds = { .dsname = key };
+    HSPRTDatasource *ds = UTHashGet(mdata->rtmDatasourceHT, &search_ds);
+    if(ds == NULL) {
+      ds = (HSPRTDatasource *)my_calloc(sizeof(HSPRTDatasource));
+      ds->dsname = my_strdup(key);
+      ds->metrics = UTHASH_NEW(HSPRTMetric, name, UTHASH_SKEY);
+      UTHashAdd(mdata->rtmDatasourceHT, ds);
+    }
+    ds->updates++;
+
+    uint32_t num_fields = ntohl(*p++);
+    for(uint32_t ff = 0; ff < num_fields; ff++) {
+      uint32_t name_len = ntohl(*p++);
+      memcpy(key, p, name_len);
+      key[name_len] = '\0';
+      p += (name_len + 3) >> 2;
+      uint32_t type = ntohl(*p++);
+      uint32_t val_quads = xdr_rt_val_quads(type, p, UINT32_MAX, NO);
+      HSPRTMetric search = { .name = key };
+      HSPRTMetric *metric = UTHashGet(ds->metrics, &search);
+      if(metric == NULL) {
+	metric = (HSPRTMetric *)my_calloc(sizeof(HSPRTMetric));
+	metric->name = my_strdup(key);
+	metric->name_len = name_len;
+	metric->type = type;
+	UTHashAdd(ds->metrics, metric);
+      }
+      if(metric->type != type) {
+	// start again
+	metric->type = type;
+	metric->count = 0;
+	metric->sum = 0;
+	sketchReset(&metric->sketch);
+      }
+      metric->count++;
+      metric->last_quads = val_quads;
+      memcpy(metric->last, p, val_quads << 2);
+      if(rtmIsGauge(type)) {
+	double val = xdr_rtm_value(type, p);
+	if(isfinite(val)) {
+	  if(metric->sketch.count == 0
+	     || val < metric->min)
+	    metric->min = val;
+	  if(metric->sketch.count == 0
+	     || val > metric->max)
+	    metric->max = val;
+	  metric->sum += val;
+	  sketchAdd(&metric->sketch, val);
+	}
+      }
+      p += val_quads;
+    }
+  }
+
+  /*_________________---------------------------__________________
+    _________________    flushRTMetrics         __________________
+    -----------------___________________________------------------
+    End of window: send the summaries and start again.  Called on the
+    packetBus with sync_rtm held.
+  */
+
+  static void flushRTMetrics(EVMod *mod)
+  {
+    HSP_mod_JSON *mdata = (HSP_mod_JSON *)mod->data;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    SFLReceiver *receiver = sp->agent->receivers;
+    uint32_t limit = receiver
+      ? sfl_receiver_get_sFlowRcvrMaximumDatagramSize(receiver) - HSP_RTM_DATAGRAM_HDR
+      : 0;
+    XDRBuf buf;
+    XDRBuf mbuf;
+    // deleting can rebuild a hash,  so not while walking it
+    UTArray *idle_ds = UTArrayNew(UTARRAY_DFLT);
+    UTArray *idle_metrics = UTArrayNew(UTARRAY_DFLT);
+
+    HSPRTDatasource *ds;
+    UTHASH_WALK(mdata->rtmDatasourceHT, ds) {
+      if(ds->updates == 0) {
+	if(++ds->idle_windows > HSP_RTM_IDLE_WINDOWS)
+	  UTArrayAdd(idle_ds, ds);
+	continue;
+      }
+      ds->updates = 0;
+      ds->idle_windows = 0;
+      uint32_t dsname_len = my_strlen(ds->dsname);
+      uint32_t *mstart = NULL;
+      uint32_t *fstart = NULL;
+      uint32_t num_fields = 0;
+      xdr_init(&buf);
+      HSPRTMetric *metric;
+      UTHASH_WALK(ds->metrics, metric) {
+	if(metric->count == 0) {
+	  if(++metric->idle_windows > HSP_RTM_IDLE_WINDOWS)
+	    UTArrayAdd(idle_metrics, metric);
+	  continue;
+	}
+	metric->idle_windows = 0;
+	// encode this metric's fields on their own first
+	xdr_init(&mbuf);
+	uint32_t mfields = 1;
+	xdr_enc_str(&mbuf, metric->name, metric->name_len);
+	xdr_enc_int32(&mbuf, metric->type);
+	memcpy(xdr_ptr(&mbuf), metric->last, metric->last_quads << 2);
+	mbuf.cursor += metric->last_quads;
+	if(metric->type != RTMetricType_string
+	   && (metric->name_len + 6) <= HSP_MAX_RTMETRIC_KEY_LEN) {
+	  xdr_enc_rtm_field(&mbuf, metric, "count", RTMetricType_gauge32, metric->count);
+	  mfields++;
+	  if(metric->sketch.count) {
+	    xdr_enc_rtm_field(&mbuf, metric, "min", metric->type, metric->min);
+	    xdr_enc_rtm_field(&mbuf, metric, "max", metric->type, metric->max);
+	    xdr_enc_rtm_field(&mbuf, metric, "sum", RTMetricType_gaugeDouble, metric->sum);
+	    xdr_enc_rtm_field(&mbuf, metric, "p50", RTMetricType_gaugeDouble, rtmQuantile(metric, 0.50));
+	    xdr_enc_rtm_field(&mbuf, metric, "p90", RTMetricType_gaugeDouble, rtmQuantile(metric, 0.90));
+	    xdr_enc_rtm_field(&mbuf, metric, "p99", RTMetricType_gaugeDouble, rtmQuantile(metric, 0.99));
+	    mfields += 6;
+	  }
+	}
+	metric->count = 0;
+	metric->sum = 0;
+	sketchReset(&metric->sketch);
+	if(receiver == NULL)
+	  continue;
+	if(num_fields
+	   && ((buf.cursor + mbuf.cursor) << 2) > limit) {
+	  // full: send what we have and start another sample
+	  mstart[0] = htonl((char *)xdr_ptr(&buf) - (char *)mstart - 4);
+	  fstart[0] = htonl(num_fields);
+	  sendEncoded(sp, receiver, buf.xdr, (buf.cursor << 2), HSP_TELEMETRY_RTMETRIC_SAMPLES);
+	  xdr_init(&buf);
+	  num_fields = 0;
+	}
+	if(num_fields == 0) {
+	  xdr_enc_int32(&buf, TAG_RTMETRIC);
+	  mstart = xdr_ptr(&buf);
+	  xdr_enc_int32(&buf, 0); // will be rtmetric len
+	  xdr_enc_str(&buf, ds->dsname, dsname_len);
+	  fstart = xdr_ptr(&buf);
+	  xdr_enc_int32(&buf, 0); // will be num fields
+	}
+	memcpy(xdr_ptr(&buf), mbuf.xdr, mbuf.cursor << 2);
+	buf.cursor += mbuf.cursor;
+	num_fields += mfields;
+      }
+      if(num_fields) {
+	mstart[0] = htonl((char *)xdr_ptr(&buf) - (char *)mstart - 4);
+	fstart[0] = htonl(num_fields);
+	sendEncoded(sp, receiver, buf.xdr, (buf.cursor << 2), HSP_TELEMETRY_RTMETRIC_SAMPLES);
+      }
+      HSPRTMetric *idle;
+      UTARRAY_WALK(idle_metrics, idle) {
+	UTHashDel(ds->metrics, idle);
+	rtmFreeMetric(idle);
+      }
+      UTArrayReset(idle_metrics);
+    }
+
+    UTARRAY_WALK(idle_ds, ds) {
+      HSPRTMetric *metric;
+      UTHASH_WALK(ds->metrics, metric)
+	rtmFreeMetric(metric);
+      UTHashFree(ds->metrics);
+      UTHashDel(mdata->rtmDatasourceHT, ds);
+      my_free(ds->dsname);
+      my_free(ds);
+    }
+    UTArrayFree(idle_ds);
+    UTArrayFree(idle_metrics);
+  }
+
+  /*_________________---------------------------__________________
+    _________________     sendRTMetric          __________________
+    -----------------___________________________------------------
+    Every encoded rtmetric sample comes through here,  whichever way
+    it arrived.
+  */
+
+  static void sendRTMetric(EVMod *mod, SFLReceiver *receiver, uint32_t *xdr, uint32_t len)
+  {
+    HSP_mod_JSON *mdata = (HSP_mod_JSON *)mod->data;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    if(sp->json.rtmetricWindow) {
+      SEMLOCK_DO(mdata->sync_rtm) {
+	aggregateRTMetric(mod, xdr);
+      }
+      return;
+    }
+    sendEncoded(sp, receiver, xdr, len, HSP_TELEMETRY_RTMETRIC_SAMPLES);
+  }
+
   /*_________________---------------------------__________________
     _________________  readJSON_rtmetric        __________________
     -----------------___________________________------------------
@@ -960,13 +1574,7 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
       uint32_t len = (char *)xdr_ptr(&buf) - (char *)mstart - 4;
       mstart[0] = htonl(len);
       fstart[0] = htonl(num_fields);
-      SEMLOCK_DO(sp->sync_agent) {
-	sfl_receiver_writeEncoded(receiver,
-				  1,
-				  buf.xdr,
-				  (buf.cursor << 2));
-	sp->telemetry[HSP_TELEMETRY_RTMETRIC_SAMPLES]++;
-      }
+      sendRTMetric(mod, receiver, buf.xdr, (buf.cursor << 2));
     }
   }
 
@@ -1193,14 +1801,126 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
       uint32_t len = (char *)xdr_ptr(&buf) - (char *)mstart - 4;
       mstart[0] = htonl(len);
       fstart[0] = htonl(num_fields);
-      SEMLOCK_DO(sp->sync_agent) {
-	sfl_receiver_writeEncoded(receiver,
-				  1,
-				  buf.xdr,
-				  (buf.cursor << 2));
-	sp->telemetry[HSP_TELEMETRY_RTFLOW_SAMPLES]++;
+      sendEncoded(sp, receiver, buf.xdr, (buf.cursor << 2), HSP_TELEMETRY_RTFLOW_SAMPLES);
+    }
+  }
+
+  /*_________________---------------------------__________________
+    _________________      readXDRMsg           __________________
+    -----------------___________________________------------------
+    Binary rtmetric and rtflow samples,  already XDR-encoded (see
+    hsflow_ring.h).  Each one is checked and then copied into the
+    sFlow datagram as it is,  so there is no encoding to do here.
+  */
+
+  static void readXDRMsg(EVMod *mod, uint32_t *xdr, int len)
+  {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+
+    SFLReceiver *receiver = sp->agent->receivers;
+    if(receiver == NULL)
+      return;
+
+    if(len & 3
+       || ntohl(xdr[1]) != HSFLOW_XDR_VERSION) {
+      myDebug(1, "XDR msg: bad length or version");
+      return;
+    }
+    uint32_t quads = len >> 2;
+    uint32_t q = 2; // after magic and version
+    while(q < quads) {
+      // sample header
+      if((q + 2) > quads)
+	return;
+      uint32_t tag = ntohl(xdr[q]);
+      uint32_t sample_len = ntohl(xdr[q + 1]);
+      uint32_t sample_quads = sample_len >> 2;
+      if((sample_len & 3)
+	 || (q + 2 + sample_quads) > quads) {
+	myDebug(1, "XDR msg: bad sample length %u", sample_len);
+	return;
+      }
+      bool rtflow = (tag == TAG_RTFLOW);
+      if(!rtflow
+	 && tag != TAG_RTMETRIC) {
+	myDebug(1, "XDR msg: unexpected tag %u", tag);
+	return;
+      }
+      uint32_t *sample = xdr + q;
+      uint32_t *body = sample + 2;
+      uint32_t *end = body + sample_quads;
+      q += 2 + sample_quads;
+      // datasource
+      if(body >= end)
+	return;
+      uint32_t dsname_len = ntohl(*body++);
+      uint32_t dsname_quads = (dsname_len + 3) >> 2;
+      if(dsname_len > HSP_MAX_RTMETRIC_KEY_LEN
+	 || (body + dsname_quads) > end
+	 || (dsname_len
+	     && (isdigit(*(char *)body)
+		 || !rtmetric_key_ok((char *)body, dsname_len)))) {
+	myDebug(1, "XDR msg: invalid datasource name");
+	continue;
+      }
+      body += dsname_quads;
+      if(rtflow) {
+	// sampling_rate,  reserved
+	if((body + 2) > end)
+	  continue;
+	if(*body == 0)
+	  *body = htonl(1);
+	body += 2;
+      }
+      if(body >= end)
+	continue;
+      uint32_t num_fields = ntohl(*body++);
+      if(!xdr_rt_fields_ok(body, (end - body) << 2, num_fields, rtflow))
+	continue;
+      if(rtflow)
+	sendEncoded(sp, receiver, sample, sample_len + 8, HSP_TELEMETRY_RTFLOW_SAMPLES);
+      else
+	sendRTMetric(mod, receiver, sample, sample_len + 8);
+    }
+  }
+
+  /*_________________---------------------------__________________
+    _________________      readJSONMsg          __________________
+    -----------------___________________________------------------
+  */
+
+  static void readJSONMsg(EVMod *mod, HSPJSONReader *reader, char *buf, int len)
+  {
+    HSP_mod_JSON *mdata = (HSP_mod_JSON *)mod->data;
+    if(len >= 8
+       && ntohl(*(uint32_t *)buf) == HSFLOW_XDR_MAGIC) {
+      // binary,  not JSON
+      readXDRMsg(mod, (uint32_t *)buf, len);
+      return;
+    }
+    myDebug(2, "got JSON msg: %u bytes", len);
+    // parse in place into the arena:  strings in the tree point
+    // into buf,  and nothing is freed until the reset below.
+    cJSON *top = cJSON_ArenaParse(reader->arena, buf, len);
+    if(top == NULL)
+      myDebug(1, "JSON parse error at offset %u", (uint32_t)cJSON_ArenaError(reader->arena));
+    else {
+      if(getDebug()) logJSON(top, "got JSON message");
+      cJSON *fs = cJSON_GetObjectItem(top, "flow_sample");
+      cJSON *cs = cJSON_GetObjectItem(top, "counter_sample");
+      if(fs || cs) {
+	SEMLOCK_DO(mdata->sync_apps) {
+	  if(fs) readJSON_flowSample(mod, fs);
+	  if(cs) readJSON_counterSample(mod, cs);
+	}
       }
+      // rtmetric and rtflow share no state beyond the agent
+      cJSON *rtmetric = cJSON_GetObjectItem(top, "rtmetric");
+      if(rtmetric) readJSON_rtmetric(mod, rtmetric);
+      cJSON *rtflow = cJSON_GetObjectItem(top, "rtflow");
+      if(rtflow) readJSON_rtflow(mod, rtflow);
     }
+    cJSON_ArenaReset(reader->arena);
   }
 
   /*_________________---------------------------__________________
@@ -1211,32 +1931,35 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
   static void readJSON(EVMod *mod, EVSocket *sock, void *magic)
   {
     HSP *sp = (HSP *)EVROOTDATA(mod);
+    HSPJSONReader *reader = (HSPJSONReader *)magic;
 
     if(sp->sFlowSettings == NULL) {
       // config was turned off
       return;
     }
     int batch = 0;
-    if(sock->fd) {
+    if(reader->mmsgs) {
+      // UDP: take up to HSP_JSON_MMSG_BATCH datagrams per syscall
+      while(batch < HSP_READJSON_BATCH) {
+	int nmsgs = recvmmsg(sock->fd, reader->mmsgs, HSP_JSON_MMSG_BATCH, MSG_DONTWAIT, NULL);
+	if(nmsgs <= 0) break;
+	for(int ii = 0; ii < nmsgs; ii++) {
+	  struct mmsghdr *mmsg = &reader->mmsgs[ii];
+	  if(mmsg->msg_hdr.msg_flags & MSG_TRUNC)
+	    myDebug(1, "JSON msg truncated: > %u bytes", HSP_MAX_JSON_MSG_BYTES);
+	  else if(mmsg->msg_len > 0)
+	    readJSONMsg(mod, reader, reader->iovs[ii].iov_base, mmsg->msg_len);
+	}
+	batch += nmsgs;
+	if(nmsgs < HSP_JSON_MMSG_BATCH) break;
+      }
+    }
+    else {
+      // FIFO
       for( ; batch < HSP_READJSON_BATCH; batch++) {
-	char buf[HSP_MAX_JSON_MSG_BYTES];
-	// use read() so that it works for both UDP and FIFO inputs
-	int len = read(sock->fd, buf, HSP_MAX_JSON_MSG_BYTES);
+	int len = read(sock->fd, reader->bufs, HSP_MAX_JSON_MSG_BYTES);
 	if(len <= 0) break;
-	myDebug(2, "got JSON msg: %u bytes", len);
-	cJSON *top = cJSON_Parse(buf);
-	if(top) {
-	  if(getDebug()) logJSON(top, "got JSON message");
-	  cJSON *fs = cJSON_GetObjectItem(top, "flow_sample");
-	  if(fs) readJSON_flowSample(mod, fs);
-	  cJSON *cs = cJSON_GetObjectItem(top, "counter_sample");
-	  if(cs) readJSON_counterSample(mod, cs);
-	  cJSON *rtmetric = cJSON_GetObjectItem(top, "rtmetric");
-	  if(rtmetric) readJSON_rtmetric(mod, rtmetric);
-	  cJSON *rtflow = cJSON_GetObjectItem(top, "rtflow");
-	  if(rtflow) readJSON_rtflow(mod, rtflow);
-	  cJSON_Delete(top);
-	}
+	readJSONMsg(mod, reader, reader->bufs, len);
       }
     }
     // may have queued one or more counter-samples during this read-batch.
@@ -1245,10 +1968,398 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
     // introduce time-dither.  On the other hand,  this could increase the
     // number of datagrams/second sent by this host under very particular
     // conditions (e.g. if the arrival rate is about 10 per second and each
-    // one is read on a different pass through this function).
+    // one is read on a different pass through this function).  The same
+    // applies on the json reader buses.
     flushCounters(mod);
   }
 
+  /*_________________---------------------------__________________
+    _________________      addReader            __________________
+    -----------------___________________________------------------
+    A reader with recvmmsg() buffers for UDP,  or with just one
+    buffer for the FIFO.
+  */
+
+  static HSPJSONReader *addReader(EVMod *mod, EVBus *bus, bool udp)
+  {
+    HSP_mod_JSON *mdata = (HSP_mod_JSON *)mod->data;
+    HSPJSONReader *reader = (HSPJSONReader *)my_calloc(sizeof(HSPJSONReader));
+    reader->bus = bus;
+    reader->arena = cJSON_ArenaNew(0);
+    uint32_t nbufs = udp ? HSP_JSON_MMSG_BATCH : 1;
+    reader->bufs = (char *)my_calloc(nbufs * HSP_MAX_JSON_MSG_BYTES);
+    if(udp) {
+      reader->mmsgs = (struct mmsghdr *)my_calloc(nbufs * sizeof(struct mmsghdr));
+      reader->iovs = (struct iovec *)my_calloc(nbufs * sizeof(struct iovec));
+      for(uint32_t ii = 0; ii < nbufs; ii++) {
+	reader->iovs[ii].iov_base = reader->bufs + (ii * HSP_MAX_JSON_MSG_BYTES);
+	reader->iovs[ii].iov_len = HSP_MAX_JSON_MSG_BYTES;
+	reader->mmsgs[ii].msg_hdr.msg_iov = &reader->iovs[ii];
+	reader->mmsgs[ii].msg_hdr.msg_iovlen = 1;
+      }
+    }
+    UTArrayAdd(mdata->readers, reader);
+    return reader;
+  }
+
+  /*_________________---------------------------__________________
+    _________________      openUDP              __________________
+    -----------------___________________________------------------
+    With json { threads=N } there are N sockets on each of 127.0.0.1
+    and ::1,  sharing the port with SO_REUSEPORT,  each pair read by a
+    bus of its own.  The kernel hashes each sender to one of them.
+  */
+
+  static void openUDP(EVMod *mod)
+  {
+    HSP_mod_JSON *mdata = (HSP_mod_JSON *)mod->data;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+
+    if(sp->json.threads == 0) {
+      HSPJSONReader *reader = addReader(mod, mdata->packetBus, YES);
+      // TODO: do we really need to bind to both "127.0.0.1" and "::1" ?
+      mdata->json_soc = UTSocketUDP("127.0.0.1", PF_INET, sp->json.port, HSP_JSON_RCV_BUF);
+      if(mdata->json_soc > 0)
+	EVBusAddSocket(mod, mdata->packetBus, mdata->json_soc, readJSON, reader);
+      mdata->json_soc6 = UTSocketUDP("::1", PF_INET6, sp->json.port, HSP_JSON_RCV_BUF);
+      if(mdata->json_soc6 > 0)
+	EVBusAddSocket(mod, mdata->packetBus, mdata->json_soc6, readJSON, reader);
+      return;
+    }
+
+    for(uint32_t ii = 0; ii < sp->json.threads; ii++) {
+      char busName[32];
+      snprintf(busName, sizeof(busName), HSPBUS_JSON "%u", ii);
+      EVBus *bus = EVGetBus(mod, busName, YES);
+      HSPJSONReader *reader = addReader(mod, bus, YES);
+      int soc = UTSocketUDPReusePort("127.0.0.1", PF_INET, sp->json.port, HSP_JSON_RCV_BUF);
+      if(soc > 0)
+	EVBusAddSocket(mod, bus, soc, readJSON, reader);
+      int soc6 = UTSocketUDPReusePort("::1", PF_INET6, sp->json.port, HSP_JSON_RCV_BUF);
+      if(soc6 > 0)
+	EVBusAddSocket(mod, bus, soc6, readJSON, reader);
+    }
+    myDebug(1, "json UDP port %u read by %u bus(es)", sp->json.port, sp->json.threads);
+  }
+
+  /*_________________---------------------------__________________
+    _________________      readRing_rt          __________________
+    -----------------___________________________------------------
+  */
+
+  static void readRing_rt(EVMod *mod, hsflow_ring_rt *rt, uint32_t len, bool rtflow)
+  {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+
+    SFLReceiver *receiver = sp->agent->receivers;
+    if(receiver == NULL)
+      return;
+
+    if(len < sizeof(*rt)
+       || rt->fields_len != (len - sizeof(*rt))) {
+      myDebug(1, "json ring: bad %s record length", rtflow ? "rtflow" : "rtmetric");
+      return;
+    }
+    rt->datasource[HSP_MAX_RTMETRIC_KEY_LEN] = '\0';
+    uint32_t dsname_len = my_strlen(rt->datasource);
+    if(dsname_len
+       && dsname_len_ok(rt->datasource) == 0) {
+      myDebug(1, "invalid datasource name: %s", rt->datasource);
+      return;
+    }
+    if(!xdr_rt_fields_ok(rt->fields, rt->fields_len, rt->num_fields, rtflow))
+      return;
+
+    XDRBuf buf;
+    xdr_init(&buf);
+    xdr_enc_int32(&buf, rtflow ? TAG_RTFLOW : TAG_RTMETRIC);
+    uint32_t *mstart = xdr_ptr(&buf);
+    xdr_enc_int32(&buf, 0); // will be len
+    xdr_enc_str(&buf, rt->datasource, dsname_len);
+    if(rtflow) {
+      xdr_enc_int32(&buf, rt->sampling_rate ?: 1);
+      xdr_enc_int32(&buf, 0); // reserved (e.g. for sample_pool)
+    }
+    xdr_enc_int32(&buf, rt->num_fields);
+    xdr_enc_bytes(&buf, (u_char *)rt->fields, rt->fields_len);
+    mstart[0] = htonl((char *)xdr_ptr(&buf) - (char *)mstart - 4);
+    if(rtflow)
+      sendEncoded(sp, receiver, buf.xdr, (buf.cursor << 2), HSP_TELEMETRY_RTFLOW_SAMPLES);
+    else
+      sendRTMetric(mod, receiver, buf.xdr, (buf.cursor << 2));
+  }
+
+  /*_________________---------------------------__________________
+    _________________   readRing_appSample      __________________
+    -----------------___________________________------------------
+    As readJSON_flowSample().  Called with sync_apps held.
+  */
+
+#define HSP_RING_STR(str) ((str)[sizeof(str) - 1] = '\0', (str)[0] ? (str) : NULL)
+
+  static void readRing_appSample(EVMod *mod, hsflow_ring_app_sample *as, uint32_t len)
+  {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+
+    if(len != sizeof(*as)) {
+      myDebug(1, "json ring: bad app sample length %u", len);
+      return;
+    }
+    char *app = HSP_RING_STR(as->application);
+    if(app == NULL)
+      return;
+    HSPApplication *application = getApplication(mod, app, as->service_port);
+    if(application == NULL)
+      return;
+    // remember that we heard from this application
+    application->last_json = EVCurrentBus()->now.tv_sec;
+
+    EnumSFLAPPStatus status = (EnumSFLAPPStatus)as->status;
+    if((u_int)status > (u_int)SFLAPP_UNAUTHORIZED)
+      status = SFLAPP_OTHER;
+    uint32_t sampling_n = as->sampling_rate ?: 1;
+    uint32_t effective_sampling_n = appSampling(application, sampling_n, status);
+    if(effective_sampling_n == 0)
+      return;
+
+    SFLExtended_socket_ipv4 soc4 = { 0 };
+    if(as->flags & HSFLOW_RING_APP_SOCKET4) {
+      soc4.protocol = as->socket4.protocol;
+      memcpy(&soc4.local_ip.addr, as->socket4.local_ip, 4);
+      memcpy(&soc4.remote_ip.addr, as->socket4.remote_ip, 4);
+      soc4.local_port = as->socket4.local_port;
+      soc4.remote_port = as->socket4.remote_port;
+    }
+    SFLExtended_socket_ipv6 soc6 = { 0 };
+    if(as->flags & HSFLOW_RING_APP_SOCKET6) {
+      soc6.protocol = as->socket6.protocol;
+      memcpy(soc6.local_ip.addr, as->socket6.local_ip, 16);
+      memcpy(soc6.remote_ip.addr, as->socket6.remote_ip, 16);
+      soc6.local_port = as->socket6.local_port;
+      soc6.remote_port = as->socket6.remote_port;
+    }
+
+    sendAppSample(sp,
+		  application,
+		  effective_sampling_n,
+		  (as->flags & HSFLOW_RING_APP_CLIENT) ? YES : NO,
+		  HSP_RING_STR(as->operation),
+		  HSP_RING_STR(as->attributes),
+		  HSP_RING_STR(as->status_descr),
+		  status,
+		  as->req_bytes,
+		  as->resp_bytes,
+		  as->duration_uS,
+		  HSP_RING_STR(as->parent_application),
+		  HSP_RING_STR(as->parent_operation),
+		  HSP_RING_STR(as->parent_attributes),
+		  HSP_RING_STR(as->actor_initiator),
+		  HSP_RING_STR(as->actor_target),
+		  (as->flags & HSFLOW_RING_APP_SOCKET4) ? &soc4 : NULL,
+		  (as->flags & HSFLOW_RING_APP_SOCKET6) ? &soc6 : NULL);
+  }
+
+  /*_________________---------------------------__________________
+    _________________      drainRing            __________________
+    -----------------___________________________------------------
+    Runs on every pass through the packetBus loop.  Each slot is
+    copied out whole and handed straight back before it is processed,
+    so a producer can never change it under us.  The length comes from
+    the copy (see hsflow_ring.h for why it is not in the slot header).
+  */
+
+  static uint32_t ringRecordLen(hsflow_ring_slot *rec)
+  {
+    switch(rec->type) {
+    case HSFLOW_RING_APP_SAMPLE:
+      return sizeof(hsflow_ring_app_sample);
+    case HSFLOW_RING_RTMETRIC:
+    case HSFLOW_RING_RTFLOW:
+      {
+	hsflow_ring_rt *rt = (hsflow_ring_rt *)rec->body;
+	if(rt->fields_len > HSFLOW_RING_RT_MAX_FIELDS_LEN)
+	  return 0;
+	return hsflow_ring_rt_len(rt);
+      }
+    }
+    return 0;
+  }
+
+  static void drainRing(EVMod *mod)
+  {
+    HSP_mod_JSON *mdata = (HSP_mod_JSON *)mod->data;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    hsflow_ring_hdr *hdr = mdata->ring.hdr;
+    hsflow_ring_slot rec;
+
+    if(sp->sFlowSettings == NULL) {
+      // config was turned off
+      return;
+    }
+    uint64_t pos = mdata->ring_tail;
+    for(uint32_t batch = 0; batch < mdata->ring_slots; batch++) {
+      hsflow_ring_slot *slot = &mdata->ring.slots[pos & (mdata->ring_slots - 1)];
+      uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+      if(seq != (pos + 1)) {
+	if(seq == pos
+	   && __atomic_load_n(&hdr->head, __ATOMIC_RELAXED) > pos) {
+	  // reserved but not committed (yet).  If the producer died
+	  // or hung,  take the slot back so the ring does not stall.
+	  time_t now = EVCurrentBus()->now.tv_sec;
+	  if(mdata->ring_wait_since == 0
+	     || mdata->ring_wait_pos != pos) {
+	    mdata->ring_wait_pos = pos;
+	    mdata->ring_wait_since = now;
+	  }
+	  else if((now - mdata->ring_wait_since) > HSP_JSON_RING_ABANDON
+		  && __atomic_compare_exchange_n(&slot->seq, &seq, pos + mdata->ring_slots, NO, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+	    myDebug(1, "json ring: abandoned slot %"PRIu64, pos);
+	    mdata->ring_wait_since = 0;
+	    __atomic_store_n(&hdr->tail, ++pos, __ATOMIC_RELAXED);
+	    continue;
+	  }
+	}
+	break;
+      }
+      rec.type = slot->type;
+      memcpy(rec.body, slot->body, sizeof(rec.body));
+      __atomic_store_n(&slot->seq, pos + mdata->ring_slots, __ATOMIC_RELEASE);
+      __atomic_store_n(&hdr->tail, ++pos, __ATOMIC_RELAXED);
+      uint32_t len = ringRecordLen(&rec);
+
+      switch(rec.type) {
+      case HSFLOW_RING_APP_SAMPLE:
+	SEMLOCK_DO(mdata->sync_apps) {
+	  readRing_appSample(mod, (hsflow_ring_app_sample *)rec.body, len);
+	}
+	break;
+      case HSFLOW_RING_RTMETRIC:
+	readRing_rt(mod, (hsflow_ring_rt *)rec.body, len, NO);
+	break;
+      case HSFLOW_RING_RTFLOW:
+	readRing_rt(mod, (hsflow_ring_rt *)rec.body, len, YES);
+	break;
+      default:
+	myDebug(1, "json ring: unknown record type %u", rec.type);
+	break;
+      }
+    }
+    mdata->ring_tail = pos;
+  }
+
+  /*_________________---------------------------__________________
+    _________________      openRing             __________________
+    -----------------___________________________------------------
+    Create the shared-memory ring,  or pick up the one left by a
+    previous run so that the writers' mappings stay good across a
+    restart.  Anyone who can open the ring can also ftruncate() it,
+    which would SIGBUS us in drainRing(),  and can read every other
+    writer's records.  So it is mode 0600,  or 0660 and owned by
+    ringGroup if that is set,  and only a ring that we created with
+    exactly those permissions is picked up.  Anything else under that
+    name may be held open by someone we do not trust,  so it is
+    unlinked and a new ring is created in its place.
+  */
+
+  static int ringShmOpen(EVMod *mod, gid_t gid, mode_t mode)
+  {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    int fd = shm_open(sp->json.ring, O_RDWR, 0);
+    if(fd >= 0) {
+      struct stat st;
+      if(fstat(fd, &st) == 0
+	 && st.st_uid == geteuid()
+	 && (st.st_mode & 0777) == mode
+	 && (gid == (gid_t)-1 || st.st_gid == gid))
+	return fd;
+      myLog(LOG_INFO, "json ring %s: not ours or wrong permissions - replacing it", sp->json.ring);
+      close(fd);
+      if(shm_unlink(sp->json.ring) != 0) {
+	myLog(LOG_ERR, "json ring shm_unlink(%s) failed: %s", sp->json.ring, strerror(errno));
+	return -1;
+      }
+    }
+    fd = shm_open(sp->json.ring, O_RDWR|O_CREAT|O_EXCL, 0600);
+    if(fd < 0) {
+      myLog(LOG_ERR, "json ring shm_open(%s) failed: %s", sp->json.ring, strerror(errno));
+      return -1;
+    }
+    // the group first,  then open it up to them (fchmod is not subject to umask)
+    if((gid != (gid_t)-1
+	&& fchown(fd, -1, gid) != 0)
+       || fchmod(fd, mode) != 0) {
+      myLog(LOG_ERR, "json ring %s: setting permissions failed: %s", sp->json.ring, strerror(errno));
+      close(fd);
+      shm_unlink(sp->json.ring);
+      return -1;
+    }
+    return fd;
+  }
+
+  static void openRing(EVMod *mod)
+  {
+    HSP_mod_JSON *mdata = (HSP_mod_JSON *)mod->data;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    size_t map_len = sizeof(hsflow_ring_hdr) + (HSP_JSON_RING_SLOTS * sizeof(hsflow_ring_slot));
+
+    gid_t gid = (gid_t)-1;
+    mode_t mode = 0600;
+    if(sp->json.ringGroup) {
+      struct group *gr = getgrnam(sp->json.ringGroup);
+      if(gr == NULL) {
+	myLog(LOG_ERR, "json ring: group %s not found", sp->json.ringGroup);
+	return;
+      }
+      gid = gr->gr_gid;
+      mode = 0660;
+    }
+    int fd = ringShmOpen(mod, gid, mode);
+    if(fd < 0)
+      return;
+    struct stat st;
+    bool reuse = (fstat(fd, &st) == 0
+		  && (size_t)st.st_size == map_len);
+    if(!reuse
+       && ftruncate(fd, map_len) != 0) {
+      myLog(LOG_ERR, "json ring ftruncate(%s) failed: %s", sp->json.ring, strerror(errno));
+      close(fd);
+      return;
+    }
+    void *map = mmap(NULL, map_len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+      myLog(LOG_ERR, "json ring mmap(%s) failed: %s", sp->json.ring, strerror(errno));
+      return;
+    }
+    hsflow_ring_hdr *hdr = (hsflow_ring_hdr *)map;
+    mdata->ring.hdr = hdr;
+    mdata->ring.slots = (hsflow_ring_slot *)(hdr + 1);
+    mdata->ring.map_len = map_len;
+    mdata->ring_slots = HSP_JSON_RING_SLOTS;
+    if(reuse
+       && hdr->magic == HSFLOW_RING_MAGIC
+       && hdr->version == HSFLOW_RING_VERSION
+       && hdr->slots == HSP_JSON_RING_SLOTS
+       && hdr->slot_bytes == sizeof(hsflow_ring_slot)) {
+      mdata->ring_tail = hdr->tail;
+      mdata->ring_dropped = hdr->dropped;
+      myDebug(1, "json ring %s: picked up at %"PRIu64, sp->json.ring, mdata->ring_tail);
+      return;
+    }
+    // (re)initialize. Writers check the magic last.
+    __atomic_store_n(&hdr->magic, 0, __ATOMIC_RELEASE);
+    hdr->version = HSFLOW_RING_VERSION;
+    hdr->slots = HSP_JSON_RING_SLOTS;
+    hdr->slot_bytes = sizeof(hsflow_ring_slot);
+    hdr->dropped = 0;
+    hdr->head = 0;
+    hdr->tail = 0;
+    for(uint32_t ii = 0; ii < HSP_JSON_RING_SLOTS; ii++)
+      mdata->ring.slots[ii].seq = ii;
+    __atomic_store_n(&hdr->magic, HSFLOW_RING_MAGIC, __ATOMIC_RELEASE);
+    myDebug(1, "json ring %s: %u slots", sp->json.ring, HSP_JSON_RING_SLOTS);
+  }
+
   /*_________________---------------------------__________________
     _________________    module init            __________________
     -----------------___________________________------------------
@@ -1256,11 +2367,32 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
 
   static void evt_packet_tick(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
     HSP_mod_JSON *mdata = (HSP_mod_JSON *)mod->data;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
     time_t clk = evt->bus->now.tv_sec;
     if(clk > mdata->next_app_timeout_check) {
-      json_app_timeout_check(mod);
+      SEMLOCK_DO(mdata->sync_apps) {
+	json_app_timeout_check(mod);
+      }
       mdata->next_app_timeout_check = clk + HSP_JSON_APP_TIMEOUT;
     }
+    if(sp->json.rtmetricWindow
+       && clk >= mdata->next_rtm_window) {
+      SEMLOCK_DO(mdata->sync_rtm) {
+	flushRTMetrics(mod);
+      }
+      mdata->next_rtm_window = clk + sp->json.rtmetricWindow;
+    }
+    if(mdata->ring.hdr) {
+      uint64_t dropped = __atomic_load_n(&mdata->ring.hdr->dropped, __ATOMIC_RELAXED);
+      if(dropped != mdata->ring_dropped) {
+	myDebug(1, "json ring: %"PRIu64" records dropped by writers", dropped - mdata->ring_dropped);
+	mdata->ring_dropped = dropped;
+      }
+    }
+  }
+
+  static void evt_packet_loop(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
+    drainRing(mod);
   }
 
   static void evt_packet_tock(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
@@ -1272,7 +2404,9 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
       if(poller) {
 	SFL_COUNTERS_SAMPLE_TYPE cs;
 	memset(&cs, 0, sizeof(cs));
-	agentCB_getCounters_JSON((void *)mod, poller, &cs);
+	SEMLOCK_DO(mdata->sync_apps) {
+	  agentCB_getCounters_JSON((void *)mod, poller, &cs);
+	}
 	UTArrayDelAt(mdata->pollActions, ii);
       }
     }
@@ -1288,8 +2422,16 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
     // (cannot use UTHASH_PACK flag because we delete while we
     // are iterating over the array)
     mdata->pollActions = UTArrayNew(UTARRAY_SYNC);
-    // but the applicationHT is only ever accessed from the packetBus
+    // the applicationHT may be accessed from the json reader buses
+    // too,  so it is guarded by sync_apps rather than a UTHash lock
+    // (which would not cover the timeoutQ and the counters).
     mdata->applicationHT = UTHASH_NEW(HSPApplication, application, UTHASH_SKEY);
+    mdata->sync_apps = (pthread_mutex_t *)my_calloc(sizeof(pthread_mutex_t));
+    pthread_mutex_init(mdata->sync_apps, NULL);
+    mdata->readers = UTArrayNew(UTARRAY_DFLT);
+    mdata->sync_rtm = (pthread_mutex_t *)my_calloc(sizeof(pthread_mutex_t));
+    pthread_mutex_init(mdata->sync_rtm, NULL);
+    mdata->rtmDatasourceHT = UTHASH_NEW(HSPRTDatasource, dsname, UTHASH_SKEY);
 
     mdata->pollBus = EVGetBus(mod, HSPBUS_POLL, YES);
     mdata->packetBus = EVGetBus(mod, HSPBUS_PACKET, YES);
@@ -1301,13 +2443,13 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
     // counters in the packetBus thread too.
     EVEventRx(mod, EVGetEvent(mdata->packetBus, EVEVENT_TOCK), evt_packet_tock);
 
-    if(sp->json.port) {
-      // TODO: do we really need to bind to both "127.0.0.1" and "::1" ?
-      mdata->json_soc = UTSocketUDP("127.0.0.1", PF_INET, sp->json.port, HSP_JSON_RCV_BUF);
-      EVBusAddSocket(mod, mdata->packetBus, mdata->json_soc, readJSON, NULL);
+    if(sp->json.port)
+      openUDP(mod);
 
-      mdata->json_soc6 = UTSocketUDP("::1", PF_INET6, sp->json.port, HSP_JSON_RCV_BUF);
-      EVBusAddSocket(mod, mdata->packetBus, mdata->json_soc6, readJSON, NULL);
+    if(sp->json.ring) {
+      openRing(mod);
+      if(mdata->ring.hdr)
+	EVEventRx(mod, EVGetEvent(mdata->packetBus, EVEVENT_LOOP), evt_packet_loop);
     }
 
     if(sp->json.FIFO) {
@@ -1319,7 +2461,7 @@ static void readJSON_flowSample(EVMod *mod, cJSON *fs)
 	      strerror(errno));
       }
       else {
-	EVBusAddSocket(mod, mdata->packetBus, mdata->json_fifo, readJSON, NULL);
+	EVBusAddSocket(mod, mdata->packetBus, mdata->json_fifo, readJSON, addReader(mod, mdata->packetBus, NO));
       }
     }
   }
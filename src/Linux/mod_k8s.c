@@ -15,7 +15,6 @@ extern "C" {
 #include <sched.h>
 #include <openssl/sha.h>
 #include <uuid/uuid.h>
-#include <fnmatch.h>
 
 #include "hsflowd.h"
 #include "cpu_utils.h"
@@ -26,6 +25,7 @@ extern "C" {
 #define MAX_PROC_LINE_CHARS 320
 
 #include "cJSON.h"
+#include "util_containerd.h"
 
   typedef struct _HSPK8sContainerStats {
     uint32_t state; // SFLVirDomainState
@@ -46,6 +46,30 @@ extern "C" {
     HSPK8sContainerStats stats;
   } HSPK8sContainer;
 
+  // one record from hsflowd_containerd (JSON or frame)
+  typedef struct _HSPK8sContainerData {
+    char *id;
+    pid_t pid;
+    char *containerName;
+    char *containerType;
+    char *hostname;
+    char *sandboxName;
+    char *sandboxNamespace;
+    char *cgroupsPath;
+    char *gpuEnv; // value of NVIDIA_VISIBLE_DEVICES
+    uint32_t state;
+    uint64_t cpuTime;
+    uint32_t cpuCount;
+    uint64_t memory;
+    uint64_t maxMemory;
+    SFLHost_vrt_dsk_counters dsk;
+    bool gotPid:1;
+    bool gotMetrics:1;
+    bool gotCpu:1;
+    bool gotMem:1;
+    bool gotDsk:1;
+  } HSPK8sContainerData;
+
   typedef struct _HSPVMState_POD {
     HSPVMState vm; // superclass: must come first
     char *hostname;
@@ -65,6 +89,7 @@ extern "C" {
 
 #define HSP_K8S_READER "/usr/sbin/hsflowd_containerd"
 #define HSP_K8S_DATAPREFIX "data>"
+#define HSP_K8S_READ_BUFSZ 8192
 
 #define HSP_K8S_MAX_FNAME_LEN 255
 #define HSP_K8S_MAX_LINELEN 512
@@ -95,7 +120,6 @@ extern "C" {
   } HSPVNIC;
 
 #define HSP_VNIC_REFRESH_TIMEOUT 300
-#define HSP_CGROUP_REFRESH_TIMEOUT 600
 
   typedef struct _HSP_mod_K8S {
     EVBus *pollBus;
@@ -108,8 +132,8 @@ extern "C" {
     uint32_t configRevisionNo;
     pid_t readerPid;
     int idleSweepCountdown;
-    char *cgroup_path;
-    char *cgroup_devices_path;
+    UTCtrdReader *frames;
+    UTStrBuf *lineBuf;
   } HSP_mod_K8S;
 
   /*_________________---------------------------__________________
@@ -134,46 +158,6 @@ extern "C" {
       myLog(LOG_INFO, "%s: %s", prefix, podStr(pod, buf, 1024));
   }
 
-  /*________________---------------------------__________________
-    ________________    readCgroupPaths        __________________
-    ----------------___________________________------------------
-  */
-
-  static void readCgroupPaths(EVMod *mod) {
-    HSP_mod_K8S *mdata = (HSP_mod_K8S *)mod->data;
-    char mpath[HSP_K8S_MAX_FNAME_LEN+1];
-    snprintf(mpath, HSP_K8S_MAX_FNAME_LEN, PROCFS_STR "mounts");
-    FILE *procFile = fopen(mpath, "r");
-    if(procFile) {
-      // limit the number of chars we will read from each line
-      // (there can be more than this - my_readline will chop for us)
-      char line[MAX_PROC_LINE_CHARS];
-      int truncated;
-      while(my_readline(procFile, line, MAX_PROC_LINE_CHARS, &truncated) != EOF) {
-	char buf[MAX_PROC_LINE_CHARS];
-	char *p = line;
-	char *fsType = parseNextTok(&p, " ", NO, '\0', NO, buf, MAX_PROC_LINE_CHARS);
-	if(my_strequal(fsType, "cgroup2")) {
-	  char *fsPath = parseNextTok(&p, " ", NO, '\0', NO, buf, MAX_PROC_LINE_CHARS);
-	  if(fsPath) {
-	    myDebug(1, "found cgroup2 path = %s", fsPath);
-	    mdata->cgroup_path = my_strdup(fsPath);
-	  }
-	}
-	// devices controller is still cgroups v1
-	if(my_strequal(fsType, "cgroup")) {
-	  char *fsPath = parseNextTok(&p, " ", NO, '\0', NO, buf, MAX_PROC_LINE_CHARS);
-	  if(fsPath
-	     && fnmatch("*/devices", fsPath, 0) == 0) {
-	    myDebug(1, "found cgroup devices controller path = %s", fsPath);
-	    mdata->cgroup_devices_path = my_strdup(fsPath);
-	  }
-	}
-      }
-      fclose(procFile);
-    }
-  }
-
   /*________________---------------------------__________________
     ________________    setVNIC_ds             __________________
     ----------------___________________________------------------
@@ -336,7 +320,7 @@ extern "C" {
 
       // open /proc/<nspid>/ns/net
       char topath[HSP_K8S_MAX_FNAME_LEN+1];
-      snprintf(topath, HSP_K8S_MAX_FNAME_LEN, PROCFS_STR "/%u/ns/net", nspid);
+      snprintf(topath, HSP_K8S_MAX_FNAME_LEN, "%s/%u/ns/net", hspFS(HSP_FS_PROC), nspid);
       int nsfd = open(topath, O_RDONLY | O_CLOEXEC);
       if(nsfd < 0) {
 	fprintf(stderr, "cannot open %s : %s", topath, strerror(errno));
@@ -377,7 +361,9 @@ extern "C" {
 	exit(EXIT_FAILURE);
       }
 
-      FILE *procFile = fopen(PROCFS_STR "/net/dev", "r");
+      char fsbuf[HSP_MAX_PATHLEN];
+
+      FILE *procFile = fopen(hspFSPath(fsbuf, HSP_MAX_PATHLEN, HSP_FS_PROC, "/net/dev"), "r");
       if(procFile) {
 	struct ifreq ifr;
 	memset(&ifr, 0, sizeof(ifr));
@@ -725,14 +711,11 @@ extern "C" {
 	UTHashAdd(mdata->podsByHostname, pod);
 	// collection of child containers
 	pod->containers = UTHASH_NEW(HSPK8sContainer, id, UTHASH_SKEY);
-	if(cgpath
-	   && mdata->cgroup_path) {
+	if(cgpath) {
 	  // get inode that TCP DIAG will report as 'cgroup_id'
-	  char path[HSP_K8S_MAX_FNAME_LEN];
-	  snprintf(path, HSP_K8S_MAX_FNAME_LEN, "%s/%s", mdata->cgroup_path, cgpath);
-	  struct stat statBuf = {};
-	  if(stat(path, &statBuf) == 0) {
-	    pod->cgroup_id = statBuf.st_ino;
+	  HSPCgroup *cg = hspCgroup(sp, cgpath);
+	  if(cg) {
+	    pod->cgroup_id = cg->ino;
 	    myDebug(1, "Learned cgroup_id = %u for pod %s",
 		    pod->cgroup_id,
 		    pod->hostname);
@@ -802,36 +785,8 @@ extern "C" {
   static void updatePodCgroupPaths(EVMod *mod, HSPVMState_POD *pod) {
     if(pod->nspid == 0)
       return;
-    HSPVMState *vm = &pod->vm;
-    if(vm) {
-      // open /proc/<pid>/cgroup
-      char cgpath[HSP_K8S_MAX_FNAME_LEN+1];
-      snprintf(cgpath, HSP_K8S_MAX_FNAME_LEN, PROCFS_STR "/%u/cgroup", pod->nspid);
-      FILE *procFile = fopen(cgpath, "r");
-      if(procFile) {
-	char line[MAX_PROC_LINE_CHARS];
-	int truncated;
-	while(my_readline(procFile, line, MAX_PROC_LINE_CHARS, &truncated) != EOF) {
-	  if(!truncated) {
-	    // expect lines like 3:devices:<long_path>
-	    int entryNo;
-	    char type[MAX_PROC_LINE_CHARS];
-	    char path[MAX_PROC_LINE_CHARS];
-	    if(sscanf(line, "%d:%[^:]:%[^:]", &entryNo, type, path) == 3) {
-	      if(my_strequal(type, "devices")) {
-		if(!my_strequal(pod->cgroup_devices, path)) {
-		  if(pod->cgroup_devices)
-		    my_free(pod->cgroup_devices);
-		  pod->cgroup_devices = my_strdup(path);
-		  myDebug(1, "k8s: pod(%s)->cgroup_devices=%s", pod->hostname, pod->cgroup_devices);
-		}
-	      }
-	    }
-	  }
-	}
-	fclose(procFile);
-      }
-    }
+    if(hspCgroupOfPid(pod->nspid, "devices", &pod->cgroup_devices))
+      myDebug(1, "k8s: pod(%s)->cgroup_devices=%s", pod->hostname, pod->cgroup_devices);
   }
 
   /*_________________---------------------------__________________
@@ -887,55 +842,47 @@ extern "C" {
     UTArrayReset(arr);
   }
 
-  static void readPodGPUsFromEnv(EVMod *mod, HSPVMState_POD *pod, cJSON *jenv) {
-    // look through env vars for evidence of GPUs assigned to this pod
+  static void readPodGPUsFromEnv(EVMod *mod, HSPVMState_POD *pod, char *gpu_uuids) {
+    // gpu_uuids is the value of NVIDIA_VISIBLE_DEVICES, if set
     myDebug(1, "readPodGPUsFromEnv(%s)", pod->hostname);
     pod->gpu_env_tried = YES;
-    int entries = cJSON_GetArraySize(jenv);
+    if(gpu_uuids == NULL)
+      return;
     UTArray *arr = pod->vm.gpus;
-    for(int ii = 0; ii < entries; ii++) {
-      cJSON *varval = cJSON_GetArrayItem(jenv, ii);
-      if(varval) {
-	char *vvstr = varval->valuestring;
-	int vlen = strlen(HSP_NVIDIA_VIS_DEV_ENV);
-	if(vvstr
-	   && my_strnequal(vvstr, HSP_NVIDIA_VIS_DEV_ENV, vlen)
-	   && vvstr[vlen] == '=') {
-	  myDebug(2, "parsing GPU env: %s", vvstr);
-	  char *gpu_uuids = vvstr + vlen + 1;
-	  clearPodGPUs(mod, pod);
-	  // (re)populate
-	  char *str;
-	  char buf[128];
-	  while((str = parseNextTok(&gpu_uuids, ",", NO, 0, YES, buf, 128)) != NULL) {
-	    myDebug(2, "parsing GPU uuidstr: %s", str);
-	    // expect GPU-<uuid>
-	    if(my_strnequal(str, "GPU-", 4)) {
-	      HSPGpuID *gpu = my_calloc(sizeof(HSPGpuID));
-	      if(parseUUID(str + 4, gpu->uuid)) {
-		gpu->has_uuid = YES;
-		myDebug(2, "adding GPU uuid to pod: %s", pod->hostname);
-		UTArrayAdd(arr, gpu);
-		pod->gpu_env = YES;
-	      }
-	      else {
-		myDebug(2, "GPU uuid parse failed");
-		my_free(gpu);
-	      }
-	    }
-	  }
+    myDebug(2, "parsing GPU env: %s", gpu_uuids);
+    clearPodGPUs(mod, pod);
+    // (re)populate
+    char *str;
+    char buf[128];
+    while((str = parseNextTok(&gpu_uuids, ",", NO, 0, YES, buf, 128)) != NULL) {
+      myDebug(2, "parsing GPU uuidstr: %s", str);
+      // expect GPU-<uuid>
+      if(my_strnequal(str, "GPU-", 4)) {
+	HSPGpuID *gpu = my_calloc(sizeof(HSPGpuID));
+	if(parseUUID(str + 4, gpu->uuid)) {
+	  gpu->has_uuid = YES;
+	  myDebug(2, "adding GPU uuid to pod: %s", pod->hostname);
+	  UTArrayAdd(arr, gpu);
+	  pod->gpu_env = YES;
+	}
+	else {
+	  myDebug(2, "GPU uuid parse failed");
+	  my_free(gpu);
 	}
       }
     }
   }
   
   static void readPodGPUsFromDev(EVMod *mod, HSPVMState_POD *pod) {
-    HSP_mod_K8S *mdata = (HSP_mod_K8S *)mod->data;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
     myDebug(1, "readPodGPUsFromDev(%s)", pod->hostname);
     pod->gpu_dev_tried = YES;
+    char *devices = hspCgroupV1Mount(sp, HSP_CGROUP_V1_DEVICES);
+    if(devices == NULL)
+      return;
     // look through devices to see if individial GPUs are exposed
     char path[HSP_MAX_PATHLEN];
-    sprintf(path, "%s/%s/devices.list", mdata->cgroup_devices_path, pod->cgroup_devices);
+    snprintf(path, HSP_MAX_PATHLEN, "%s/%s/devices.list", devices, pod->cgroup_devices);
     FILE *procFile = fopen(path, "r");
     if(procFile) {
       UTArray *arr = pod->vm.gpus;
@@ -1001,27 +948,13 @@ extern "C" {
   }
 
   /*_________________---------------------------__________________
-    _________________       logField            __________________
+    _________________     readContainerData     __________________
     -----------------___________________________------------------
+    One record from hsflowd_containerd,  whether it came as a "data>"
+    JSON line or as a binary frame.  The strings are borrowed.
   */
 
-  static void logField(int debugLevel, char *msg, cJSON *obj, char *field)
-  {
-    if(debug(debugLevel)) {
-      cJSON *fieldObj = cJSON_GetObjectItem(obj, field);
-      char *str = fieldObj ? cJSON_Print(fieldObj) : NULL;
-      myLog(LOG_INFO, "%s %s=%s", msg, field, str ?: "<not found>");
-      if(str)
-	my_free(str);
-    }
-  }
-
-  /*_________________---------------------------__________________
-    _________________     readContainerJSON     __________________
-    -----------------___________________________------------------
-  */
-
-  static void readContainerJSON(EVMod *mod, cJSON *top, void *magic) {
+  static void readContainerData(EVMod *mod, HSPK8sContainerData *data) {
     HSP_mod_K8S *mdata = (HSP_mod_K8S *)mod->data;
     HSP *sp = (HSP *)EVROOTDATA(mod);
     if(sp->sFlowSettings == NULL) {
@@ -1029,44 +962,23 @@ extern "C" {
       return;
     }
     HSPK8sContainer *container = NULL;
-    cJSON *jid = cJSON_GetObjectItem(top, "Id");
-
-    if(jid)
-      container = getContainer(mod, jid->valuestring, YES);
+    if(data->id)
+      container = getContainer(mod, data->id, YES);
     if(container == NULL)
       return;
 
-    cJSON *jpid = cJSON_GetObjectItem(top, "Pid");
-    if(jpid)
-      container->pid = (pid_t)jpid->valueint;
-    
-    cJSON *jmetrics = cJSON_GetObjectItem(top, "Metrics");
-    if(!jmetrics)
+    if(data->gotPid)
+      container->pid = data->pid;
+
+    if(!data->gotMetrics)
       return;
 
-    cJSON *jnames = cJSON_GetObjectItem(jmetrics, "Names");
-    if(jnames) {
-      logField(1, " ", jnames, "Image");
-      logField(1, " ", jnames, "Hostname");
-      logField(1, " ", jnames, "ContainerName");
-      logField(1, " ", jnames, "ContainerType");
-      logField(1, " ", jnames, "SandboxName");
-      logField(1, " ", jnames, "SandboxNamespace");
-      logField(1, " ", jnames, "ImageName");
-    }
-    
-    cJSON *jn = cJSON_GetObjectItem(jnames, "ContainerName");
-    cJSON *jt = cJSON_GetObjectItem(jnames, "ContainerType");
-    cJSON *jhn = cJSON_GetObjectItem(jnames, "Hostname");
-    cJSON *jsn = cJSON_GetObjectItem(jnames, "SandboxName");
-    cJSON *jsns = cJSON_GetObjectItem(jnames, "SandboxNamespace");
-    cJSON *jcgpth = cJSON_GetObjectItem(jnames, "CgroupsPath");
-    char *jn_s = (jn && strlen(jn->valuestring)) ? jn->valuestring : NULL;
-    char *jt_s = (jt && strlen(jt->valuestring)) ? jt->valuestring : NULL;
-    char *jhn_s = (jhn && strlen(jhn->valuestring)) ? jhn->valuestring : NULL;
-    char *jsn_s = (jsn && strlen(jsn->valuestring)) ? jsn->valuestring : NULL;
-    char *jsns_s = (jsns && strlen(jsns->valuestring)) ? jsns->valuestring : NULL;
-    char *jcgpth_s = (jcgpth && strlen(jcgpth->valuestring)) ? jcgpth->valuestring : NULL;
+    char *jn_s = my_strlen(data->containerName) ? data->containerName : NULL;
+    char *jt_s = my_strlen(data->containerType) ? data->containerType : NULL;
+    char *jhn_s = my_strlen(data->hostname) ? data->hostname : NULL;
+    char *jsn_s = my_strlen(data->sandboxName) ? data->sandboxName : NULL;
+    char *jsns_s = my_strlen(data->sandboxNamespace) ? data->sandboxNamespace : NULL;
+    char *jcgpth_s = my_strlen(data->cgroupsPath) ? data->cgroupsPath : NULL;
     // containerType indicates sandbox
     container->isSandbox = (my_strequal(jt_s, "sandbox"));
 
@@ -1074,51 +986,24 @@ extern "C" {
     setContainerName(mod, container, jn_s);
 
     // next gather the latest metrics for this container
-    cJSON *jcpu = cJSON_GetObjectItem(jmetrics, "Cpu");
-    if(jcpu) {
-      cJSON *jcpustate = cJSON_GetObjectItem(jcpu, "VirDomainState");
-      container->stats.state = SFL_VIR_DOMAIN_RUNNING;
-      if(jcpustate) {
-	container->stats.state = jcpustate->valueint;
-	if(container->stats.state != SFL_VIR_DOMAIN_RUNNING)
-	  myDebug(2, "container (name=%s) state=%u",
-		  jn_s,
-		  container->stats.state);
-      }
-      cJSON *jcputime = cJSON_GetObjectItem(jcpu, "CpuTime");
-      if(jcputime)
-	container->stats.cpu_total = jcputime->valuedouble;
-      cJSON *jcpucount = cJSON_GetObjectItem(jcpu, "CpuCount");
-      if(jcpucount)
-	container->stats.cpu_count = jcpucount->valueint;
+    if(data->gotCpu) {
+      container->stats.state = data->state;
+      if(container->stats.state != SFL_VIR_DOMAIN_RUNNING)
+	myDebug(2, "container (name=%s) state=%u",
+		jn_s,
+		container->stats.state);
+      container->stats.cpu_total = data->cpuTime;
+      container->stats.cpu_count = data->cpuCount;
     }
-    cJSON *jmem = cJSON_GetObjectItem(jmetrics, "Mem");
-    if(jmem) {
-      cJSON *jm = cJSON_GetObjectItem(jmem, "Memory");
-      if(jm)
-	container->stats.mem_usage = jm->valuedouble; // TODO: units?
-      cJSON *jmm = cJSON_GetObjectItem(jmem, "MaxMemory");
-      if(jmm)
-	container->stats.memoryLimit = jmm->valuedouble; // TODO: units?
-    }
-    
-    cJSON *jnet = cJSON_GetObjectItem(jmetrics, "Net");
-    if(jnet) {
+    if(data->gotMem) {
+      container->stats.mem_usage = data->memory; // TODO: units?
+      container->stats.memoryLimit = data->maxMemory; // TODO: units?
     }
-    cJSON *jdsk = cJSON_GetObjectItem(jmetrics, "Dsk");
-    if(jdsk) {
-      cJSON *jrd_req = cJSON_GetObjectItem(jdsk, "Rd_req");
-      cJSON *jwr_req = cJSON_GetObjectItem(jdsk, "Wr_req");
-      cJSON *jrd_bytes = cJSON_GetObjectItem(jdsk, "Rd_bytes");
-      cJSON *jwr_bytes = cJSON_GetObjectItem(jdsk, "Wr_bytes");
-      if(jrd_req)
-	container->stats.dsk.rd_req = jrd_req->valuedouble;
-      if(jwr_req)
-	container->stats.dsk.wr_req = jwr_req->valuedouble;
-      if(jrd_bytes)
-	container->stats.dsk.rd_bytes = jrd_bytes->valuedouble;
-      if(jwr_bytes)
-	container->stats.dsk.wr_bytes = jwr_bytes->valuedouble;
+    if(data->gotDsk) {
+      container->stats.dsk.rd_req = data->dsk.rd_req;
+      container->stats.dsk.wr_req = data->dsk.wr_req;
+      container->stats.dsk.rd_bytes = data->dsk.rd_bytes;
+      container->stats.dsk.wr_bytes = data->dsk.wr_bytes;
     }
 
     // set hostname
@@ -1127,7 +1012,7 @@ extern "C" {
     // k8s_POD_{s.name}_{s.namespace}_{s.uid}_{s.attempt}
     // Container
     // k8s_{c.name}_{s.name}_{s.namespace}_{s.uid}_{c.attempt}
-    
+
     // Match the Kubernetes docker_inspect output by combining these strings into
     // the form k8s_<containername>_<sandboxname>_<sandboxnamespace>_<sandboxuser>_<c.attempt>
     // but in this case we are only naming the pod,  so we always leave out the containername.
@@ -1143,7 +1028,7 @@ extern "C" {
 
     // make sure this container is assigned to this pod.
     podAddContainer(mod, pod, container);
-    
+
     // set/update the pod nspid
     setPodNSPid(mod, pod);
 
@@ -1151,7 +1036,7 @@ extern "C" {
       // probe for the MAC and peer-ifIndex (will only
       // work if we have at least one regular container here
       // since the sandbox has pid==0).
-      
+
       // see if spacing the VNIC refresh reduces load
       time_t now_mono = mdata->pollBus->now.tv_sec;
       pod->last_heard = now_mono;
@@ -1161,23 +1046,21 @@ extern "C" {
 	pod->last_vnic = now_mono;
 	updatePodAdaptors(mod, pod);
       }
-      
+
       if(pod->last_cgroup == 0
 	 || (now_mono - pod->last_cgroup) > HSP_CGROUP_REFRESH_TIMEOUT) {
 	pod->last_cgroup = now_mono;
 	updatePodCgroupPaths(mod, pod);
       }
     }
-    
+
     if(!container->isSandbox) {
       // Only try to find the GPU info once, but don't
       // try it on the sandbox container because it won't
       // have the full ENV.
-      cJSON *jenv = cJSON_GetObjectItem(jmetrics, "Env");
-      if(jenv
-	 && !pod->gpu_env_tried)
-	readPodGPUsFromEnv(mod, pod, jenv);
-      
+      if(!pod->gpu_env_tried)
+	readPodGPUsFromEnv(mod, pod, data->gpuEnv);
+
       if(pod->cgroup_devices
 	 && !pod->gpu_dev_tried)
 	readPodGPUsFromDev(mod, pod);
@@ -1196,17 +1079,130 @@ extern "C" {
       }
     }
   }
-  
-  static void readContainerData(EVMod *mod, char *str, void *magic) {
+
+  /*_________________---------------------------__________________
+    _________________       logField            __________________
+    -----------------___________________________------------------
+  */
+
+  static void logField(int debugLevel, char *msg, cJSON *obj, char *field)
+  {
+    if(debug(debugLevel)) {
+      cJSON *fieldObj = cJSON_GetObjectItem(obj, field);
+      char *str = fieldObj ? cJSON_Print(fieldObj) : NULL;
+      myLog(LOG_INFO, "%s %s=%s", msg, field, str ?: "<not found>");
+      if(str)
+	my_free(str);
+    }
+  }
+
+  /*_________________---------------------------__________________
+    _________________     readContainerJSON     __________________
+    -----------------___________________________------------------
+    A "data>" line from an older hsflowd_containerd that does not
+    write frames.
+  */
+
+  static char *jsonStr(cJSON *obj, char *field) {
+    cJSON *item = cJSON_GetObjectItem(obj, field);
+    return item ? item->valuestring : NULL;
+  }
+
+  static void readContainerJSON(EVMod *mod, cJSON *top, void *magic) {
+    HSPK8sContainerData data = { };
+    data.id = jsonStr(top, "Id");
+
+    cJSON *jpid = cJSON_GetObjectItem(top, "Pid");
+    if(jpid) {
+      data.pid = (pid_t)jpid->valueint;
+      data.gotPid = YES;
+    }
+
+    cJSON *jmetrics = cJSON_GetObjectItem(top, "Metrics");
+    if(jmetrics) {
+      data.gotMetrics = YES;
+      cJSON *jnames = cJSON_GetObjectItem(jmetrics, "Names");
+      if(jnames) {
+	logField(1, " ", jnames, "Image");
+	logField(1, " ", jnames, "Hostname");
+	logField(1, " ", jnames, "ContainerName");
+	logField(1, " ", jnames, "ContainerType");
+	logField(1, " ", jnames, "SandboxName");
+	logField(1, " ", jnames, "SandboxNamespace");
+	logField(1, " ", jnames, "ImageName");
+      }
+      data.containerName = jsonStr(jnames, "ContainerName");
+      data.containerType = jsonStr(jnames, "ContainerType");
+      data.hostname = jsonStr(jnames, "Hostname");
+      data.sandboxName = jsonStr(jnames, "SandboxName");
+      data.sandboxNamespace = jsonStr(jnames, "SandboxNamespace");
+      data.cgroupsPath = jsonStr(jnames, "CgroupsPath");
+
+      cJSON *jcpu = cJSON_GetObjectItem(jmetrics, "Cpu");
+      if(jcpu) {
+	data.gotCpu = YES;
+	cJSON *jcpustate = cJSON_GetObjectItem(jcpu, "VirDomainState");
+	data.state = jcpustate ? jcpustate->valueint : SFL_VIR_DOMAIN_RUNNING;
+	cJSON *jcputime = cJSON_GetObjectItem(jcpu, "CpuTime");
+	if(jcputime)
+	  data.cpuTime = jcputime->valuedouble;
+	cJSON *jcpucount = cJSON_GetObjectItem(jcpu, "CpuCount");
+	if(jcpucount)
+	  data.cpuCount = jcpucount->valueint;
+      }
+      cJSON *jmem = cJSON_GetObjectItem(jmetrics, "Mem");
+      if(jmem) {
+	data.gotMem = YES;
+	cJSON *jm = cJSON_GetObjectItem(jmem, "Memory");
+	if(jm)
+	  data.memory = jm->valuedouble;
+	cJSON *jmm = cJSON_GetObjectItem(jmem, "MaxMemory");
+	if(jmm)
+	  data.maxMemory = jmm->valuedouble;
+      }
+      cJSON *jdsk = cJSON_GetObjectItem(jmetrics, "Dsk");
+      if(jdsk) {
+	data.gotDsk = YES;
+	cJSON *jrd_req = cJSON_GetObjectItem(jdsk, "Rd_req");
+	cJSON *jwr_req = cJSON_GetObjectItem(jdsk, "Wr_req");
+	cJSON *jrd_bytes = cJSON_GetObjectItem(jdsk, "Rd_bytes");
+	cJSON *jwr_bytes = cJSON_GetObjectItem(jdsk, "Wr_bytes");
+	if(jrd_req)
+	  data.dsk.rd_req = jrd_req->valuedouble;
+	if(jwr_req)
+	  data.dsk.wr_req = jwr_req->valuedouble;
+	if(jrd_bytes)
+	  data.dsk.rd_bytes = jrd_bytes->valuedouble;
+	if(jwr_bytes)
+	  data.dsk.wr_bytes = jwr_bytes->valuedouble;
+      }
+      // look through env vars for evidence of GPUs assigned to this pod
+      cJSON *jenv = cJSON_GetObjectItem(jmetrics, "Env");
+      int entries = cJSON_GetArraySize(jenv);
+      int vlen = strlen(HSP_NVIDIA_VIS_DEV_ENV);
+      for(int ii = 0; ii < entries; ii++) {
+	cJSON *varval = cJSON_GetArrayItem(jenv, ii);
+	char *vvstr = varval ? varval->valuestring : NULL;
+	if(vvstr
+	   && my_strnequal(vvstr, HSP_NVIDIA_VIS_DEV_ENV, vlen)
+	   && vvstr[vlen] == '=')
+	  data.gpuEnv = vvstr + vlen + 1;
+      }
+    }
+    readContainerData(mod, &data);
+  }
+
+  static void readContainerLine(EVMod *mod, char *str, void *magic) {
     // HSP_mod_K8S *mdata = (HSP_mod_K8S *)mod->data;
     int prefixLen = strlen(HSP_K8S_DATAPREFIX);
     if(memcmp(str, HSP_K8S_DATAPREFIX, prefixLen) == 0) {
       cJSON *top = cJSON_Parse(str + prefixLen);
-      readContainerJSON(mod, top, magic);
+      if(top)
+	readContainerJSON(mod, top, magic);
       cJSON_Delete(top);
     }
   }
-  
+
   static void readContainerCB(EVMod *mod, EVSocket *sock, EnumEVSocketReadStatus status, void *magic) {
     // HSP_mod_K8S *mdata = (HSP_mod_K8S *)mod->data;
     switch(status) {
@@ -1215,11 +1211,13 @@ extern "C" {
     case EVSOCKETREAD_STR:
       // UTStrBuf_chomp(sock->ioline);
       myDebug(1, "readContainerCB: %s", UTSTRBUF_STR(sock->ioline));
-      readContainerData(mod, UTSTRBUF_STR(sock->ioline), magic);
+      readContainerLine(mod, UTSTRBUF_STR(sock->ioline), magic);
       UTStrBuf_reset(sock->ioline);
       break;
     case EVSOCKETREAD_EOF:
+      // the reader has gone (see readerReset)
       myDebug(1, "readContainerCB EOF");
+      EVSocketClose(mod, sock, YES);
       break;
     case EVSOCKETREAD_BADF:
       myDebug(1, "readContainerCB BADF");
@@ -1229,7 +1227,88 @@ extern "C" {
       break;
     }
   }
-  
+
+  /*_________________---------------------------__________________
+    _________________    readContainerFrame     __________________
+    -----------------___________________________------------------
+    A record from a helper that writes binary frames (see
+    util_containerd.h).  A STATS record carries a complete poll,  so
+    it maps onto one "data>" line.
+  */
+
+  static void readContainerFrame(void *magic, EnumUTCtrdRec recType, UTCtrdContainer *ctr) {
+    EVMod *mod = (EVMod *)magic;
+    if(!my_strlen(ctr->id))
+      return;
+    HSPK8sContainerData data = { .id = ctr->id, .pid = ctr->pid, .gotPid = YES };
+    switch(recType) {
+    case UTCTRD_REC_CONTAINER:
+      myDebug(1, "container id=%s name=%s type=%s sandbox=%s/%s image=%s",
+	      ctr->id,
+	      ctr->containerName,
+	      ctr->containerType,
+	      ctr->sandboxNamespace,
+	      ctr->sandboxName,
+	      ctr->imageName);
+      readContainerData(mod, &data);
+      break;
+    case UTCTRD_REC_STATS:
+      data.gotMetrics = YES;
+      data.containerName = ctr->containerName;
+      data.containerType = ctr->containerType;
+      data.hostname = ctr->hostname;
+      data.sandboxName = ctr->sandboxName;
+      data.sandboxNamespace = ctr->sandboxNamespace;
+      data.cgroupsPath = ctr->cgroupsPath;
+      data.gpuEnv = my_strlen(ctr->gpus) ? ctr->gpus : NULL;
+      if(ctr->statsMask & UTCTRD_STAT_CPU) {
+	data.gotCpu = YES;
+	data.state = (ctr->statsMask & UTCTRD_STAT(UTCTRD_STAT_STATE))
+	  ? ctr->state
+	  : SFL_VIR_DOMAIN_RUNNING;
+	data.cpuTime = ctr->cpuTime;
+	data.cpuCount = ctr->cpuCount;
+      }
+      if(ctr->statsMask & UTCTRD_STAT_MEM) {
+	data.gotMem = YES;
+	data.memory = ctr->memory;
+	data.maxMemory = ctr->maxMemory;
+      }
+      if(ctr->statsMask & UTCTRD_STAT_DSK) {
+	data.gotDsk = YES;
+	data.dsk.rd_req = ctr->rd_req;
+	data.dsk.rd_bytes = ctr->rd_bytes;
+	data.dsk.wr_req = ctr->wr_req;
+	data.dsk.wr_bytes = ctr->wr_bytes;
+      }
+      readContainerData(mod, &data);
+      break;
+    case UTCTRD_REC_GONE: {
+      // the pod goes when none of its containers are running
+      // (see getCounters_POD),  or else when it is idle.
+      HSPK8sContainer search = { .id = ctr->id };
+      HSPK8sContainer *container = UTHashGet(((HSP_mod_K8S *)mod->data)->containersByID, &search);
+      if(container) {
+	myDebug(1, "container gone: %s", ctr->id);
+	container->stats.state = SFL_VIR_DOMAIN_SHUTOFF;
+      }
+      break;
+    }
+    }
+  }
+
+  // Lines from an older helper may be split across reads,
+  // so they are put back together in mdata->lineBuf.
+  static void readContainerText(EVMod *mod, char *buf, int len) {
+    HSP_mod_K8S *mdata = (HSP_mod_K8S *)mod->data;
+    UTStrBuf_append_n(mdata->lineBuf, buf, len);
+    char *eol;
+    while((eol = memchr(UTSTRBUF_STR(mdata->lineBuf), '\n', UTSTRBUF_LEN(mdata->lineBuf))) != NULL) {
+      *eol = '\0';
+      readContainerLine(mod, UTSTRBUF_STR(mdata->lineBuf), mdata);
+      UTStrBuf_snip_prefix(mdata->lineBuf, (eol - UTSTRBUF_STR(mdata->lineBuf)) + 1);
+    }
+  }
   /*_________________---------------------------__________________
     _________________ evt_flow_sample_released  __________________
     -----------------___________________________------------------
@@ -1354,8 +1433,43 @@ extern "C" {
     -----------------___________________________------------------
   */
 
+  // A frame that will not decode leaves the stream out of step,  so
+  // kill the reader and let the next tock start a fresh one.
+  static void readerReset(EVMod *mod, EVSocket *sock) {
+    HSP_mod_K8S *mdata = (HSP_mod_K8S *)mod->data;
+    if(mdata->readerPid > 0)
+      kill(mdata->readerPid, SIGKILL);
+    // reaps the child too
+    EVSocketClose(mod, sock, YES);
+    UTCtrdFree(mdata->frames);
+    mdata->frames = UTCtrdNew(readContainerFrame, mod);
+    mdata->readerPid = 0;
+  }
+
   static void readCB(EVMod *mod, EVSocket *sock, void *magic) {
-    EVSocketReadLines(mod, sock, readContainerCB, YES, magic);
+    HSP_mod_K8S *mdata = (HSP_mod_K8S *)mod->data;
+    if(sock->errOut) {
+      // just log what the reader says on stderr
+      EVSocketReadLines(mod, sock, readContainerCB, YES, magic);
+      return;
+    }
+    char buf[HSP_K8S_READ_BUFSZ];
+    int cc;
+    while((cc = read(sock->fd, buf, HSP_K8S_READ_BUFSZ)) < 0
+	  && errno == EINTR);
+    if(cc > 0) {
+      if(UTCtrdMode(mdata->frames, buf, cc) == UTCTRD_MODE_TEXT)
+	readContainerText(mod, buf, cc);
+      else if(!UTCtrdFeed(mdata->frames, buf, cc)) {
+	myLog(LOG_ERR, "hsflowd_containerd: %s (restarting reader)", UTCtrdError(mdata->frames));
+	readerReset(mod, sock);
+      }
+    }
+    else if(cc == 0
+	    || errno != EAGAIN) {
+      myDebug(1, "readCB: %s", cc ? strerror(errno) : "EOF");
+      EVSocketClose(mod, sock, YES);
+    }
   }
 
   static void evt_cfg_done(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
@@ -1401,7 +1515,9 @@ extern "C" {
       // char *cmd[] = { HSP_K8S_READER, "--debugLevel", level,  NULL };
       // but can always debug reader separately, so just invoke it like this:
       char *cmd[] = { HSP_K8S_READER, NULL };
-      mdata->readerPid = EVBusExec(mod, mdata->pollBus, mdata, cmd, readCB);
+      // ask for binary frames.  An older reader will ignore this.
+      char *env[] = { HSP_CTRD_FRAMES_ENV, NULL };
+      mdata->readerPid = EVBusExecEnv(mod, mdata->pollBus, mdata, cmd, env, readCB);
     }
   }
 
@@ -1431,6 +1547,8 @@ extern "C" {
     mdata->podsByHostname = UTHASH_NEW(HSPVMState_POD, hostname, UTHASH_SKEY);
     mdata->podsByCgroupId = UTHASH_NEW(HSPVMState_POD, cgroup_id, UTHASH_DFLT);
     mdata->containersByID = UTHASH_NEW(HSPK8sContainer, id, UTHASH_SKEY);
+    mdata->frames = UTCtrdNew(readContainerFrame, mod);
+    mdata->lineBuf = UTStrBuf_new();
     
     // register call-backs
     mdata->pollBus = EVGetBus(mod, HSPBUS_POLL, YES);
@@ -1454,8 +1572,6 @@ extern "C" {
       EVBus *packetBus = EVGetBus(mod, HSPBUS_PACKET, YES);
       EVEventRx(mod, EVGetEvent(packetBus, HSPEVENT_FLOW_SAMPLE_RELEASED), evt_flow_sample_released);
     }
-
-    readCgroupPaths(mod);
   }
 
 #if defined(__cplusplus)
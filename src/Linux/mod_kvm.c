@@ -14,8 +14,28 @@ extern "C" {
   typedef struct _HSPVMState_KVM {
     HSPVMState vm; // superclass: must come first
     int virDomainId;
+    virDomainPtr domain; // held for the stats calls
+    bool xmlStale:1; // devices need to be read from the XML
   } HSPVMState_KVM;
 
+  // posted by the libvirt event thread for the poll bus
+  typedef struct _HSPKVMEvent {
+    u_char uuid[VIR_UUID_BUFLEN];
+    int eventId; // VIR_DOMAIN_EVENT_ID_*, or HSP_KVM_EVENT_CLOSED
+  } HSPKVMEvent;
+
+#define HSP_KVM_EVENT_CLOSED -1
+
+  // everything the counter sample needs,  in one virDomainListGetStats()
+#define HSP_KVM_STATS (VIR_DOMAIN_STATS_STATE	\
+		       | VIR_DOMAIN_STATS_CPU_TOTAL	\
+		       | VIR_DOMAIN_STATS_BALLOON	\
+		       | VIR_DOMAIN_STATS_VCPU		\
+		       | VIR_DOMAIN_STATS_BLOCK)
+
+#define HSP_KVM_KEEPALIVE_INTERVAL 5
+#define HSP_KVM_KEEPALIVE_COUNT 3
+
   typedef struct _HSP_mod_KVM {
     virConnectPtr virConn;
     UTHash *vmsByUUID;
@@ -25,166 +45,135 @@ extern "C" {
     uint32_t refreshVMListSecs;
     time_t next_refreshVMList;
     uint32_t forgetVMSecs;
+    UTArray *events; // HSPKVMEvent
+    bool eventLoop; // libvirt event thread is running
+    bool refreshNow;
+    int cbLifecycle; // callback ids,  -1 if not registered
+    int cbDeviceAdded;
+    int cbDeviceRemoved;
   } HSP_mod_KVM;
 
-  static void agentCB_getCounters_KVM(void *magic, SFLPoller *poller, SFL_COUNTERS_SAMPLE_TYPE *cs)
+  /*_________________---------------------------__________________
+    _________________    getCounters_KVM        __________________
+    -----------------___________________________------------------
+    From the bulk stats record for one domain (see evt_tock).
+  */
+
+  static unsigned long long statULL(virDomainStatsRecordPtr rec, char *fmt, ...) {
+    char name[VIR_TYPED_PARAM_FIELD_LENGTH];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(name, VIR_TYPED_PARAM_FIELD_LENGTH, fmt, args);
+    va_end(args);
+    unsigned long long val = 0;
+    if(virTypedParamsGetULLong(rec->params, rec->nparams, name, &val) != 1)
+      val = 0;
+    return val;
+  }
+
+  static void getCounters_KVM(EVMod *mod, HSPVMState_KVM *state, virDomainStatsRecordPtr rec)
   {
-    EVMod *mod = (EVMod *)magic;
-    HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
     HSP *sp = (HSP *)EVROOTDATA(mod);
-
-    assert(poller->magic);
-    HSPVMState_KVM *state = (HSPVMState_KVM *)poller->userData;
     HSPVMState *vm = (HSPVMState *)&state->vm;
-    if(state == NULL) {
-      myDebug(1, "agentCB_getCounters_KVM: state==NULL");
-      return;
+    SFL_COUNTERS_SAMPLE_TYPE cs = { 0 };
+
+    // host ID
+    SFLCounters_sample_element hidElem = { 0 };
+    hidElem.tag = SFLCOUNTERS_HOST_HID;
+    const char *hname = virDomainGetName(state->domain); // no need to free this one
+    if(hname) {
+      hidElem.counterBlock.host_hid.hostname.str = (char *)hname;
+      hidElem.counterBlock.host_hid.hostname.len = strlen(hname);
+      memcpy(hidElem.counterBlock.host_hid.uuid, vm->uuid, 16);
+
+      // char *osType = virDomainGetOSType(domainPtr); $$$
+      hidElem.counterBlock.host_hid.machine_type = SFLMT_unknown;//$$$
+      hidElem.counterBlock.host_hid.os_name = SFLOS_unknown;//$$$
+      //hidElem.counterBlock.host_hid.os_release.str = NULL;
+      //hidElem.counterBlock.host_hid.os_release.len = 0;
+      SFLADD_ELEMENT(&cs, &hidElem);
     }
 
-    if(mdata->virConn) {
-      virDomainPtr domainPtr = virDomainLookupByID(mdata->virConn, state->virDomainId);
-      if(domainPtr == NULL) {
-	sp->refreshVMList = YES;
-      }
-      else {
-	// host ID
-	SFLCounters_sample_element hidElem = { 0 };
-	hidElem.tag = SFLCOUNTERS_HOST_HID;
-	const char *hname = virDomainGetName(domainPtr); // no need to free this one
-	if(hname) {
-	  // copy the name out here so we can free it straight away
-	  hidElem.counterBlock.host_hid.hostname.str = (char *)hname;
-	  hidElem.counterBlock.host_hid.hostname.len = strlen(hname);
-	  virDomainGetUUID(domainPtr, hidElem.counterBlock.host_hid.uuid);
-
-	  // char *osType = virDomainGetOSType(domainPtr); $$$
-	  hidElem.counterBlock.host_hid.machine_type = SFLMT_unknown;//$$$
-	  hidElem.counterBlock.host_hid.os_name = SFLOS_unknown;//$$$
-	  //hidElem.counterBlock.host_hid.os_release.str = NULL;
-	  //hidElem.counterBlock.host_hid.os_release.len = 0;
-	  SFLADD_ELEMENT(cs, &hidElem);
-	}
-
-	// host parent
-	SFLCounters_sample_element parElem = { 0 };
-	parElem.tag = SFLCOUNTERS_HOST_PAR;
-	parElem.counterBlock.host_par.dsClass = SFL_DSCLASS_PHYSICAL_ENTITY;
-	parElem.counterBlock.host_par.dsIndex = HSP_DEFAULT_PHYSICAL_DSINDEX;
-	SFLADD_ELEMENT(cs, &parElem);
-
-	// VM Net I/O
-	SFLCounters_sample_element nioElem = { 0 };
-	nioElem.tag = SFLCOUNTERS_HOST_VRT_NIO;
-	// since we are already maintaining the accumulated network counters (and handling issues like 32-bit
-	// rollover) then we can just use the same mechanism again.  On a non-linux platform we may
-	// want to take advantage of the libvirt call to get the counters (it takes the domain id and the
-	// device name as parameters so you have to call it multiple times),  but even then we would
-	// probably do that down inside the readNioCounters() fn in case there is work to do on the
-	// accumulation and rollover-detection.
-	readNioCounters(sp, (SFLHost_nio_counters *)&nioElem.counterBlock.host_vrt_nio, NULL, vm->interfaces);
-	SFLADD_ELEMENT(cs, &nioElem);
-
-	// VM cpu counters [ref xenstat.c]
-	SFLCounters_sample_element cpuElem = { 0 };
-	cpuElem.tag = SFLCOUNTERS_HOST_VRT_CPU;
-	virDomainInfo domainInfo;
-	int domainInfoOK = NO;
-	if(virDomainGetInfo(domainPtr, &domainInfo) != 0) {
-	  myLog(LOG_ERR, "virDomainGetInfo() failed");
-	}
-	else {
-	  domainInfoOK = YES;
-	  // enum virDomainState really is the same as enum SFLVirDomainState
-	  cpuElem.counterBlock.host_vrt_cpu.state = domainInfo.state;
-	  cpuElem.counterBlock.host_vrt_cpu.cpuTime = (domainInfo.cpuTime / 1000000);
-	  cpuElem.counterBlock.host_vrt_cpu.nrVirtCpu = domainInfo.nrVirtCpu;
-	  SFLADD_ELEMENT(cs, &cpuElem);
-	}
-
-	SFLCounters_sample_element memElem = { 0 };
-	memElem.tag = SFLCOUNTERS_HOST_VRT_MEM;
-	if(domainInfoOK) {
-	  memElem.counterBlock.host_vrt_mem.memory = domainInfo.memory * 1024;
-	  memElem.counterBlock.host_vrt_mem.maxMemory = (domainInfo.maxMem == UINT_MAX) ? -1 : (domainInfo.maxMem * 1024);
-	  SFLADD_ELEMENT(cs, &memElem);
-	}
-
-	// VM disk I/O counters
-	SFLCounters_sample_element dskElem = { 0 };
-	dskElem.tag = SFLCOUNTERS_HOST_VRT_DSK;
-	for(int i = strArrayN(vm->disks); --i >= 0; ) {
-	  /* vm->volumes and vm->disks are populated in lockstep
-	   * so they always have the same number of elements
-	   */
-	  char *volPath = strArrayAt(vm->volumes, i);
-	  char *dskPath = strArrayAt(vm->disks, i);
-	  bool gotVolInfo = NO;
-
-#if (LIBVIR_VERSION_NUMBER >= 8001)
-	  if(gotVolInfo == NO) {
-	    /* try appealing directly to the disk path instead */
-	    /* this call was only added in April 2010 (version 0.8.1).
-	     * See http://markmail.org/message/mjafgt47f5e5zzfc
-	     */
-	    virDomainBlockInfo blkInfo;
-	    if(virDomainGetBlockInfo(domainPtr, volPath, &blkInfo, 0) == -1) {
-	      myLog(LOG_ERR, "virDomainGetBlockInfo(%s) failed", dskPath);
-	    }
-	    else {
-	      dskElem.counterBlock.host_vrt_dsk.capacity += blkInfo.capacity;
-	      dskElem.counterBlock.host_vrt_dsk.allocation += blkInfo.allocation;
-	      dskElem.counterBlock.host_vrt_dsk.available += (blkInfo.capacity - blkInfo.allocation);
-	      // don't need blkInfo.physical
-	      gotVolInfo = YES;
-	    }
-	  }
-#endif
-
-	  if(gotVolInfo == NO) {
-	    virStorageVolPtr volPtr = virStorageVolLookupByPath(mdata->virConn, volPath);
-	    if(volPtr == NULL) {
-	      myLog(LOG_ERR, "virStorageLookupByPath(%s) failed", volPath);
-	    }
-	    else {
-	      virStorageVolInfo volInfo;
-	      if(virStorageVolGetInfo(volPtr, &volInfo) != 0) {
-		myLog(LOG_ERR, "virStorageVolGetInfo(%s) failed", volPath);
-	      }
-	      else {
-		gotVolInfo = YES;
-		dskElem.counterBlock.host_vrt_dsk.capacity += volInfo.capacity;
-		dskElem.counterBlock.host_vrt_dsk.allocation += volInfo.allocation;
-		dskElem.counterBlock.host_vrt_dsk.available += (volInfo.capacity - volInfo.allocation);
-	      }
-	    }
-	  }
+    // host parent
+    SFLCounters_sample_element parElem = { 0 };
+    parElem.tag = SFLCOUNTERS_HOST_PAR;
+    parElem.counterBlock.host_par.dsClass = SFL_DSCLASS_PHYSICAL_ENTITY;
+    parElem.counterBlock.host_par.dsIndex = HSP_DEFAULT_PHYSICAL_DSINDEX;
+    SFLADD_ELEMENT(&cs, &parElem);
+
+    // VM Net I/O
+    SFLCounters_sample_element nioElem = { 0 };
+    nioElem.tag = SFLCOUNTERS_HOST_VRT_NIO;
+    // since we are already maintaining the accumulated network counters (and handling issues like 32-bit
+    // rollover) then we can just use the same mechanism again.  On a non-linux platform we may
+    // want to take advantage of the libvirt call to get the counters (it takes the domain id and the
+    // device name as parameters so you have to call it multiple times),  but even then we would
+    // probably do that down inside the readNioCounters() fn in case there is work to do on the
+    // accumulation and rollover-detection.
+    readNioCounters(sp, (SFLHost_nio_counters *)&nioElem.counterBlock.host_vrt_nio, NULL, vm->interfaces);
+    SFLADD_ELEMENT(&cs, &nioElem);
+
+    // VM cpu counters [ref xenstat.c]
+    SFLCounters_sample_element cpuElem = { 0 };
+    cpuElem.tag = SFLCOUNTERS_HOST_VRT_CPU;
+    int domState;
+    if(virTypedParamsGetInt(rec->params, rec->nparams, "state.state", &domState) == 1) {
+      // enum virDomainState really is the same as enum SFLVirDomainState
+      cpuElem.counterBlock.host_vrt_cpu.state = domState;
+      cpuElem.counterBlock.host_vrt_cpu.cpuTime = (statULL(rec, "cpu.time") / 1000000);
+      unsigned int nrVirtCpu = 0;
+      virTypedParamsGetUInt(rec->params, rec->nparams, "vcpu.current", &nrVirtCpu);
+      cpuElem.counterBlock.host_vrt_cpu.nrVirtCpu = nrVirtCpu;
+      SFLADD_ELEMENT(&cs, &cpuElem);
+    }
 
-	  /* we get reads, writes and errors from a different call */
-	  virDomainBlockStatsStruct blkStats;
-	  if(virDomainBlockStats(domainPtr, dskPath, &blkStats, sizeof(blkStats)) != -1) {
-	    if(blkStats.rd_req != -1) dskElem.counterBlock.host_vrt_dsk.rd_req += blkStats.rd_req;
-	    if(blkStats.rd_bytes != -1) dskElem.counterBlock.host_vrt_dsk.rd_bytes += blkStats.rd_bytes;
-	    if(blkStats.wr_req != -1) dskElem.counterBlock.host_vrt_dsk.wr_req += blkStats.wr_req;
-	    if(blkStats.wr_bytes != -1) dskElem.counterBlock.host_vrt_dsk.wr_bytes += blkStats.wr_bytes;
-	    if(blkStats.errs != -1) dskElem.counterBlock.host_vrt_dsk.errs += blkStats.errs;
-	  }
-	}
-	SFLADD_ELEMENT(cs, &dskElem);
-
-	// include my slice of the adaptor list
-	SFLCounters_sample_element adaptorsElem = { 0 };
-	adaptorsElem.tag = SFLCOUNTERS_ADAPTORS;
-	adaptorsElem.counterBlock.adaptors = vm->interfaces;
-	SFLADD_ELEMENT(cs, &adaptorsElem);
-
-	SEMLOCK_DO(sp->sync_agent) {
-	  sfl_poller_writeCountersSample(poller, cs);
-	  sp->counterSampleQueued = YES;
-	  sp->telemetry[HSP_TELEMETRY_COUNTER_SAMPLES]++;
-	}
+    SFLCounters_sample_element memElem = { 0 };
+    memElem.tag = SFLCOUNTERS_HOST_VRT_MEM;
+    unsigned long long memKB, maxMemKB;
+    if(virTypedParamsGetULLong(rec->params, rec->nparams, "balloon.current", &memKB) == 1) {
+      memElem.counterBlock.host_vrt_mem.memory = memKB * 1024;
+      maxMemKB = statULL(rec, "balloon.maximum");
+      memElem.counterBlock.host_vrt_mem.maxMemory = (maxMemKB == UINT_MAX) ? -1 : (maxMemKB * 1024);
+      SFLADD_ELEMENT(&cs, &memElem);
+    }
 
-	virDomainFree(domainPtr);
-      }
+    // VM disk I/O counters.  The stats cover every block device,  but
+    // only count the ones we accepted from the XML (vm->disks),  which
+    // leaves out readonly devices.
+    SFLCounters_sample_element dskElem = { 0 };
+    dskElem.tag = SFLCOUNTERS_HOST_VRT_DSK;
+    unsigned int blockCount = 0;
+    virTypedParamsGetUInt(rec->params, rec->nparams, "block.count", &blockCount);
+    for(unsigned int bb = 0; bb < blockCount; bb++) {
+      char field[VIR_TYPED_PARAM_FIELD_LENGTH];
+      const char *dev = NULL;
+      snprintf(field, VIR_TYPED_PARAM_FIELD_LENGTH, "block.%u.name", bb);
+      if(virTypedParamsGetString(rec->params, rec->nparams, field, &dev) != 1
+	 || strArrayIndexOf(vm->disks, (char *)dev) == -1)
+	continue;
+      unsigned long long capacity = statULL(rec, "block.%u.capacity", bb);
+      unsigned long long allocation = statULL(rec, "block.%u.allocation", bb);
+      dskElem.counterBlock.host_vrt_dsk.capacity += capacity;
+      dskElem.counterBlock.host_vrt_dsk.allocation += allocation;
+      dskElem.counterBlock.host_vrt_dsk.available += (capacity - allocation);
+      dskElem.counterBlock.host_vrt_dsk.rd_req += statULL(rec, "block.%u.rd.reqs", bb);
+      dskElem.counterBlock.host_vrt_dsk.rd_bytes += statULL(rec, "block.%u.rd.bytes", bb);
+      dskElem.counterBlock.host_vrt_dsk.wr_req += statULL(rec, "block.%u.wr.reqs", bb);
+      dskElem.counterBlock.host_vrt_dsk.wr_bytes += statULL(rec, "block.%u.wr.bytes", bb);
+      dskElem.counterBlock.host_vrt_dsk.errs += statULL(rec, "block.%u.errors", bb);
+    }
+    SFLADD_ELEMENT(&cs, &dskElem);
+
+    // include my slice of the adaptor list
+    SFLCounters_sample_element adaptorsElem = { 0 };
+    adaptorsElem.tag = SFLCOUNTERS_ADAPTORS;
+    adaptorsElem.counterBlock.adaptors = vm->interfaces;
+    SFLADD_ELEMENT(&cs, &adaptorsElem);
+
+    SEMLOCK_DO(sp->sync_agent) {
+      sfl_poller_writeCountersSample(vm->poller, &cs);
+      sp->counterSampleQueued = YES;
+      sp->telemetry[HSP_TELEMETRY_COUNTER_SAMPLES]++;
     }
   }
 
@@ -337,16 +326,22 @@ extern "C" {
     -----------------___________________________------------------
   */
 
-  HSPVMState_KVM *getVM_KVM(EVMod *mod, char *uuid) {
+  static HSPVMState_KVM *findVM_KVM(EVMod *mod, char *uuid) {
     HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
     HSPVMState_KVM search;
     memset(&search, 0, sizeof(search));
     memcpy(search.vm.uuid, uuid, 16);
-    HSPVMState_KVM *state = UTHashGet(mdata->vmsByUUID, &search);
+    return UTHashGet(mdata->vmsByUUID, &search);
+  }
+
+  HSPVMState_KVM *getVM_KVM(EVMod *mod, char *uuid) {
+    HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
+    HSPVMState_KVM *state = findVM_KVM(mod, uuid);
     if(state == NULL) {
       // new vm or container
       state = (HSPVMState_KVM *)getVM(mod, uuid, YES, sizeof(HSPVMState_KVM), VMTYPE_KVM, agentCB_getCounters_KVM_request);
       if(state) {
+	state->xmlStale = YES;
 	UTHashAdd(mdata->vmsByUUID, state);
       }
     }
@@ -358,11 +353,58 @@ extern "C" {
     myDebug(1, "removeAndFreeVM: removing vm with dsIndex=%u (domId=%u)",
 	  state->vm.dsIndex,
 	  state->virDomainId);
+    if(state->domain) {
+      virDomainFree(state->domain);
+      state->domain = NULL;
+    }
+    // remove from pollActions if present (necessary if this happens in tick() and before tock()
+    UTArrayDel(mdata->pollActions, state->vm.poller);
     UTHashDel(mdata->vmsByUUID, state);
     HSPVMState *vm = &state->vm;
     removeAndFreeVM(mod, vm);
   }
 
+  /*_________________---------------------------__________________
+    _________________    readDomainXML          __________________
+    -----------------___________________________------------------
+    Interfaces and disks.  Only done for a new domain,  or when the
+    events say it changed (or on every refresh if we have no events).
+  */
+
+  static void readDomainXML(EVMod *mod, HSPVMState_KVM *state) {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    HSPVMState *vm = (HSPVMState *)&state->vm;
+    myDebug(1, "kvm: readDomainXML(%s)", virDomainGetName(state->domain));
+    // reset the information that we are about to refresh
+    adaptorListMarkAll(vm->interfaces);
+    strArrayReset(vm->volumes);
+    strArrayReset(vm->disks);
+    // get the XML descr - this seems more portable than some of
+    // the newer libvert API calls,  such as those to list interfaces
+    char *xmlstr = virDomainGetXMLDesc(state->domain, 0 /*VIR_DOMAIN_XML_SECURE not allowed for read-only */);
+    if(xmlstr == NULL) {
+      myLog(LOG_ERR, "virDomainGetXMLDesc(domain=%u, 0) failed", state->virDomainId);
+    }
+    else {
+      // parse the XML to get the list of interfaces and storage nodes
+      xmlDoc *doc = xmlParseMemory(xmlstr, strlen(xmlstr));
+      if(doc) {
+	xmlNode *rootNode = xmlDocGetRootElement(doc);
+	domain_xml_node(sp, rootNode, state);
+	xmlFreeDoc(doc);
+      }
+      free(xmlstr); // allocated by virDomainGetXMLDesc()
+      state->xmlStale = NO;
+    }
+    xmlCleanupParser();
+    // fully delete and free the marked adaptors - some may return if
+    // they are still present in the global-namespace list,  but
+    // we have to do this here in case one of these was discovered
+    // and allocated just for this VM.
+    deleteMarkedAdaptors_adaptorList(sp, vm->interfaces);
+    adaptorListFreeMarked(vm->interfaces);
+  }
+
   /*_________________---------------------------__________________
     _________________    configVMs_KVM          __________________
     -----------------___________________________------------------
@@ -370,83 +412,192 @@ extern "C" {
 
   static void configVMs_KVM(EVMod *mod) {
     HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
-    HSP *sp = (HSP *)EVROOTDATA(mod);
     if(mdata->virConn == NULL) {
       // no libvirt connection
       return;
     }
-    int num_domains = virConnectNumOfDomains(mdata->virConn);
-    if(num_domains == -1) {
-      myLog(LOG_ERR, "virConnectNumOfDomains() returned -1");
-      return;
-    }
-    int *domainIds = (int *)my_calloc(num_domains * sizeof(int));
-    if(virConnectListDomains(mdata->virConn, domainIds, num_domains) != num_domains) {
-      my_free(domainIds);
+    // without events we cannot tell when a domain's devices change
+    bool rereadXML = (mdata->cbLifecycle == -1
+		      || !mdata->eventLoop);
+    virDomainPtr *domains = NULL;
+    int num_domains = virConnectListAllDomains(mdata->virConn, &domains, VIR_CONNECT_LIST_DOMAINS_ACTIVE);
+    if(num_domains < 0) {
+      myLog(LOG_ERR, "virConnectListAllDomains() failed");
       return;
     }
     for(int i = 0; i < num_domains; i++) {
-      int domId = domainIds[i];
-      virDomainPtr domainPtr = virDomainLookupByID(mdata->virConn, domId);
-      if(domainPtr) {
-	char uuid[16];
-	virDomainGetUUID(domainPtr, (u_char *)uuid);
-	HSPVMState_KVM *state = getVM_KVM(mod, uuid);
-	HSPVMState *vm = (HSPVMState *)&state->vm;
-	vm->marked = NO;
-	vm->created = NO;
-	// remember the domId, which might have changed (if vm rebooted)
-	state->virDomainId = domId;
-	// reset the information that we are about to refresh
-	adaptorListMarkAll(vm->interfaces);
-	strArrayReset(vm->volumes);
-	strArrayReset(vm->disks);
-	// get the XML descr - this seems more portable than some of
-	// the newer libvert API calls,  such as those to list interfaces
-	char *xmlstr = virDomainGetXMLDesc(domainPtr, 0 /*VIR_DOMAIN_XML_SECURE not allowed for read-only */);
-	if(xmlstr == NULL) {
-	  myLog(LOG_ERR, "virDomainGetXMLDesc(domain=%u, 0) failed", domId);
-	}
-	else {
-	  // parse the XML to get the list of interfaces and storage nodes
-	  xmlDoc *doc = xmlParseMemory(xmlstr, strlen(xmlstr));
-	  if(doc) {
-	    xmlNode *rootNode = xmlDocGetRootElement(doc);
-	    domain_xml_node(sp, rootNode, state);
-	    xmlFreeDoc(doc);
-	  }
-	  free(xmlstr); // allocated by virDomainGetXMLDesc()
-	}
-	xmlCleanupParser();
+      virDomainPtr domainPtr = domains[i];
+      char uuid[16];
+      virDomainGetUUID(domainPtr, (u_char *)uuid);
+      HSPVMState_KVM *state = getVM_KVM(mod, uuid);
+      if(state == NULL) {
 	virDomainFree(domainPtr);
-	// fully delete and free the marked adaptors - some may return if
-	// they are still present in the global-namespace list,  but
-	// we have to do this here in case one of these was discovered
-	// and allocated just for this VM.
-	deleteMarkedAdaptors_adaptorList(sp, vm->interfaces);
-	adaptorListFreeMarked(vm->interfaces);
+	continue;
       }
+      HSPVMState *vm = (HSPVMState *)&state->vm;
+      vm->marked = NO;
+      vm->created = NO;
+      // remember the domId, which might have changed (if vm rebooted)
+      state->virDomainId = virDomainGetID(domainPtr);
+      // and hold on to this reference for the stats calls
+      if(state->domain)
+	virDomainFree(state->domain);
+      state->domain = domainPtr;
+      if(state->xmlStale
+	 || rereadXML)
+	readDomainXML(mod, state);
     }
+    myDebug(1, "kvm: configVMs_KVM() found %d domains", num_domains);
     mdata->num_domains = num_domains;
-    my_free(domainIds);
+    free(domains); // allocated by virConnectListAllDomains()
+  }
+
+  /*_________________---------------------------__________________
+    _________________    libvirt events         __________________
+    -----------------___________________________------------------
+    The callbacks run on the libvirt event thread,  so they only post
+    the domain UUID to mdata->events for evt_tick to pick up.
+  */
+
+  static void postEvent(EVMod *mod, virDomainPtr dom, int eventId) {
+    HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
+    HSPKVMEvent *kev = (HSPKVMEvent *)my_calloc(sizeof(HSPKVMEvent));
+    if(dom)
+      virDomainGetUUID(dom, kev->uuid);
+    kev->eventId = eventId;
+    UTArrayPush(mdata->events, kev);
+  }
+
+  static int lifecycleCB(virConnectPtr conn, virDomainPtr dom, int event, int detail, void *magic) {
+    myDebug(1, "kvm: domain %s lifecycle event=%d detail=%d", virDomainGetName(dom), event, detail);
+    postEvent((EVMod *)magic, dom, VIR_DOMAIN_EVENT_ID_LIFECYCLE);
+    return 0;
+  }
+
+  static void deviceAddedCB(virConnectPtr conn, virDomainPtr dom, const char *devAlias, void *magic) {
+    myDebug(1, "kvm: domain %s device added: %s", virDomainGetName(dom), devAlias);
+    postEvent((EVMod *)magic, dom, VIR_DOMAIN_EVENT_ID_DEVICE_ADDED);
+  }
+
+  static void deviceRemovedCB(virConnectPtr conn, virDomainPtr dom, const char *devAlias, void *magic) {
+    myDebug(1, "kvm: domain %s device removed: %s", virDomainGetName(dom), devAlias);
+    postEvent((EVMod *)magic, dom, VIR_DOMAIN_EVENT_ID_DEVICE_REMOVED);
+  }
+
+  static void closeCB(virConnectPtr conn, int reason, void *magic) {
+    myLog(LOG_INFO, "kvm: libvirt connection closed (reason=%d)", reason);
+    postEvent((EVMod *)magic, NULL, HSP_KVM_EVENT_CLOSED);
+  }
+
+  static void *eventLoop(void *magic) {
+    EVMod *mod = (EVMod *)magic;
+    HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
+    while(virEventRunDefaultImpl() == 0);
+    myLog(LOG_ERR, "virEventRunDefaultImpl() failed: falling back on polling for VM changes");
+    mdata->eventLoop = NO;
+    return NULL;
+  }
+
+  static void startEventLoop(EVMod *mod) {
+    HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
+    // must come before the connection is opened
+    if(virEventRegisterDefaultImpl() != 0) {
+      myLog(LOG_ERR, "virEventRegisterDefaultImpl() failed");
+      return;
+    }
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, EV_BUS_STACKSIZE);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t thread;
+    mdata->eventLoop = YES;
+    int err = pthread_create(&thread, &attr, eventLoop, mod);
+    if(err) {
+      myLog(LOG_ERR, "mod_kvm: pthread_create() failed: %s\n", strerror(err));
+      mdata->eventLoop = NO;
+    }
+    pthread_attr_destroy(&attr);
+  }
+
+  static void registerEvents(EVMod *mod) {
+    HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
+    if(!mdata->eventLoop)
+      return;
+    virConnectPtr conn = mdata->virConn;
+    if(virConnectSetKeepAlive(conn, HSP_KVM_KEEPALIVE_INTERVAL, HSP_KVM_KEEPALIVE_COUNT) < 0)
+      myDebug(1, "kvm: virConnectSetKeepAlive() failed");
+    if(virConnectRegisterCloseCallback(conn, closeCB, mod, NULL) < 0)
+      myDebug(1, "kvm: virConnectRegisterCloseCallback() failed");
+    mdata->cbLifecycle = virConnectDomainEventRegisterAny(conn, NULL, VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+							  VIR_DOMAIN_EVENT_CALLBACK(lifecycleCB), mod, NULL);
+    mdata->cbDeviceAdded = virConnectDomainEventRegisterAny(conn, NULL, VIR_DOMAIN_EVENT_ID_DEVICE_ADDED,
+							    VIR_DOMAIN_EVENT_CALLBACK(deviceAddedCB), mod, NULL);
+    mdata->cbDeviceRemoved = virConnectDomainEventRegisterAny(conn, NULL, VIR_DOMAIN_EVENT_ID_DEVICE_REMOVED,
+							      VIR_DOMAIN_EVENT_CALLBACK(deviceRemovedCB), mod, NULL);
+    if(mdata->cbLifecycle < 0
+       || mdata->cbDeviceAdded < 0
+       || mdata->cbDeviceRemoved < 0) {
+      // need all three to trust the cached XML
+      myLog(LOG_ERR, "kvm: domain event registration failed: will re-read domain XML on every refresh");
+      if(mdata->cbLifecycle >= 0)
+	virConnectDomainEventDeregisterAny(conn, mdata->cbLifecycle);
+      mdata->cbLifecycle = -1;
+    }
+  }
+
+  static void deregisterEvents(EVMod *mod) {
+    HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
+    virConnectPtr conn = mdata->virConn;
+    int *cbs[] = { &mdata->cbLifecycle, &mdata->cbDeviceAdded, &mdata->cbDeviceRemoved };
+    for(int ii = 0; ii < 3; ii++) {
+      if(*cbs[ii] >= 0)
+	virConnectDomainEventDeregisterAny(conn, *cbs[ii]);
+      *cbs[ii] = -1;
+    }
+    if(mdata->eventLoop)
+      virConnectUnregisterCloseCallback(conn, closeCB);
   }
 
   /*_________________---------------------------__________________
     _________________     getConnection         __________________
     -----------------___________________________------------------
+    kvm { uri=... } picks the hypervisor,  e.g. test:///default for
+    libvirt's test driver.  The default is libvirt's own choice.
   */
 
   static virConnectPtr getConnection(EVMod *mod) {
     HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
     if(mdata->virConn == NULL) {
-      mdata->virConn = virConnectOpenReadOnly(NULL);
+      mdata->virConn = virConnectOpenReadOnly(sp->kvm.uri);
       if(mdata->virConn == NULL) {
-	myLog(LOG_ERR, "virConnectOpenReadOnly() failed\n");
+	myLog(LOG_ERR, "virConnectOpenReadOnly(%s) failed\n", sp->kvm.uri ?: "");
       }
+      else
+	registerEvents(mod);
     }
     return mdata->virConn;
   }
 
+  static void closeConnection(EVMod *mod) {
+    HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
+    if(mdata->virConn == NULL)
+      return;
+    // the domain references hold the connection open,  so drop them
+    // too.  The VMs keep their pollers until the next refresh.
+    HSPVMState_KVM *state;
+    UTHASH_WALK(mdata->vmsByUUID, state) {
+      if(state->domain) {
+	virDomainFree(state->domain);
+	state->domain = NULL;
+      }
+      state->xmlStale = YES;
+    }
+    deregisterEvents(mod);
+    virConnectClose(mdata->virConn);
+    mdata->virConn = NULL;
+  }
+
   /*_________________---------------------------__________________
     _________________    configVMs              __________________
     -----------------___________________________------------------
@@ -455,6 +606,11 @@ extern "C" {
   static void configVMs(EVMod *mod) {
     HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
 
+    // no close callback without the event loop,  so check here too
+    if(mdata->virConn
+       && virConnectIsAlive(mdata->virConn) != 1)
+      closeConnection(mod);
+
     if(getConnection(mod) == NULL)
       return;
 
@@ -476,25 +632,90 @@ extern "C" {
     }
   }
 
+  static void readEvents(EVMod *mod) {
+    HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
+    HSPKVMEvent *kev;
+    while((kev = (HSPKVMEvent *)UTArrayPop(mdata->events)) != NULL) {
+      if(kev->eventId == HSP_KVM_EVENT_CLOSED) {
+	closeConnection(mod);
+      }
+      else {
+	// re-read the XML for this domain.  A lifecycle event (start,
+	// stop, define...) may also mean the domain list has changed.
+	HSPVMState_KVM *state = findVM_KVM(mod, (char *)kev->uuid);
+	if(state)
+	  state->xmlStale = YES;
+      }
+      mdata->refreshNow = YES;
+      my_free(kev);
+    }
+  }
+
   static void evt_tick(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
     HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
     HSP *sp = (HSP *)EVROOTDATA(mod);
     time_t clk = evt->bus->now.tv_sec;
-    if(clk >= mdata->next_refreshVMList
+    readEvents(mod);
+    if((mdata->refreshNow
+	|| clk >= mdata->next_refreshVMList)
        && sp->sFlowSettings) {
       configVMs(mod);
+      mdata->refreshNow = NO;
       mdata->next_refreshVMList = clk + mdata->refreshVMListSecs;
     }
   }
 
+  /*_________________---------------------------__________________
+    _________________    evt_tock               __________________
+    -----------------___________________________------------------
+    The VMs that are due for a counter sample all get their stats
+    from one virDomainListGetStats() call,  rather than a lookup,
+    a virDomainGetInfo() and two calls per disk for each.
+  */
+
   static void evt_tock(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
     HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
-    // now we can execute pollActions without holding on to the semaphore
-    for(uint32_t ii = 0; ii < UTArrayN(mdata->pollActions); ii++) {
-      SFLPoller *poller = (SFLPoller *)UTArrayAt(mdata->pollActions, ii);
-      SFL_COUNTERS_SAMPLE_TYPE cs;
-      memset(&cs, 0, sizeof(cs));
-      agentCB_getCounters_KVM((void *)mod, poller, &cs);
+    uint32_t nDue = UTArrayN(mdata->pollActions);
+    if(nDue == 0)
+      return;
+    if(mdata->virConn) {
+      // now we can execute pollActions without holding on to the semaphore
+      virDomainPtr *doms = (virDomainPtr *)my_calloc((nDue + 1) * sizeof(virDomainPtr));
+      int nDoms = 0;
+      for(uint32_t ii = 0; ii < nDue; ii++) {
+	SFLPoller *poller = (SFLPoller *)UTArrayAt(mdata->pollActions, ii);
+	if(poller == NULL)
+	  continue; // VM removed since (see removeAndFreeVM_KVM)
+	HSPVMState_KVM *state = (HSPVMState_KVM *)poller->userData;
+	if(state
+	   && state->domain)
+	  doms[nDoms++] = state->domain;
+      }
+      virDomainStatsRecordPtr *records = NULL;
+      int nRecs = 0;
+      if(nDoms) {
+	nRecs = virDomainListGetStats(doms, HSP_KVM_STATS, &records, 0);
+	if(nRecs < 0) {
+	  // not a sign that a domain went away,  so no refresh for this
+	  myLog(LOG_ERR, "virDomainListGetStats() failed");
+	  nRecs = nDoms = 0;
+	}
+      }
+      for(int ii = 0; ii < nRecs; ii++) {
+	char uuid[16];
+	if(virDomainGetUUID(records[ii]->dom, (u_char *)uuid) == 0) {
+	  HSPVMState_KVM *state = findVM_KVM(mod, uuid);
+	  if(state
+	     && state->domain)
+	    getCounters_KVM(mod, state, records[ii]);
+	}
+      }
+      // a domain that went away without an event?
+      if(nRecs < nDoms)
+	mdata->refreshNow = YES;
+      if(records)
+	virDomainStatsRecordListFree(records);
+      my_free(doms);
     }
     UTArrayReset(mdata->pollActions);
   }
@@ -518,11 +739,7 @@ extern "C" {
   }
 
   static void evt_final(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
-    HSP_mod_KVM *mdata = (HSP_mod_KVM *)mod->data;
-    if(mdata->virConn) {
-      virConnectClose(mdata->virConn);
-      mdata->virConn = NULL;
-    }
+    closeConnection(mod);
   }
 
   /*_________________---------------------------__________________
@@ -537,7 +754,7 @@ extern "C" {
 
     requestVNodeRole(mod, HSP_VNODE_PRIORITY_KVM);
     retainRootRequest(mod, "needed by virConnectOpenReadOnly() to create user runtime directory");
-      
+
     // open the libvirt connection - failure is not an option
     int virErr = virInitialize();
     if(virErr != 0) {
@@ -547,10 +764,18 @@ extern "C" {
 
     mdata->vmsByUUID = UTHASH_NEW(HSPVMState_KVM, vm.uuid, UTHASH_DFLT);
     mdata->pollActions = UTArrayNew(UTARRAY_DFLT);
+    // use UTARRAY_SYNC here because the libvirt event thread adds to it
+    mdata->events = UTArrayNew(UTARRAY_SYNC);
+    mdata->cbLifecycle = -1;
+    mdata->cbDeviceAdded = -1;
+    mdata->cbDeviceRemoved = -1;
 
     mdata->refreshVMListSecs = sp->kvm.refreshVMListSecs ?: sp->refreshVMListSecs;
     mdata->forgetVMSecs = sp->kvm.forgetVMSecs ?: sp->forgetVMSecs;
 
+    // domain events need the libvirt event loop on its own thread
+    startEventLoop(mod);
+
     // register call-backs
     EVBus *pollBus = EVGetBus(mod, HSPBUS_POLL, YES);
     EVEventRx(mod, EVGetEvent(pollBus, EVEVENT_TICK), evt_tick);
@@ -20,6 +20,7 @@ extern "C" {
 
 #include <pcap.h>
 #define HSP_READPACKET_BATCH_PCAP 10000
+#define HSP_PCAP_REPLAY_REPORT_SECS 10
 
   typedef struct _BPFSoc {
     EVMod *module;
@@ -38,11 +39,32 @@ extern "C" {
     int n_dlts;
     int *dlts;
     int dlt;
+    // offline replay from pcap { file=... }
+    char *file;
+    uint32_t rate; // packets/sec, 0 == as fast as possible
+    bool loop;
+    uint64_t openPkts;
+    double credit;
+    struct timespec lastDeci;
   } BPFSoc;
 
+  typedef struct _HSPReplayStats {
+    uint64_t pkts;
+    uint64_t flow_samples;
+    uint64_t datagrams;
+    uint64_t cpu_nS;
+    struct timespec wall;
+  } HSPReplayStats;
+
   typedef struct _HSP_mod_PCAP {
     UTArray *bpf_socs;
     EVBus *packetBus;
+    // replay benchmark accounting
+    uint64_t replayPkts;
+    uint32_t replaysActive;
+    HSPReplayStats replayStart;
+    HSPReplayStats replayMark;
+    time_t replayNextReport;
   } HSP_mod_PCAP;
 
   static void tap_close(EVMod *mod, BPFSoc *bpfs);
@@ -60,6 +82,11 @@ extern "C" {
     BPFSoc *bpfs = (BPFSoc *)user;
     uint32_t sr = bpfs->subSamplingRate;
 
+    if(bpfs->file) {
+      HSP_mod_PCAP *mdata = (HSP_mod_PCAP *)bpfs->module->data;
+      mdata->replayPkts++;
+    }
+
     if(sr == 0) {
       // sampling disabled by setting to 0
       return;
@@ -139,9 +166,16 @@ extern "C" {
     }
   }
 
+  static void replay_dispatch(EVMod *mod, BPFSoc *bpfs, int max);
+
   static void readPackets_pcap(EVMod *mod, EVSocket *sock, void *magic)
   {
     BPFSoc *bpfs = (BPFSoc *)magic;
+    if(bpfs->file) {
+      // a savefile is always "readable", so we just go flat out
+      replay_dispatch(mod, bpfs, HSP_READPACKET_BATCH_PCAP);
+      return;
+    }
     int batch = pcap_dispatch(bpfs->pcap,
 			      HSP_READPACKET_BATCH_PCAP,
 			      readPackets_pcap_cb,
@@ -240,6 +274,135 @@ extern "C" {
     return YES;
   }
 
+  /*_________________---------------------------__________________
+    _________________    replay                 __________________
+    -----------------___________________________------------------
+    pcap { dev=eth0 file=capture.pcap rate=100000 loop=on }
+
+    Push the packets from a capture file through takeSample() and
+    the rest of the sample pipeline as if they had been captured on
+    dev, either as fast as possible (rate=0) or at a fixed packet
+    rate.  Throughput and CPU per sample are logged periodically, so
+    this can be used as a benchmark without any live traffic.
+  */
+
+  static void replay_snapshot(EVMod *mod, HSPReplayStats *snap) {
+    HSP_mod_PCAP *mdata = (HSP_mod_PCAP *)mod->data;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    struct timespec cpu;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+    clock_gettime(CLOCK_MONOTONIC, &snap->wall);
+    snap->cpu_nS = (cpu.tv_sec * 1000000000LL) + cpu.tv_nsec;
+    snap->pkts = mdata->replayPkts;
+    snap->flow_samples = sp->telemetry[HSP_TELEMETRY_FLOW_SAMPLES];
+    snap->datagrams = sp->telemetry[HSP_TELEMETRY_DATAGRAMS];
+  }
+
+  // log rates since *since, and reset it to now
+  static void replay_report(EVMod *mod, HSPReplayStats *since, char *label) {
+    HSPReplayStats now;
+    replay_snapshot(mod, &now);
+    double secs = ((now.wall.tv_sec - since->wall.tv_sec) * 1.0)
+      + ((now.wall.tv_nsec - since->wall.tv_nsec) / 1.0e9);
+    uint64_t samples = now.flow_samples - since->flow_samples;
+    if(secs > 0) {
+      myLog(LOG_INFO, "PCAP replay %s: secs=%.3f pkts/s=%.0f samples/s=%.0f datagrams/s=%.0f cpu_uS/sample=%.3f",
+	    label,
+	    secs,
+	    (now.pkts - since->pkts) / secs,
+	    samples / secs,
+	    (now.datagrams - since->datagrams) / secs,
+	    samples ? ((now.cpu_nS - since->cpu_nS) / 1000.0 / samples) : 0.0);
+    }
+    *since = now;
+  }
+
+  static void replay_close(EVMod *mod, BPFSoc *bpfs) {
+    if(bpfs->sock) {
+      EVSocketClose(mod, bpfs->sock, NO); // pcap_close() closes the file
+      bpfs->sock = NULL;
+    }
+    if(bpfs->pcap) {
+      pcap_close(bpfs->pcap);
+      bpfs->pcap = NULL;
+    }
+  }
+
+  static bool replay_open(EVMod *mod, BPFSoc *bpfs) {
+    HSP_mod_PCAP *mdata = (HSP_mod_PCAP *)mod->data;
+    if((bpfs->pcap = pcap_open_offline(bpfs->file, bpfs->pcap_err)) == NULL) {
+      myLog(LOG_ERR, "PCAP: replay file %s open failed: %s", bpfs->file, bpfs->pcap_err);
+      return NO;
+    }
+    bpfs->openPkts = mdata->replayPkts;
+    bpfs->dlt = pcap_datalink(bpfs->pcap);
+    if(bpfs->dlt != DLT_EN10MB
+       && bpfs->dlt != DLT_RAW) {
+      myLog(LOG_ERR, "PCAP: replay file %s has unsupported encapsulation %u (%s)",
+	    bpfs->file,
+	    bpfs->dlt,
+	    pcap_datalink_val_to_name(bpfs->dlt));
+      replay_close(mod, bpfs);
+      return NO;
+    }
+    // with no rate limit we register the fd and let the bus call us
+    // on every pass.  Otherwise we are paced by evt_deci().
+    if(bpfs->rate == 0)
+      bpfs->sock = EVBusAddSocket(mod, mdata->packetBus, pcap_fileno(bpfs->pcap), readPackets_pcap, bpfs);
+    return YES;
+  }
+
+  static void replay_finished(EVMod *mod, BPFSoc *bpfs) {
+    HSP_mod_PCAP *mdata = (HSP_mod_PCAP *)mod->data;
+    myLog(LOG_INFO, "PCAP: replay %s finished", bpfs->file);
+    if(--mdata->replaysActive == 0)
+      replay_report(mod, &mdata->replayStart, "total");
+  }
+
+  static void replay_dispatch(EVMod *mod, BPFSoc *bpfs, int max) {
+    HSP_mod_PCAP *mdata = (HSP_mod_PCAP *)mod->data;
+    int batch = pcap_dispatch(bpfs->pcap,
+			      max,
+			      readPackets_pcap_cb,
+			      (u_char *)bpfs);
+    if(batch > 0) {
+      bpfs->credit -= batch;
+      return;
+    }
+    if(batch == -1)
+      myLog(LOG_ERR, "PCAP: replay %s error: %s", bpfs->file, pcap_geterr(bpfs->pcap));
+    // end of file (or error)
+    replay_close(mod, bpfs);
+    // (only loop if that pass yielded something)
+    if(batch == 0
+       && bpfs->loop
+       && mdata->replayPkts > bpfs->openPkts
+       && replay_open(mod, bpfs))
+      return;
+    replay_finished(mod, bpfs);
+  }
+
+  static void evt_deci(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
+    HSP_mod_PCAP *mdata = (HSP_mod_PCAP *)mod->data;
+    BPFSoc *bpfs;
+    UTARRAY_WALK(mdata->bpf_socs, bpfs) {
+      if(bpfs->file == NULL
+	 || bpfs->rate == 0
+	 || bpfs->pcap == NULL)
+	continue;
+      if(bpfs->lastDeci.tv_sec) {
+	int mS = EVTimeDiff_mS(&bpfs->lastDeci, &evt->bus->now);
+	bpfs->credit += (bpfs->rate * (double)mS) / 1000.0;
+	// don't try to catch up more than a second's worth after a stall
+	if(bpfs->credit > bpfs->rate)
+	  bpfs->credit = bpfs->rate;
+      }
+      bpfs->lastDeci = evt->bus->now;
+      if(bpfs->credit >= 1.0)
+	replay_dispatch(mod, bpfs, (int)bpfs->credit);
+    }
+  }
+
   /*_________________---------------------------__________________
     _________________    evt_tick               __________________
     -----------------___________________________------------------
@@ -253,10 +416,16 @@ extern "C" {
     UTARRAY_WALK(mdata->bpf_socs, bpfs) {
       struct pcap_stat stats;
       if(bpfs->pcap
+	 && bpfs->file == NULL
 	 && pcap_stats(bpfs->pcap, &stats) == 0) {
 	bpfs->drops = stats.ps_drop;
       }
     }
+    if(mdata->replaysActive
+       && evt->bus->now.tv_sec >= mdata->replayNextReport) {
+      mdata->replayNextReport = evt->bus->now.tv_sec + HSP_PCAP_REPLAY_REPORT_SECS;
+      replay_report(mod, &mdata->replayMark, "interval");
+    }
   }
 
   /*_________________---------------------------__________________
@@ -272,6 +441,19 @@ extern "C" {
       bpfs->samplingRate = lookupPacketSamplingRate(bpfs->adaptor, sp->sFlowSettings);
     bpfs->subSamplingRate = bpfs->samplingRate;
 
+    if(bpfs->file) {
+      // offline replay - always sampled in user-space
+      if(replay_open(mod, bpfs)) {
+	if(mdata->replaysActive++ == 0) {
+	  replay_snapshot(mod, &mdata->replayStart);
+	  mdata->replayMark = mdata->replayStart;
+	  mdata->replayNextReport = mdata->packetBus->now.tv_sec + HSP_PCAP_REPLAY_REPORT_SECS;
+	}
+	forceCounterPolling(sp, bpfs->adaptor);
+      }
+      return;
+    }
+
     // create pcap
     if((bpfs->pcap = pcap_create(bpfs->deviceName, bpfs->pcap_err)) == NULL) {
       myLog(LOG_ERR, "PCAP: device %s open failed: %s", bpfs->deviceName, bpfs->pcap_err);
@@ -373,6 +555,14 @@ extern "C" {
   
   static void tap_close(EVMod *mod, BPFSoc *bpfs) {
     bpfs->adaptor = NULL;
+    if(bpfs->file) {
+      // still running?
+      if(bpfs->pcap) {
+	replay_close(mod, bpfs);
+	replay_finished(mod, bpfs);
+      }
+      return;
+    }
     bpfs->sock->fd = -1;
     if(bpfs->pcap) {
       pcap_close(bpfs->pcap);
@@ -401,6 +591,9 @@ extern "C" {
     bpfs->vport_set = pcap->vport_set;
     bpfs->samplingRate = pcap->sampling_n;
     bpfs->samplingRateSet = pcap->sampling_n_set;
+    bpfs->file = pcap->file;
+    bpfs->rate = pcap->rate;
+    bpfs->loop = pcap->loop;
     tap_open(mod, bpfs);
   }
 
@@ -486,6 +679,7 @@ extern "C" {
   */
 
   void mod_pcap(EVMod *mod) {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
     mod->data = my_calloc(sizeof(HSP_mod_PCAP));
     HSP_mod_PCAP *mdata = (HSP_mod_PCAP *)mod->data;
     mdata->bpf_socs = UTArrayNew(UTARRAY_DFLT);
@@ -494,6 +688,13 @@ extern "C" {
     EVEventRx(mod, EVGetEvent(mdata->packetBus, HSPEVENT_CONFIG_FIRST), evt_config_first);
     EVEventRx(mod, EVGetEvent(mdata->packetBus, HSPEVENT_INTFS_CHANGED), evt_intfs_changed);
     EVEventRx(mod, EVGetEvent(mdata->packetBus, EVEVENT_TICK), evt_tick);
+    // rate-limited replay is paced by deci-ticks
+    for(HSPPcap *pcap = sp->pcap.pcaps; pcap; pcap = pcap->nxt) {
+      if(pcap->file && pcap->rate) {
+	EVEventRx(mod, EVGetEvent(mdata->packetBus, EVEVENT_DECI), evt_deci);
+	break;
+      }
+    }
   }
 
 #if defined(__cplusplus)
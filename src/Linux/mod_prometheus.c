@@ -0,0 +1,463 @@
+/* This software is distributed under the following license:
+ * http://sflow.net/license.html
+ */
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+  /*
+    Serve the telemetry counters in OpenMetrics text format,
+    for a local Prometheus agent to scrape.  Configure with:
+
+    prometheus { TCPPort=9117 path=/run/hsflowd.prom }
+
+    TCPPort binds to 127.0.0.1 only (set it to 0 to turn it off)
+    and path is a unix stream socket.  Both speak just enough
+    HTTP/1.0 for "GET /metrics", e.g.
+
+    curl http://127.0.0.1:9117/metrics
+    curl --unix-socket /run/hsflowd.prom http://localhost/metrics
+
+    As well as sp->telemetry[] we export the per-bus CPU and,
+    when "instrument=on", the per-event and per-socket dispatch
+    stats from evbus.c and the counter-polling timers (sp->timing).  The response is rendered straight into
+    a fixed buffer that is flushed to the socket whenever it
+    fills, so a scrape does not allocate (beyond growing the
+    stats snapshot).  The bus and event stats are copied out
+    under root->sync first,  so that a slow scraper never blocks
+    event dispatch while we write.
+  */
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#define HSP_TELEMETRY_NAMES 1
+#define HSP_TIMING_NAMES 1
+#include "hsflowd.h"
+
+#define HSP_PROMETHEUS_OBUF 16384
+#define HSP_PROMETHEUS_IBUF 1024
+#define HSP_PROMETHEUS_MAX_CLIENTS 8
+#define HSP_PROMETHEUS_CLIENT_TIMEOUT 5
+#define HSP_PROMETHEUS_SEND_TIMEOUT_MS 1000
+#define HSP_PROMETHEUS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+  // one bus,  event action or socket,  copied out under root->sync
+  typedef struct _HSPPromStat {
+    char labels[128];
+    bool socket;
+    uint64_t calls;
+    uint64_t wall_nS;
+    uint64_t cpu_nS;
+  } HSPPromStat;
+
+  typedef struct _HSPPromClient {
+    EVSocket *sock;
+    time_t accepted;
+  } HSPPromClient;
+
+  typedef struct _HSP_mod_PROMETHEUS {
+    EVBus *pollBus;
+    int tcp_soc;
+    int unix_soc;
+    HSPPromClient clients[HSP_PROMETHEUS_MAX_CLIENTS];
+    // request and response buffers
+    char ibuf[HSP_PROMETHEUS_IBUF];
+    char obuf[HSP_PROMETHEUS_OBUF];
+    int olen;
+    int ofd;
+    bool oerr;
+    uint32_t scrapes;
+    // stats snapshot,  reused from one scrape to the next
+    HSPPromStat *snap;
+    uint32_t snapN;
+    uint32_t snapMax;
+  } HSP_mod_PROMETHEUS;
+
+  /*_________________---------------------------__________________
+    _________________    output buffer          __________________
+    -----------------___________________________------------------
+  */
+
+  static void promFlush(HSP_mod_PROMETHEUS *mdata) {
+    int off = 0;
+    while(!mdata->oerr
+	  && off < mdata->olen) {
+      int n = write(mdata->ofd, mdata->obuf + off, mdata->olen - off);
+      if(n < 0) {
+	if(errno == EINTR)
+	  continue;
+	myDebug(1, "prometheus: write failed: %s", strerror(errno));
+	mdata->oerr = YES;
+      }
+      else
+	off += n;
+    }
+    mdata->olen = 0;
+  }
+
+  static void promPrintf(HSP_mod_PROMETHEUS *mdata, char *fmt, ...) {
+    if(mdata->oerr)
+      return;
+    for(int tries = 0; tries < 2; tries++) {
+      int room = HSP_PROMETHEUS_OBUF - mdata->olen;
+      va_list args;
+      va_start(args, fmt);
+      int n = vsnprintf(mdata->obuf + mdata->olen, room, fmt, args);
+      va_end(args);
+      if(n < room) {
+	mdata->olen += n;
+	return;
+      }
+      // did not fit - send what we have and try again
+      promFlush(mdata);
+    }
+    myDebug(1, "prometheus: line too long, dropped");
+  }
+
+  /*_________________---------------------------__________________
+    _________________    render telemetry       __________________
+    -----------------___________________________------------------
+  */
+
+  static bool telemetryIsGauge(int ii) {
+    return (ii == HSP_TELEMETRY_GOVERNOR_CPU_PPM
+	    || ii == HSP_TELEMETRY_GOVERNOR_LEVEL);
+  }
+
+  static bool telemetryIsHistogram(int ii) {
+    // see telemetryLatency(): 8 decade bins then a total in uS
+    return ((ii >= HSP_TELEMETRY_SAMPLE_LATENCY_10US
+	     && ii <= HSP_TELEMETRY_SAMPLE_LATENCY_USECS)
+	    || (ii >= HSP_TELEMETRY_DATAGRAM_FILL_10US
+		&& ii <= HSP_TELEMETRY_DATAGRAM_FILL_USECS));
+  }
+
+  static void renderHistogram(HSP_mod_PROMETHEUS *mdata, HSP *sp, char *name, EnumHSPTelemetry bin0) {
+    static const char *le[] = { "1e-05", "0.0001", "0.001", "0.01", "0.1", "1.0", "10.0", "+Inf" };
+    promPrintf(mdata, "# TYPE hsflowd_%s_seconds histogram\n", name);
+    uint64_t cum = 0;
+    for(int bin = 0; bin < 8; bin++) {
+      cum += sp->telemetry[bin0 + bin];
+      promPrintf(mdata, "hsflowd_%s_seconds_bucket{le=\"%s\"} %"PRIu64"\n", name, le[bin], cum);
+    }
+    uint64_t uS = sp->telemetry[bin0 + 8];
+    promPrintf(mdata, "hsflowd_%s_seconds_sum %"PRIu64".%06"PRIu64"\n", name, uS / 1000000, uS % 1000000);
+    promPrintf(mdata, "hsflowd_%s_seconds_count %"PRIu64"\n", name, cum);
+  }
+
+  static void renderTelemetry(HSP_mod_PROMETHEUS *mdata, HSP *sp) {
+    for(int ii = 0; ii < HSP_TELEMETRY_NUM_COUNTERS; ii++) {
+      if(telemetryIsHistogram(ii))
+	continue;
+      const char *name = HSPTelemetryNames[ii];
+      if(telemetryIsGauge(ii)) {
+	promPrintf(mdata, "# TYPE hsflowd_%s gauge\n", name);
+	promPrintf(mdata, "hsflowd_%s %"PRIu64"\n", name, sp->telemetry[ii]);
+      }
+      else {
+	promPrintf(mdata, "# TYPE hsflowd_%s counter\n", name);
+	promPrintf(mdata, "hsflowd_%s_total %"PRIu64"\n", name, sp->telemetry[ii]);
+      }
+    }
+    renderHistogram(mdata, sp, "sample_latency", HSP_TELEMETRY_SAMPLE_LATENCY_10US);
+    renderHistogram(mdata, sp, "datagram_fill", HSP_TELEMETRY_DATAGRAM_FILL_10US);
+  }
+
+  /*_________________---------------------------__________________
+    _________________    render bus stats       __________________
+    -----------------___________________________------------------
+  */
+
+  static HSPPromStat *snapAdd(HSP_mod_PROMETHEUS *mdata) {
+    if(mdata->snapN == mdata->snapMax) {
+      mdata->snapMax = mdata->snapMax ? (mdata->snapMax * 2) : 64;
+      mdata->snap = (HSPPromStat *)my_realloc(mdata->snap, mdata->snapMax * sizeof(HSPPromStat));
+    }
+    HSPPromStat *ps = &mdata->snap[mdata->snapN++];
+    memset(ps, 0, sizeof(*ps));
+    return ps;
+  }
+
+  static void renderBusCPU(EVMod *mod, HSP_mod_PROMETHEUS *mdata) {
+    mdata->snapN = 0;
+    SEMLOCK_DO(mod->root->sync) {
+      EVBus *bus;
+      UTHASH_WALK(mod->root->buses, bus) {
+	HSPPromStat *ps = snapAdd(mdata);
+	snprintf(ps->labels, 128, "bus=\"%s\"", bus->name);
+	ps->cpu_nS = EVBusCPU_nS(bus);
+      }
+    }
+    // lock released - now we can write
+    promPrintf(mdata, "# TYPE hsflowd_bus_cpu_seconds counter\n");
+    for(uint32_t ii = 0; ii < mdata->snapN; ii++) {
+      HSPPromStat *ps = &mdata->snap[ii];
+      promPrintf(mdata, "hsflowd_bus_cpu_seconds_total{%s} %"PRIu64".%09"PRIu64"\n",
+		 ps->labels,
+		 ps->cpu_nS / 1000000000,
+		 ps->cpu_nS % 1000000000);
+    }
+  }
+
+  // called with root->sync held,  so just copy
+  static void statsCB(EVBus *bus, EVEvent *evt, EVMod *mod, EVSocket *sock, EVStats *stats, void *magic) {
+    HSP_mod_PROMETHEUS *mdata = (HSP_mod_PROMETHEUS *)magic;
+    HSPPromStat *ps = snapAdd(mdata);
+    ps->socket = (sock != NULL);
+    if(sock)
+      snprintf(ps->labels, 128, "bus=\"%s\",module=\"%s\",fd=\"%d\"", bus->name, mod->name, sock->fd);
+    else
+      snprintf(ps->labels, 128, "bus=\"%s\",event=\"%s\",module=\"%s\"", bus->name, evt->name, mod->name);
+    ps->calls = stats->calls;
+    ps->wall_nS = stats->wall_nS;
+    ps->cpu_nS = stats->cpu_nS;
+  }
+
+  static void renderEventStats(EVMod *mod, HSP_mod_PROMETHEUS *mdata) {
+    mdata->snapN = 0;
+    EVStatsWalk(mod, statsCB, mdata);
+    // one pass per metric family so that each family is contiguous
+    for(int sockets = 0; sockets < 2; sockets++) {
+      char *family = sockets ? "socket" : "event";
+      promPrintf(mdata, "# TYPE hsflowd_%s_calls counter\n", family);
+      for(uint32_t ii = 0; ii < mdata->snapN; ii++) {
+	HSPPromStat *ps = &mdata->snap[ii];
+	if(ps->socket == sockets)
+	  promPrintf(mdata, "hsflowd_%s_calls_total{%s} %"PRIu64"\n", family, ps->labels, ps->calls);
+      }
+      promPrintf(mdata, "# TYPE hsflowd_%s_wall_seconds counter\n", family);
+      for(uint32_t ii = 0; ii < mdata->snapN; ii++) {
+	HSPPromStat *ps = &mdata->snap[ii];
+	if(ps->socket == sockets)
+	  promPrintf(mdata, "hsflowd_%s_wall_seconds_total{%s} %"PRIu64".%09"PRIu64"\n",
+		     family, ps->labels, ps->wall_nS / 1000000000, ps->wall_nS % 1000000000);
+      }
+      promPrintf(mdata, "# TYPE hsflowd_%s_cpu_seconds counter\n", family);
+      for(uint32_t ii = 0; ii < mdata->snapN; ii++) {
+	HSPPromStat *ps = &mdata->snap[ii];
+	if(ps->socket == sockets)
+	  promPrintf(mdata, "hsflowd_%s_cpu_seconds_total{%s} %"PRIu64".%09"PRIu64"\n",
+		     family, ps->labels, ps->cpu_nS / 1000000000, ps->cpu_nS % 1000000000);
+      }
+    }
+  }
+
+  static void renderTiming(HSP_mod_PROMETHEUS *mdata, HSP *sp) {
+    promPrintf(mdata, "# TYPE hsflowd_timing_calls counter\n");
+    for(int ii = 0; ii < HSP_TIMING_NUM; ii++)
+      promPrintf(mdata, "hsflowd_timing_calls_total{path=\"%s\"} %"PRIu64"\n",
+		 HSPTimingNames[ii], sp->timing[ii].calls);
+    promPrintf(mdata, "# TYPE hsflowd_timing_wall_seconds counter\n");
+    for(int ii = 0; ii < HSP_TIMING_NUM; ii++)
+      promPrintf(mdata, "hsflowd_timing_wall_seconds_total{path=\"%s\"} %"PRIu64".%09"PRIu64"\n",
+		 HSPTimingNames[ii], sp->timing[ii].wall_nS / 1000000000, sp->timing[ii].wall_nS % 1000000000);
+    promPrintf(mdata, "# TYPE hsflowd_timing_cpu_seconds counter\n");
+    for(int ii = 0; ii < HSP_TIMING_NUM; ii++)
+      promPrintf(mdata, "hsflowd_timing_cpu_seconds_total{path=\"%s\"} %"PRIu64".%09"PRIu64"\n",
+		 HSPTimingNames[ii], sp->timing[ii].cpu_nS / 1000000000, sp->timing[ii].cpu_nS % 1000000000);
+  }
+
+  /*_________________---------------------------__________________
+    _________________    client connections     __________________
+    -----------------___________________________------------------
+  */
+
+  static void closeClient(EVMod *mod, HSPPromClient *client) {
+    EVSocketClose(mod, client->sock, YES);
+    client->sock = NULL;
+  }
+
+  static void sendResponse(EVMod *mod, int fd, char *path) {
+    HSP_mod_PROMETHEUS *mdata = (HSP_mod_PROMETHEUS *)mod->data;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    mdata->ofd = fd;
+    mdata->olen = 0;
+    mdata->oerr = NO;
+    if(path == NULL) {
+      promPrintf(mdata, "HTTP/1.0 400 Bad Request\r\nConnection: close\r\n\r\n");
+    }
+    else if(!my_strequal(path, "/metrics")
+	    && !my_strequal(path, "/")) {
+      promPrintf(mdata, "HTTP/1.0 404 Not Found\r\nConnection: close\r\n\r\n");
+    }
+    else {
+      mdata->scrapes++;
+      myDebug(2, "prometheus: scrape %u", mdata->scrapes);
+      promPrintf(mdata, "HTTP/1.0 200 OK\r\nContent-Type: %s\r\nConnection: close\r\n\r\n",
+		 HSP_PROMETHEUS_CONTENT_TYPE);
+      renderTelemetry(mdata, sp);
+      renderBusCPU(mod, mdata);
+      if(mod->root->instrument) {
+	renderEventStats(mod, mdata);
+	renderTiming(mdata, sp);
+      }
+      promPrintf(mdata, "# EOF\n");
+    }
+    promFlush(mdata);
+  }
+
+  static void readClient(EVMod *mod, EVSocket *sock, void *magic) {
+    HSP_mod_PROMETHEUS *mdata = (HSP_mod_PROMETHEUS *)mod->data;
+    HSPPromClient *client = (HSPPromClient *)magic;
+    int n = read(sock->fd, mdata->ibuf, HSP_PROMETHEUS_IBUF - 1);
+    if(n < 0
+       && (errno == EAGAIN || errno == EINTR))
+      return;
+    if(n > 0) {
+      // only need the request line: "GET <path> HTTP/1.x"
+      mdata->ibuf[n] = '\0';
+      char *path = NULL;
+      if(strncmp(mdata->ibuf, "GET ", 4) == 0) {
+	path = mdata->ibuf + 4;
+	path[strcspn(path, " \r\n?")] = '\0';
+      }
+      sendResponse(mod, sock->fd, path);
+    }
+    closeClient(mod, client);
+  }
+
+  static void acceptClient(EVMod *mod, EVSocket *sock, void *magic) {
+    HSP_mod_PROMETHEUS *mdata = (HSP_mod_PROMETHEUS *)mod->data;
+    int fd = accept4(sock->fd, NULL, NULL, SOCK_CLOEXEC);
+    if(fd < 0) {
+      if(errno != EAGAIN && errno != EINTR)
+	myLog(LOG_ERR, "prometheus: accept() failed: %s", strerror(errno));
+      return;
+    }
+    HSPPromClient *client = NULL;
+    for(int ii = 0; ii < HSP_PROMETHEUS_MAX_CLIENTS; ii++) {
+      if(mdata->clients[ii].sock == NULL) {
+	client = &mdata->clients[ii];
+	break;
+      }
+    }
+    if(client == NULL) {
+      myDebug(1, "prometheus: too many clients");
+      close(fd);
+      return;
+    }
+    // don't let a stalled client hold up the poll bus for long
+    struct timeval tv = { .tv_sec = HSP_PROMETHEUS_SEND_TIMEOUT_MS / 1000,
+			  .tv_usec = (HSP_PROMETHEUS_SEND_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    client->accepted = mdata->pollBus->now.tv_sec;
+    client->sock = EVBusAddSocket(mod, mdata->pollBus, fd, readClient, client);
+    if(client->sock == NULL)
+      close(fd);
+  }
+
+  /*_________________---------------------------__________________
+    _________________    listen sockets         __________________
+    -----------------___________________________------------------
+  */
+
+  static int listenTCP(uint32_t port) {
+    int fd = socket(PF_INET, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0);
+    if(fd < 0) {
+      myLog(LOG_ERR, "prometheus: socket() failed: %s", strerror(errno));
+      return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = { .sin_family = AF_INET,
+				.sin_port = htons(port),
+				.sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+       || listen(fd, HSP_PROMETHEUS_MAX_CLIENTS) < 0) {
+      myLog(LOG_ERR, "prometheus: bind/listen on 127.0.0.1:%u failed: %s", port, strerror(errno));
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  static int listenUnix(char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if(my_strlen(path) >= sizeof(addr.sun_path)) {
+      myLog(LOG_ERR, "prometheus: socket path too long: %s", path);
+      return -1;
+    }
+    strcpy(addr.sun_path, path);
+    int fd = socket(PF_UNIX, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0);
+    if(fd < 0) {
+      myLog(LOG_ERR, "prometheus: socket() failed: %s", strerror(errno));
+      return -1;
+    }
+    // clear out any stale socket from a previous run
+    unlink(path);
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+       || listen(fd, HSP_PROMETHEUS_MAX_CLIENTS) < 0) {
+      myLog(LOG_ERR, "prometheus: bind/listen on %s failed: %s", path, strerror(errno));
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  /*_________________---------------------------__________________
+    _________________       evt_tick            __________________
+    -----------------___________________________------------------
+  */
+
+  static void evt_tick(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
+    HSP_mod_PROMETHEUS *mdata = (HSP_mod_PROMETHEUS *)mod->data;
+    // drop clients that connected but never sent a request
+    time_t now = mdata->pollBus->now.tv_sec;
+    for(int ii = 0; ii < HSP_PROMETHEUS_MAX_CLIENTS; ii++) {
+      HSPPromClient *client = &mdata->clients[ii];
+      if(client->sock
+	 && (now - client->accepted) > HSP_PROMETHEUS_CLIENT_TIMEOUT) {
+	myDebug(1, "prometheus: client timeout");
+	closeClient(mod, client);
+      }
+    }
+  }
+
+  /*_________________---------------------------__________________
+    _________________        evt_final          __________________
+    -----------------___________________________------------------
+  */
+
+  static void evt_final(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
+    HSP_mod_PROMETHEUS *mdata = (HSP_mod_PROMETHEUS *)mod->data;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    if(mdata->unix_soc >= 0)
+      unlink(sp->prometheus.path);
+  }
+
+  /*_________________---------------------------__________________
+    _________________    module init            __________________
+    -----------------___________________________------------------
+  */
+
+  void mod_prometheus(EVMod *mod) {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    mod->data = my_calloc(sizeof(HSP_mod_PROMETHEUS));
+    HSP_mod_PROMETHEUS *mdata = (HSP_mod_PROMETHEUS *)mod->data;
+    mdata->tcp_soc = -1;
+    mdata->unix_soc = -1;
+    // per-bus CPU is cheap to track, so turn it on
+    EVMeasureCPU(mod, YES);
+
+    mdata->pollBus = EVGetBus(mod, HSPBUS_POLL, YES);
+    EVEventRx(mod, EVGetEvent(mdata->pollBus, EVEVENT_TICK), evt_tick);
+    EVEventRx(mod, EVGetEvent(mdata->pollBus, EVEVENT_FINAL), evt_final);
+
+    if(sp->prometheus.port) {
+      mdata->tcp_soc = listenTCP(sp->prometheus.port);
+      if(mdata->tcp_soc >= 0)
+	EVBusAddSocket(mod, mdata->pollBus, mdata->tcp_soc, acceptClient, NULL);
+    }
+    if(sp->prometheus.path) {
+      mdata->unix_soc = listenUnix(sp->prometheus.path);
+      if(mdata->unix_soc >= 0)
+	EVBusAddSocket(mod, mdata->pollBus, mdata->unix_soc, acceptClient, NULL);
+    }
+  }
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
@@ -23,7 +23,6 @@ extern "C" {
 #include <openssl/sha.h>
 #include <dirent.h>
 #include <uuid/uuid.h>
-#include <fnmatch.h>
 
 #include "hsflowd.h"
 #include "cpu_utils.h"
@@ -107,11 +106,6 @@ extern "C" {
     bool subscribed;
 #endif
     uint32_t page_size;
-    char *cgroup_path;
-    char *cgroup_systemd;
-    char *cgroup_cpuacct;
-    char *cgroup_memory;
-    char *cgroup_blkio;
     uint packetSamples;
   } HSP_mod_SYSTEMD;
 
@@ -144,60 +138,6 @@ extern "C" {
       myLog(LOG_INFO, "%s: %s", prefix, containerStr(container, buf, 1024));
   }
 
-  /*________________---------------------------__________________
-    ________________    readCgroupPaths        __________________
-    ----------------___________________________------------------
-  */
-
-  static void readCgroupPaths(EVMod *mod) {
-    HSP_mod_SYSTEMD *mdata = (HSP_mod_SYSTEMD *)mod->data;
-    char mpath[HSP_MAX_PATHLEN+1];
-    snprintf(mpath, HSP_MAX_PATHLEN, PROCFS_STR "/mounts");
-    FILE *procFile = fopen(mpath, "r");
-    if(procFile) {
-      // limit the number of chars we will read from each line
-      // (there can be more than this - my_readline will chop for us)
-      char line[MAX_PROC_LINELEN];
-      int truncated;
-      while(my_readline(procFile, line, MAX_PROC_LINELEN, &truncated) != EOF) {
-	char buf[MAX_PROC_LINELEN];
-	char *p = line;
-	char *fsType = parseNextTok(&p, " ", NO, '\0', NO, buf, MAX_PROC_LINELEN);
-	if(my_strequal(fsType, "cgroup2")) {
-	  char *fsPath = parseNextTok(&p, " ", NO, '\0', NO, buf, MAX_PROC_LINELEN);
-	  if(fsPath) {
-	    myDebug(1, "found cgroup2 path = %s", fsPath);
-	    mdata->cgroup_path = my_strdup(fsPath);
-	  }
-	}
-	// cgroups v1 systemd, cpuacct, memory, blkio
-	if(my_strequal(fsType, "cgroup")) {
-	  char *fsPath = parseNextTok(&p, " ", NO, '\0', NO, buf, MAX_PROC_LINELEN);
-	  if(fsPath) {
-	    if(fnmatch("*/systemd", fsPath, 0) == 0) {
-	      myDebug(1, "found cgroup v1 systemd controller path = %s", fsPath);
-	      mdata->cgroup_systemd = my_strdup(fsPath);
-	    }
-	    if(fnmatch("*/cpuacct", fsPath, 0) == 0) {
-	      myDebug(1, "found cgroup v1 cpuacct controller path = %s", fsPath);
-	      mdata->cgroup_cpuacct = my_strdup(fsPath);
-	    }
-	    if(fnmatch("*/memory", fsPath, 0) == 0) {
-	      myDebug(1, "found cgroup v1 memory controller path = %s", fsPath);
-	      mdata->cgroup_memory = my_strdup(fsPath);
-	    }
-	    if(fnmatch("*/blkio", fsPath, 0) == 0) {
-	      myDebug(1, "found cgroup v1 blkio controller path = %s", fsPath);
-	      mdata->cgroup_blkio = my_strdup(fsPath);
-	    }
-	  }
-	}
-	
-      }
-      fclose(procFile);
-    }
-  }
-
   /*_________________---------------------------__________________
     _________________   add and remove VM       __________________
     -----------------___________________________------------------
@@ -209,6 +149,16 @@ extern "C" {
     HSP_mod_SYSTEMD *mdata = (HSP_mod_SYSTEMD *)mod->data;
     HSPVMState_SYSTEMD *container = (HSPVMState_SYSTEMD *)poller->userData;
     UTHashAdd(mdata->pollActions, container);
+    // getCounters_SYSTEMD() will run in our tock, so the cgroup
+    // files can be read in the poll tick's batch
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    if(sp->systemd.cgroup2) {
+      HSPDBusUnit search = { .name = container->id };
+      HSPDBusUnit *unit = UTHashGet(mdata->units, &search);
+      if(unit
+	 && unit->cgroup)
+	hspCgroupPrefetch(sp, unit->cgroup);
+    }
   }
 
   static void removeAndFreeVM_SYSTEMD(EVMod *mod, HSPVMState_SYSTEMD *container) {
@@ -244,6 +194,7 @@ extern "C" {
 
   static HSPVMState_SYSTEMD *getContainer(EVMod *mod, HSPDBusUnit *unit, int create) {
     HSP_mod_SYSTEMD *mdata = (HSP_mod_SYSTEMD *)mod->data;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
     HSPVMState_SYSTEMD cont = { .id = unit->name };
     HSPVMState_SYSTEMD *container = UTHashGet(mdata->vmsByID, &cont);
     if(container == NULL
@@ -260,22 +211,17 @@ extern "C" {
 	UTHashAdd(mdata->vmsByID, container);
 	UTHashAdd(mdata->vmsByUUID, container);
 	// see if we can get a cgroup id (no point if it is not cgroups v2)
-	if(unit->cgroup
-	   && mdata->cgroup_path) {
-	  char fName[HSP_SYSTEMD_MAX_FNAME_LEN+1];
-	  snprintf(fName, HSP_SYSTEMD_MAX_FNAME_LEN, "%s/%s",
-		   mdata->cgroup_path,
-		   unit->cgroup);
-	  struct stat statBuf = {};
-	  if(stat(fName, &statBuf) != 0) {
+	if(unit->cgroup) {
+	  HSPCgroup *cg = hspCgroup(sp, unit->cgroup);
+	  if(cg == NULL) {
 	    myDebug(1, "cannot get inode for cgroup %s", unit->cgroup);
 	  }
 	  else {
-	    container->cgroup_id = statBuf.st_ino;
+	    container->cgroup_id = cg->ino;
 	    myDebug(1, "Learned cgroup_id = %u for container %s (%s)",
 		    container->cgroup_id,
 		    container->id,
-		    fName);
+		    unit->cgroup);
 	    // remember this for packet sample lookup
 	    UTHashAdd(mdata->vmsByCgroupId, container);
 	  }
@@ -364,7 +310,7 @@ extern "C" {
     uint64_t cpu_total = 0;
     // compare with the reading of /proc/stat in readCpuCounters.c
     char path[HSP_SYSTEMD_MAX_FNAME_LEN+1];
-    sprintf(path, PROCFS_STR "/%u/stat", process->pid);
+    snprintf(path, HSP_SYSTEMD_MAX_FNAME_LEN, "%s/%u/stat", hspFS(HSP_FS_PROC), process->pid);
     FILE *statFile = fopen(path, "r");
     if(statFile == NULL) {
       myDebug(2, "cannot open %s : %s", path, strerror(errno));
@@ -401,11 +347,15 @@ extern "C" {
   */
 
   static uint64_t accumulateProcessCPU(EVMod *mod, HSPDBusUnit *unit) {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
     HSPDBusProcess *process;
     uint64_t unit_total = 0;
+    struct timespec tm_wall0, tm_cpu0;
+    timingStart(sp, &tm_wall0, &tm_cpu0);
     UTHASH_WALK(unit->processes, process) {
       unit_total += readProcessCPU(mod, process);
     }
+    timingEnd(sp, HSP_TIMING_SYSTEMD_PROCS, &tm_wall0, &tm_cpu0);
     unit->cntr.cpu_total = unit_total;
     return unit->cntr.cpu_total;
   }
@@ -419,7 +369,7 @@ extern "C" {
     HSP_mod_SYSTEMD *mdata = (HSP_mod_SYSTEMD *)mod->data;
     uint64_t rss = 0;
     char path[HSP_SYSTEMD_MAX_FNAME_LEN+1];
-    sprintf(path, PROCFS_STR "/%u/statm", process->pid);
+    snprintf(path, HSP_SYSTEMD_MAX_FNAME_LEN, "%s/%u/statm", hspFS(HSP_FS_PROC), process->pid);
     FILE *statFile = fopen(path, "r");
     if(statFile == NULL) {
       myDebug(2, "cannot open %s : %s", path, strerror(errno));
@@ -449,11 +399,15 @@ extern "C" {
   */
 
   static uint64_t accumulateProcessRAM(EVMod *mod, HSPDBusUnit *unit) {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
     uint64_t rss = 0;
     HSPDBusProcess *process;
+    struct timespec tm_wall0, tm_cpu0;
+    timingStart(sp, &tm_wall0, &tm_cpu0);
     UTHASH_WALK(unit->processes, process) {
       rss += readProcessRAM(mod, process);
     }
+    timingEnd(sp, HSP_TIMING_SYSTEMD_PROCS, &tm_wall0, &tm_cpu0);
     return rss;
   }
 
@@ -467,7 +421,7 @@ extern "C" {
     uint64_t rd_bytes = 0;
     uint64_t wr_bytes = 0;
     char path[HSP_SYSTEMD_MAX_FNAME_LEN+1];
-    sprintf(path, PROCFS_STR "/%u/io", process->pid);
+    snprintf(path, HSP_SYSTEMD_MAX_FNAME_LEN, "%s/%u/io", hspFS(HSP_FS_PROC), process->pid);
     FILE *statFile = fopen(path, "r");
     if(statFile == NULL) {
       myDebug(2, "cannot open %s : %s", path, strerror(errno));
@@ -507,11 +461,15 @@ extern "C" {
   */
 
   static bool accumulateProcessIO(EVMod *mod, HSPDBusUnit *unit, SFLHost_vrt_dsk_counters *dskio) {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
     bool gotData = NO;
     HSPDBusProcess *process;
+    struct timespec tm_wall0, tm_cpu0;
+    timingStart(sp, &tm_wall0, &tm_cpu0);
     UTHASH_WALK(unit->processes, process) {
       gotData |= readProcessIO(mod, process, dskio);
     }
+    timingEnd(sp, HSP_TIMING_SYSTEMD_PROCS, &tm_wall0, &tm_cpu0);
     return gotData;
   }
 
@@ -555,75 +513,6 @@ extern "C" {
     return (found > 0);
   }
 
-  /*_________________---------------------------__________________
-    _________________     readCgroup2Counters   __________________
-    -----------------___________________________------------------
-  */
-
-  static bool readCgroup2Counter(EVMod *mod, char *cgroup, char *fname, uint64_t *pVal64) {
-    HSP_mod_SYSTEMD *mdata = (HSP_mod_SYSTEMD *)mod->data;
-    bool ok = NO;
-    char statsFileName[HSP_SYSTEMD_MAX_FNAME_LEN+1];
-    snprintf(statsFileName, HSP_SYSTEMD_MAX_FNAME_LEN, "%s/%s/%s",
-	     mdata->cgroup_path,
-	     cgroup,
-	     fname);
-    FILE *statsFile = fopen(statsFileName, "r");
-    if(statsFile == NULL) {
-      myDebug(2, "cannot open %s : %s", statsFileName, strerror(errno));
-    }
-    else {
-      char line[HSP_SYSTEMD_MAX_STATS_LINELEN];
-      int truncated;
-      if(my_readline(statsFile, line, HSP_SYSTEMD_MAX_STATS_LINELEN, &truncated) != EOF) {
-	if(sscanf(line, "%"SCNu64, pVal64) == 1) {
-	  ok = YES;
-        }
-      }
-      fclose(statsFile);
-    }
-    return ok;
-  }
-
-  static bool readCgroup2Counters(EVMod *mod, char *cgroup, char *fname, int nvals, HSPNameVal *nameVals, bool multi) {
-    HSP_mod_SYSTEMD *mdata = (HSP_mod_SYSTEMD *)mod->data;
-    int found = 0;
-    char statsFileName[HSP_SYSTEMD_MAX_FNAME_LEN+1];
-    snprintf(statsFileName, HSP_SYSTEMD_MAX_FNAME_LEN, "%s/%s/%s",
-	     mdata->cgroup_path,
-	     cgroup,
-	     fname);
-    FILE *statsFile = fopen(statsFileName, "r");
-    if(statsFile == NULL) {
-      myDebug(2, "cannot open %s : %s", statsFileName, strerror(errno));
-    }
-    else {
-      char line[HSP_SYSTEMD_MAX_STATS_LINELEN];
-      char var[HSP_SYSTEMD_MAX_STATS_LINELEN];
-      uint64_t val64;
-      char *fmt = multi ?
-	"%s %"SCNu64 :
-	"%"SCNu64 ;
-      int truncated;
-      while(my_readline(statsFile, line, HSP_SYSTEMD_MAX_STATS_LINELEN, &truncated) != EOF) {
-	if(found == nvals && !multi) break;
-	if(sscanf(line, fmt, var, &val64) == 2) {
-	  for(int ii = 0; ii < nvals; ii++) {
-	    char *nm = nameVals[ii].nv_name;
-	    if(nm == NULL) break; // null name is double-check
-	    if(strcmp(var, nm) == 0)  {
-	      nameVals[ii].nv_found = YES;
-	      nameVals[ii].nv_val64 += val64;
-	      found++;
-	    }
-	  }
-        }
-      }
-      fclose(statsFile);
-    }
-    return (found > 0);
-  }
-
   /*________________---------------------------__________________
     ________________   getCounters_SYSTEMD     __________________
     ----------------___________________________------------------
@@ -686,32 +575,32 @@ extern "C" {
     enum SFLVirDomainState virState = SFL_VIR_DOMAIN_RUNNING;
     cpuElem.counterBlock.host_vrt_cpu.state = virState;
 
+    // cgroup v2 - whole unit in a few reads
+    HSPCgroupStats cg2 = { 0 };
+    if(sp->systemd.cgroup2) {
+      HSPCgroup *cg = hspCgroup(sp, unit->cgroup);
+      HSPCgroupStats *st = cg ? hspCgroupStats(sp, cg) : NULL;
+      if(st)
+	cg2 = *st;
+    }
+
     uint64_t cpu_total = 0;
-    if(mdata->cgroup_path) {
-      HSPNameVal cpuVals[] = {
-	{ "usage_usec",0,0 },
-	{ "user_usec",0,0},
-	{ "system_usec",0,0},
-	{ NULL,0,0},
-      };
-      if(readCgroup2Counters(mod, unit->cgroup, "cpu.stat", 3, cpuVals, YES)) {
-	if(cpuVals[0].nv_found)
-	  cpu_total = cpuVals[0].nv_val64;
-	// sFlow VM CPU not broken out by user/system
-      }
+    if(cg2.gotCPU) {
+      // sFlow VM CPU not broken out by user/system
+      cpu_total = cg2.cpu_uS;
       cpuElem.counterBlock.host_vrt_cpu.cpuTime = (uint32_t)(cpu_total / 1000); // uS to mS
     }
 
     // Fallback 1 - try groups v1 cpu accounting
-    if(cpu_total == 0
+    if(!cg2.gotCPU
        && unit->cpuAccounting
-       && mdata->cgroup_cpuacct) {
+       && hspCgroupV1Mount(sp, HSP_CGROUP_V1_CPUACCT)) {
       HSPNameVal cpuVals[] = {
 	{ "user",0,0 },
 	{ "system",0,0},
 	{ NULL,0,0},
       };
-      if(readCgroupCounters(mod, mdata->cgroup_cpuacct, unit->cgroup, "cpuacct.stat", 2, cpuVals, NO)) {
+      if(readCgroupCounters(mod, hspCgroupV1Mount(sp, HSP_CGROUP_V1_CPUACCT), unit->cgroup, "cpuacct.stat", 2, cpuVals, NO)) {
 	if(cpuVals[0].nv_found) cpu_total += cpuVals[0].nv_val64;
 	if(cpuVals[1].nv_found) cpu_total += cpuVals[1].nv_val64;
       }
@@ -719,7 +608,8 @@ extern "C" {
     }
  
     // Fallback 2 - add up by process
-    if(cpu_total == 0) {
+    if(!cg2.gotCPU
+       && cpu_total == 0) {
       cpu_total = accumulateProcessCPU(mod, unit);
       cpuElem.counterBlock.host_vrt_cpu.cpuTime = (uint32_t)(JIFFY_TO_MS(cpu_total));
     }
@@ -729,24 +619,25 @@ extern "C" {
     memElem.tag = SFLCOUNTERS_HOST_VRT_MEM;
     uint64_t rss = 0;
     uint64_t rss_max = 0;
-    if(mdata->cgroup_path) {
-      readCgroup2Counter(mod, unit->cgroup, "memory.current", &rss);
-      readCgroup2Counter(mod, unit->cgroup, "memory.max", &rss_max);
+    if(cg2.gotMem) {
+      rss = cg2.mem;
+      rss_max = cg2.mem_max;
     }
     // Fallback 1 - try cgroups v1 accounting
-    if(rss == 0
+    if(!cg2.gotMem
        && unit->memoryAccounting
-       && mdata->cgroup_memory) {
+       && hspCgroupV1Mount(sp, HSP_CGROUP_V1_MEMORY)) {
       HSPNameVal memVals[] = {
 	{ "rss",0,0 },
 	{ NULL,0,0},
       };
-      if(readCgroupCounters(mod, mdata->cgroup_memory, unit->cgroup, "memory.stat", 2, memVals, NO)) {
+      if(readCgroupCounters(mod, hspCgroupV1Mount(sp, HSP_CGROUP_V1_MEMORY), unit->cgroup, "memory.stat", 2, memVals, NO)) {
 	if(memVals[0].nv_found) rss += memVals[0].nv_val64;
       }
     }
     // Fallback 2 - add up by process
-    if(rss == 0) {
+    if(!cg2.gotMem
+       && rss == 0) {
       rss = accumulateProcessRAM(mod, unit);
     }
     memElem.counterBlock.host_vrt_mem.memory = rss;
@@ -756,14 +647,17 @@ extern "C" {
     // VM disk I/O counters
     SFLCounters_sample_element dskElem = { 0 };
     dskElem.tag = SFLCOUNTERS_HOST_VRT_DSK;
-    if(unit->blockIOAccounting
-       && mdata->cgroup_blkio) {
+    if(cg2.gotIO) {
+      dskElem.counterBlock.host_vrt_dsk = cg2.dsk;
+    }
+    else if(unit->blockIOAccounting
+       && hspCgroupV1Mount(sp, HSP_CGROUP_V1_BLKIO)) {
       HSPNameVal dskValsB[] = {
 	{ "Read",0,0 },
 	{ "Write",0,0},
 	{ NULL,0,0},
       };
-      if(readCgroupCounters(mod, mdata->cgroup_blkio, unit->cgroup, "blkio.io_service_bytes_recursive", 2, dskValsB, YES)) {
+      if(readCgroupCounters(mod, hspCgroupV1Mount(sp, HSP_CGROUP_V1_BLKIO), unit->cgroup, "blkio.io_service_bytes_recursive", 2, dskValsB, YES)) {
 	if(dskValsB[0].nv_found) {
 	  dskElem.counterBlock.host_vrt_dsk.rd_bytes += dskValsB[0].nv_val64;
 	}
@@ -778,7 +672,7 @@ extern "C" {
 	{ NULL,0,0},
       };
 
-      if(readCgroupCounters(mod, mdata->cgroup_blkio, unit->cgroup, "blkio.io_serviced_recursive", 2, dskValsO, YES)) {
+      if(readCgroupCounters(mod, hspCgroupV1Mount(sp, HSP_CGROUP_V1_BLKIO), unit->cgroup, "blkio.io_serviced_recursive", 2, dskValsO, YES)) {
 	if(dskValsO[0].nv_found) {
 	  dskElem.counterBlock.host_vrt_dsk.rd_req += dskValsO[0].nv_val64;
 	}
@@ -958,6 +852,7 @@ extern "C" {
 
   static void handler_controlGroup(EVMod *mod, DBusMessage *dbm, void *magic) {
     HSP_mod_SYSTEMD *mdata = (HSP_mod_SYSTEMD *)mod->data;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
     HSPDBusUnit *unit = (HSPDBusUnit *)magic;
     DBusMessageIter it;
     if(dbus_message_iter_init(dbm, &it)) {
@@ -984,7 +879,7 @@ extern "C" {
 	  process->marked = YES;
 
 	char path[HSP_SYSTEMD_MAX_FNAME_LEN+1];
-	char *systemd_controller = mdata->cgroup_path ?: mdata->cgroup_systemd;
+	char *systemd_controller = hspCgroupV2Mount(sp) ?: hspCgroupV1Mount(sp, HSP_CGROUP_V1_SYSTEMD);
 	snprintf(path, HSP_SYSTEMD_MAX_FNAME_LEN, "%s/%s/cgroup.procs",
 		 systemd_controller,
 		 unit->cgroup);
@@ -1417,9 +1312,6 @@ static DBusHandlerResult dbusCB(DBusConnection *connection, DBusMessage *message
 
     requestVNodeRole(mod, HSP_VNODE_PRIORITY_SYSTEMD);
 
-    // learn cgroup controller paths from /proc/mounts...
-    readCgroupPaths(mod);
-
     // get page size for scaling memory pages->bytes
 #if defined(PAGESIZE)
     mdata->page_size = PAGESIZE;
@@ -144,6 +144,7 @@ extern "C" {
     uint32_t diag_timeouts;
     uint32_t n_lastTick;
     uint32_t ipip_tx;
+    uint32_t governor_paused;
     UTHash *sampleHT;
     UTQ(HSPTCPSample) timeoutQ;
   } HSP_mod_TCP;
@@ -374,15 +375,16 @@ extern "C" {
 
   static void evt_tick(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
     HSP_mod_TCP *mdata = (HSP_mod_TCP *)mod->data;
-    uint32_t n_thisTick = mdata->diag_tx + mdata->diag_rx + mdata->nl_seq_lost + mdata->diag_timeouts;
+    uint32_t n_thisTick = mdata->diag_tx + mdata->diag_rx + mdata->nl_seq_lost + mdata->diag_timeouts + mdata->governor_paused;
     if(n_thisTick != mdata->n_lastTick) {
-      myDebug(1, "tcp: tx=%u, rx=%u, lost=%u, timeout=%u, annotated=%u, ipip_tx=%u",
+      myDebug(1, "tcp: tx=%u, rx=%u, lost=%u, timeout=%u, annotated=%u, ipip_tx=%u, governor_paused=%u",
 	      mdata->diag_tx,
 	      mdata->diag_rx,
 	      mdata->nl_seq_lost,
 	      mdata->diag_timeouts,
 	      mdata->samples_annotated,
-	      mdata->ipip_tx);
+	      mdata->ipip_tx,
+	      mdata->governor_paused);
      mdata->n_lastTick = n_thisTick;
     }
   }
@@ -535,8 +537,14 @@ extern "C" {
   */
 
   static void evt_flow_sample(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
+    HSP_mod_TCP *mdata = (HSP_mod_TCP *)mod->data;
     HSP *sp = (HSP *)EVROOTDATA(mod);
     HSPPendingSample *ps = (HSPPendingSample *)data;
+    if(sp->governor.pauseAnnotators) {
+      // mod_governor is shedding load - let the sample go unannotated
+      mdata->governor_paused++;
+      return;
+    }
     int ip_ver = decodePendingSample(ps);
     if(ip_ver == 4
        || ip_ver == 6) {
@@ -0,0 +1,353 @@
+/* This software is distributed under the following license:
+ * http://sflow.net/license.html
+ */
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "hsflowd.h"
+
+#define MAX_PROC_LINE_CHARS 320
+
+  /*_________________---------------------------__________________
+    _________________   cgroup accounting       __________________
+    -----------------___________________________------------------
+    Shared by mod_systemd, mod_docker, mod_containerd and mod_k8s
+    so that the cgroup mounts are only discovered once, and each
+    cgroup v2 directory is indexed once (by path and by inode) with
+    its stats files held open.  A cgroup's stats are read at most
+    once per polling interval no matter how many modules ask for
+    them.  Poll bus only - there is no locking here.  Entries that
+    nobody has asked about for a few polling intervals are closed
+    by hspCgroupSweep(),  so callers should not hold on to an
+    HSPCgroup pointer from one tick to the next.
+  */
+
+#define HSP_CGROUP_IDLE_POLLS 3
+
+  static const char *CgroupV1Names[HSP_CGROUP_V1_NUM] = {
+    "systemd",
+    "cpuacct",
+    "memory",
+    "blkio",
+    "devices"
+  };
+
+  static void readCgroupMounts(HSP *sp) {
+    sp->cgroups.mountsRead = YES;
+    char fsbuf[HSP_MAX_PATHLEN];
+    UTProcFile *pf = UTProcFileNew(hspFSPath(fsbuf, HSP_MAX_PATHLEN, HSP_FS_PROC, "/mounts"), 8192, 0);
+    if(UTProcFileRead(pf)) {
+      char *line;
+      while((line = UTProcFileLine(pf)) != NULL) {
+	// device mount-point type options ...
+	char *p = line;
+	UTNextTok(&p);
+	char *fsPath = UTNextTok(&p);
+	char *fsType = UTNextTok(&p);
+	if(fsType == NULL)
+	  continue;
+	if(my_strequal(fsType, "cgroup2")) {
+	  myDebug(1, "found cgroup2 path = %s", fsPath);
+	  if(sp->cgroups.v2_mount)
+	    my_free(sp->cgroups.v2_mount);
+	  sp->cgroups.v2_mount = my_strdup(fsPath);
+	}
+	else if(my_strequal(fsType, "cgroup")) {
+	  char *ctrl = strrchr(fsPath, '/');
+	  if(ctrl == NULL)
+	    continue;
+	  ctrl++;
+	  for(int ii = 0; ii < HSP_CGROUP_V1_NUM; ii++) {
+	    if(my_strequal(ctrl, (char *)CgroupV1Names[ii])
+	       && sp->cgroups.v1_mount[ii] == NULL) {
+	      myDebug(1, "found cgroup v1 %s controller path = %s", ctrl, fsPath);
+	      sp->cgroups.v1_mount[ii] = my_strdup(fsPath);
+	    }
+	  }
+	}
+      }
+    }
+    UTProcFileFree(pf);
+    sp->cgroups.byIno = UTHASH_NEW(HSPCgroup, ino, UTHASH_DFLT);
+    sp->cgroups.byPath = UTHASH_NEW(HSPCgroup, path, UTHASH_SKEY);
+  }
+
+  char *hspCgroupV2Mount(HSP *sp) {
+    if(!sp->cgroups.mountsRead)
+      readCgroupMounts(sp);
+    return sp->cgroups.v2_mount;
+  }
+
+  char *hspCgroupV1Mount(HSP *sp, EnumHSPCgroupV1 ctrl) {
+    if(!sp->cgroups.mountsRead)
+      readCgroupMounts(sp);
+    return sp->cgroups.v1_mount[ctrl];
+  }
+
+  /*_________________---------------------------__________________
+    _________________   cgroup index            __________________
+    -----------------___________________________------------------
+  */
+
+  static void cgroupFree(HSP *sp, HSPCgroup *cg) {
+    UTHashDel(sp->cgroups.byIno, cg);
+    UTHashDel(sp->cgroups.byPath, cg);
+    if(cg->pf_cpu) UTProcFileFree(cg->pf_cpu);
+    if(cg->pf_mem) UTProcFileFree(cg->pf_mem);
+    if(cg->pf_mem_max) UTProcFileFree(cg->pf_mem_max);
+    if(cg->pf_io) UTProcFileFree(cg->pf_io);
+    my_free(cg->path);
+    my_free(cg);
+  }
+
+  // path is relative to the cgroup2 mount,  with or without the leading '/'
+  HSPCgroup *hspCgroup(HSP *sp, char *path) {
+    char *mount = hspCgroupV2Mount(sp);
+    if(mount == NULL
+       || path == NULL)
+      return NULL;
+    while(*path == '/')
+      path++;
+    time_t now = sp->pollBus->now.tv_sec;
+    HSPCgroup search = { .path = path };
+    HSPCgroup *cg = UTHashGet(sp->cgroups.byPath, &search);
+    if(cg == NULL) {
+      char fullPath[HSP_MAX_PATHLEN];
+      snprintf(fullPath, HSP_MAX_PATHLEN, "%s/%s", mount, path);
+      struct stat statBuf = {};
+      if(stat(fullPath, &statBuf) != 0) {
+	myDebug(2, "cannot stat cgroup %s : %s", fullPath, strerror(errno));
+	return NULL;
+      }
+      // same directory under another name (e.g. a bind mount)?
+      search.ino = statBuf.st_ino;
+      cg = UTHashGet(sp->cgroups.byIno, &search);
+      if(cg == NULL) {
+	cg = (HSPCgroup *)my_calloc(sizeof(HSPCgroup));
+	cg->ino = statBuf.st_ino;
+	cg->path = my_strdup(path);
+	UTHashAdd(sp->cgroups.byIno, cg);
+	UTHashAdd(sp->cgroups.byPath, cg);
+	myDebug(1, "cgroup %s has inode %"PRIu64, cg->path, cg->ino);
+      }
+    }
+    cg->lastUsed = now;
+    return cg;
+  }
+
+  HSPCgroup *hspCgroupByIno(HSP *sp, uint64_t ino) {
+    if(sp->cgroups.byIno == NULL)
+      return NULL;
+    HSPCgroup search = { .ino = ino };
+    HSPCgroup *cg = UTHashGet(sp->cgroups.byIno, &search);
+    if(cg)
+      cg->lastUsed = sp->pollBus->now.tv_sec;
+    return cg;
+  }
+
+  /*_________________---------------------------__________________
+    _________________   hspCgroupStats          __________________
+    -----------------___________________________------------------
+    cpu.stat, memory.current, memory.max and io.stat. With cgroup
+    v2 the kernel has already added these up for the whole
+    subtree, so there is no need to visit the processes.
+  */
+
+  static UTProcFile *cgroupFile(HSP *sp, HSPCgroup *cg, UTProcFile **ppf, char *fname) {
+    if(*ppf == NULL) {
+      char path[HSP_MAX_PATHLEN];
+      snprintf(path, HSP_MAX_PATHLEN, "%s/%s/%s", sp->cgroups.v2_mount, cg->path, fname);
+      *ppf = UTProcFileNew(path, 1024, 0);
+    }
+    return *ppf;
+  }
+
+  static UTProcFile *cgroupFileRead(HSP *sp, HSPCgroup *cg, UTProcFile **ppf, char *fname) {
+    if(UTProcFileRead(cgroupFile(sp, cg, ppf, fname)))
+      return *ppf;
+    myDebug(2, "cannot read %s : %s", (*ppf)->path, strerror(errno));
+    return NULL;
+  }
+
+  static void readCgroupStats(HSP *sp, HSPCgroup *cg) {
+    HSPCgroupStats *st = &cg->stats;
+    memset(st, 0, sizeof(*st));
+    UTProcFile *pf;
+    char *line;
+    char *p;
+
+    if((pf = cgroupFileRead(sp, cg, &cg->pf_cpu, "cpu.stat"))) {
+      while((line = UTProcFileLine(pf)) != NULL) {
+	p = line;
+	char *var = UTNextTok(&p);
+	if(my_strequal(var, "usage_usec")
+	   && UTNextU64(&p, &st->cpu_uS)) {
+	  st->gotCPU = YES;
+	  break;
+	}
+      }
+    }
+
+    if((pf = cgroupFileRead(sp, cg, &cg->pf_mem, "memory.current"))) {
+      p = pf->buf;
+      st->gotMem = UTNextU64(&p, &st->mem);
+    }
+
+    // "max" (no limit) leaves mem_max at 0
+    if((pf = cgroupFileRead(sp, cg, &cg->pf_mem_max, "memory.max"))) {
+      p = pf->buf;
+      UTNextU64(&p, &st->mem_max);
+    }
+
+    // one line per device, e.g.
+    // 8:0 rbytes=1459200 wbytes=314773504 rios=192 wios=353 dbytes=0 dios=0
+    if((pf = cgroupFileRead(sp, cg, &cg->pf_io, "io.stat"))) {
+      st->gotIO = YES;
+      while((line = UTProcFileLine(pf)) != NULL) {
+	p = line;
+	if(UTNextTok(&p) == NULL)
+	  continue;
+	char *kv;
+	while((kv = UTNextTok(&p)) != NULL) {
+	  char *eq = strchr(kv, '=');
+	  if(eq == NULL)
+	    continue;
+	  *eq++ = '\0';
+	  uint64_t val64;
+	  if(!UTNextU64(&eq, &val64))
+	    continue;
+	  if(my_strequal(kv, "rbytes")) st->dsk.rd_bytes += val64;
+	  else if(my_strequal(kv, "wbytes")) st->dsk.wr_bytes += val64;
+	  else if(my_strequal(kv, "rios")) st->dsk.rd_req += val64;
+	  else if(my_strequal(kv, "wios")) st->dsk.wr_req += val64;
+	}
+      }
+    }
+  }
+
+  // Returns NULL if the cgroup has gone away,  in which case
+  // the entry is also freed.
+  HSPCgroupStats *hspCgroupStats(HSP *sp, HSPCgroup *cg) {
+    time_t now = sp->pollBus->now.tv_sec;
+    uint32_t interval = sp->actualPollingInterval ?: 1;
+    cg->lastUsed = now;
+    if(cg->lastRead
+       && (now - cg->lastRead) < interval)
+      return &cg->stats;
+
+    struct timespec tm_wall0, tm_cpu0;
+    timingStart(sp, &tm_wall0, &tm_cpu0);
+    readCgroupStats(sp, cg);
+    timingEnd(sp, HSP_TIMING_CGROUP_STATS, &tm_wall0, &tm_cpu0);
+
+    HSPCgroupStats *st = &cg->stats;
+    if(!st->gotCPU
+       && !st->gotMem
+       && !st->gotIO) {
+      // removed, or recreated with a new inode - either
+      // way the next hspCgroup() call will start again
+      myDebug(1, "cgroup %s unreadable - dropping it", cg->path);
+      cgroupFree(sp, cg);
+      return NULL;
+    }
+    cg->lastRead = now;
+    return st;
+  }
+
+  /*_________________---------------------------__________________
+    _________________   hspCgroupPrefetch       __________________
+    -----------------___________________________------------------
+    Call from a poller's request callback (i.e. during the poll
+    tick) if hspCgroupStats() will be wanted for this cgroup later
+    in the same tick.  If it is due to be read,  its files go into
+    the tick's batch,  which evt_poll_tick() reads all together.
+  */
+
+  void hspCgroupPrefetch(HSP *sp, char *path) {
+    HSPCgroup *cg = hspCgroup(sp, path);
+    if(cg == NULL)
+      return;
+    time_t now = sp->pollBus->now.tv_sec;
+    uint32_t interval = sp->actualPollingInterval ?: 1;
+    if(cg->lastRead
+       && (now - cg->lastRead) < interval)
+      return;
+    UTBatchReadAdd(sp->pollBatch, cgroupFile(sp, cg, &cg->pf_cpu, "cpu.stat"));
+    UTBatchReadAdd(sp->pollBatch, cgroupFile(sp, cg, &cg->pf_mem, "memory.current"));
+    UTBatchReadAdd(sp->pollBatch, cgroupFile(sp, cg, &cg->pf_mem_max, "memory.max"));
+    UTBatchReadAdd(sp->pollBatch, cgroupFile(sp, cg, &cg->pf_io, "io.stat"));
+  }
+
+  /*_________________---------------------------__________________
+    _________________   hspCgroupSweep          __________________
+    -----------------___________________________------------------
+    Called from the poll tick to close the files of cgroups that
+    are no longer being asked about.
+  */
+
+  void hspCgroupSweep(HSP *sp) {
+    if(sp->cgroups.byPath == NULL)
+      return;
+    time_t now = sp->pollBus->now.tv_sec;
+    uint32_t interval = sp->actualPollingInterval ?: 1;
+    if((now - sp->cgroups.lastSweep) < interval)
+      return;
+    sp->cgroups.lastSweep = now;
+    time_t idle = interval * HSP_CGROUP_IDLE_POLLS;
+    HSPCgroup *cg;
+    UTHASH_WALK(sp->cgroups.byPath, cg) {
+      if((now - cg->lastUsed) > idle) {
+	myDebug(1, "cgroup %s idle - closing", cg->path);
+	cgroupFree(sp, cg);
+      }
+    }
+  }
+
+  /*_________________---------------------------__________________
+    _________________   hspCgroupOfPid          __________________
+    -----------------___________________________------------------
+    Look up a process's cgroup for the given v1 controller,  or
+    for the v2 unified hierarchy if controller is "".  The lines
+    in /proc/<pid>/cgroup look like "3:devices:/path" (v1) or
+    "0::/path" (v2).  Replaces *p_path if it changed and returns
+    YES if so.
+  */
+
+  bool hspCgroupOfPid(pid_t pid, char *controller, char **p_path) {
+    char fsbuf[HSP_MAX_PATHLEN];
+    FILE *procFile = fopen(hspFSPath(fsbuf, HSP_MAX_PATHLEN, HSP_FS_PROC, "/%u/cgroup", pid), "r");
+    if(procFile == NULL)
+      return NO;
+    bool changed = NO;
+    char line[MAX_PROC_LINE_CHARS];
+    int truncated;
+    while(my_readline(procFile, line, MAX_PROC_LINE_CHARS, &truncated) != EOF) {
+      if(truncated)
+	continue;
+      char *type = strchr(line, ':');
+      if(type == NULL)
+	continue;
+      *type++ = '\0';
+      char *path = strchr(type, ':');
+      if(path == NULL)
+	continue;
+      *path++ = '\0';
+      if(my_strequal(type, controller)) {
+	if(!my_strequal(*p_path, path)) {
+	  if(*p_path)
+	    my_free(*p_path);
+	  *p_path = my_strdup(path);
+	  changed = YES;
+	}
+	break;
+      }
+    }
+    fclose(procFile);
+    return changed;
+  }
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
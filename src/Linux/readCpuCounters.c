@@ -15,22 +15,34 @@ extern "C" {
     -----------------___________________________------------------
   */
 
+  // kept open between polls (see hspProcFileRead)
+  static UTProcFile *pf_loadavg;
+  static UTProcFile *pf_stat;
+  static UTProcFile *pf_uptime;
+  static UTProcFile *pf_cpuinfo;
+
   int readCpuCounters(SFLHost_cpu_counters *cpu) {
     int gotData = NO;
-    FILE *procFile;
+    UTProcFile *pf;
     // We assume that the cpu counters struct has been initialized
     // with all zeros.
-    procFile= fopen(PROCFS_STR "/loadavg", "r");
-    if(procFile) {
-      // The docs are pretty clear about %f being "float" rather
-      // that "double", so just give the pointers to fscanf.
-      if(fscanf(procFile, "%f %f %f %"SCNu32"/%"SCNu32"",
-		&cpu->load_one,
-		&cpu->load_five,
-		&cpu->load_fifteen,
-		&cpu->proc_run,
-		&cpu->proc_total) == 5) {
+    if((pf = hspProcFileRead(&pf_loadavg, HSP_FS_PROC, "/loadavg", 256, 0))) {
+      // e.g. "0.52 0.58 0.59 1/1234 5678"
+      char *p = pf->buf;
+      double load_one, load_five, load_fifteen;
+      uint64_t proc_run, proc_total;
+      if(UTNextDouble(&p, &load_one)
+	 && UTNextDouble(&p, &load_five)
+	 && UTNextDouble(&p, &load_fifteen)
+	 && UTNextU64(&p, &proc_run)
+	 && *p++ == '/'
+	 && UTNextU64(&p, &proc_total)) {
 	gotData = YES;
+	cpu->load_one = (float)load_one;
+	cpu->load_five = (float)load_five;
+	cpu->load_fifteen = (float)load_fifteen;
+	cpu->proc_run = (uint32_t)proc_run;
+	cpu->proc_total = (uint32_t)proc_total;
       }
       if(cpu->proc_run > 0) {
 	// subtract myself from the running process count,
@@ -38,64 +50,48 @@ extern "C" {
 	// Dave Mangot for pointing this out.
 	cpu->proc_run--;
       }
-      fclose(procFile);
     }
 
-    procFile = fopen(PROCFS_STR "/stat", "r");
-    if(procFile) {
+    // /proc/stat has a line per cpu and the "intr" line can be
+    // long, so let the buffer grow to fit the whole thing.
+    if((pf = hspProcFileRead(&pf_stat, HSP_FS_PROC, "/stat", 8192, 0))) {
       // ASCII numbers in /proc/stat may be 64-bit (if not now
       // then someday), so it seems safer to read into
-      // 64-bit ints with scanf first,  then copy them
+      // 64-bit ints first,  then copy them
       // into the host_cpu structure from there. This also
       // allows us to convert "jiffies" to milliseconds.
-      uint64_t cpu_user=0;
-      uint64_t cpu_nice =0;
-      uint64_t cpu_system=0;
-      uint64_t cpu_idle=0;
-      uint64_t cpu_wio=0;
-      uint64_t cpu_intr=0;
-      uint64_t cpu_sintr=0;
-      uint64_t cpu_interrupts=0;
-      uint64_t cpu_contexts=0;
-      uint64_t cpu_steal=0;
-      uint64_t cpu_guest=0;
-      uint64_t cpu_guest_nice=0;
-
 #define JIFFY_TO_MS(i) (((i) * 1000L) / HZ)
 
-      // limit the number of chars we will read from each line
-      // (there can be more than this - my_readline will chop for us)
-#define MAX_PROC_LINE_CHARS 240
-      char line[MAX_PROC_LINE_CHARS];
       uint32_t lineNo = 0;
-      int truncated;
-      while(my_readline(procFile, line, MAX_PROC_LINE_CHARS, &truncated) != EOF) {
+      char *line;
+      while((line = UTProcFileLine(pf)) != NULL) {
 	if(++lineNo == 1) {
-	  if(sscanf(line, "cpu %"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64"",
-		    &cpu_user,
-		    &cpu_nice,
-		    &cpu_system,
-		    &cpu_idle,
-		    &cpu_wio,
-		    &cpu_intr,
-		    &cpu_sintr,
-		    &cpu_steal,
-		    &cpu_guest,
-		    &cpu_guest_nice) >= 4) {
+	  // cpu user nice system idle iowait irq softirq steal guest guest_nice
+	  uint64_t cpu_ctrs[10] = { 0 };
+	  int nctrs = 0;
+	  char *p = line;
+	  if(UTNextTok(&p)) {
+	    while(nctrs < 10
+		  && UTNextU64(&p, &cpu_ctrs[nctrs]))
+	      nctrs++;
+	  }
+	  if(nctrs >= 4) {
 	    gotData = YES;
-	    cpu->cpu_user = (uint32_t)(JIFFY_TO_MS(cpu_user));
-	    cpu->cpu_nice = (uint32_t)(JIFFY_TO_MS(cpu_nice));
-	    cpu->cpu_system = (uint32_t)(JIFFY_TO_MS(cpu_system));
-	    cpu->cpu_idle = (uint32_t)(JIFFY_TO_MS(cpu_idle));
-	    cpu->cpu_wio = (uint32_t)(JIFFY_TO_MS(cpu_wio));
-	    cpu->cpu_intr = (uint32_t)(JIFFY_TO_MS(cpu_intr));
-	    cpu->cpu_sintr = (uint32_t)(JIFFY_TO_MS(cpu_sintr));
-	    cpu->cpu_steal = (uint32_t)(JIFFY_TO_MS(cpu_steal));
-	    cpu->cpu_guest = (uint32_t)(JIFFY_TO_MS(cpu_guest));
-	    cpu->cpu_guest_nice = (uint32_t)(JIFFY_TO_MS(cpu_guest_nice));
+	    cpu->cpu_user = (uint32_t)(JIFFY_TO_MS(cpu_ctrs[0]));
+	    cpu->cpu_nice = (uint32_t)(JIFFY_TO_MS(cpu_ctrs[1]));
+	    cpu->cpu_system = (uint32_t)(JIFFY_TO_MS(cpu_ctrs[2]));
+	    cpu->cpu_idle = (uint32_t)(JIFFY_TO_MS(cpu_ctrs[3]));
+	    cpu->cpu_wio = (uint32_t)(JIFFY_TO_MS(cpu_ctrs[4]));
+	    cpu->cpu_intr = (uint32_t)(JIFFY_TO_MS(cpu_ctrs[5]));
+	    cpu->cpu_sintr = (uint32_t)(JIFFY_TO_MS(cpu_ctrs[6]));
+	    cpu->cpu_steal = (uint32_t)(JIFFY_TO_MS(cpu_ctrs[7]));
+	    cpu->cpu_guest = (uint32_t)(JIFFY_TO_MS(cpu_ctrs[8]));
+	    cpu->cpu_guest_nice = (uint32_t)(JIFFY_TO_MS(cpu_ctrs[9]));
 	  }
 	}
 	else {
+	  uint64_t val64;
+	  char *p = line + 4;
 	  if(line[0] == 'c' &&
 	     line[1] == 'p' &&
 	     line[2] == 'u' &&
@@ -105,30 +101,28 @@ extern "C" {
 	  }
 	  else if(strncmp(line, "intr", 4) == 0) {
 	    // total interrupts is the second token on this line
-	    if(sscanf(line, "intr %"SCNu64"", &cpu_interrupts) == 1) {
+	    if(UTNextU64(&p, &val64)) {
 	      gotData = YES;
-	      cpu->interrupts = (uint32_t)cpu_interrupts;
+	      cpu->interrupts = (uint32_t)val64;
 	    }
 	  }
 	  else if(strncmp(line, "ctxt", 4) == 0) {
-	    if(sscanf(line, "ctxt %"SCNu64"", &cpu_contexts) == 1) {
+	    if(UTNextU64(&p, &val64)) {
 	      gotData = YES;
-	      cpu->contexts = (uint32_t)cpu_contexts;
+	      cpu->contexts = (uint32_t)val64;
 	    }
 	  }
 	}
       }
-      fclose(procFile);
     }
 
-    procFile = fopen(PROCFS_STR "/uptime", "r");
-    if(procFile) {
-      float uptime = 0;
-      if(fscanf(procFile, "%f",	&uptime) == 1) {
+    if((pf = hspProcFileRead(&pf_uptime, HSP_FS_PROC, "/uptime", 128, 0))) {
+      char *p = pf->buf;
+      double uptime = 0;
+      if(UTNextDouble(&p, &uptime)) {
 	gotData = YES;
 	cpu->uptime = (uint32_t)uptime;
       }
-      fclose(procFile);
     }
 
     // GNU libc knows the number of processors so
@@ -147,24 +141,26 @@ extern "C" {
 
     //cpu_speed.  According to Ganglia/libmetrics we should
     // look first in /sys/devices/system/cpu/cpu0/cpufreq/scaling_max_freq
-    // but for now just take the first one from /proc/cpuinfo
-    procFile = fopen(PROCFS_STR "/cpuinfo", "r");
-    if(procFile) {
-#undef MAX_PROC_LINE_CHARS
-#define MAX_PROC_LINE_CHARS 80
-      char line[MAX_PROC_LINE_CHARS];
-      int truncated;
-      while(my_readline(procFile, line, MAX_PROC_LINE_CHARS, &truncated) != EOF) {
+    // but for now just take the first one from /proc/cpuinfo.
+    // That is always in the first block, so cap the read there
+    // rather than pulling in the stanzas for every cpu.
+    if((pf = hspProcFileRead(&pf_cpuinfo, HSP_FS_PROC, "/cpuinfo", 4096, 4096))) {
+      char *line;
+      while((line = UTProcFileLine(pf)) != NULL) {
 	if(strncmp(line, "cpu MHz", 7) == 0) {
+	  // "cpu MHz		: 2400.000"
+	  char *p = strchr(line, ':');
 	  double cpu_mhz = 0.0;
-	  if(sscanf(line, "cpu MHz : %lf", &cpu_mhz) == 1) {
-	    gotData = YES;
-	    cpu->cpu_speed = (uint32_t)(cpu_mhz);
-	    break;
+	  if(p) {
+	    p++;
+	    if(UTNextDouble(&p, &cpu_mhz)) {
+	      gotData = YES;
+	      cpu->cpu_speed = (uint32_t)(cpu_mhz);
+	      break;
+	    }
 	  }
 	}
       }
-      fclose(procFile);
     }
 
     return gotData;
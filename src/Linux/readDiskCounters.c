@@ -45,50 +45,44 @@ int remote_mount(const char *device, const char *type)
     -----------------___________________________------------------
   */
 
+  // kept open between polls (see hspProcFileRead)
+  static UTProcFile *pf_diskstats;
+  static UTProcFile *pf_mounts;
+
+  // device names in the tree point into pf_mounts->buf
+  static void noFree(void *ptr) { }
+
   int readDiskCounters(HSP *sp, SFLHost_dsk_counters *dsk) {
     int gotData = NO;
-    FILE *procFile;
-    procFile= fopen(PROCFS_STR "/diskstats", "r");
-    if(procFile) {
+    struct timespec tm_wall0, tm_cpu0;
+    timingStart(sp, &tm_wall0, &tm_cpu0);
+    UTProcFile *pf;
+    char *line;
+    if((pf = hspProcFileRead(&pf_diskstats, HSP_FS_PROC, "/diskstats", 8192, 0))) {
       // ASCII numbers in /proc/diskstats may be 64-bit (if not now
       // then someday), so it seems safer to read into
-      // 64-bit ints with scanf first,  then copy them
+      // 64-bit ints first,  then copy them
       // into the host_dsk structure from there.
-      uint32_t majorNo;
-      uint32_t minorNo;
-
-      uint64_t reads = 0;
-      /* uint64_t reads_merged = 0;*/
-      uint64_t sectors_read = 0;
-      uint64_t read_time_ms = 0;
-      uint64_t writes = 0;
-      /* uint64_t writes_merged = 0;*/
-      uint64_t sectors_written = 0;
-      uint64_t write_time_ms = 0;
 
       // handle 64-bit counters specially
       uint64_t total_sectors_read = 0;
       uint64_t total_sectors_written = 0;
 
-      // limit the number of chars we will read from each line
-      // (there can be more than this - my_readline will chop for us)
-#define MAX_PROC_LINE_CHARS 240
-      char line[MAX_PROC_LINE_CHARS];
-      char devName[MAX_PROC_LINE_CHARS];
-      int truncated;
-      while(my_readline(procFile, line, MAX_PROC_LINE_CHARS, &truncated) != EOF) {
-	if(sscanf(line, "%"SCNu32" %"SCNu32" %s %"SCNu64" %*u %"SCNu64" %"SCNu64" %"SCNu64" %*u %"SCNu64" %"SCNu64"",
-		  &majorNo,
-		  &minorNo,
-		  devName,
-		  &reads,
-		  /*&reads_merged,*/
-		  &sectors_read,
-		  &read_time_ms,
-		  &writes,
-		  /*&writes_merged,*/
-		  &sectors_written,
-		  &write_time_ms) == 9) {
+      while((line = UTProcFileLine(pf)) != NULL) {
+	// major minor name reads reads_merged sectors_read read_time_ms
+	//   writes writes_merged sectors_written write_time_ms ...
+	uint64_t majorNo, minorNo;
+	uint64_t ctrs[8];
+	char *p = line;
+	if(!UTNextU64(&p, &majorNo)
+	   || !UTNextU64(&p, &minorNo)
+	   || UTNextTok(&p) == NULL)
+	  continue;
+	int nctrs = 0;
+	while(nctrs < 8
+	      && UTNextU64(&p, &ctrs[nctrs]))
+	  nctrs++;
+	if(nctrs == 8) {
 	  gotData = YES;
 	  // report the sum over all disks - except software RAID devices and logical volumes
 	  // because that would cause double-counting.   We identify those by their
@@ -96,16 +90,15 @@ int remote_mount(const char *device, const char *type)
 	  // Software RAID = 9
 	  // Logical Vol = 253
 	  if(majorNo != 9 && majorNo != 253) {
-	    dsk->reads += reads;
-	    total_sectors_read += sectors_read;
-	    dsk->read_time += read_time_ms;
-	    dsk->writes += writes;
-	    total_sectors_written += sectors_written;
-	    dsk->write_time += write_time_ms;
+	    dsk->reads += ctrs[0];
+	    total_sectors_read += ctrs[2];
+	    dsk->read_time += ctrs[3];
+	    dsk->writes += ctrs[4];
+	    total_sectors_written += ctrs[6];
+	    dsk->write_time += ctrs[7];
 	  }
 	}
       }
-      fclose(procFile);
 
       // accumulate the 64-bit counters (they may only be 32-bit counters in this OS)
       sp->diskIO.bytes_read += (total_sectors_read - sp->diskIO.last_sectors_read) * ASSUMED_DISK_SECTOR_BYTES;
@@ -120,19 +113,15 @@ int remote_mount(const char *device, const char *type)
     // borrowed heavily from ganglia/linux/metrics.c for this part where
     // we read the mount points and then interrogate them to add up the
     // disk space on local disks.
-    procFile = fopen(PROCFS_STR "/mounts", "r");
-    if(procFile) {
-#undef MAX_PROC_LINE_CHARS
-#define MAX_PROC_LINE_CHARS 240
-      char line[MAX_PROC_LINE_CHARS];
-      char device[MAX_PROC_LINE_CHARS];
-      char mount[MAX_PROC_LINE_CHARS];
-      char type[MAX_PROC_LINE_CHARS];
-      char mode[MAX_PROC_LINE_CHARS];
+    if((pf = hspProcFileRead(&pf_mounts, HSP_FS_PROC, "/mounts", 8192, 0))) {
       void *treeRoot = NULL;
-      int truncated;
-      while(my_readline(procFile, line, MAX_PROC_LINE_CHARS, &truncated) != EOF) {
-	if(sscanf(line, "%s %s %s %s", device, mount, type, mode) == 4) {
+      while((line = UTProcFileLine(pf)) != NULL) {
+	char *p = line;
+	char *device = UTNextTok(&p);
+	char *mount = UTNextTok(&p);
+	char *type = UTNextTok(&p);
+	char *mode = UTNextTok(&p);
+	if(mode) {
 	  // must start with /dev/ or /dev2/ or ubi:
 	  if(strncmp(device, "/dev/", 5) == 0 ||
 	     strncmp(device, "/dev2/", 6) == 0 ||
@@ -144,7 +133,7 @@ int remote_mount(const char *device, const char *type)
 		// don't count it again if it was seen before
 		if(tfind(device, &treeRoot, (comparison_fn_t)strcmp) == NULL) {
 		  // not found, so remember it
-		  tsearch(my_strdup(device), &treeRoot, (comparison_fn_t)strcmp);
+		  tsearch(device, &treeRoot, (comparison_fn_t)strcmp);
 		  // and get the numbers
 		  struct statvfs svfs;
 		  if(statvfs(mount, &svfs) == 0) {
@@ -164,10 +153,10 @@ int remote_mount(const char *device, const char *type)
 	  }
 	}
       }
-      tdestroy(treeRoot, my_free);
-      fclose(procFile);
+      tdestroy(treeRoot, noFree);
     }
 
+    timingEnd(sp, HSP_TIMING_READ_DISK, &tm_wall0, &tm_cpu0);
     return gotData;
   }
 
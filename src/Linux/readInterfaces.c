@@ -34,7 +34,8 @@ extern "C" {
   void readVLANs(HSP *sp)
   {
     // mark interfaces that are specific to a VLAN
-    FILE *procFile = fopen(PROCFS_STR "/net/vlan/config", "r");
+    char fsbuf[HSP_MAX_PATHLEN];
+    FILE *procFile = fopen(hspFSPath(fsbuf, HSP_MAX_PATHLEN, HSP_FS_PROC, "/net/vlan/config"), "r");
     if(procFile) {
       char line[MAX_PROC_LINE_CHARS];
       int lineNo = 0;
@@ -211,7 +212,8 @@ extern "C" {
   static int readIPv6Addresses(HSP *sp, UTHash *addrHT)
   {
     int addresses_added = 0;
-    FILE *procFile = fopen(PROCFS_STR "/net/if_inet6", "r");
+    char fsbuf[HSP_MAX_PATHLEN];
+    FILE *procFile = fopen(hspFSPath(fsbuf, HSP_MAX_PATHLEN, HSP_FS_PROC, "/net/if_inet6"), "r");
     if(procFile) {
       char line[MAX_PROC_LINE_CHARS];
       int lineNo = 0;
@@ -713,6 +715,8 @@ extern "C" {
   int readInterfaces(HSP *sp, bool full_discovery,  uint32_t *p_added, uint32_t *p_removed, uint32_t *p_cameup, uint32_t *p_wentdown, uint32_t *p_changed)
   {
   uint32_t ad_added=0, ad_removed=0, ad_cameup=0, ad_wentdown=0, ad_changed=0;
+  struct timespec tm_wall0, tm_cpu0;
+  timingStart(sp, &tm_wall0, &tm_cpu0);
 
   // keep v4 and v6 separate to simplify HT logic
   UTHash *newLocalIP = UTHASH_NEW(HSPLocalIP, ipAddr.address.ip_v4, UTHASH_DFLT);
@@ -735,7 +739,9 @@ extern "C" {
     return 0;
   }
 
-  FILE *procFile = fopen(PROCFS_STR "/net/dev", "r");
+  char fsbuf[HSP_MAX_PATHLEN];
+
+  FILE *procFile = fopen(hspFSPath(fsbuf, HSP_MAX_PATHLEN, HSP_FS_PROC, "/net/dev"), "r");
   if(procFile) {
     struct ifreq ifr;
     memset(&ifr, 0, sizeof(ifr));
@@ -946,6 +952,7 @@ extern "C" {
   if(oldLocalIP6)
     freeLocalIPs(oldLocalIP6);
 
+  timingEnd(sp, HSP_TIMING_READ_INTERFACES, &tm_wall0, &tm_cpu0);
   return sp->adaptorsByName->entries;
 }
 
@@ -13,24 +13,26 @@ extern "C" {
     -----------------___________________________------------------
   */
 
+  // kept open between polls (see hspProcFileRead)
+  static UTProcFile *pf_meminfo;
+  static UTProcFile *pf_vmstat;
+
   int readMemoryCounters(SFLHost_mem_counters *mem) {
     int gotData = NO;
-    FILE *procFile;
-    // limit the number of chars we will read from each line
-    // (there can be more than this - my_readline will chop for us)
-#define MAX_PROC_LINE_CHARS 80
-    char line[MAX_PROC_LINE_CHARS];
-    char var[MAX_PROC_LINE_CHARS];
+    UTProcFile *pf;
+    char *line;
     uint64_t val64;
 
     // zero the structure so we can accumulate into it.
     memset(mem, 0, sizeof(*mem));
 
-    procFile= fopen(PROCFS_STR "/meminfo", "r");
-    if(procFile) {
-      int truncated;
-      while(my_readline(procFile, line, MAX_PROC_LINE_CHARS, &truncated) != EOF) {
-	if(sscanf(line, "%s %"SCNu64"", var, &val64) == 2) {
+    if((pf = hspProcFileRead(&pf_meminfo, HSP_FS_PROC, "/meminfo", 4096, 0))) {
+      while((line = UTProcFileLine(pf)) != NULL) {
+	// e.g. "MemTotal:       16318480 kB"
+	char *p = line;
+	char *var = UTNextTok(&p);
+	if(var
+	   && UTNextU64(&p, &val64)) {
 	  gotData = YES;
 	  if(strcmp(var, "MemTotal:") == 0) mem->mem_total += val64 * 1024;
 	  else if(strcmp(var, "MemFree:") == 0) mem->mem_free += val64 * 1024;
@@ -41,14 +43,14 @@ extern "C" {
 	  else if(strcmp(var, "SReclaimable:") == 0) mem->mem_cached += val64 * 1024;
 	}
       }
-      fclose(procFile);
     }
 
-    procFile= fopen(PROCFS_STR "/vmstat", "r");
-    if(procFile) {
-      int truncated;
-      while(my_readline(procFile, line, MAX_PROC_LINE_CHARS, &truncated) != EOF) {
-	if(sscanf(line, "%s %"SCNu64"", var, &val64) == 2) {
+    if((pf = hspProcFileRead(&pf_vmstat, HSP_FS_PROC, "/vmstat", 8192, 0))) {
+      while((line = UTProcFileLine(pf)) != NULL) {
+	char *p = line;
+	char *var = UTNextTok(&p);
+	if(var
+	   && UTNextU64(&p, &val64)) {
 	  gotData = YES;
 	  if(strcmp(var, "pgpgin") == 0) mem->page_in += (uint32_t)val64;
 	  else if(strcmp(var, "pgpgout") == 0) mem->page_out += (uint32_t)val64;
@@ -56,7 +58,6 @@ extern "C" {
 	  else if(strcmp(var, "pswpout") == 0) mem->swap_out += (uint32_t)val64;
 	}
       }
-      fclose(procFile);
     }
 
     return gotData;
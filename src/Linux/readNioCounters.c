@@ -38,7 +38,7 @@ extern "C" {
 
   void updateBondCounters(HSP *sp, SFLAdaptor *bond) {
     char procFileName[256];
-    snprintf(procFileName, 256, PROCFS_STR "/net/bonding/%s", bond->deviceName);
+    snprintf(procFileName, 256, "%s/net/bonding/%s", hspFS(HSP_FS_PROC), bond->deviceName);
     FILE *procFile = fopen(procFileName, "r");
     if(procFile) {
       // limit the number of chars we will read from each line
@@ -369,6 +369,21 @@ extern "C" {
 
 #if ( HSP_OPTICAL_STATS && ETHTOOL_GMODULEEEPROM )
 
+  // The EEPROM reads go out over i2c and can take tens of mS per
+  // module,  so they are done on the sfp worker buses.  The request
+  // and the result are the same self-contained struct,  passed by
+  // value through the bus pipes.
+#define HSP_SFP_MAX_LANES 4
+
+  typedef struct _HSPSFPRead {
+    char deviceName[IFNAMSIZ];
+    uint32_t ifIndex;
+    uint32_t modinfo_type;
+    uint32_t modinfo_len;
+    SFLSFP_counters sfp; // num_lanes == 0 if nothing was read
+    SFLLane lanes[HSP_SFP_MAX_LANES];
+  } HSPSFPRead;
+
   /*_________________---------------------------__________________
     _________________    SFF8472 SFP Data       __________________
     -----------------___________________________------------------
@@ -404,12 +419,11 @@ extern "C" {
   }
 #define SFF8472_CAL_RXPWR(x, ff) (x) = sff8472_calibration_rxpwr((x), (ff))
 
-  static void sff8472_read(SFLAdaptor *adaptor, struct ifreq *ifr, int fd)
+  static void sff8472_read(HSPSFPRead *rd, struct ifreq *ifr, int fd)
   {
     struct ethtool_eeprom *eeprom = NULL;
-    HSPAdaptorNIO *nio = ADAPTOR_NIO(adaptor);
 
-    if(nio->modinfo_len < ETH_MODULE_SFF_8472_LEN)
+    if(rd->modinfo_len < ETH_MODULE_SFF_8472_LEN)
       goto out;
 
     eeprom = (struct ethtool_eeprom *)my_calloc(sizeof(*eeprom) + ETH_MODULE_SFF_8472_LEN);
@@ -486,13 +500,13 @@ extern "C" {
     }
 
     // populate sFlow structure
-    nio->sfp.lanes = (SFLLane *)my_realloc(nio->sfp.lanes, sizeof(SFLLane) * num_lanes);
-    nio->sfp.module_id = adaptor->ifIndex;
-    nio->sfp.module_total_lanes = num_lanes;
-    nio->sfp.module_supply_voltage = (voltage / 10); // mV
-    nio->sfp.module_temperature = (temperature * 1000); // mC
-    nio->sfp.num_lanes = num_lanes;
-    SFLLane *lane = &(nio->sfp.lanes[0]);
+    rd->sfp.lanes = rd->lanes;
+    rd->sfp.module_id = rd->ifIndex;
+    rd->sfp.module_total_lanes = num_lanes;
+    rd->sfp.module_supply_voltage = (voltage / 10); // mV
+    rd->sfp.module_temperature = (temperature * 1000); // mC
+    rd->sfp.num_lanes = num_lanes;
+    SFLLane *lane = &(rd->lanes[0]);
     lane->lane_index = 1;
     lane->tx_bias_current = (bias_current * 2); // uA
     lane->tx_power = (tx_power / 10); // uW
@@ -505,10 +519,10 @@ extern "C" {
     lane->rx_wavelength = wavelength; // same as tx_wavelength
 
     myDebug(1, "SFP8472 %s u=%u(nm) T=%u(mC) V=%u(mV) I=%u(uA) tx=%u(uW) [%u-%u] rx=%u(uW) [%u-%u]",
-	    adaptor->deviceName,
+	    rd->deviceName,
 	    lane->tx_wavelength,
-	    nio->sfp.module_temperature,
-	    nio->sfp.module_supply_voltage,
+	    rd->sfp.module_temperature,
+	    rd->sfp.module_supply_voltage,
 	    lane->tx_bias_current,
 	    lane->tx_power,
 	    lane->tx_power_min,
@@ -522,12 +536,11 @@ extern "C" {
       my_free(eeprom);
   }
 
-  static void sff8436_read(SFLAdaptor *adaptor, struct ifreq *ifr, int fd)
+  static void sff8436_read(HSPSFPRead *rd, struct ifreq *ifr, int fd)
   {
     struct ethtool_eeprom *eeprom = NULL;
-    HSPAdaptorNIO *nio = ADAPTOR_NIO(adaptor);
 
-    if(nio->modinfo_len < ETH_MODULE_SFF_8436_LEN)
+    if(rd->modinfo_len < ETH_MODULE_SFF_8436_LEN)
       goto out;
 
     eeprom = (struct ethtool_eeprom *)my_calloc(sizeof(*eeprom) + ETH_MODULE_SFF_8436_LEN);
@@ -656,15 +669,15 @@ extern "C" {
     rx_power_min = ntohs(eew[256 + 25]);
 
     // populate sFlow structure
-    nio->sfp.lanes = (SFLLane *)my_realloc(nio->sfp.lanes, sizeof(SFLLane) * num_lanes);
-    nio->sfp.module_id = adaptor->ifIndex;
-    nio->sfp.module_total_lanes = num_lanes;
-    nio->sfp.module_supply_voltage = (voltage / 10); // mV
-    nio->sfp.module_temperature = (temperature * 1000); // mC
-    nio->sfp.num_lanes = num_lanes;
+    rd->sfp.lanes = rd->lanes;
+    rd->sfp.module_id = rd->ifIndex;
+    rd->sfp.module_total_lanes = num_lanes;
+    rd->sfp.module_supply_voltage = (voltage / 10); // mV
+    rd->sfp.module_temperature = (temperature * 1000); // mC
+    rd->sfp.num_lanes = num_lanes;
 
     for (int ch=0; ch < num_lanes; ch++) {
-      SFLLane *lane = &(nio->sfp.lanes[ch]);
+      SFLLane *lane = &(rd->lanes[ch]);
       lane->lane_index = (ch + 1);
       lane->tx_bias_current = (bias_current[ch] * 2); // uA
       lane->tx_wavelength = wavelength;
@@ -674,11 +687,11 @@ extern "C" {
       lane->rx_wavelength = wavelength; // same as tx_wavelength
 
       myDebug(1, "SFP8436 %s[%u] u=%u(nm) T=%u(mC) V=%u(mV) I=%u(uA) tx=%u(uW) [%u-%u] rx=%u(uW) [%u-%u]",
-	    adaptor->deviceName,
+	    rd->deviceName,
 	    ch,
 	    lane->tx_wavelength,
-	    nio->sfp.module_temperature,
-	    nio->sfp.module_supply_voltage,
+	    rd->sfp.module_temperature,
+	    rd->sfp.module_supply_voltage,
 	    lane->tx_bias_current,
 	    lane->tx_power,
 	    lane->tx_power_min,
@@ -693,8 +706,121 @@ extern "C" {
       my_free(eeprom);
   }
 
+  /*_________________---------------------------__________________
+    _________________    SFP worker buses       __________________
+    -----------------___________________________------------------
+    The poll bus sends an HSPEVENT_SFP_REQUEST when a module's stats
+    are older than sfpRefresh,  and counter samples go out with the
+    last values received. A device always goes to the same worker,
+    and only has one request outstanding at a time (unless a worker
+    is stuck for longer than HSP_SFP_REQUEST_TIMEOUT).
+  */
+
+  static void sfpRead(HSPSFPRead *rd, int fd) {
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    memcpy(ifr.ifr_name, rd->deviceName, IFNAMSIZ);
+    switch(rd->modinfo_type) {
+    case ETH_MODULE_SFF_8472: sff8472_read(rd, &ifr, fd); break;
+    case ETH_MODULE_SFF_8436: sff8436_read(rd, &ifr, fd); break;
+    }
+  }
+
+  static void sfpApply(SFLAdaptor *adaptor, HSPSFPRead *rd) {
+    HSPAdaptorNIO *nio = ADAPTOR_NIO(adaptor);
+    nio->sfp_pending = NO;
+    if(rd->sfp.num_lanes == 0) {
+      // keep the last good values
+      return;
+    }
+    uint32_t num_lanes = rd->sfp.num_lanes;
+    nio->sfp.lanes = (SFLLane *)my_realloc(nio->sfp.lanes, sizeof(SFLLane) * num_lanes);
+    memcpy(nio->sfp.lanes, rd->lanes, sizeof(SFLLane) * num_lanes);
+    nio->sfp.module_id = rd->sfp.module_id;
+    nio->sfp.module_total_lanes = rd->sfp.module_total_lanes;
+    nio->sfp.module_supply_voltage = rd->sfp.module_supply_voltage;
+    nio->sfp.module_temperature = rd->sfp.module_temperature;
+    nio->sfp.num_lanes = num_lanes;
+  }
+
+  static void evt_sfp_request(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
+    // runs on one of the sfp worker buses
+    static __thread int sfpSock = -1;
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    HSPSFPRead rd;
+    if(dataLen != sizeof(rd))
+      return;
+    memcpy(&rd, data, sizeof(rd));
+    if(sfpSock < 0)
+      sfpSock = socket(PF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if(sfpSock >= 0)
+      sfpRead(&rd, sfpSock);
+    EVEventTx(mod, sp->sfp.resultEvent, &rd, sizeof(rd));
+  }
+
+  static void evt_sfp_result(EVMod *mod, EVEvent *evt, void *data, size_t dataLen) {
+    HSP *sp = (HSP *)EVROOTDATA(mod);
+    HSPSFPRead rd;
+    if(dataLen != sizeof(rd))
+      return;
+    memcpy(&rd, data, sizeof(rd));
+    // the device may have gone (or its ifIndex been reused) meanwhile
+    SFLAdaptor *adaptor = adaptorByIndex(sp, rd.ifIndex);
+    if(adaptor
+       && my_strequal(adaptor->deviceName, rd.deviceName))
+      sfpApply(adaptor, &rd);
+  }
+
+  static void sfpRefresh(HSP *sp, SFLAdaptor *adaptor, int fd) {
+    HSPAdaptorNIO *nio = ADAPTOR_NIO(adaptor);
+    if(nio->modinfo_type != ETH_MODULE_SFF_8472
+       && nio->modinfo_type != ETH_MODULE_SFF_8436)
+      return;
+    time_t age = sp->pollBus->now.tv_sec - nio->sfp_requested;
+    if(age < sp->sfp.refreshSecs)
+      return;
+    if(nio->sfp_pending
+       && age < HSP_SFP_REQUEST_TIMEOUT)
+      return;
+    nio->sfp_requested = sp->pollBus->now.tv_sec;
+    HSPSFPRead rd = { .ifIndex = adaptor->ifIndex,
+		      .modinfo_type = nio->modinfo_type,
+		      .modinfo_len = nio->modinfo_len };
+    strncpy(rd.deviceName, adaptor->deviceName, IFNAMSIZ-1);
+    if(sp->sfp.requestEvents == NULL) {
+      // sfpThreads=0: read it here
+      sfpRead(&rd, fd);
+      sfpApply(adaptor, &rd);
+      return;
+    }
+    nio->sfp_pending = YES;
+    uint32_t worker = adaptor->ifIndex % UTArrayN(sp->sfp.requestEvents);
+    EVEventTx(sp->rootModule, UTArrayAt(sp->sfp.requestEvents, worker), &rd, sizeof(rd));
+  }
+
 #endif /* ( HSP_OPTICAL_STATS && ETHTOOL_GMODULEEEPROM ) */
 
+  void initSFPWorkers(HSP *sp) {
+#if ( HSP_OPTICAL_STATS && ETHTOOL_GMODULEEEPROM )
+    if(sp->sfp.threads == 0)
+      return;
+    sp->sfp.resultEvent = EVGetEvent(sp->pollBus, HSPEVENT_SFP_RESULT);
+    EVEventRx(sp->rootModule, sp->sfp.resultEvent, evt_sfp_result);
+    sp->sfp.requestEvents = UTArrayNew(UTARRAY_DFLT);
+    for(uint32_t ii = 0; ii < sp->sfp.threads; ii++) {
+      char busName[32];
+      snprintf(busName, sizeof(busName), HSPBUS_SFP "%u", ii);
+      EVBus *bus = EVGetBus(sp->rootModule, busName, YES);
+      EVEvent *request = EVGetEvent(bus, HSPEVENT_SFP_REQUEST);
+      EVEventRx(sp->rootModule, request, evt_sfp_request);
+      UTArrayAdd(sp->sfp.requestEvents, request);
+    }
+    myDebug(1, "optical module stats read by %u worker bus(es), refresh=%us",
+	    sp->sfp.threads,
+	    sp->sfp.refreshSecs);
+#endif
+  }
+
   /*_________________---------------------------__________________
     _________________  accumulateNioCounters    __________________
     -----------------___________________________------------------
@@ -852,70 +978,53 @@ extern "C" {
     -----------------___________________________------------------
   */
 
-  void updateNioCounters(HSP *sp, SFLAdaptor *filter) {
-
-    assert(EVCurrentBus() == sp->pollBus);
-    time_t clk = sp->pollBus->now.tv_sec;
-
-    // notify modules in case they want to override
-    EVEventTx(sp->rootModule, EVGetEvent(sp->pollBus, HSPEVENT_UPDATE_NIO), &filter, sizeof(filter));
-
-    if(filter == NULL) {
-      // full refresh - but don't do anything if we just
-      // refreshed all the numbers less than a second ago
-      if (sp->nio_last_update == clk) {
-	return;
-      }
-      sp->nio_last_update = clk;
-    }
-    else {
-      if(ADAPTOR_NIO(filter)->last_update == clk) {
-	// the requested adaptor has fresh counters
-	// so nothing to do here
-	return;
-      }
-    }
-
-    FILE *procFile;
-    procFile= fopen(PROCFS_STR "/net/dev", "r");
-    if(procFile) {
-      int fd = socket (PF_INET, SOCK_DGRAM, 0);
+  // kept between polls: /proc/net/dev stays open (see hspProcFileRead),
+  // and so does the ioctl socket and the ethtool stats buffer.
+  // Only used from the poll bus.
+  static UTProcFile *pf_netdev;
+  static int nioSock = -1;
+  static struct ethtool_stats *et_stats;
+  static uint32_t et_statsLen;
+
+  // One pass over /proc/net/dev.  Refreshes every adaptor, or just the
+  // filter adaptor,  or (if due is set) just the ones marked nio_due.
+  static void readProcNetDev(HSP *sp, SFLAdaptor *filter, bool due) {
+    UTProcFile *pf = hspProcFileRead(&pf_netdev, HSP_FS_PROC, "/net/dev", 16384, 0);
+    if(pf) {
+      if(nioSock < 0)
+	nioSock = socket(PF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+      int fd = nioSock;
       struct ifreq ifr;
       memset (&ifr, 0, sizeof(ifr));
-      // ASCII numbers in /proc/diskstats may be 64-bit (if not now
+      // ASCII numbers in /proc/net/dev may be 64-bit (if not now
       // then someday), so it seems safer to read into
-      // 64-bit ints with scanf first,  then copy them
+      // 64-bit ints first,  then copy them
       // into the host_nio structure from there.
-      uint64_t bytes_in = 0;
-      uint64_t pkts_in = 0;
-      uint64_t errs_in = 0;
-      uint64_t drops_in = 0;
-      uint64_t bytes_out = 0;
-      uint64_t pkts_out = 0;
-      uint64_t errs_out = 0;
-      uint64_t drops_out = 0;
-      // limit the number of chars we will read from each line
-      // (there can be more than this - my_readline will chop for us)
-#define MAX_PROC_LINE_CHARS 240
-      char line[MAX_PROC_LINE_CHARS];
-      int truncated;
-      while(my_readline(procFile, line, MAX_PROC_LINE_CHARS, &truncated) != EOF) {
-	char deviceName[MAX_PROC_LINE_CHARS];
+      char *line;
+      while((line = UTProcFileLine(pf)) != NULL) {
 	// assume the format is:
 	// Inter-|   Receive                                                |  Transmit
 	//  face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed
-	if(sscanf(line, "%[^:]:%"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64" %*u %*u %*u %*u %"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64"",
-		  deviceName,
-		  &bytes_in,
-		  &pkts_in,
-		  &errs_in,
-		  &drops_in,
-		  &bytes_out,
-		  &pkts_out,
-		  &errs_out,
-		  &drops_out) == 9) {
-	  uint32_t devLen = my_strnlen(deviceName, MAX_PROC_LINE_CHARS-1);
-	  char *trimmed = trimWhitespace(deviceName, devLen);
+	// so only the device lines have a ':'
+	char *p = strchr(line, ':');
+	if(p == NULL)
+	  continue;
+	*p++ = '\0';
+	uint64_t ctrs[16];
+	int nctrs = 0;
+	while(nctrs < 16
+	      && UTNextU64(&p, &ctrs[nctrs]))
+	  nctrs++;
+	if(nctrs >= 12) {
+	  uint64_t bytes_in = ctrs[0];
+	  uint64_t pkts_in = ctrs[1];
+	  uint64_t errs_in = ctrs[2];
+	  uint64_t drops_in = ctrs[3];
+	  uint64_t bytes_out = ctrs[8];
+	  uint64_t pkts_out = ctrs[9];
+	  uint64_t errs_out = ctrs[10];
+	  uint64_t drops_out = ctrs[11];
+	  char *trimmed = trimWhitespace(line, my_strlen(line));
 	  if(trimmed == NULL)
 	    continue;
 	  SFLAdaptor *adaptor = adaptorByName(sp, trimmed);
@@ -926,6 +1035,15 @@ extern "C" {
 
 	    HSPAdaptorNIO *niostate = ADAPTOR_NIO(adaptor);
 
+	    // its poller is due on this tick
+	    bool pollerDue = niostate->nio_due;
+	    if(due && !pollerDue)
+	      continue;
+	    if(pollerDue) {
+	      niostate->nio_due = NO;
+	      sp->nio_due--;
+	    }
+
 	    if(niostate->procNetDev == NO)
 	      continue;
 
@@ -948,7 +1066,13 @@ extern "C" {
 	      uint32_t bytes = sizeof(struct ethtool_stats);
 	      bytes += niostate->et_nctrs * sizeof(uint64_t);
 	      bytes += 32; // pad - just in case driver wants to write more
-	      struct ethtool_stats *et_stats = (struct ethtool_stats *)my_calloc(bytes);
+	      // the buffer is kept for next time and only grows
+	      if(bytes > et_statsLen) {
+		my_free(et_stats);
+		et_stats = (struct ethtool_stats *)my_calloc(bytes);
+		et_statsLen = bytes;
+	      }
+	      memset(et_stats, 0, bytes);
 	      et_stats->cmd = ETHTOOL_GSTATS;
 	      et_stats->n_stats = niostate->et_nctrs;
 
@@ -973,21 +1097,19 @@ extern "C" {
 		if(niostate->et_idx_bcasts_out)
 		  et_ctrs.bcasts_out = et_stats->data[niostate->et_idx_bcasts_out - 1];
 	      }
-	      my_free(et_stats);
 	    }
 
 #if ( HSP_OPTICAL_STATS && ETHTOOL_GMODULEEEPROM )
-	    if(filter) {
+	    if(filter || pollerDue) {
 	      // If we are refreshing stats for an individual device, then
 	      // check for SFP (lane) stats too. This operation can be slow so
 	      // it's important to avoid doing it when we are refreshing
 	      // counters for all interfaces for host-sflow network totals.
 	      // Since the host-sflow network totals do not include optical
-	      // stats,  this is not a problem.
-	      switch(niostate->modinfo_type) {
-	      case ETH_MODULE_SFF_8472: sff8472_read(adaptor, &ifr, fd); break;
-	      case ETH_MODULE_SFF_8436: sff8436_read(adaptor, &ifr, fd); break;
-	      }
+	      // stats,  this is not a problem.  Normally the read is
+	      // queued for a worker bus and the sample uses the values
+	      // from the last one (see sfpRefresh).
+	      sfpRefresh(sp, adaptor, fd);
 	    }
 #endif /*  ( HSP_OPTICAL_STATS && ETHTOOL_GMODULEEEPROM ) */
 
@@ -995,9 +1117,79 @@ extern "C" {
 	  }
 	}
       }
-      if(fd >= 0)
-	close(fd);
-      fclose(procFile);
+    }
+  }
+
+  void updateNioCounters(HSP *sp, SFLAdaptor *filter) {
+
+    assert(EVCurrentBus() == sp->pollBus);
+    time_t clk = sp->pollBus->now.tv_sec;
+
+    // notify modules in case they want to override
+    EVEventTx(sp->rootModule, EVGetEvent(sp->pollBus, HSPEVENT_UPDATE_NIO), &filter, sizeof(filter));
+
+    if(filter == NULL) {
+      // full refresh - but don't do anything if we just
+      // refreshed all the numbers less than a second ago
+      if (sp->nio_last_update == clk) {
+	return;
+      }
+      sp->nio_last_update = clk;
+    }
+    else {
+      if(ADAPTOR_NIO(filter)->last_update == clk) {
+	// the requested adaptor has fresh counters
+	// so nothing to do here
+	return;
+      }
+    }
+
+    // only the full refresh is timed
+    struct timespec tm_wall0, tm_cpu0;
+    if(filter == NULL)
+      timingStart(sp, &tm_wall0, &tm_cpu0);
+
+    readProcNetDev(sp, filter, NO);
+
+    if(filter == NULL)
+      timingEnd(sp, HSP_TIMING_UPDATE_NIO, &tm_wall0, &tm_cpu0);
+  }
+
+  /*_________________---------------------------__________________
+    _________________   updateNioCountersDue    __________________
+    -----------------___________________________------------------
+    Interface pollers that come due on the same tick (all of them
+    together with syncPolling) would each re-read and re-parse the
+    whole of /proc/net/dev in updateNioCounters().  Instead the
+    poller request marks the adaptor nio_due,  and the poll tick
+    calls this to refresh them all in one pass before running the
+    poll actions. The per-poller updateNioCounters() call then finds
+    fresh counters (it still sends HSPEVENT_UPDATE_NIO,  in poller
+    order,  so the module hooks see the same sequence as before).
+    If a full refresh is going to happen on this tick anyway (host
+    counters, or the 32-bit wrap check) then it is done here instead
+    so the file is still only parsed once.
+  */
+
+  void updateNioCountersDue(HSP *sp, bool full) {
+    assert(EVCurrentBus() == sp->pollBus);
+    time_t clk = sp->pollBus->now.tv_sec;
+    if(full
+       && sp->nio_last_update != clk) {
+      struct timespec tm_wall0, tm_cpu0;
+      timingStart(sp, &tm_wall0, &tm_cpu0);
+      sp->nio_last_update = clk;
+      readProcNetDev(sp, NULL, NO);
+      timingEnd(sp, HSP_TIMING_UPDATE_NIO, &tm_wall0, &tm_cpu0);
+    }
+    else if(sp->nio_due)
+      readProcNetDev(sp, NULL, YES);
+    if(sp->nio_due) {
+      // some were not found in /proc/net/dev
+      SFLAdaptor *adaptor;
+      UTHASH_WALK(sp->adaptorsByName, adaptor)
+	ADAPTOR_NIO(adaptor)->nio_due = NO;
+      sp->nio_due = 0;
     }
   }
 
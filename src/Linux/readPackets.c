@@ -194,8 +194,24 @@ extern "C" {
   static void agentCB_getCounters_interface_request(void *magic, SFLPoller *poller, SFL_COUNTERS_SAMPLE_TYPE *cs)
   {
     HSP *sp = (HSP *)poller->magic;
-    UTArrayAdd(sp->pollActions, poller);
-    UTArrayAdd(sp->pollActions, agentCB_getCounters_interface);
+    // bond members are kept in the same poll slot as their bond
+    uint32_t group = 0;
+    char *devName = (char *)poller->userData;
+    SFLAdaptor *adaptor = devName ? adaptorByName(sp, devName) : NULL;
+    if(adaptor) {
+      HSPAdaptorNIO *adaptorNIO = ADAPTOR_NIO(adaptor);
+      if(adaptorNIO->bond_master)
+	group = adaptor->ifIndex;
+      else if(adaptorNIO->bond_slave)
+	group = adaptorNIO->lacp.attachedAggID;
+      // idle virtual interfaces may back off (see pollBackoff)
+      if((adaptorNIO->vm_or_container
+	  || adaptorNIO->devType == HSPDEV_VETH
+	  || adaptorNIO->devType == HSPDEV_VIF)
+	 && pollBackoff(sp, &adaptorNIO->backoff, poller, adaptorActivity(sp, adaptor)))
+	return;
+    }
+    addPollAction(sp, poller, agentCB_getCounters_interface, group);
   }
 
   /*_________________---------------------------__________________
@@ -236,6 +252,16 @@ extern "C" {
     -----------------___________________________------------------
   */
 
+  static uint32_t samplerHeaderBytes(HSP *sp)
+  {
+    uint32_t headerBytes = sp->sFlowSettings_file->headerBytes;
+    // mod_governor may be trimming this to shed load
+    if(sp->governor.headerBytes
+       && sp->governor.headerBytes < headerBytes)
+      headerBytes = sp->governor.headerBytes;
+    return headerBytes;
+  }
+
   static SFLSampler *getSampler(HSP *sp, SFLAdaptor *adaptor)
   {
     HSPAdaptorNIO *adaptorNIO = ADAPTOR_NIO(adaptor);
@@ -247,12 +273,30 @@ extern "C" {
 	adaptorNIO->sampler = sfl_agent_addSampler(sp->agent, &dsi);
 	sfl_sampler_set_sFlowFsReceiver(adaptorNIO->sampler, HSP_SFLOW_RECEIVER_INDEX);
 	// TODO: adapt if headerBytes changes dynamically in config settings
-	sfl_sampler_set_sFlowFsMaximumHeaderSize(adaptorNIO->sampler, sp->sFlowSettings_file->headerBytes);
+	sfl_sampler_set_sFlowFsMaximumHeaderSize(adaptorNIO->sampler, samplerHeaderBytes(sp));
       }
     }
     return adaptorNIO->sampler;
   }
 
+  /*_________________---------------------------__________________
+    _________________ updateSamplerHeaderBytes  __________________
+    -----------------___________________________------------------
+    Push a change in the effective headerBytes out to the samplers
+    that already exist (e.g. when mod_governor trims it).
+  */
+
+  void updateSamplerHeaderBytes(HSP *sp)
+  {
+    if(sp->agent == NULL)
+      return;
+    uint32_t headerBytes = samplerHeaderBytes(sp);
+    SEMLOCK_DO(sp->sync_agent) {
+      for(SFLSampler *sm = sp->agent->samplers; sm; sm = sm->nxt)
+	sfl_sampler_set_sFlowFsMaximumHeaderSize(sm, headerBytes);
+    }
+  }
+
 
   /*_________________---------------------------__________________
     _________________     pendingSample         __________________
@@ -265,6 +309,8 @@ extern "C" {
     ps->sampler = sampler;
     ps->refCount = 1;
     ps->ptrsToFree = UTArrayNew(UTARRAY_DFLT);
+    // precise clock here: the diag lookups we may wait for are sub-mS
+    clock_gettime(CLOCK_MONOTONIC, &ps->ts_created);
     return ps;
   }
 
@@ -286,6 +332,7 @@ extern "C" {
   {
     if(--ps->refCount == 0) {
       EVBus *bus = EVCurrentBus();
+      clock_gettime(CLOCK_MONOTONIC, &ps->ts_released);
 
       // some consumers of packet-samples will want to wait until everyone has
       // looked at it and released it before they process it. For example, mod_k8s
@@ -302,6 +349,10 @@ extern "C" {
 	  sfl_agent_set_now(ps->sampler->agent, bus->now.tv_sec, bus->now.tv_nsec);
 	  sfl_sampler_writeFlowSample(ps->sampler, ps->fs);
 	  sp->telemetry[HSP_TELEMETRY_FLOW_SAMPLES]++;
+	  telemetryLatency(sp,
+			   HSP_TELEMETRY_SAMPLE_LATENCY_10US,
+			   &ps->ts_created,
+			   &ps->ts_released);
 	}
       }
       void *ptr;
@@ -465,6 +516,8 @@ extern "C" {
     
     SFLSampler *sampler = getSampler(sp, sampler_dev);
     assert(sampler != NULL);
+    // counts as activity for adaptive polling
+    ADAPTOR_NIO(sampler_dev)->samples++;
 
     // may want to kick off an interface poller too,
     // even if it has no corresponding sampler
@@ -479,6 +532,53 @@ extern "C" {
 	getPoller(sp, ad_out);
     }
 
+    // submit the actual sampling rate so it goes out with the sFlow feed
+    // otherwise the sampler object would fill in his own (sub-sampling) rate.
+    // If it's a switch port then samplerNIO->sampling_n may be set, so that
+    // takes precendence (allows different ports to have different sampling
+    // settings).
+    uint32_t actualSamplingRate = sampling_n;
+    HSPAdaptorNIO *samplerNIO = ADAPTOR_NIO(sampler_dev);
+    if(samplerNIO->sampling_n_set && samplerNIO->sampling_n) {
+      actualSamplingRate = samplerNIO->sampling_n;
+    }
+
+    // estimate the sample pool from the samples.  Could maybe do this
+    // above with the (possibly more granular) ulogSamplingRate, but then
+    // we would have to look up the sampler object every time, which
+    // might be too expensive in the case where ulogSamplingRate==1.
+    sampler->samplePool += actualSamplingRate;
+    
+    // accumulate total drops
+    sp->telemetry[HSP_TELEMETRY_DROPPED_SAMPLES] += drops;
+
+    // also accumulate dropped-samples we detected against whichever sampler
+    // sends the next sample. This is not perfect,  but is likely to accrue
+    // drops against the point whose sampling-rate needs to be adjusted.
+    samplerNIO->netlink_drops += drops;
+
+    // If mod_governor is shedding load then sub-sample here, before
+    // we spend any more cycles on this one. Same accounting as in
+    // mod_psample: the sample we keep carries the sampling_n of all
+    // the packets it now represents.
+    if(sp->governor.subSampling > 1) {
+      samplerNIO->governorSubSampleCount += actualSamplingRate;
+      if(samplerNIO->governorSubSampleCount < (actualSamplingRate * sp->governor.subSampling)) {
+	sp->telemetry[HSP_TELEMETRY_GOVERNOR_SAMPLES_SHED]++;
+	for(SFLFlow_sample_element *elem = extended_elements; elem; ) {
+	  SFLFlow_sample_element *next_elem = elem->nxt;
+	  my_free(elem);
+	  elem = next_elem;
+	}
+	my_free(fs);
+	return;
+      }
+      actualSamplingRate = samplerNIO->governorSubSampleCount;
+      samplerNIO->governorSubSampleCount = 0;
+    }
+    fs->sampling_rate = actualSamplingRate;
+    fs->drops = samplerNIO->netlink_drops;
+
     // build the sampled header structure
     HSPPendingSample *ps = pendingSampleNew(sampler, fs);
     SFLFlow_sample_element *hdrElem = pendingSample_calloc(ps, sizeof(SFLFlow_sample_element));
@@ -527,33 +627,6 @@ extern "C" {
     // add to flow sample
     SFLADD_ELEMENT(fs, hdrElem);
 
-    // submit the actual sampling rate so it goes out with the sFlow feed
-    // otherwise the sampler object would fill in his own (sub-sampling) rate.
-    // If it's a switch port then samplerNIO->sampling_n may be set, so that
-    // takes precendence (allows different ports to have different sampling
-    // settings).
-    uint32_t actualSamplingRate = sampling_n;
-    HSPAdaptorNIO *samplerNIO = ADAPTOR_NIO(sampler_dev);
-    if(samplerNIO->sampling_n_set && samplerNIO->sampling_n) {
-      actualSamplingRate = samplerNIO->sampling_n;
-    }
-    fs->sampling_rate = actualSamplingRate;
-    
-    // estimate the sample pool from the samples.  Could maybe do this
-    // above with the (possibly more granular) ulogSamplingRate, but then
-    // we would have to look up the sampler object every time, which
-    // might be too expensive in the case where ulogSamplingRate==1.
-    sampler->samplePool += actualSamplingRate;
-    
-    // accumulate total drops
-    sp->telemetry[HSP_TELEMETRY_DROPPED_SAMPLES] += drops;
-
-    // also accumulate dropped-samples we detected against whichever sampler
-    // sends the next sample. This is not perfect,  but is likely to accrue
-    // drops against the point whose sampling-rate needs to be adjusted.
-    samplerNIO->netlink_drops += drops;
-    fs->drops = samplerNIO->netlink_drops;
-
     // Attach linked list of extension structures if supplied, and
     // take over responsibility for freeing them when the sample is
     // released (it might get queued and released later if
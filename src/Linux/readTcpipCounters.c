@@ -8,9 +8,6 @@ extern "C" {
 
 #include "hsflowd.h"
 
-  // make sure we read whole lines at a time
-#define MAX_PROC_LINE_CHARS 2048
-
   /*_________________---------------------------__________________
     _________________    parseCounterArray      __________________
     -----------------___________________________------------------
@@ -20,19 +17,12 @@ extern "C" {
     char *p = str;
     int ff = 0;
     for(; ff < n; ff++) {
-      char buf[MAX_PROC_LINE_CHARS];
-      char *var = parseNextTok(&p, " \t", NO, 0, NO, buf, MAX_PROC_LINE_CHARS);
+      int64_t val;
       // stop if we reach the end of the line - or if something was not a number
-      if(var == NULL) {
-	// no more tokens
-	break;
-      }
-      char *end = NULL;
-      long val = strtol(var, &end, 0);
-      if(end == var) {
-	// nothing was consumed - it wasn't a number
+      // (e.g. the header line that names the fields)
+      if(!UTNextI64(&p, &val))
 	break;
-      }
+      // Tcp MaxConn is -1, which the MIB expects as 0xFFFFFFFF
       counters[ff] = (uint32_t)val;
     }
     return ff;
@@ -43,18 +33,20 @@ extern "C" {
     -----------------___________________________------------------
   */
 
+  // kept open between polls (see hspProcFileRead)
+  static UTProcFile *pf_snmp;
+
   int readTcpipCounters(HSP *sp, SFLHost_ip_counters *c_ip, SFLHost_icmp_counters *c_icmp, SFLHost_tcp_counters *c_tcp, SFLHost_udp_counters *c_udp) {
     int count = 0;
-    FILE *procFile;
-    char line[MAX_PROC_LINE_CHARS];
+    UTProcFile *pf;
 
-    procFile= fopen(PROCFS_STR "/net/snmp", "r");
-    if(procFile) {
-      int truncated;
-      while(my_readline(procFile, line, MAX_PROC_LINE_CHARS, &truncated) != EOF) {
+    if((pf = hspProcFileRead(&pf_snmp, HSP_FS_PROC, "/net/snmp", 8192, 0))) {
+      char *line;
+      while((line = UTProcFileLine(pf)) != NULL) {
 	char *p = line;
-	char buf[MAX_PROC_LINE_CHARS];
-	char *var = parseNextTok(&p, " \t", NO, 0, NO, buf, MAX_PROC_LINE_CHARS);
+	char *var = UTNextTok(&p);
+	if(var == NULL)
+	  continue;
 	if(strcmp(var, "Ip:") == 0) {
 	  count += parseCounterArray(p, (uint32_t *)c_ip, SFLHOST_NUM_IP_COUNTERS);
 	}
@@ -68,7 +60,6 @@ extern "C" {
 	  count += parseCounterArray(p, (uint32_t *)c_udp, SFLHOST_NUM_UDP_COUNTERS);
 	}
       }
-      fclose(procFile);
     }
     return (count > 0);
   }
@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+
+# Stand-in for the Docker Engine API on a Unix socket,  for exercising
+# mod_docker's request handling without dockerd.  It answers the four
+# calls that mod_docker makes:
+#   GET /<v>/events?...                     chunked feed,  held open
+#   GET /<v>/containers/json                --containers running containers
+#   GET /<v>/containers/<id>/json           inspect
+#   GET /<v>/containers/<id>/stats?stream=false
+# Connections are kept alive and pipelined requests are answered in
+# order.  Bodies are sent with Content-Length or chunked (--encoding),
+# and written in small pieces so that responses straddle reads.
+# With --event-every the event feed restarts a random container
+# ("die" then "start") at that interval.  Every --report seconds it
+# prints the connections accepted and the requests served so far.
+#
+# Point hsflowd at it with the var prefix,  e.g.
+#   unshare -n sleep infinity &
+#   docker_standin.py --dir /tmp/dk --containers 1000 --pid $! &
+#   hsflowd -d -f hsflowd.conf -F var=/tmp/dk
+# (the socket is DIR/run/docker.sock)
+
+import argparse
+import hashlib
+import json
+import os
+import random
+import socket
+import sys
+import threading
+import time
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--dir", required=True, help="socket is created at DIR/run/docker.sock")
+parser.add_argument("--containers", type=int, default=100)
+parser.add_argument("--encoding", choices=["chunked", "length", "mixed"], default="mixed")
+parser.add_argument("--stats-delay", dest="statsDelay", type=float, default=0.0,
+  help="seconds to sleep before each stats answer (dockerd takes about 1)")
+parser.add_argument("--close-every", dest="closeEvery", type=int, default=0,
+  help="answer every Nth request with Connection: close")
+parser.add_argument("--pid", type=int, default=os.getpid(),
+  help="State.Pid for every container,  e.g. that of 'unshare -n sleep infinity' so they get a netns of their own")
+parser.add_argument("--event-every", dest="eventEvery", type=float, default=0.0,
+  help="seconds between container restarts on the event feed")
+parser.add_argument("--report", type=float, default=10.0)
+args = parser.parse_args()
+
+lock = threading.Lock()
+counts = {"connections": 0, "events": 0, "sent_events": 0, "containers": 0, "inspect": 0, "stats": 0, "other": 0}
+served = [0]
+
+def containerId(i):
+  return hashlib.sha256(str(i).encode()).hexdigest()
+
+IDS = [containerId(i) for i in range(args.containers)]
+INDEX = dict((cid, i) for i, cid in enumerate(IDS))
+
+def listing():
+  return [{"Id": cid, "Names": ["/ct%d" % i], "State": "running",
+           "NetworkSettings": {"Networks": {}}} for i, cid in enumerate(IDS)]
+
+def inspect(i):
+  return {"Id": IDS[i], "Name": "/ct%d" % i,
+          "State": {"Pid": args.pid, "Status": "running", "Running": True},
+          "Config": {"Hostname": "ct%d" % i, "Env": []},
+          "HostConfig": {"Memory": 0, "CpuCount": 0, "NanoCpus": 0}}
+
+def stats(i):
+  n = int(time.time()) * (i + 1)
+  return {"cpu_stats": {"cpu_usage": {"total_usage": n * 1000}},
+          "memory_stats": {"usage": 1048576 * (i + 1), "limit": 1073741824},
+          "networks": {"eth0": {"rx_bytes": n * 100, "rx_packets": n, "rx_dropped": 0, "rx_errors": 0,
+                                "tx_bytes": n * 90, "tx_packets": n, "tx_dropped": 0, "tx_errors": 0}},
+          "blkio_stats": {"io_service_bytes_recursive": [{"op": "Read", "value": n}, {"op": "Write", "value": n}],
+                          "io_serviced_recursive": [{"op": "Read", "value": i}, {"op": "Write", "value": i}]}}
+
+def sendPieces(conn, data):
+  # dribble it out so responses get split across the client's reads
+  while data:
+    n = random.randint(1, 1500)
+    conn.sendall(data[:n])
+    data = data[n:]
+
+def respond(conn, status, body, close=False):
+  body = json.dumps(body).encode() + b"\n"
+  chunked = args.encoding == "chunked" or (args.encoding == "mixed" and random.random() < 0.5)
+  head = "HTTP/1.1 %s\r\nContent-Type: application/json\r\n" % status
+  if close:
+    head += "Connection: close\r\n"
+  if chunked:
+    out = b""
+    while body:
+      n = random.randint(1, 700)
+      out += b"%x\r\n" % len(body[:n]) + body[:n] + b"\r\n"
+      body = body[n:]
+    out += b"0\r\n\r\n"
+    head += "Transfer-Encoding: chunked\r\n\r\n"
+  else:
+    out = body
+    head += "Content-Length: %d\r\n\r\n" % len(body)
+  sendPieces(conn, head.encode() + out)
+
+def event(status, i):
+  return {"status": status, "id": IDS[i], "from": "busybox", "Type": "container", "Action": status,
+          "Actor": {"ID": IDS[i], "Attributes": {"image": "busybox", "name": "ct%d" % i}},
+          "scope": "local", "time": int(time.time()), "timeNano": time.time_ns()}
+
+def events(conn):
+  conn.sendall(b"HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n")
+  if not args.eventEvery:
+    # nothing ever happens,  but hold the feed open until the client goes
+    while conn.recv(4096):
+      pass
+    return
+  conn.settimeout(args.eventEvery)
+  while True:
+    try:
+      if not conn.recv(4096):
+        return
+    except socket.timeout:
+      i = random.randrange(len(IDS))
+      for status in ("die", "start"):
+        body = json.dumps(event(status, i)).encode() + b"\n"
+        sendPieces(conn, b"%x\r\n" % len(body) + body + b"\r\n")
+        with lock:
+          counts["sent_events"] += 1
+
+def handle(conn):
+  with lock:
+    counts["connections"] += 1
+  buf = b""
+  try:
+    while True:
+      while b"\r\n\r\n" not in buf and b"\n\n" not in buf:
+        data = conn.recv(65536)
+        if not data:
+          return
+        buf += data
+      sep = b"\r\n\r\n" if b"\r\n\r\n" in buf else b"\n\n"
+      req, buf = buf.split(sep, 1)
+      path = req.split(b"\n")[0].split(b" ")[1].decode()
+      parts = path.split("?")[0].strip("/").split("/")
+      with lock:
+        served[0] += 1
+        close = args.closeEvery and served[0] % args.closeEvery == 0
+      if parts[1:] == ["events"]:
+        with lock:
+          counts["events"] += 1
+        events(conn)
+        return
+      elif parts[1:] == ["containers", "json"]:
+        kind = "containers"
+        respond(conn, "200 OK", listing(), close)
+      elif len(parts) == 4 and parts[1] == "containers" and parts[2] in INDEX:
+        i = INDEX[parts[2]]
+        if parts[3] == "json":
+          kind = "inspect"
+          respond(conn, "200 OK", inspect(i), close)
+        else:
+          kind = "stats"
+          if args.statsDelay:
+            time.sleep(args.statsDelay)
+          respond(conn, "200 OK", stats(i), close)
+      else:
+        kind = "other"
+        respond(conn, "404 Not Found", {"message": "no such container"}, close)
+      with lock:
+        counts[kind] += 1
+      if close:
+        return
+  except (BrokenPipeError, ConnectionResetError):
+    pass
+  finally:
+    conn.close()
+
+def report():
+  while True:
+    time.sleep(args.report)
+    with lock:
+      print(" ".join("%s=%d" % kv for kv in counts.items()), flush=True)
+
+def main():
+  path = os.path.join(os.path.abspath(args.dir), "run/docker.sock")
+  os.makedirs(os.path.dirname(path), exist_ok=True)
+  if os.path.exists(path):
+    os.unlink(path)
+  srv = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+  srv.bind(path)
+  srv.listen(128)
+  print("%s: containers=%d encoding=%s" % (path, args.containers, args.encoding), flush=True)
+  threading.Thread(target=report, daemon=True).start()
+  while True:
+    conn, _ = srv.accept()
+    threading.Thread(target=handle, args=(conn,), daemon=True).start()
+
+try:
+  main()
+except KeyboardInterrupt:
+  sys.exit(0)
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+
+# Build a synthetic /proc and /sys tree for scale-testing hsflowd's
+# counter polling without a real fleet.  Point hsflowd at it with
+#   hsflowd -F proc=DIR/proc -F sys=DIR/sys ...
+#
+# Generates:
+#   proc/net/dev           --interfaces entries (eth0, eth1, ...)
+#   proc/diskstats         --disks whole-disk entries
+#   proc/<pid>/stat,statm,io  for --processes pids starting at --first-pid
+#   proc/mounts            a cgroup2 mount pointing at DIR/sys/fs/cgroup
+#   sys/fs/cgroup/system.slice/<unit>.service   --units systemd units
+#   sys/fs/cgroup/system.slice/docker-<id>.scope  --containers containers
+# Each cgroup gets cgroup.procs (pids shared out round-robin), cpu.stat,
+# memory.current, memory.max, memory.stat and io.stat in cgroup v2 format.
+# The remaining /proc files that hsflowd reads (stat, meminfo, etc.)
+# are copied from the host so the other readers still work.
+#
+# mod_systemd learns its units over D-Bus, so with --mirror-units the
+# host's own system.slice unit names are added to the tree too, which
+# lets its per-process reads resolve against the fixture pids.
+#
+# e.g. fake_fs.py --dir /tmp/fix --interfaces 50000 --units 10000
+
+import argparse
+import hashlib
+import os
+import shutil
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--dir", required=True, help="output directory (replaced if it exists)")
+parser.add_argument("--interfaces", type=int, default=100)
+parser.add_argument("--disks", type=int, default=10)
+parser.add_argument("--units", type=int, default=100, help="systemd service cgroups")
+parser.add_argument("--containers", type=int, default=100, help="container scope cgroups")
+parser.add_argument("--processes", type=int, default=1000)
+parser.add_argument("--first-pid", dest="firstPid", type=int, default=100000)
+parser.add_argument("--mirror-units", dest="mirrorUnits", action="store_true",
+  help="also create cgroups named after the host's own systemd units")
+args = parser.parse_args()
+
+HOST_PROC_FILES = ["stat", "meminfo", "loadavg", "uptime", "vmstat",
+                   "cpuinfo", "net/snmp", "net/if_inet6"]
+
+def write(path, text):
+  os.makedirs(os.path.dirname(path), exist_ok=True)
+  with open(path, "w") as f:
+    f.write(text)
+
+def netDev(proc, n):
+  lines = ["Inter-|   Receive                                                |  Transmit",
+           " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed"]
+  for i in range(n):
+    rx = 1000 * (i + 1)
+    lines.append("%8s: %d %d 0 0 0 0 0 %d %d %d 0 0 0 0 0 0"
+                 % ("eth%d" % i, rx * 1500, rx, i, rx * 1400, rx))
+  write(os.path.join(proc, "net/dev"), "\n".join(lines) + "\n")
+
+def diskStats(proc, n):
+  lines = []
+  for i in range(n):
+    name = "sd" + chr(ord("a") + i % 26) + ("" if i < 26 else str(i // 26))
+    lines.append("%4d %7d %s %d 0 %d %d %d 0 %d %d 0 %d %d 0 0 0 0 0 0"
+                 % (8, i * 16, name, i * 100, i * 800, i * 10, i * 50, i * 400, i * 5, i * 15, i * 15))
+  write(os.path.join(proc, "diskstats"), "\n".join(lines) + "\n")
+
+def processes(proc, firstPid, n):
+  for pid in range(firstPid, firstPid + n):
+    d = os.path.join(proc, str(pid))
+    # fields 14 and 15 are utime and stime (see proc(5))
+    fields = [str(pid), "(fake%d)" % pid, "S", "1"] + ["0"] * 9 + [str(pid % 1000), str(pid % 100)] + ["0"] * 37
+    write(os.path.join(d, "stat"), " ".join(fields) + "\n")
+    write(os.path.join(d, "statm"), "%d %d 100 10 0 200 0\n" % (pid % 5000 + 1000, pid % 2000 + 100))
+    write(os.path.join(d, "io"),
+          "rchar: %d\nwchar: %d\nsyscr: %d\nsyscw: %d\nread_bytes: %d\nwrite_bytes: %d\ncancelled_write_bytes: 0\n"
+          % (pid * 10, pid * 5, pid, pid // 2, pid * 4096, pid * 2048))
+
+def cgroup(path, pids, seed):
+  os.makedirs(path, exist_ok=True)
+  write(os.path.join(path, "cgroup.procs"), "".join("%d\n" % p for p in pids))
+  write(os.path.join(path, "cpu.stat"),
+        "usage_usec %d\nuser_usec %d\nsystem_usec %d\n" % (seed * 3000, seed * 2000, seed * 1000))
+  write(os.path.join(path, "memory.current"), "%d\n" % (seed * 4096 + 1048576))
+  write(os.path.join(path, "memory.max"), "max\n")
+  write(os.path.join(path, "memory.stat"), "anon %d\nfile %d\nkernel %d\n" % (seed * 4096, seed * 8192, seed * 512))
+  write(os.path.join(path, "io.stat"), "8:0 rbytes=%d wbytes=%d rios=%d wios=%d dbytes=0 dios=0\n"
+        % (seed * 4096, seed * 2048, seed, seed // 2))
+
+def hostUnits():
+  try:
+    return sorted(d for d in os.listdir("/sys/fs/cgroup/system.slice")
+                  if d.endswith(".service"))
+  except OSError:
+    return []
+
+def main():
+  top = os.path.abspath(args.dir)
+  if os.path.exists(top):
+    shutil.rmtree(top)
+  proc = os.path.join(top, "proc")
+  cgroupRoot = os.path.join(top, "sys/fs/cgroup")
+  sliceDir = os.path.join(cgroupRoot, "system.slice")
+
+  for f in HOST_PROC_FILES:
+    try:
+      with open(os.path.join("/proc", f)) as src:
+        write(os.path.join(proc, f), src.read())
+    except OSError:
+      write(os.path.join(proc, f), "")
+
+  netDev(proc, args.interfaces)
+  diskStats(proc, args.disks)
+  processes(proc, args.firstPid, args.processes)
+  write(os.path.join(proc, "mounts"),
+        "cgroup2 %s cgroup2 rw,nosuid,nodev,noexec,relatime 0 0\n" % cgroupRoot)
+
+  names = ["fake%d.service" % i for i in range(args.units)]
+  if args.mirrorUnits:
+    names += hostUnits()
+  for i in range(args.containers):
+    names.append("docker-%s.scope" % hashlib.sha256(str(i).encode()).hexdigest())
+  pids = list(range(args.firstPid, args.firstPid + args.processes))
+  for i, name in enumerate(names):
+    cgroup(os.path.join(sliceDir, name), pids[i::len(names)], i + 1)
+
+  print("%s: interfaces=%d disks=%d units=%d containers=%d processes=%d"
+        % (top, args.interfaces, args.disks, len(names) - args.containers, args.containers, args.processes))
+
+main()
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+
+# Stand-in for org.freedesktop.systemd1 on a private D-Bus,  so that
+# mod_systemd can be exercised against a fake_fs.py fixture without
+# a real systemd.  Serves just what mod_systemd asks for:
+#   ListUnits    --units running services fake0.service, fake1.service, ...
+#   GetUnit      the object path for one of those
+#   Subscribe    (no signals are ever sent)
+#   Properties.Get  ControlGroup = /system.slice/<unit>,  anything else = true
+# Each call is counted and the counts are logged to stderr after
+# every ListUnits.  Needs the jeepney module.
+#
+# e.g. fake_systemd.py --bus unix:path=/tmp/x/bus --units 20
+
+import argparse
+import sys
+
+from jeepney import MessageType, new_error, new_method_return
+from jeepney.bus_messages import message_bus
+from jeepney.io.blocking import open_dbus_connection
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--bus", required=True, help="D-Bus address to connect to")
+parser.add_argument("--units", type=int, default=20)
+args = parser.parse_args()
+
+UNIT_PATH = "/org/freedesktop/systemd1/unit/u%d"
+names = ["fake%d.service" % i for i in range(args.units)]
+
+def reply(msg):
+  member = msg.header.fields.get(3)
+  path = msg.header.fields.get(1)
+  if member == "ListUnits":
+    units = [(n, "fake", "loaded", "active", "running", "", UNIT_PATH % i, 0, "", "/")
+             for i, n in enumerate(names)]
+    return new_method_return(msg, "a(ssssssouso)", (units,))
+  if member == "GetUnit" and msg.body[0] in names:
+    return new_method_return(msg, "o", (UNIT_PATH % names.index(msg.body[0]),))
+  if member == "Subscribe":
+    return new_method_return(msg)
+  if member == "Get":
+    idx = int(path.rsplit("u", 1)[1])
+    if msg.body[1] == "ControlGroup":
+      return new_method_return(msg, "v", (("s", "/system.slice/" + names[idx]),))
+    return new_method_return(msg, "v", (("b", True),))
+  return new_error(msg, "org.freedesktop.DBus.Error.UnknownMethod")
+
+def main():
+  conn = open_dbus_connection(bus=args.bus)
+  conn.send_and_get_reply(message_bus.RequestName("org.freedesktop.systemd1"))
+  calls = {}
+  while True:
+    msg = conn.receive()
+    if msg.header.message_type != MessageType.method_call:
+      continue
+    member = msg.header.fields.get(3)
+    calls[member] = calls.get(member, 0) + 1
+    conn.send(reply(msg))
+    if member == "ListUnits":
+      print("calls %s" % calls, file=sys.stderr, flush=True)
+
+main()
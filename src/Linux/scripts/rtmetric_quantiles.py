@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+
+# Send batches of JSON rtmetric gauge values to hsflowd (with
+# json { rtmetricWindow=N }),  one batch per aggregation window,  and
+# check the _p50, _p90 and _p99 of each window's summary sample
+# against the true quantiles of that batch.  The batches are:
+#   normal     1..100
+#   spike      100 x 1000000000
+#   after      1..100 again,  which must not be lumped by the spike
+#   bigfirst   10000 followed by 1..100
+# Each batch is sent just after the previous summary arrived,  so it
+# lands in one window.  Exits with status 1 on any mismatch.
+# Used by the rtmetric_check script.
+#
+# e.g. rtmetric_quantiles.py --json-port 36343 --port 16399
+
+import argparse
+import json
+import random
+import socket
+import struct
+import sys
+import time
+
+TAG_RTMETRIC = (4300 << 12) + 1002
+RTM_STRING, RTM_COUNTER32, RTM_COUNTER64, RTM_GAUGE32, RTM_GAUGE64, RTM_FLOAT, RTM_DOUBLE = range(7)
+
+parser = argparse.ArgumentParser()
+parser.add_argument("-j", "--json-port", dest="jsonPort", type=int, default=36343,
+  help="hsflowd json UDPport")
+parser.add_argument("-p", "--port", dest="port", type=int, default=6343,
+  help="UDP port to collect sFlow on")
+parser.add_argument("-w", "--wait", dest="wait", type=float, default=30,
+  help="seconds to wait for each summary")
+parser.add_argument("-e", "--error", dest="error", type=float, default=0.03,
+  help="relative error allowed")
+args = parser.parse_args()
+
+DS = "rtmcheck"
+METRIC = "lat"
+
+def xdrString(buf, off):
+  n = struct.unpack_from(">I", buf, off)[0]
+  return buf[off + 4:off + 4 + n].decode(errors="replace"), off + 4 + ((n + 3) & ~3)
+
+def rtmValue(buf, off, mtype):
+  if mtype in (RTM_COUNTER32, RTM_GAUGE32):
+    return struct.unpack_from(">I", buf, off)[0], off + 4
+  if mtype in (RTM_COUNTER64, RTM_GAUGE64):
+    return struct.unpack_from(">Q", buf, off)[0], off + 8
+  if mtype == RTM_FLOAT:
+    return struct.unpack_from(">f", buf, off)[0], off + 4
+  if mtype == RTM_DOUBLE:
+    return struct.unpack_from(">d", buf, off)[0], off + 8
+  return xdrString(buf, off)
+
+def summaries(buf):
+  off = 4
+  addrType = struct.unpack_from(">I", buf, off)[0]
+  off += 4 + (4 if addrType == 1 else 16)
+  # sub_agent_id, sequence_number, uptime
+  off += 12
+  nSamples = struct.unpack_from(">I", buf, off)[0]
+  off += 4
+  for _ in range(nSamples):
+    tag, ln = struct.unpack_from(">II", buf, off)
+    body = buf[off + 8:off + 8 + ln]
+    off += 8 + ln
+    if tag != TAG_RTMETRIC:
+      continue
+    ds, boff = xdrString(body, 0)
+    if ds != DS:
+      continue
+    nFields = struct.unpack_from(">I", body, boff)[0]
+    boff += 4
+    fields = {}
+    for _ in range(nFields):
+      name, boff = xdrString(body, boff)
+      mtype = struct.unpack_from(">I", body, boff)[0]
+      fields[name], boff = rtmValue(body, boff + 4, mtype)
+    yield fields
+
+def waitSummary(sock):
+  end = time.time() + args.wait
+  while time.time() < end:
+    try:
+      buf, _ = sock.recvfrom(65536)
+    except socket.timeout:
+      continue
+    for fields in summaries(buf):
+      if METRIC + "_count" in fields:
+        return fields
+  return None
+
+def send(out, values):
+  for val in values:
+    msg = {"rtmetric": {"datasource": DS, METRIC: {"type": "gauge32", "value": val}}}
+    out.sendto(json.dumps(msg).encode(), ("127.0.0.1", args.jsonPort))
+
+def truth(values, q):
+  # the same rank as the sketch uses
+  return sorted(values)[int(q * (len(values) - 1))]
+
+def main():
+  sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+  sock.bind(("127.0.0.1", args.port))
+  sock.settimeout(0.5)
+  out = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+  normal = list(range(1, 101))
+  random.seed(1)
+  random.shuffle(normal)
+  batches = [
+    ("normal", normal),
+    ("spike", [1000000000] * 100),
+    ("after", normal),
+    ("bigfirst", [10000] + normal),
+  ]
+  # one value to find where the windows start
+  send(out, [1])
+  if waitSummary(sock) is None:
+    print("no rtmetric summary from hsflowd")
+    return 1
+  status = 0
+  for label, values in batches:
+    send(out, values)
+    fields = waitSummary(sock)
+    if fields is None:
+      print("%s: no summary" % label)
+      return 1
+    if fields[METRIC + "_count"] != len(values):
+      print("%s: batch split across windows (count=%d)" % (label, fields[METRIC + "_count"]))
+      return 1
+    line = label
+    for q in (50, 90, 99):
+      got = fields["%s_p%d" % (METRIC, q)]
+      want = truth(values, q / 100.0)
+      line += " p%d=%.1f (%d)" % (q, got, want)
+      if abs(got - want) > args.error * want:
+        line += " MISMATCH"
+        status = 1
+    print(line, flush=True)
+  return status
+
+sys.exit(main())
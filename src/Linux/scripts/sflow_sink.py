@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+
+# Minimal sFlow v5 collector for testing and benchmarking hsflowd.
+# Decodes datagram and sample headers, checks the datagram, flow,
+# counter and event sequence numbers for gaps, and reports received
+# samples/sec and datagram fill ratio.  Exits with status 1 if any
+# loss was detected, so it can be used to gate CI.
+#
+# e.g. with "collector { ip=127.0.0.1 udpport=6343 }" in hsflowd.conf:
+#   sflow_sink.py --port 6343 --duration 60
+
+import argparse
+import signal
+import socket
+import struct
+import sys
+import time
+
+SAMPLE_NAMES = {
+  1: "flow",
+  2: "counter",
+  3: "flow",
+  4: "counter",
+  5: "event",
+  (4300 << 12) + 1002: "rtmetric",
+  (4300 << 12) + 1003: "rtflow",
+}
+
+parser = argparse.ArgumentParser()
+parser.add_argument("-b", "--bind", dest="bind", default="127.0.0.1",
+  help="address to listen on")
+parser.add_argument("-p", "--port", dest="port", type=int, default=6343,
+  help="UDP port to listen on")
+parser.add_argument("-i", "--interval", dest="interval", type=float, default=10,
+  help="seconds between interim reports (0 = final report only)")
+parser.add_argument("-d", "--duration", dest="duration", type=float, default=0,
+  help="seconds to run for (0 = until interrupted)")
+parser.add_argument("-m", "--max-datagram", dest="maxDatagram", type=int, default=1400,
+  help="agent datagram size, for the fill ratio")
+args = parser.parse_args()
+
+class Counts:
+  def __init__(self):
+    self.datagrams = 0
+    self.bytes = 0
+    self.samples = {}
+    self.lost = {}
+    self.resets = 0
+    self.errors = 0
+
+  def bump(self, table, key, n=1):
+    table[key] = table.get(key, 0) + n
+
+total = Counts()
+interval = Counts()
+lastSeq = {}
+
+def checkSeq(key, seq):
+  # returns the number of missing sequence numbers before this one
+  prev = lastSeq.get(key)
+  lastSeq[key] = seq
+  if prev is None or seq == ((prev + 1) & 0xffffffff):
+    return 0
+  if seq <= prev:
+    # agent restarted, or the sampler/poller was re-created
+    total.resets += 1
+    interval.resets += 1
+    return 0
+  return seq - prev - 1
+
+def recordLoss(kind, n):
+  if n:
+    total.bump(total.lost, kind, n)
+    interval.bump(interval.lost, kind, n)
+
+def decode(pkt):
+  off = 0
+  def u32():
+    nonlocal off
+    val = struct.unpack_from("!I", pkt, off)[0]
+    off += 4
+    return val
+  if u32() != 5:
+    raise ValueError("not sFlow v5")
+  addrType = u32()
+  if addrType == 1:
+    agent = socket.inet_ntop(socket.AF_INET, pkt[off:off+4]); off += 4
+  elif addrType == 2:
+    agent = socket.inet_ntop(socket.AF_INET6, pkt[off:off+16]); off += 16
+  else:
+    raise ValueError("bad agent address type %d" % addrType)
+  subAgent = u32()
+  dgSeq = u32()
+  u32() # uptime
+  nSamples = u32()
+  recordLoss("datagram", checkSeq((agent, subAgent), dgSeq))
+  for i in range(nSamples):
+    tag = u32()
+    length = u32()
+    end = off + length
+    kind = SAMPLE_NAMES.get(tag, "other")
+    for c in (total, interval):
+      c.bump(c.samples, kind)
+    if tag in (1, 2):
+      seq = u32()
+      srcId = u32()
+      recordLoss(kind, checkSeq((agent, subAgent, kind, srcId >> 24, srcId & 0xffffff), seq))
+    elif tag in (3, 4, 5):
+      seq = u32()
+      dsClass = u32()
+      dsIndex = u32()
+      recordLoss(kind, checkSeq((agent, subAgent, kind, dsClass, dsIndex), seq))
+    off = end
+
+def report(c, secs, label):
+  if secs <= 0:
+    return
+  samples = sum(c.samples.values())
+  fill = (c.bytes / c.datagrams / args.maxDatagram) if c.datagrams else 0.0
+  line = "%s: secs=%.1f datagrams/s=%.1f samples/s=%.1f fill=%.3f" % (label, secs, c.datagrams / secs, samples / secs, fill)
+  for kind in sorted(c.samples):
+    line += " %s/s=%.1f" % (kind, c.samples[kind] / secs)
+  line += " lost=%s resets=%d errors=%d" % (dict(sorted(c.lost.items())) if c.lost else "{}", c.resets, c.errors)
+  print(line, flush=True)
+
+stop = False
+def onSignal(signum, frame):
+  global stop
+  stop = True
+signal.signal(signal.SIGINT, onSignal)
+signal.signal(signal.SIGTERM, onSignal)
+
+sock = socket.socket(socket.AF_INET6 if ":" in args.bind else socket.AF_INET, socket.SOCK_DGRAM)
+sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4 * 1024 * 1024)
+sock.bind((args.bind, args.port))
+sock.settimeout(0.2)
+
+start = time.monotonic()
+mark = start
+while not stop:
+  now = time.monotonic()
+  if args.duration and (now - start) >= args.duration:
+    break
+  if args.interval and (now - mark) >= args.interval:
+    report(interval, now - mark, "interval")
+    interval = Counts()
+    mark = now
+  try:
+    pkt = sock.recv(65536)
+  except socket.timeout:
+    continue
+  except InterruptedError:
+    continue
+  for c in (total, interval):
+    c.datagrams += 1
+    c.bytes += len(pkt)
+  try:
+    decode(pkt)
+  except (ValueError, struct.error):
+    total.errors += 1
+    interval.errors += 1
+
+report(total, time.monotonic() - start, "total")
+sys.exit(1 if total.lost else 0)
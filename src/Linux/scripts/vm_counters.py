@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+
+# Receive sFlow v5 counter samples and print the virtual-node ones
+# (those with a host_vrt_cpu structure: VMs,  containers,  systemd
+# units) one line per datasource,  as last seen:
+#   <class>:<index> name=<host_hid hostname> cpuTime=.. memory=.. maxMemory=..
+#     rd_req=.. rd_bytes=.. wr_req=.. wr_bytes=..
+# Exits with status 1 if fewer than --min such datasources were seen.
+# Used by the systemd_check and kvm_check scripts.
+#
+# e.g. vm_counters.py --port 16399 --duration 20 --min 10
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+HOST_HID = 2000
+HOST_VRT_CPU = 2101
+HOST_VRT_MEM = 2102
+HOST_VRT_DSK = 2103
+
+parser = argparse.ArgumentParser()
+parser.add_argument("-b", "--bind", dest="bind", default="127.0.0.1",
+  help="address to listen on")
+parser.add_argument("-p", "--port", dest="port", type=int, default=6343,
+  help="UDP port to listen on")
+parser.add_argument("-d", "--duration", dest="duration", type=float, default=20,
+  help="seconds to listen for")
+parser.add_argument("-m", "--min", dest="min", type=int, default=1,
+  help="fewest virtual datasources that count as a pass")
+args = parser.parse_args()
+
+def xdrString(buf, off):
+  n = struct.unpack_from(">I", buf, off)[0]
+  return buf[off + 4:off + 4 + n].decode(errors="replace")
+
+def counterRecords(body, off, n, rec):
+  for _ in range(n):
+    tag, ln = struct.unpack_from(">II", body, off)
+    data = body[off + 8:off + 8 + ln]
+    off += 8 + ln
+    if tag == HOST_HID:
+      rec["name"] = xdrString(data, 0)
+    elif tag == HOST_VRT_CPU:
+      rec["state"], rec["cpuTime"], rec["nrVirtCpu"] = struct.unpack_from(">III", data, 0)
+    elif tag == HOST_VRT_MEM:
+      rec["memory"], rec["maxMemory"] = struct.unpack_from(">QQ", data, 0)
+    elif tag == HOST_VRT_DSK:
+      (rec["capacity"], rec["allocation"], rec["available"],
+       rec["rd_req"], rec["rd_bytes"], rec["wr_req"], rec["wr_bytes"],
+       rec["errs"]) = struct.unpack_from(">QQQIQIQI", data, 0)
+
+def datagram(buf, seen):
+  off = 4
+  addrType = struct.unpack_from(">I", buf, off)[0]
+  off += 4 + (4 if addrType == 1 else 16)
+  # sub_agent_id, sequence_number, uptime
+  off += 12
+  nSamples = struct.unpack_from(">I", buf, off)[0]
+  off += 4
+  for _ in range(nSamples):
+    tag, ln = struct.unpack_from(">II", buf, off)
+    body = buf[off + 8:off + 8 + ln]
+    off += 8 + ln
+    if tag == 2:
+      sourceId, nRecs = struct.unpack_from(">II", body, 4)
+      ds = (sourceId >> 24, sourceId & 0xffffff)
+      recOff = 12
+    elif tag == 4:
+      dsClass, dsIndex, nRecs = struct.unpack_from(">III", body, 4)
+      ds = (dsClass, dsIndex)
+      recOff = 16
+    else:
+      continue
+    rec = {}
+    counterRecords(body, recOff, nRecs, rec)
+    if "cpuTime" in rec:
+      seen[ds] = rec
+
+def main():
+  sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+  sock.bind((args.bind, args.port))
+  sock.settimeout(0.5)
+  seen = {}
+  end = time.time() + args.duration
+  while time.time() < end:
+    try:
+      buf, _ = sock.recvfrom(65536)
+    except socket.timeout:
+      continue
+    try:
+      datagram(buf, seen)
+    except struct.error:
+      print("truncated datagram", file=sys.stderr)
+  for ds in sorted(seen):
+    rec = seen[ds]
+    print("%d:%d name=%s cpuTime=%d memory=%d maxMemory=%d rd_req=%d rd_bytes=%d wr_req=%d wr_bytes=%d"
+          % (ds[0], ds[1], rec.get("name", "-"), rec["cpuTime"],
+             rec.get("memory", 0), rec.get("maxMemory", 0),
+             rec.get("rd_req", 0), rec.get("rd_bytes", 0),
+             rec.get("wr_req", 0), rec.get("wr_bytes", 0)))
+  return 0 if len(seen) >= args.min else 1
+
+sys.exit(main())
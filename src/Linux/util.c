@@ -522,6 +522,173 @@ extern "C" {
     return atEOF ? EOF : count;
   }
 
+  /*_________________---------------------------__________________
+    _________________     UTProcFile            __________________
+    -----------------___________________________------------------
+    Keep a /proc (or /sys) file open and re-read it with pread()
+    from offset 0 on each poll.  The kernel regenerates the content
+    for each read at offset 0, so this sees fresh numbers without the
+    open/fstat/close and stdio buffering of fopen().  If the read
+    fails the fd is closed and we try to re-open next time.
+  */
+
+  UTProcFile *UTProcFileNew(char *path, size_t bufLen, size_t maxLen) {
+    UTProcFile *pf = (UTProcFile *)my_calloc(sizeof(UTProcFile));
+    pf->path = my_strdup(path);
+    pf->fd = -1;
+    pf->cap = bufLen;
+    pf->maxLen = maxLen;
+    pf->buf = (char *)my_calloc(pf->cap);
+    return pf;
+  }
+
+  static void procFileClose(UTProcFile *pf) {
+    if(pf->fd >= 0) {
+      close(pf->fd);
+      pf->fd = -1;
+    }
+  }
+
+  bool UTProcFileRead(UTProcFile *pf) {
+    if(pf->batchReady
+       && pf->batchGen == pf->batch->gen) {
+      // already read this round by UTBatchReadRun()
+      pf->batchReady = NO;
+      pf->cursor = pf->buf;
+      return YES;
+    }
+    if(pf->batchReady)
+      pf->batch->missed++;
+    pf->batchReady = NO;
+    pf->len = 0;
+    pf->buf[0] = '\0';
+    pf->cursor = pf->buf;
+    pf->truncated = NO;
+    if(pf->fd < 0) {
+      pf->fd = open(pf->path, O_RDONLY | O_CLOEXEC);
+      if(pf->fd < 0)
+	return NO;
+    }
+    for(;;) {
+      ssize_t cc = pread(pf->fd, pf->buf + pf->len, pf->cap - pf->len - 1, pf->len);
+      if(cc < 0) {
+	if(errno == EINTR)
+	  continue;
+	myDebug(1, "UTProcFileRead(%s) failed : %s", pf->path, strerror(errno));
+	procFileClose(pf);
+	return NO;
+      }
+      if(cc == 0)
+	break;
+      pf->len += cc;
+      if(pf->len == (pf->cap - 1)) {
+	// buffer full - grow it and keep going, unless capped
+	if(pf->maxLen
+	   && pf->cap >= pf->maxLen) {
+	  pf->truncated = YES;
+	  break;
+	}
+	pf->cap *= 2;
+	pf->buf = (char *)my_realloc(pf->buf, pf->cap);
+	pf->cursor = pf->buf;
+      }
+    }
+    pf->buf[pf->len] = '\0';
+    return YES;
+  }
+
+  char *UTProcFileLine(UTProcFile *pf) {
+    char *line = pf->cursor;
+    if(line == NULL
+       || line >= (pf->buf + pf->len))
+      return NULL;
+    char *eol = memchr(line, '\n', (pf->buf + pf->len) - line);
+    if(eol) {
+      *eol = '\0';
+      pf->cursor = eol + 1;
+    }
+    else {
+      // last line has no newline. If the read was capped it
+      // is probably incomplete, so leave it out.
+      if(pf->truncated)
+	return NULL;
+      pf->cursor = pf->buf + pf->len;
+    }
+    return line;
+  }
+
+  void UTProcFileFree(UTProcFile *pf) {
+    procFileClose(pf);
+    my_free(pf->path);
+    my_free(pf->buf);
+    my_free(pf);
+  }
+
+  /*_________________---------------------------__________________
+    _________________     UTBatchRead           __________________
+    -----------------___________________________------------------
+    Files are only referenced between UTBatchReadAdd() and the end
+    of UTBatchReadRun(),  so the owners are free to close them at
+    any other time.
+  */
+
+  UTBatchRead *UTBatchReadNew(void) {
+    UTBatchRead *br = (UTBatchRead *)my_calloc(sizeof(UTBatchRead));
+    br->files = UTArrayNew(UTARRAY_DFLT);
+    br->gen = 1;
+    return br;
+  }
+
+  void UTBatchReadAdd(UTBatchRead *br, UTProcFile *pf) {
+    if(pf->batch == br
+       && pf->batchGen == br->gen)
+      return; // already in this round
+    if(pf->fd < 0) {
+      pf->fd = open(pf->path, O_RDONLY | O_CLOEXEC);
+      if(pf->fd < 0)
+	return; // leave it to the owner's UTProcFileRead()
+    }
+    pf->batch = br;
+    pf->batchGen = br->gen;
+    pf->batchReady = NO;
+    UTArrayAdd(br->files, pf);
+  }
+
+  static void batchRead(UTBatchRead *br, UTProcFile *pf) {
+    br->reads++;
+    if(UTProcFileRead(pf))
+      pf->batchReady = YES;
+  }
+
+  // Read everything added since the last call.  Returns the number
+  // of files now waiting for their UTProcFileRead().
+  uint32_t UTBatchReadRun(UTBatchRead *br) {
+    uint32_t nFiles = UTArrayN(br->files);
+    if(nFiles == 0)
+      return 0;
+    br->batches++;
+    for(uint32_t ii = 0; ii < nFiles; ii++)
+      batchRead(br, (UTProcFile *)UTArrayAt(br->files, ii));
+    uint32_t ready = 0;
+    for(uint32_t ii = 0; ii < nFiles; ii++) {
+      if(((UTProcFile *)UTArrayAt(br->files, ii))->batchReady)
+	ready++;
+    }
+    UTArrayReset(br->files);
+    return ready;
+  }
+
+  // end of round: anything read but not consumed is now stale
+  void UTBatchReadDone(UTBatchRead *br) {
+    UTArrayReset(br->files);
+    br->gen++;
+  }
+
+  void UTBatchReadFree(UTBatchRead *br) {
+    UTArrayFree(br->files);
+    my_free(br);
+  }
+
   /*_________________---------------------------__________________
     _________________     setStr                __________________
     -----------------___________________________------------------
@@ -1873,7 +2040,7 @@ static uint32_t hashSearch(UTHash *oh, void *obj, void **found) {
     }
   }
 
-  int UTSocketUDP(char *bindaddr, int family, uint16_t port, int bufferSize)
+  static int socketUDP(char *bindaddr, int family, uint16_t port, int bufferSize, bool reusePort)
   {
     struct sockaddr_in myaddr_in = { 0 };
     struct sockaddr_in6 myaddr_in6 = { 0 };
@@ -1902,6 +2069,17 @@ static uint32_t hashSearch(UTHash *oh, void *obj, void **found) {
       myLog(LOG_ERR, "ULOG fcntl(F_SETFD=FD_CLOEXEC) failed: %s", strerror(errno));
     }
 
+    // allow several sockets to share the port,  with the kernel
+    // spreading the senders across them
+    if(reusePort) {
+      int one = 1;
+      if(setsockopt(soc, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+	myLog(LOG_ERR, "setsockopt(SO_REUSEPORT) failed: %s", strerror(errno));
+	close(soc);
+	return 0;
+      }
+    }
+
     // lookup bind address
     struct sockaddr *psockaddr = (family == PF_INET6) ?
       (struct sockaddr *)&myaddr_in6 :
@@ -1932,6 +2110,14 @@ static uint32_t hashSearch(UTHash *oh, void *obj, void **found) {
     return soc;
   }
 
+  int UTSocketUDP(char *bindaddr, int family, uint16_t port, int bufferSize) {
+    return socketUDP(bindaddr, family, port, bufferSize, NO);
+  }
+
+  int UTSocketUDPReusePort(char *bindaddr, int family, uint16_t port, int bufferSize) {
+    return socketUDP(bindaddr, family, port, bufferSize, YES);
+  }
+
   int UTUnixDomainSocket(char *path) {
     struct sockaddr_un addr;
     int fd = socket(AF_UNIX, SOCK_STREAM, 0);
@@ -215,6 +215,117 @@ extern "C" {
   // tokenizer
   char *parseNextTok(char **str, char *sep, int delim, char quot, int trim, char *buf, int buflen);
 
+  // persistent /proc reader: the fd stays open and each read is a
+  // pread() from offset 0 into a buffer that is reused (and only
+  // grows, up to maxLen if that is non-zero).  UTProcFileLine()
+  // then walks the lines in place, terminating each one.
+  typedef struct _UTProcFile {
+    char *path;
+    int fd;
+    char *buf;
+    size_t cap;
+    size_t maxLen;
+    size_t len;
+    char *cursor;
+    bool truncated;
+    // set when a UTBatchRead has already filled buf for
+    // this round,  so the next UTProcFileRead() just uses it
+    struct _UTBatchRead *batch;
+    uint32_t batchGen;
+    bool batchReady;
+  } UTProcFile;
+
+  UTProcFile *UTProcFileNew(char *path, size_t bufLen, size_t maxLen);
+  bool UTProcFileRead(UTProcFile *pf);
+  char *UTProcFileLine(UTProcFile *pf);
+  void UTProcFileFree(UTProcFile *pf);
+
+  // batch reader: collect the UTProcFiles that are about to be read,
+  // read them all in one go,  then let the owners call
+  // UTProcFileRead() as usual.  UTBatchReadDone() ends
+  // the round,  discarding anything that was read but not used.
+  typedef struct _UTBatchRead {
+    UTArray *files;
+    uint32_t gen;
+    uint64_t batches;
+    uint64_t reads;
+    uint64_t missed; // read in a batch,  but the round ended before it was used
+  } UTBatchRead;
+
+  UTBatchRead *UTBatchReadNew(void);
+  void UTBatchReadAdd(UTBatchRead *br, UTProcFile *pf);
+  uint32_t UTBatchReadRun(UTBatchRead *br);
+  void UTBatchReadDone(UTBatchRead *br);
+  void UTBatchReadFree(UTBatchRead *br);
+
+  // scanf-free numeric tokenizer for the lines UTProcFileLine() returns.
+  // Each call skips blanks, then consumes one field and advances *str.
+  // They return NO (and leave *str alone) if the next field does not
+  // start with a digit, so a short line stops the parse cleanly.
+#define UT_ISBLANK(c) ((c) == ' ' || (c) == '\t')
+#define UT_ISDIGIT(c) ((unsigned)((c) - '0') <= 9)
+
+  static inline bool UTNextU64(char **str, uint64_t *val) {
+    char *p = *str;
+    while(UT_ISBLANK(*p)) p++;
+    if(!UT_ISDIGIT(*p))
+      return NO;
+    uint64_t v = 0;
+    for(; UT_ISDIGIT(*p); p++)
+      v = (v * 10) + (*p - '0');
+    *val = v;
+    *str = p;
+    return YES;
+  }
+
+  static inline bool UTNextI64(char **str, int64_t *val) {
+    char *p = *str;
+    while(UT_ISBLANK(*p)) p++;
+    bool neg = (*p == '-');
+    char *q = p + neg;
+    uint64_t v;
+    if(!UTNextU64(&q, &v))
+      return NO;
+    *val = neg ? -(int64_t)v : (int64_t)v;
+    *str = q;
+    return YES;
+  }
+
+  // plain decimals only ("123.45"), as in /proc/loadavg and /proc/uptime
+  static inline bool UTNextDouble(char **str, double *val) {
+    char *p = *str;
+    uint64_t ipart, fpart = 0;
+    if(!UTNextU64(&p, &ipart))
+      return NO;
+    double scale = 1.0;
+    if(*p == '.') {
+      for(p++; UT_ISDIGIT(*p); p++) {
+	if(scale < 1e18) {
+	  fpart = (fpart * 10) + (*p - '0');
+	  scale *= 10.0;
+	}
+      }
+    }
+    *val = (double)ipart + ((double)fpart / scale);
+    *str = p;
+    return YES;
+  }
+
+  // next blank-separated token, terminated in place (so the line is
+  // modified).  Returns NULL at end of line.
+  static inline char *UTNextTok(char **str) {
+    char *p = *str;
+    while(UT_ISBLANK(*p)) p++;
+    if(*p == '\0')
+      return NULL;
+    char *tok = p;
+    while(*p && !UT_ISBLANK(*p)) p++;
+    if(*p)
+      *p++ = '\0';
+    *str = p;
+    return tok;
+  }
+
   // sleep
   void my_usleep(uint32_t microseconds);
 
@@ -246,6 +357,7 @@ extern "C" {
   // sockets
   void UTSocketRcvbuf(int fd, int requested);
   int UTSocketUDP(char *bindaddr, int family, uint16_t port, int bufferSize);
+  int UTSocketUDPReusePort(char *bindaddr, int family, uint16_t port, int bufferSize);
   int UTUnixDomainSocket(char *path);
 
   // SFLAddress utils
@@ -318,10 +430,8 @@ extern "C" {
     (obj)->next = (q).head;			\
     (obj)->prev = NULL;				\
     if((q).head) (q).head->prev = (obj);	\
-    else {					\
-      (q).tail = (obj);				\
-      (q).head = (obj);				\
-    }						\
+    else (q).tail = (obj);			\
+    (q).head = (obj);				\
   } while(0)
 
 #define UTQ_ADD_TAIL(q, obj)			\
@@ -0,0 +1,311 @@
+/* This software is distributed under the following license:
+ * http://sflow.net/license.html
+ */
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "util_containerd.h"
+
+  struct _UTCtrdReader {
+    UTCtrdRecordCB recordCB;
+    void *magic;
+    EnumUTCtrdMode mode;
+    UTHash *byHandle;
+    // a frame that was split across reads
+    u_char *frame;
+    uint32_t pending;
+    uint32_t frameLen;
+    uint32_t frameRecs;
+    bool gotHdr:1;
+    char *error;
+  };
+
+  // a bounds-checked cursor over one record
+  typedef struct _UTCtrdCursor {
+    u_char *p;
+    u_char *end;
+    bool err;
+  } UTCtrdCursor;
+
+  static uint32_t get16(UTCtrdCursor *c) {
+    if(c->err || (c->end - c->p) < 2) {
+      c->err = YES;
+      return 0;
+    }
+    uint32_t val = ((uint32_t)c->p[0] << 8) | c->p[1];
+    c->p += 2;
+    return val;
+  }
+
+  static uint32_t get32(UTCtrdCursor *c) {
+    if(c->err || (c->end - c->p) < 4) {
+      c->err = YES;
+      return 0;
+    }
+    uint32_t val;
+    memcpy(&val, c->p, 4);
+    c->p += 4;
+    return ntohl(val);
+  }
+
+  static uint64_t get64(UTCtrdCursor *c) {
+    uint64_t hi = get32(c);
+    return (hi << 32) | get32(c);
+  }
+
+  static void getStr(UTCtrdCursor *c, char **p_str) {
+    uint32_t len = get16(c);
+    if(c->err || (c->end - c->p) < len) {
+      c->err = YES;
+      return;
+    }
+    // the names rarely change,  so only reallocate when they do
+    if(*p_str == NULL
+       || strlen(*p_str) != len
+       || memcmp(*p_str, c->p, len) != 0) {
+      if(*p_str)
+	my_free(*p_str);
+      *p_str = my_calloc(len + 1);
+      memcpy(*p_str, c->p, len);
+    }
+    c->p += len;
+  }
+
+  /*_________________---------------------------__________________
+    _________________      containers           __________________
+    -----------------___________________________------------------
+  */
+
+  static UTCtrdContainer *getContainer(UTCtrdReader *rdr, uint32_t handle, bool create) {
+    UTCtrdContainer search = { .handle = handle };
+    UTCtrdContainer *ctr = UTHashGet(rdr->byHandle, &search);
+    if(ctr == NULL
+       && create) {
+      ctr = my_calloc(sizeof(UTCtrdContainer));
+      ctr->handle = handle;
+      UTHashAdd(rdr->byHandle, ctr);
+    }
+    return ctr;
+  }
+
+  static void freeContainer(UTCtrdContainer *ctr) {
+    char **strs[] = { &ctr->id, &ctr->hostname, &ctr->containerName, &ctr->containerType,
+		      &ctr->sandboxName, &ctr->sandboxNamespace, &ctr->cgroupsPath,
+		      &ctr->image, &ctr->imageName, &ctr->gpus };
+    for(int ii = 0; ii < sizeof(strs) / sizeof(strs[0]); ii++) {
+      if(*strs[ii])
+	my_free(*strs[ii]);
+    }
+    my_free(ctr);
+  }
+
+  /*_________________---------------------------__________________
+    _________________      records              __________________
+    -----------------___________________________------------------
+  */
+
+  static void readContainerRec(UTCtrdReader *rdr, UTCtrdCursor *c) {
+    uint32_t handle = get32(c);
+    uint32_t pid = get32(c);
+    if(c->err)
+      return;
+    UTCtrdContainer *ctr = getContainer(rdr, handle, YES);
+    ctr->pid = (pid_t)pid;
+    getStr(c, &ctr->id);
+    getStr(c, &ctr->hostname);
+    getStr(c, &ctr->containerName);
+    getStr(c, &ctr->containerType);
+    getStr(c, &ctr->sandboxName);
+    getStr(c, &ctr->sandboxNamespace);
+    getStr(c, &ctr->cgroupsPath);
+    getStr(c, &ctr->image);
+    getStr(c, &ctr->imageName);
+    getStr(c, &ctr->gpus);
+    if(c->err) {
+      // keep the container (we have the handle),  but never hand
+      // out a NULL string
+      char **strs[] = { &ctr->id, &ctr->hostname, &ctr->containerName, &ctr->containerType,
+			&ctr->sandboxName, &ctr->sandboxNamespace, &ctr->cgroupsPath,
+			&ctr->image, &ctr->imageName, &ctr->gpus };
+      for(int ii = 0; ii < sizeof(strs) / sizeof(strs[0]); ii++) {
+	if(*strs[ii] == NULL)
+	  *strs[ii] = my_calloc(1);
+      }
+      return;
+    }
+    (*rdr->recordCB)(rdr->magic, UTCTRD_REC_CONTAINER, ctr);
+  }
+
+  static void readStatsRec(UTCtrdReader *rdr, UTCtrdCursor *c) {
+    uint32_t handle = get32(c);
+    uint32_t mask = get32(c);
+    if(c->err)
+      return;
+    UTCtrdContainer *ctr = getContainer(rdr, handle, NO);
+    if(ctr == NULL
+       || ctr->id == NULL) {
+      // stats before the CONTAINER record?
+      myDebug(1, "UTCtrd: stats for unknown handle %u", handle);
+      return;
+    }
+    if(mask & UTCTRD_STAT(UTCTRD_STAT_STATE)) ctr->state = get32(c);
+    if(mask & UTCTRD_STAT(UTCTRD_STAT_CPUTIME)) ctr->cpuTime = get64(c);
+    if(mask & UTCTRD_STAT(UTCTRD_STAT_CPUCOUNT)) ctr->cpuCount = get32(c);
+    if(mask & UTCTRD_STAT(UTCTRD_STAT_MEMORY)) ctr->memory = get64(c);
+    if(mask & UTCTRD_STAT(UTCTRD_STAT_MAXMEMORY)) ctr->maxMemory = get64(c);
+    if(mask & UTCTRD_STAT(UTCTRD_STAT_RD_REQ)) ctr->rd_req = get32(c);
+    if(mask & UTCTRD_STAT(UTCTRD_STAT_RD_BYTES)) ctr->rd_bytes = get64(c);
+    if(mask & UTCTRD_STAT(UTCTRD_STAT_WR_REQ)) ctr->wr_req = get32(c);
+    if(mask & UTCTRD_STAT(UTCTRD_STAT_WR_BYTES)) ctr->wr_bytes = get64(c);
+    if(mask & UTCTRD_STAT(UTCTRD_STAT_ERRS)) ctr->errs = get32(c);
+    if(c->err)
+      return;
+    // bits we don't know about must come after the ones we do,
+    // so anything left over can be ignored
+    ctr->statsMask |= (mask & ((1 << UTCTRD_STAT_NUM) - 1));
+    (*rdr->recordCB)(rdr->magic, UTCTRD_REC_STATS, ctr);
+  }
+
+  static void readGoneRec(UTCtrdReader *rdr, UTCtrdCursor *c) {
+    uint32_t handle = get32(c);
+    if(c->err)
+      return;
+    UTCtrdContainer *ctr = getContainer(rdr, handle, NO);
+    if(ctr) {
+      if(ctr->id)
+	(*rdr->recordCB)(rdr->magic, UTCTRD_REC_GONE, ctr);
+      UTHashDel(rdr->byHandle, ctr);
+      freeContainer(ctr);
+    }
+  }
+
+  static void readFrame(UTCtrdReader *rdr, u_char *buf, uint32_t len, uint32_t nRecs) {
+    UTCtrdCursor frame = { .p = buf, .end = buf + len };
+    for(uint32_t ii = 0; ii < nRecs; ii++) {
+      uint32_t recType = get16(&frame);
+      uint32_t recLen = get16(&frame);
+      if(frame.err
+	 || (frame.end - frame.p) < recLen) {
+	myDebug(1, "UTCtrd: record %u of %u overruns frame", ii, nRecs);
+	return;
+      }
+      UTCtrdCursor rec = { .p = frame.p, .end = frame.p + recLen };
+      switch(recType) {
+      case UTCTRD_REC_CONTAINER: readContainerRec(rdr, &rec); break;
+      case UTCTRD_REC_STATS: readStatsRec(rdr, &rec); break;
+      case UTCTRD_REC_GONE: readGoneRec(rdr, &rec); break;
+      default: break;
+      }
+      if(rec.err)
+	myDebug(1, "UTCtrd: short record type=%u len=%u", recType, recLen);
+      frame.p += recLen;
+    }
+  }
+
+  static bool readFrameHdr(UTCtrdReader *rdr, u_char *buf) {
+    UTCtrdCursor c = { .p = buf, .end = buf + HSP_CTRD_FRAME_HDR };
+    uint32_t magic = get32(&c);
+    uint32_t version = get16(&c);
+    rdr->frameRecs = get16(&c);
+    rdr->frameLen = get32(&c);
+    if(magic != HSP_CTRD_FRAME_MAGIC)
+      rdr->error = "bad frame magic";
+    else if(version != HSP_CTRD_FRAME_VERSION)
+      rdr->error = "unsupported frame version";
+    else if(rdr->frameLen > HSP_CTRD_MAX_FRAME)
+      rdr->error = "frame too long";
+    return (rdr->error == NULL);
+  }
+
+  /*_________________---------------------------__________________
+    _________________      UTCtrdFeed           __________________
+    -----------------___________________________------------------
+    Whole frames are decoded straight from the caller's buffer.  Only
+    a frame that is split across reads is copied,  into rdr->frame.
+    Once the framing is lost there is no way to find it again,  so an
+    error is sticky (the helper and hsflowd are built together,  so it
+    means a bug).
+  */
+
+  bool UTCtrdFeed(UTCtrdReader *rdr, char *buf, size_t len) {
+    u_char *p = (u_char *)buf;
+    while(len > 0
+	  && rdr->error == NULL) {
+      if(rdr->pending == 0
+	 && len >= HSP_CTRD_FRAME_HDR) {
+	if(!readFrameHdr(rdr, p))
+	  break;
+	uint32_t frameBytes = HSP_CTRD_FRAME_HDR + rdr->frameLen;
+	if(len >= frameBytes) {
+	  readFrame(rdr, p + HSP_CTRD_FRAME_HDR, rdr->frameLen, rdr->frameRecs);
+	  p += frameBytes;
+	  len -= frameBytes;
+	  continue;
+	}
+      }
+      // accumulate the header,  then the rest of the frame
+      uint32_t want = rdr->gotHdr
+	? (HSP_CTRD_FRAME_HDR + rdr->frameLen - rdr->pending)
+	: (HSP_CTRD_FRAME_HDR - rdr->pending);
+      uint32_t take = (len < want) ? len : want;
+      memcpy(rdr->frame + rdr->pending, p, take);
+      rdr->pending += take;
+      p += take;
+      len -= take;
+      if(!rdr->gotHdr
+	 && rdr->pending == HSP_CTRD_FRAME_HDR) {
+	if(!readFrameHdr(rdr, rdr->frame))
+	  break;
+	rdr->gotHdr = YES;
+      }
+      if(rdr->gotHdr
+	 && rdr->pending == (HSP_CTRD_FRAME_HDR + rdr->frameLen)) {
+	readFrame(rdr, rdr->frame + HSP_CTRD_FRAME_HDR, rdr->frameLen, rdr->frameRecs);
+	rdr->pending = 0;
+	rdr->gotHdr = NO;
+      }
+    }
+    return (rdr->error == NULL);
+  }
+
+  // An older helper ignores HSP_CTRD_FRAMES_ENV and writes text,  which
+  // always starts with "data>" or "debug>",  so the first byte tells.
+  EnumUTCtrdMode UTCtrdMode(UTCtrdReader *rdr, char *buf, size_t len) {
+    if(rdr->mode == UTCTRD_MODE_UNKNOWN
+       && len > 0) {
+      rdr->mode = ((u_char)buf[0] == (HSP_CTRD_FRAME_MAGIC >> 24))
+	? UTCTRD_MODE_FRAMES
+	: UTCTRD_MODE_TEXT;
+      myDebug(1, "UTCtrd: helper is writing %s",
+	      rdr->mode == UTCTRD_MODE_FRAMES ? "frames" : "text");
+    }
+    return rdr->mode;
+  }
+
+  char *UTCtrdError(UTCtrdReader *rdr) {
+    return rdr->error;
+  }
+
+  UTCtrdReader *UTCtrdNew(UTCtrdRecordCB recordCB, void *magic) {
+    UTCtrdReader *rdr = my_calloc(sizeof(UTCtrdReader));
+    rdr->recordCB = recordCB;
+    rdr->magic = magic;
+    rdr->byHandle = UTHASH_NEW(UTCtrdContainer, handle, UTHASH_DFLT);
+    rdr->frame = my_calloc(HSP_CTRD_FRAME_HDR + HSP_CTRD_MAX_FRAME);
+    return rdr;
+  }
+
+  void UTCtrdFree(UTCtrdReader *rdr) {
+    UTCtrdContainer *ctr;
+    UTHASH_WALK(rdr->byHandle, ctr)
+      freeContainer(ctr);
+    UTHashFree(rdr->byHandle);
+    my_free(rdr->frame);
+    my_free(rdr);
+  }
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
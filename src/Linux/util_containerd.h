@@ -0,0 +1,136 @@
+/* This software is distributed under the following license:
+ * http://sflow.net/license.html
+ */
+
+#ifndef UTIL_CONTAINERD_H
+#define UTIL_CONTAINERD_H 1
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "util.h"
+
+  /*_________________---------------------------__________________
+    _________________  hsflowd_containerd frames __________________
+    -----------------___________________________------------------
+    When hsflowd_containerd finds HSP_CTRD_FRAMES_ENV in its
+    environment it writes length-prefixed binary frames on stdout
+    instead of "data>" JSON lines (and sends its debug output to
+    stderr).  Everything is in network byte order.  A frame is
+
+      u32 magic        HSP_CTRD_FRAME_MAGIC
+      u16 version      HSP_CTRD_FRAME_VERSION
+      u16 records
+      u32 length       bytes of records that follow
+
+    and each record is
+
+      u16 type         EnumUTCtrdRec
+      u16 length       bytes of body that follow
+
+    CONTAINER  u32 handle,  u32 pid,  then ten strings,  each a u16
+               length and the bytes:  id,  hostname,  containerName,
+               containerType,  sandboxName,  sandboxNamespace,
+               cgroupsPath,  image,  imageName,  gpus (the value of
+               NVIDIA_VISIBLE_DEVICES).  Sent when the container is
+               first seen and again if any of these change.
+    STATS      u32 handle,  u32 mask,  then the fields in the mask
+               (EnumUTCtrdStat) in bit order.  Only the fields that
+               changed since the last STATS for this handle are sent;
+               the reader keeps the rest,  so every callback sees the
+               full set.  One is sent for every poll,  even if nothing
+               changed.
+    GONE       u32 handle.  The container was deleted.
+
+    Unknown record types,  and trailing bytes in a known record,  are
+    skipped so that fields can be added later without a version bump.
+    The handle is assigned by the helper and stands in for the id
+    after the CONTAINER record.
+  */
+
+#define HSP_CTRD_FRAMES_ENV "HSFLOWD_CONTAINERD_FRAMES=1"
+#define HSP_CTRD_FRAME_MAGIC 0x68736364 // "hscd"
+#define HSP_CTRD_FRAME_VERSION 1
+#define HSP_CTRD_FRAME_HDR 12
+#define HSP_CTRD_MAX_FRAME 65536
+#define HSP_CTRD_REC_HDR 4
+#define HSP_CTRD_MAX_STR 4096
+
+  typedef enum {
+    UTCTRD_REC_CONTAINER=1,
+    UTCTRD_REC_STATS,
+    UTCTRD_REC_GONE
+  } EnumUTCtrdRec;
+
+  typedef enum {
+    UTCTRD_STAT_STATE=0,  // u32 SFLVirDomainState
+    UTCTRD_STAT_CPUTIME,  // u64 nS
+    UTCTRD_STAT_CPUCOUNT, // u32
+    UTCTRD_STAT_MEMORY,   // u64
+    UTCTRD_STAT_MAXMEMORY,// u64
+    UTCTRD_STAT_RD_REQ,   // u32
+    UTCTRD_STAT_RD_BYTES, // u64
+    UTCTRD_STAT_WR_REQ,   // u32
+    UTCTRD_STAT_WR_BYTES, // u64
+    UTCTRD_STAT_ERRS,     // u32
+    UTCTRD_STAT_NUM
+  } EnumUTCtrdStat;
+
+#define UTCTRD_STAT(s) (1 << (s))
+#define UTCTRD_STAT_CPU (UTCTRD_STAT(UTCTRD_STAT_STATE) | UTCTRD_STAT(UTCTRD_STAT_CPUTIME) | UTCTRD_STAT(UTCTRD_STAT_CPUCOUNT))
+#define UTCTRD_STAT_MEM (UTCTRD_STAT(UTCTRD_STAT_MEMORY) | UTCTRD_STAT(UTCTRD_STAT_MAXMEMORY))
+#define UTCTRD_STAT_DSK (UTCTRD_STAT(UTCTRD_STAT_RD_REQ) | UTCTRD_STAT(UTCTRD_STAT_RD_BYTES) \
+			 | UTCTRD_STAT(UTCTRD_STAT_WR_REQ) | UTCTRD_STAT(UTCTRD_STAT_WR_BYTES) \
+			 | UTCTRD_STAT(UTCTRD_STAT_ERRS))
+
+  // what the reader knows about one container.  The strings are
+  // owned by the reader and are never NULL.
+  typedef struct _UTCtrdContainer {
+    uint32_t handle;
+    char *id;
+    pid_t pid;
+    char *hostname;
+    char *containerName;
+    char *containerType;
+    char *sandboxName;
+    char *sandboxNamespace;
+    char *cgroupsPath;
+    char *image;
+    char *imageName;
+    char *gpus;
+    uint32_t statsMask; // stats received so far
+    uint32_t state;
+    uint64_t cpuTime;
+    uint32_t cpuCount;
+    uint64_t memory;
+    uint64_t maxMemory;
+    uint32_t rd_req;
+    uint64_t rd_bytes;
+    uint32_t wr_req;
+    uint64_t wr_bytes;
+    uint32_t errs;
+  } UTCtrdContainer;
+
+  typedef enum {
+    UTCTRD_MODE_UNKNOWN=0,
+    UTCTRD_MODE_TEXT,  // an older helper,  writing "data>" lines
+    UTCTRD_MODE_FRAMES
+  } EnumUTCtrdMode;
+
+  // called for each record.  For GONE the container is freed on return.
+  typedef void (*UTCtrdRecordCB)(void *magic, EnumUTCtrdRec recType, UTCtrdContainer *ctr);
+
+  typedef struct _UTCtrdReader UTCtrdReader;
+
+  UTCtrdReader *UTCtrdNew(UTCtrdRecordCB recordCB, void *magic);
+  void UTCtrdFree(UTCtrdReader *rdr);
+  EnumUTCtrdMode UTCtrdMode(UTCtrdReader *rdr, char *buf, size_t len);
+  bool UTCtrdFeed(UTCtrdReader *rdr, char *buf, size_t len);
+  char *UTCtrdError(UTCtrdReader *rdr);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+#endif /* UTIL_CONTAINERD_H */
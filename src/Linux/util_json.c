@@ -0,0 +1,565 @@
+/* This software is distributed under the following license:
+ * http://sflow.net/license.html
+ */
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "util_json.h"
+
+  typedef enum {
+    UTJSON_S_VALUE=0,   // expecting a value (or whitespace between documents)
+    UTJSON_S_FIRST_KEY, // after '{'
+    UTJSON_S_KEY,       // after ',' in an object
+    UTJSON_S_COLON,
+    UTJSON_S_FIRST_ELEM,// after '['
+    UTJSON_S_AFTER,     // after a value inside a container
+    UTJSON_S_STRING,
+    UTJSON_S_ESCAPE,
+    UTJSON_S_UNICODE,
+    UTJSON_S_NUMBER,
+    UTJSON_S_LITERAL,
+    UTJSON_S_ERROR
+  } EnumUTJSONState;
+
+  typedef struct _UTJSONPath {
+    uint32_t nComp;
+    char **comp;
+  } UTJSONPath;
+
+  typedef struct _UTJSONFrame {
+    uint64_t mask; // fields that matched the path to this container
+    bool isArray;
+  } UTJSONFrame;
+
+  struct _UTJSONParser {
+    UTJSONPath fields[UTJSON_MAX_FIELDS];
+    uint32_t nFields;
+    // fields by path length,  so the per-value tests are one AND
+    uint64_t atLevel[UTJSON_MAX_DEPTH + 1];
+    uint64_t belowLevel[UTJSON_MAX_DEPTH + 1];
+    UTJSONFieldCB fieldCB;
+    void *magic;
+    EnumUTJSONState state;
+    UTJSONFrame stack[UTJSON_MAX_DEPTH];
+    uint32_t depth;
+    uint64_t valMask; // fields that the next value is on the path to
+    bool inDoc:1;
+    bool inKey:1;
+    bool capture:1;
+    bool haveKey:1;
+    UTStrBuf *tok;
+    UTStrBuf *key;
+    char *literal;
+    uint32_t litPos;
+    EnumUTJSONType litType;
+    uint32_t uni;
+    uint32_t uniDigits;
+    uint32_t hiSurrogate;
+    char *error;
+  };
+
+  /*_________________---------------------------__________________
+    _________________      new, free, reset     __________________
+    -----------------___________________________------------------
+  */
+
+  UTJSONParser *UTJSONNew(char **fields, uint32_t nFields, UTJSONFieldCB fieldCB, void *magic) {
+    if(nFields > UTJSON_MAX_FIELDS) {
+      myLog(LOG_ERR, "UTJSONNew: %u fields requested (max %u)", nFields, UTJSON_MAX_FIELDS);
+      return NULL;
+    }
+    UTJSONParser *jp = (UTJSONParser *)my_calloc(sizeof(UTJSONParser));
+    jp->fieldCB = fieldCB;
+    jp->magic = magic;
+    jp->nFields = nFields;
+    for(uint32_t ff = 0; ff < nFields; ff++) {
+      UTJSONPath *path = &jp->fields[ff];
+      // "a.b[].c" -> "a" "b" "[]" "c"
+      char *p = fields[ff];
+      path->comp = (char **)my_calloc((2 * my_strlen(p) + 1) * sizeof(char *));
+      while(p && *p) {
+	if(*p == '.') {
+	  p++;
+	  continue;
+	}
+	if(p[0] == '[' && p[1] == ']') {
+	  path->comp[path->nComp++] = my_strdup("[]");
+	  p += 2;
+	  continue;
+	}
+	size_t clen = strcspn(p, ".[");
+	char *comp = my_calloc(clen + 1);
+	memcpy(comp, p, clen);
+	path->comp[path->nComp++] = comp;
+	p += clen;
+      }
+      uint64_t bit = 1ULL << ff;
+      if(path->nComp <= UTJSON_MAX_DEPTH)
+	jp->atLevel[path->nComp] |= bit;
+      for(uint32_t lvl = 0; lvl < path->nComp && lvl <= UTJSON_MAX_DEPTH; lvl++)
+	jp->belowLevel[lvl] |= bit;
+    }
+    jp->tok = UTStrBuf_new();
+    jp->key = UTStrBuf_new();
+    return jp;
+  }
+
+  void UTJSONFree(UTJSONParser *jp) {
+    for(uint32_t ff = 0; ff < jp->nFields; ff++) {
+      UTJSONPath *path = &jp->fields[ff];
+      for(uint32_t cc = 0; cc < path->nComp; cc++)
+	my_free(path->comp[cc]);
+      my_free(path->comp);
+    }
+    UTStrBuf_free(jp->tok);
+    UTStrBuf_free(jp->key);
+    my_free(jp);
+  }
+
+  // Discard any partial document,  e.g. when a new response starts
+  // or after a syntax error.
+  void UTJSONReset(UTJSONParser *jp) {
+    jp->state = UTJSON_S_VALUE;
+    jp->depth = 0;
+    jp->inDoc = NO;
+    jp->haveKey = NO;
+    jp->hiSurrogate = 0;
+    jp->error = NULL;
+    UTStrBuf_reset(jp->tok);
+    UTStrBuf_reset(jp->key);
+  }
+
+  bool UTJSONInDoc(UTJSONParser *jp) {
+    return jp->inDoc;
+  }
+
+  char *UTJSONError(UTJSONParser *jp) {
+    return jp->error;
+  }
+
+  /*_________________---------------------------__________________
+    _________________      value helpers        __________________
+    -----------------___________________________------------------
+  */
+
+  // Numbers are also passed as text so that 64-bit counters
+  // do not have to go through a double.
+  uint64_t UTJSONU64(UTJSONValue *val) {
+    if(val->type != UTJSON_NUMBER)
+      return 0;
+    if(val->str
+       && strpbrk(val->str, ".eE-") == NULL)
+      return strtoull(val->str, NULL, 10);
+    return (val->num > 0) ? (uint64_t)val->num : 0;
+  }
+
+  char *UTJSONStrCopy(UTJSONValue *val, char *buf, size_t bufLen) {
+    if(bufLen == 0)
+      return NULL;
+    buf[0] = '\0';
+    if(val->type == UTJSON_STRING
+       && val->str)
+      snprintf(buf, bufLen, "%s", val->str);
+    return buf;
+  }
+
+  /*_________________---------------------------__________________
+    _________________      path matching        __________________
+    -----------------___________________________------------------
+  */
+
+  // fields that continue from the current container to this member
+  // (key != NULL) or array element (key == NULL).
+  static uint64_t childMask(UTJSONParser *jp, char *key) {
+    uint32_t lvl = jp->depth - 1;
+    uint64_t candidates = jp->stack[lvl].mask & jp->belowLevel[lvl];
+    uint64_t ans = 0;
+    while(candidates) {
+      int ff = __builtin_ctzll(candidates);
+      candidates &= candidates - 1;
+      char *comp = jp->fields[ff].comp[lvl];
+      if(key == NULL) {
+	if(comp[0] == '[')
+	  ans |= 1ULL << ff;
+      }
+      else if((comp[0] == '*' && comp[1] == '\0')
+	      || my_strequal(comp, key))
+	ans |= 1ULL << ff;
+    }
+    return ans;
+  }
+
+  static void emit(UTJSONParser *jp, uint64_t mask, UTJSONValue *val) {
+    while(mask) {
+      int ff = __builtin_ctzll(mask);
+      mask &= mask - 1;
+      (*jp->fieldCB)(jp->magic, jp, ff, val);
+    }
+  }
+
+  /*_________________---------------------------__________________
+    _________________      state machine        __________________
+    -----------------___________________________------------------
+  */
+
+  static bool setError(UTJSONParser *jp, char *msg) {
+    jp->error = msg;
+    jp->state = UTJSON_S_ERROR;
+    return NO;
+  }
+
+  static void afterValue(UTJSONParser *jp) {
+    if(jp->depth == 0) {
+      UTJSONValue val = { .type = UTJSON_DOC_END };
+      jp->inDoc = NO;
+      jp->state = UTJSON_S_VALUE;
+      (*jp->fieldCB)(jp->magic, jp, -1, &val);
+    }
+    else
+      jp->state = UTJSON_S_AFTER;
+  }
+
+  static void scalarDone(UTJSONParser *jp, EnumUTJSONType type) {
+    uint64_t mask = jp->valMask & jp->atLevel[jp->depth];
+    if(mask) {
+      UTJSONValue val = { .type = type };
+      if(type == UTJSON_STRING
+	 || type == UTJSON_NUMBER) {
+	val.str = UTSTRBUF_STR(jp->tok);
+	val.len = UTSTRBUF_LEN(jp->tok);
+	if(type == UTJSON_NUMBER)
+	  val.num = strtod(val.str, NULL);
+      }
+      if(jp->haveKey)
+	val.key = UTSTRBUF_STR(jp->key);
+      emit(jp, mask, &val);
+    }
+    afterValue(jp);
+  }
+
+  static bool push(UTJSONParser *jp, bool isArray) {
+    if(jp->depth >= UTJSON_MAX_DEPTH)
+      return setError(jp, "nested too deep");
+    jp->stack[jp->depth].mask = jp->valMask;
+    jp->stack[jp->depth].isArray = isArray;
+    jp->depth++;
+    jp->haveKey = NO;
+    jp->state = isArray ? UTJSON_S_FIRST_ELEM : UTJSON_S_FIRST_KEY;
+    return YES;
+  }
+
+  static bool pop(UTJSONParser *jp, bool isArray) {
+    if(jp->depth == 0
+       || jp->stack[jp->depth - 1].isArray != isArray)
+      return setError(jp, "mismatched close");
+    jp->depth--;
+    uint64_t mask = jp->stack[jp->depth].mask & jp->atLevel[jp->depth];
+    if(mask) {
+      UTJSONValue val = { .type = isArray ? UTJSON_ARRAY_END : UTJSON_OBJECT_END };
+      emit(jp, mask, &val);
+    }
+    jp->haveKey = NO;
+    afterValue(jp);
+    return YES;
+  }
+
+  static void startString(UTJSONParser *jp, bool inKey) {
+    jp->inKey = inKey;
+    if(inKey) {
+      uint32_t lvl = jp->depth - 1;
+      jp->capture = (jp->stack[lvl].mask & jp->belowLevel[lvl]) ? YES : NO;
+      UTStrBuf_reset(jp->key);
+    }
+    else {
+      jp->capture = (jp->valMask & jp->atLevel[jp->depth]) ? YES : NO;
+      UTStrBuf_reset(jp->tok);
+    }
+    jp->hiSurrogate = 0;
+    jp->state = UTJSON_S_STRING;
+  }
+
+  static void appendUTF8(UTJSONParser *jp, uint32_t cp) {
+    char out[4];
+    int n;
+    if(cp < 0x80) {
+      out[0] = cp;
+      n = 1;
+    }
+    else if(cp < 0x800) {
+      out[0] = 0xC0 | (cp >> 6);
+      out[1] = 0x80 | (cp & 0x3F);
+      n = 2;
+    }
+    else if(cp < 0x10000) {
+      out[0] = 0xE0 | (cp >> 12);
+      out[1] = 0x80 | ((cp >> 6) & 0x3F);
+      out[2] = 0x80 | (cp & 0x3F);
+      n = 3;
+    }
+    else {
+      out[0] = 0xF0 | (cp >> 18);
+      out[1] = 0x80 | ((cp >> 12) & 0x3F);
+      out[2] = 0x80 | ((cp >> 6) & 0x3F);
+      out[3] = 0x80 | (cp & 0x3F);
+      n = 4;
+    }
+    UTStrBuf_append_n(jp->inKey ? jp->key : jp->tok, out, n);
+  }
+
+  static void stringDone(UTJSONParser *jp) {
+    if(jp->inKey) {
+      jp->valMask = jp->capture ? childMask(jp, UTSTRBUF_STR(jp->key)) : 0;
+      jp->haveKey = YES;
+      jp->state = UTJSON_S_COLON;
+    }
+    else
+      scalarDone(jp, UTJSON_STRING);
+  }
+
+  static bool startValue(UTJSONParser *jp, char ch) {
+    if(jp->depth == 0) {
+      // start of a new document
+      jp->inDoc = YES;
+      jp->valMask = ~0ULL;
+      jp->haveKey = NO;
+    }
+    switch(ch) {
+    case '{':
+      return push(jp, NO);
+    case '[':
+      return push(jp, YES);
+    case '"':
+      startString(jp, NO);
+      return YES;
+    case 't':
+      jp->literal = "true";
+      jp->litType = UTJSON_TRUE;
+      break;
+    case 'f':
+      jp->literal = "false";
+      jp->litType = UTJSON_FALSE;
+      break;
+    case 'n':
+      jp->literal = "null";
+      jp->litType = UTJSON_NULL;
+      break;
+    default:
+      if(ch == '-'
+	 || (ch >= '0' && ch <= '9')) {
+	jp->capture = (jp->valMask & jp->atLevel[jp->depth]) ? YES : NO;
+	UTStrBuf_reset(jp->tok);
+	if(jp->capture)
+	  UTStrBuf_append_n(jp->tok, &ch, 1);
+	jp->state = UTJSON_S_NUMBER;
+	return YES;
+      }
+      return setError(jp, "unexpected character");
+    }
+    jp->litPos = 1;
+    jp->state = UTJSON_S_LITERAL;
+    return YES;
+  }
+
+#define UTJSON_WS(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+
+  // Returns NO on a syntax error,  after which the parser must be Reset.
+  bool UTJSONFeed(UTJSONParser *jp, char *buf, size_t len) {
+    size_t pos = 0;
+    while(pos < len) {
+      char ch = buf[pos];
+      switch(jp->state) {
+
+      case UTJSON_S_ERROR:
+	return NO;
+
+      case UTJSON_S_VALUE:
+	pos++;
+	if(UTJSON_WS(ch))
+	  break;
+	if(!startValue(jp, ch))
+	  return NO;
+	break;
+
+      case UTJSON_S_FIRST_KEY:
+      case UTJSON_S_KEY:
+	pos++;
+	if(UTJSON_WS(ch))
+	  break;
+	if(ch == '"')
+	  startString(jp, YES);
+	else if(ch == '}'
+		&& jp->state == UTJSON_S_FIRST_KEY) {
+	  if(!pop(jp, NO))
+	    return NO;
+	}
+	else
+	  return setError(jp, "expected key");
+	break;
+
+      case UTJSON_S_COLON:
+	pos++;
+	if(UTJSON_WS(ch))
+	  break;
+	if(ch != ':')
+	  return setError(jp, "expected ':'");
+	jp->state = UTJSON_S_VALUE;
+	break;
+
+      case UTJSON_S_FIRST_ELEM:
+	pos++;
+	if(UTJSON_WS(ch))
+	  break;
+	if(ch == ']') {
+	  if(!pop(jp, YES))
+	    return NO;
+	  break;
+	}
+	jp->valMask = childMask(jp, NULL);
+	if(!startValue(jp, ch))
+	  return NO;
+	break;
+
+      case UTJSON_S_AFTER:
+	pos++;
+	if(UTJSON_WS(ch))
+	  break;
+	if(ch == ',') {
+	  if(jp->stack[jp->depth - 1].isArray) {
+	    jp->valMask = childMask(jp, NULL);
+	    jp->haveKey = NO;
+	    jp->state = UTJSON_S_VALUE;
+	  }
+	  else
+	    jp->state = UTJSON_S_KEY;
+	}
+	else if(ch == '}' || ch == ']') {
+	  if(!pop(jp, (ch == ']')))
+	    return NO;
+	}
+	else
+	  return setError(jp, "expected ',' or close");
+	break;
+
+      case UTJSON_S_STRING: {
+	// take the run up to the next quote or escape in one go
+	size_t run = pos;
+	while(run < len
+	      && buf[run] != '"'
+	      && buf[run] != '\\')
+	  run++;
+	if(jp->capture
+	   && run > pos) {
+	  UTStrBuf *sb = jp->inKey ? jp->key : jp->tok;
+	  if(UTSTRBUF_LEN(sb) + (run - pos) > UTJSON_MAX_TOKEN)
+	    return setError(jp, "string too long");
+	  UTStrBuf_append_n(sb, buf + pos, run - pos);
+	}
+	pos = run;
+	if(pos == len)
+	  break;
+	ch = buf[pos++];
+	if(ch == '\\')
+	  jp->state = UTJSON_S_ESCAPE;
+	else
+	  stringDone(jp);
+	break;
+      }
+
+      case UTJSON_S_ESCAPE: {
+	pos++;
+	char out = 0;
+	switch(ch) {
+	case '"': out = '"'; break;
+	case '\\': out = '\\'; break;
+	case '/': out = '/'; break;
+	case 'b': out = '\b'; break;
+	case 'f': out = '\f'; break;
+	case 'n': out = '\n'; break;
+	case 'r': out = '\r'; break;
+	case 't': out = '\t'; break;
+	case 'u':
+	  jp->uni = 0;
+	  jp->uniDigits = 0;
+	  jp->state = UTJSON_S_UNICODE;
+	  break;
+	default:
+	  return setError(jp, "bad escape");
+	}
+	if(out) {
+	  if(jp->capture)
+	    UTStrBuf_append_n(jp->inKey ? jp->key : jp->tok, &out, 1);
+	  jp->state = UTJSON_S_STRING;
+	}
+	break;
+      }
+
+      case UTJSON_S_UNICODE: {
+	pos++;
+	uint32_t digit;
+	if(ch >= '0' && ch <= '9') digit = ch - '0';
+	else if(ch >= 'a' && ch <= 'f') digit = ch - 'a' + 10;
+	else if(ch >= 'A' && ch <= 'F') digit = ch - 'A' + 10;
+	else return setError(jp, "bad \\u escape");
+	jp->uni = (jp->uni << 4) | digit;
+	if(++jp->uniDigits < 4)
+	  break;
+	jp->state = UTJSON_S_STRING;
+	if(jp->uni >= 0xD800
+	   && jp->uni < 0xDC00) {
+	  // high surrogate - wait for the low one
+	  jp->hiSurrogate = jp->uni;
+	  break;
+	}
+	uint32_t cp = jp->uni;
+	if(cp >= 0xDC00
+	   && cp < 0xE000) {
+	  if(jp->hiSurrogate == 0)
+	    break; // unpaired: drop it
+	  cp = 0x10000 + ((jp->hiSurrogate - 0xD800) << 10) + (cp - 0xDC00);
+	}
+	jp->hiSurrogate = 0;
+	if(jp->capture)
+	  appendUTF8(jp, cp);
+	break;
+      }
+
+      case UTJSON_S_NUMBER:
+	if((ch >= '0' && ch <= '9')
+	   || ch == '.'
+	   || ch == 'e'
+	   || ch == 'E'
+	   || ch == '+'
+	   || ch == '-') {
+	  pos++;
+	  if(jp->capture)
+	    UTStrBuf_append_n(jp->tok, &ch, 1);
+	  break;
+	}
+	// the number ended at this char,  which we have not consumed
+	if(jp->capture) {
+	  char *end = NULL;
+	  strtod(UTSTRBUF_STR(jp->tok), &end);
+	  if(end == NULL
+	     || *end != '\0')
+	    return setError(jp, "bad number");
+	}
+	scalarDone(jp, UTJSON_NUMBER);
+	break;
+
+      case UTJSON_S_LITERAL:
+	pos++;
+	if(ch != jp->literal[jp->litPos])
+	  return setError(jp, "bad literal");
+	if(jp->literal[++jp->litPos] == '\0')
+	  scalarDone(jp, jp->litType);
+	break;
+      }
+    }
+    return (jp->state != UTJSON_S_ERROR);
+  }
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
@@ -0,0 +1,77 @@
+/* This software is distributed under the following license:
+ * http://sflow.net/license.html
+ */
+
+#ifndef UTIL_JSON_H
+#define UTIL_JSON_H 1
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "util.h"
+
+  /*_________________---------------------------__________________
+    _________________   streaming JSON          __________________
+    -----------------___________________________------------------
+    An incremental (SAX-style) parser for feeds where we only want a
+    handful of fields out of each JSON document.  Bytes are fed in as
+    they arrive,  so a document can be split across any number of
+    reads,  and one feed can hold the tail of one document and the
+    start of the next.  No tree is built:  the caller names the fields
+    it wants by path and gets a callback for each one,  plus one at the
+    end of every top-level document.
+
+    Paths are dot-separated object keys,  with "*" to match any key and
+    "[]" for any array element,  e.g.
+      "cpu_stats.cpu_usage.total_usage"
+      "networks.*.rx_bytes"
+      "blkio_stats.io_serviced_recursive[]"
+      "Env[]"
+    A path that ends at an object or array gets a callback when it
+    closes (UTJSON_OBJECT_END / UTJSON_ARRAY_END).  Strings and keys
+    under a path that cannot match are scanned but not copied.
+  */
+
+#define UTJSON_MAX_FIELDS 64 // selection is a bitmask
+#define UTJSON_MAX_DEPTH 64
+#define UTJSON_MAX_TOKEN 1048576
+
+  typedef enum {
+    UTJSON_STRING=1,
+    UTJSON_NUMBER,
+    UTJSON_TRUE,
+    UTJSON_FALSE,
+    UTJSON_NULL,
+    UTJSON_OBJECT_END,
+    UTJSON_ARRAY_END,
+    UTJSON_DOC_END  // field == -1
+  } EnumUTJSONType;
+
+  typedef struct _UTJSONValue {
+    EnumUTJSONType type;
+    char *str;   // unescaped string,  or the text of a number
+    uint32_t len;
+    double num;
+    char *key;   // the member name,  or NULL for an array element
+  } UTJSONValue;
+
+  struct _UTJSONParser;
+  typedef void (*UTJSONFieldCB)(void *magic, struct _UTJSONParser *jp, int field, UTJSONValue *val);
+
+  typedef struct _UTJSONParser UTJSONParser;
+
+  UTJSONParser *UTJSONNew(char **fields, uint32_t nFields, UTJSONFieldCB fieldCB, void *magic);
+  void UTJSONFree(UTJSONParser *jp);
+  void UTJSONReset(UTJSONParser *jp);
+  bool UTJSONFeed(UTJSONParser *jp, char *buf, size_t len);
+  bool UTJSONInDoc(UTJSONParser *jp);
+  char *UTJSONError(UTJSONParser *jp);
+  uint64_t UTJSONU64(UTJSONValue *val);
+  char *UTJSONStrCopy(UTJSONValue *val, char *buf, size_t bufLen);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+#endif /* UTIL_JSON_H */
@@ -0,0 +1,678 @@
+/* This software is distributed under the following license:
+ * http://sflow.net/license.html
+ */
+
+/* cJSON arena parse mode - see cJSON_Arena.h */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <locale.h>
+
+#include "cJSON_Arena.h"
+
+#ifdef true
+#undef true
+#endif
+#define true ((cJSON_bool)1)
+
+#ifdef false
+#undef false
+#endif
+#define false ((cJSON_bool)0)
+
+#define ARENA_DEFAULT_BLOCK 65536
+
+/* keep every allocation aligned for the strictest member of a cJSON */
+typedef union
+{
+    double d;
+    void *p;
+    long l;
+} arena_align;
+
+#define ARENA_ROUNDUP(n) ((((n) + sizeof(arena_align) - 1) / sizeof(arena_align)) * sizeof(arena_align))
+
+typedef struct arena_block
+{
+    struct arena_block *next;
+    size_t size;
+    arena_align data[1];
+} arena_block;
+
+struct cJSON_Arena
+{
+    arena_block *first;
+    arena_block *current;
+    size_t used;       /* bytes used in current */
+    size_t block_size;
+    size_t held;       /* bytes in all blocks */
+    size_t in_use;     /* bytes handed out since reset */
+    size_t peak;
+    size_t error;
+};
+
+typedef struct
+{
+    unsigned char *content;
+    size_t length;
+    size_t offset;
+    size_t depth;
+    unsigned char decimal_point;
+    cJSON_Arena *arena;
+} arena_buffer;
+
+#define can_read(buffer, size) (((buffer)->offset + (size)) <= (buffer)->length)
+#define can_access_at_index(buffer, index) (((buffer)->offset + (index)) < (buffer)->length)
+#define buffer_at_offset(buffer) ((buffer)->content + (buffer)->offset)
+
+static arena_block *new_block(size_t size)
+{
+    arena_block *block = (arena_block *)cJSON_malloc(offsetof(arena_block, data) + size);
+    if (block != NULL)
+    {
+        block->next = NULL;
+        block->size = size;
+    }
+    return block;
+}
+
+static void *arena_alloc(cJSON_Arena * const arena, size_t size)
+{
+    unsigned char *ptr = NULL;
+
+    size = ARENA_ROUNDUP(size);
+    if ((arena->current == NULL) || ((arena->used + size) > arena->current->size))
+    {
+        /* move on to the next block we already have, or chain a new one in after this */
+        arena_block *next = (arena->current == NULL) ? arena->first : arena->current->next;
+        if ((next == NULL) || (next->size < size))
+        {
+            arena_block *block = new_block((size > arena->block_size) ? size : arena->block_size);
+            if (block == NULL)
+            {
+                return NULL;
+            }
+            arena->held += block->size;
+            block->next = next;
+            if (arena->current == NULL)
+            {
+                arena->first = block;
+            }
+            else
+            {
+                arena->current->next = block;
+            }
+            next = block;
+        }
+        arena->current = next;
+        arena->used = 0;
+    }
+
+    ptr = (unsigned char *)arena->current->data + arena->used;
+    arena->used += size;
+    arena->in_use += size;
+    if (arena->in_use > arena->peak)
+    {
+        arena->peak = arena->in_use;
+    }
+    return ptr;
+}
+
+static cJSON *new_item(arena_buffer * const buffer)
+{
+    cJSON *item = (cJSON *)arena_alloc(buffer->arena, sizeof(cJSON));
+    if (item != NULL)
+    {
+        memset(item, '\0', sizeof(cJSON));
+    }
+    return item;
+}
+
+static unsigned char get_decimal_point(void)
+{
+#ifdef ENABLE_LOCALES
+    struct lconv *lconv = localeconv();
+    return (unsigned char) lconv->decimal_point[0];
+#else
+    return '.';
+#endif
+}
+
+static arena_buffer *skip_whitespace(arena_buffer * const buffer)
+{
+    while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
+    {
+        buffer->offset++;
+    }
+    return buffer;
+}
+
+/* same rules as parse_number() in cJSON.c */
+static cJSON_bool parse_number(cJSON * const item, arena_buffer * const buffer)
+{
+    double number = 0;
+    unsigned char *after_end = NULL;
+    unsigned char number_c_string[64];
+    size_t i = 0;
+
+    for (i = 0; (i < (sizeof(number_c_string) - 1)) && can_access_at_index(buffer, i); i++)
+    {
+        unsigned char c = buffer_at_offset(buffer)[i];
+        if (((c >= '0') && (c <= '9')) || (c == '+') || (c == '-') || (c == 'e') || (c == 'E'))
+        {
+            number_c_string[i] = c;
+        }
+        else if (c == '.')
+        {
+            number_c_string[i] = buffer->decimal_point;
+        }
+        else
+        {
+            break;
+        }
+    }
+    number_c_string[i] = '\0';
+
+    number = strtod((const char *)number_c_string, (char **)&after_end);
+    if (number_c_string == after_end)
+    {
+        return false;
+    }
+
+    item->valuedouble = number;
+    if (number >= INT_MAX)
+    {
+        item->valueint = INT_MAX;
+    }
+    else if (number <= (double)INT_MIN)
+    {
+        item->valueint = INT_MIN;
+    }
+    else
+    {
+        item->valueint = (int)number;
+    }
+    item->type = cJSON_Number;
+
+    buffer->offset += (size_t)(after_end - number_c_string);
+    return true;
+}
+
+/* unlike cJSON.c this rejects a non-hex digit, so a \u sequence can
+ * never swallow the closing quote of a string */
+static cJSON_bool parse_hex4(const unsigned char * const input, unsigned int *h)
+{
+    size_t i = 0;
+
+    *h = 0;
+    for (i = 0; i < 4; i++)
+    {
+        *h = *h << 4;
+        if ((input[i] >= '0') && (input[i] <= '9'))
+        {
+            *h += (unsigned int) input[i] - '0';
+        }
+        else if ((input[i] >= 'A') && (input[i] <= 'F'))
+        {
+            *h += (unsigned int) 10 + input[i] - 'A';
+        }
+        else if ((input[i] >= 'a') && (input[i] <= 'f'))
+        {
+            *h += (unsigned int) 10 + input[i] - 'a';
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Decode the \uXXXX (or surrogate pair) at input to UTF-8 at *output.
+ * The output never runs ahead of the input,  but the whole sequence is
+ * read before anything is written since they may overlap.  Returns the
+ * number of input bytes consumed,  or 0 if invalid. */
+static unsigned char utf16_literal_to_utf8(const unsigned char * const input, const unsigned char * const input_end, unsigned char **output)
+{
+    unsigned long codepoint = 0;
+    unsigned int first_code = 0;
+    unsigned char sequence_length = 6;
+    unsigned char utf8_length = 0;
+    unsigned char first_byte_mark = 0;
+    unsigned char utf8[4];
+    unsigned char i = 0;
+
+    if ((input_end - input) < 6)
+    {
+        return 0;
+    }
+    if (!parse_hex4(input + 2, &first_code) || ((first_code >= 0xDC00) && (first_code <= 0xDFFF)))
+    {
+        return 0;
+    }
+    if ((first_code >= 0xD800) && (first_code <= 0xDBFF))
+    {
+        const unsigned char *second = input + 6;
+        unsigned int second_code = 0;
+        if (((input_end - second) < 6) || (second[0] != '\\') || (second[1] != 'u'))
+        {
+            return 0;
+        }
+        if (!parse_hex4(second + 2, &second_code) || (second_code < 0xDC00) || (second_code > 0xDFFF))
+        {
+            return 0;
+        }
+        codepoint = 0x10000 + (((first_code & 0x3FF) << 10) | (second_code & 0x3FF));
+        sequence_length = 12;
+    }
+    else
+    {
+        codepoint = first_code;
+    }
+
+    if (codepoint < 0x80)
+    {
+        utf8_length = 1;
+    }
+    else if (codepoint < 0x800)
+    {
+        utf8_length = 2;
+        first_byte_mark = 0xC0;
+    }
+    else if (codepoint < 0x10000)
+    {
+        utf8_length = 3;
+        first_byte_mark = 0xE0;
+    }
+    else
+    {
+        utf8_length = 4;
+        first_byte_mark = 0xF0;
+    }
+
+    for (i = (unsigned char)(utf8_length - 1); i > 0; i--)
+    {
+        utf8[i] = (unsigned char)((codepoint | 0x80) & 0xBF);
+        codepoint >>= 6;
+    }
+    if (utf8_length > 1)
+    {
+        utf8[0] = (unsigned char)((codepoint | first_byte_mark) & 0xFF);
+    }
+    else
+    {
+        utf8[0] = (unsigned char)(codepoint & 0x7F);
+    }
+    memcpy(*output, utf8, utf8_length);
+    *output += utf8_length;
+    return sequence_length;
+}
+
+/* Unescape the string at the buffer offset where it lies, NUL
+ * terminating it over its closing quote. */
+static cJSON_bool parse_string(char **string, arena_buffer * const buffer)
+{
+    unsigned char *input_pointer = buffer_at_offset(buffer) + 1;
+    unsigned char *input_end = buffer->content + buffer->length;
+    unsigned char *output_pointer = input_pointer;
+
+    if (!can_access_at_index(buffer, 0) || (buffer_at_offset(buffer)[0] != '\"'))
+    {
+        return false;
+    }
+
+    while ((input_pointer < input_end) && (*input_pointer != '\"'))
+    {
+        if (*input_pointer != '\\')
+        {
+            *output_pointer++ = *input_pointer++;
+            continue;
+        }
+        if ((input_end - input_pointer) < 2)
+        {
+            goto fail;
+        }
+        switch (input_pointer[1])
+        {
+            case 'b':
+                *output_pointer++ = '\b';
+                break;
+            case 'f':
+                *output_pointer++ = '\f';
+                break;
+            case 'n':
+                *output_pointer++ = '\n';
+                break;
+            case 'r':
+                *output_pointer++ = '\r';
+                break;
+            case 't':
+                *output_pointer++ = '\t';
+                break;
+            case '\"':
+            case '\\':
+            case '/':
+                *output_pointer++ = input_pointer[1];
+                break;
+            case 'u':
+            {
+                unsigned char sequence_length = utf16_literal_to_utf8(input_pointer, input_end, &output_pointer);
+                if (sequence_length == 0)
+                {
+                    goto fail;
+                }
+                input_pointer += sequence_length;
+                continue;
+            }
+            default:
+                goto fail;
+        }
+        input_pointer += 2;
+    }
+    if (input_pointer >= input_end)
+    {
+        goto fail; /* string ended unexpectedly */
+    }
+
+    *output_pointer = '\0';
+    *string = (char *)(buffer_at_offset(buffer) + 1);
+    buffer->offset = (size_t)(input_pointer - buffer->content) + 1;
+    return true;
+
+fail:
+    buffer->offset = (size_t)(input_pointer - buffer->content);
+    return false;
+}
+
+static cJSON_bool parse_value(cJSON * const item, arena_buffer * const buffer);
+
+static cJSON_bool parse_array(cJSON * const item, arena_buffer * const buffer)
+{
+    cJSON *head = NULL;
+    cJSON *current_item = NULL;
+
+    if (buffer->depth >= CJSON_NESTING_LIMIT)
+    {
+        return false;
+    }
+    buffer->depth++;
+
+    buffer->offset++; /* '[' */
+    skip_whitespace(buffer);
+    if (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] == ']'))
+    {
+        goto success;
+    }
+    if (!can_access_at_index(buffer, 0))
+    {
+        buffer->offset--;
+        return false;
+    }
+
+    buffer->offset--;
+    do
+    {
+        cJSON *new_element = new_item(buffer);
+        if (new_element == NULL)
+        {
+            return false;
+        }
+        if (head == NULL)
+        {
+            head = new_element;
+        }
+        else
+        {
+            current_item->next = new_element;
+            new_element->prev = current_item;
+        }
+        current_item = new_element;
+
+        buffer->offset++; /* '[' or ',' */
+        skip_whitespace(buffer);
+        if (!parse_value(current_item, buffer))
+        {
+            return false;
+        }
+        skip_whitespace(buffer);
+    }
+    while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] == ','));
+
+    if (!can_access_at_index(buffer, 0) || (buffer_at_offset(buffer)[0] != ']'))
+    {
+        return false;
+    }
+
+success:
+    buffer->depth--;
+    if (head != NULL)
+    {
+        head->prev = current_item;
+    }
+    item->type = cJSON_Array;
+    item->child = head;
+    buffer->offset++;
+    return true;
+}
+
+static cJSON_bool parse_object(cJSON * const item, arena_buffer * const buffer)
+{
+    cJSON *head = NULL;
+    cJSON *current_item = NULL;
+
+    if (buffer->depth >= CJSON_NESTING_LIMIT)
+    {
+        return false;
+    }
+    buffer->depth++;
+
+    buffer->offset++; /* '{' */
+    skip_whitespace(buffer);
+    if (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] == '}'))
+    {
+        goto success;
+    }
+    if (!can_access_at_index(buffer, 0))
+    {
+        buffer->offset--;
+        return false;
+    }
+
+    buffer->offset--;
+    do
+    {
+        cJSON *new_element = new_item(buffer);
+        if (new_element == NULL)
+        {
+            return false;
+        }
+        if (head == NULL)
+        {
+            head = new_element;
+        }
+        else
+        {
+            current_item->next = new_element;
+            new_element->prev = current_item;
+        }
+        current_item = new_element;
+
+        buffer->offset++; /* '{' or ',' */
+        skip_whitespace(buffer);
+        if (!parse_string(&current_item->string, buffer))
+        {
+            return false;
+        }
+        skip_whitespace(buffer);
+        if (!can_access_at_index(buffer, 0) || (buffer_at_offset(buffer)[0] != ':'))
+        {
+            return false;
+        }
+        buffer->offset++;
+        skip_whitespace(buffer);
+        if (!parse_value(current_item, buffer))
+        {
+            return false;
+        }
+        skip_whitespace(buffer);
+    }
+    while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] == ','));
+
+    if (!can_access_at_index(buffer, 0) || (buffer_at_offset(buffer)[0] != '}'))
+    {
+        return false;
+    }
+
+success:
+    buffer->depth--;
+    if (head != NULL)
+    {
+        head->prev = current_item;
+    }
+    item->type = cJSON_Object;
+    item->child = head;
+    buffer->offset++;
+    return true;
+}
+
+static cJSON_bool parse_value(cJSON * const item, arena_buffer * const buffer)
+{
+    unsigned char c = 0;
+
+    if (!can_access_at_index(buffer, 0))
+    {
+        return false;
+    }
+    c = buffer_at_offset(buffer)[0];
+
+    if (can_read(buffer, 4) && (strncmp((const char *)buffer_at_offset(buffer), "null", 4) == 0))
+    {
+        item->type = cJSON_NULL;
+        buffer->offset += 4;
+        return true;
+    }
+    if (can_read(buffer, 5) && (strncmp((const char *)buffer_at_offset(buffer), "false", 5) == 0))
+    {
+        item->type = cJSON_False;
+        buffer->offset += 5;
+        return true;
+    }
+    if (can_read(buffer, 4) && (strncmp((const char *)buffer_at_offset(buffer), "true", 4) == 0))
+    {
+        item->type = cJSON_True;
+        item->valueint = 1;
+        buffer->offset += 4;
+        return true;
+    }
+    if (c == '\"')
+    {
+        item->type = cJSON_String;
+        return parse_string(&item->valuestring, buffer);
+    }
+    if ((c == '-') || ((c >= '0') && (c <= '9')))
+    {
+        return parse_number(item, buffer);
+    }
+    if (c == '[')
+    {
+        return parse_array(item, buffer);
+    }
+    if (c == '{')
+    {
+        return parse_object(item, buffer);
+    }
+    return false;
+}
+
+CJSON_PUBLIC(cJSON_Arena *) cJSON_ArenaNew(size_t block_size)
+{
+    cJSON_Arena *arena = (cJSON_Arena *)cJSON_malloc(sizeof(cJSON_Arena));
+    if (arena != NULL)
+    {
+        memset(arena, '\0', sizeof(cJSON_Arena));
+        arena->block_size = ARENA_ROUNDUP(block_size ? block_size : ARENA_DEFAULT_BLOCK);
+    }
+    return arena;
+}
+
+CJSON_PUBLIC(void) cJSON_ArenaFree(cJSON_Arena *arena)
+{
+    arena_block *block = NULL;
+
+    if (arena == NULL)
+    {
+        return;
+    }
+    block = arena->first;
+    while (block != NULL)
+    {
+        arena_block *next = block->next;
+        cJSON_free(block);
+        block = next;
+    }
+    cJSON_free(arena);
+}
+
+CJSON_PUBLIC(void) cJSON_ArenaReset(cJSON_Arena *arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+    arena->current = NULL;
+    arena->used = 0;
+    arena->in_use = 0;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ArenaParse(cJSON_Arena *arena, char *value, size_t length)
+{
+    arena_buffer buffer;
+    cJSON *item = NULL;
+
+    if ((arena == NULL) || (value == NULL) || (length == 0))
+    {
+        return NULL;
+    }
+    arena->error = 0;
+
+    memset(&buffer, '\0', sizeof(buffer));
+    buffer.content = (unsigned char *)value;
+    buffer.length = length;
+    buffer.decimal_point = get_decimal_point();
+    buffer.arena = arena;
+
+    /* skip a UTF-8 BOM */
+    if (can_read(&buffer, 3) && (strncmp(value, "\xEF\xBB\xBF", 3) == 0))
+    {
+        buffer.offset += 3;
+    }
+
+    item = new_item(&buffer);
+    if (item == NULL)
+    {
+        return NULL;
+    }
+    if (!parse_value(item, skip_whitespace(&buffer)))
+    {
+        arena->error = (buffer.offset < length) ? buffer.offset : (length - 1);
+        return NULL;
+    }
+    return item;
+}
+
+CJSON_PUBLIC(size_t) cJSON_ArenaError(const cJSON_Arena *arena)
+{
+    return (arena == NULL) ? 0 : arena->error;
+}
+
+CJSON_PUBLIC(size_t) cJSON_ArenaSize(const cJSON_Arena *arena)
+{
+    return (arena == NULL) ? 0 : arena->held;
+}
+
+CJSON_PUBLIC(size_t) cJSON_ArenaPeak(const cJSON_Arena *arena)
+{
+    return (arena == NULL) ? 0 : arena->peak;
+}
@@ -0,0 +1,57 @@
+/* This software is distributed under the following license:
+ * http://sflow.net/license.html
+ */
+
+#ifndef cJSON_Arena__h
+#define cJSON_Arena__h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "cJSON.h"
+
+/* Arena parse mode, for callers that parse a high rate of small,
+ * short-lived documents (e.g. one per datagram) and only read them.
+ *
+ * Nodes are carved out of blocks owned by a cJSON_Arena and are all
+ * released together by cJSON_ArenaReset(), which keeps the blocks for
+ * the next document, so in the steady state parsing does no malloc or
+ * free at all.  Strings are unescaped in place in the caller's buffer
+ * (an unescaped string is never longer than its JSON text) and
+ * valuestring / string point into that buffer, so the buffer must stay
+ * put until the arena is reset.
+ *
+ * The result is the same tree that cJSON_Parse() would build, types and
+ * all, for cJSON_GetObjectItem(), cJSON_Print() and friends, with two
+ * rules:
+ *   - never cJSON_Delete() it, or any part of it.  Reset the arena.
+ *   - do not add to it, detach from it or replace items in it.
+ *
+ * An arena is not locked:  give each thread that parses its own.
+ */
+
+typedef struct cJSON_Arena cJSON_Arena;
+
+/* block_size is the allocation unit,  0 for the default.  A document
+ * that needs more takes further blocks,  which are kept for reuse. */
+CJSON_PUBLIC(cJSON_Arena *) cJSON_ArenaNew(size_t block_size);
+CJSON_PUBLIC(void) cJSON_ArenaFree(cJSON_Arena *arena);
+/* release every tree parsed into the arena since the last reset */
+CJSON_PUBLIC(void) cJSON_ArenaReset(cJSON_Arena *arena);
+/* Parse length bytes of value (which need not be NUL terminated,  and
+ * is modified) into the arena.  Returns NULL on a syntax error or if
+ * memory runs out,  in which case cJSON_ArenaError() gives the offset of
+ * the failure in value. */
+CJSON_PUBLIC(cJSON *) cJSON_ArenaParse(cJSON_Arena *arena, char *value, size_t length);
+CJSON_PUBLIC(size_t) cJSON_ArenaError(const cJSON_Arena *arena);
+/* bytes of block space held,  and high-water mark in use */
+CJSON_PUBLIC(size_t) cJSON_ArenaSize(const cJSON_Arena *arena);
+CJSON_PUBLIC(size_t) cJSON_ArenaPeak(const cJSON_Arena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
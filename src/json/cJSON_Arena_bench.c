@@ -0,0 +1,248 @@
+/* This software is distributed under the following license:
+ * http://sflow.net/license.html
+ */
+
+/* Compare cJSON_Parse()/cJSON_Delete() with cJSON_ArenaParse()/
+ * cJSON_ArenaReset() on recorded mod_json messages (one per line,
+ * '#' for comments), e.g.
+ *   ./cJSON_Arena_bench cJSON_Arena_bench.txt 200000
+ * Each message is first checked to parse to the same tree both ways.
+ * Then for each message type (the top-level key) it reports the time
+ * and the number of malloc calls per message in each mode.  The tree
+ * is walked after parsing,  as readJSON() would. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cJSON.h"
+#include "cJSON_Arena.h"
+
+#define BENCH_MAX_MSGS 1024
+#define BENCH_MAX_MSG_BYTES 10000 /* as HSP_MAX_JSON_MSG_BYTES in mod_json.c */
+
+static unsigned long mallocs;
+
+static void *count_malloc(size_t size)
+{
+    mallocs++;
+    return malloc(size);
+}
+
+static void count_free(void *ptr)
+{
+    free(ptr);
+}
+
+typedef struct
+{
+    char *text;
+    size_t len;
+    char type[64];
+} bench_msg;
+
+static bench_msg msgs[BENCH_MAX_MSGS];
+static size_t n_msgs;
+
+static size_t walk(const cJSON *item)
+{
+    size_t n = 0;
+    for (; item != NULL; item = item->next)
+    {
+        n++;
+        if (item->valuestring != NULL)
+        {
+            n += (size_t)item->valuestring[0];
+        }
+        n += walk(item->child);
+    }
+    return n;
+}
+
+static int load(const char *path)
+{
+    char line[BENCH_MAX_MSG_BYTES + 2];
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        perror(path);
+        return 0;
+    }
+    while ((n_msgs < BENCH_MAX_MSGS) && (fgets(line, (int)sizeof(line), f) != NULL))
+    {
+        size_t len = strcspn(line, "\r\n");
+        cJSON *top = NULL;
+        if ((len == 0) || (line[0] == '#'))
+        {
+            continue;
+        }
+        line[len] = '\0';
+        top = cJSON_Parse(line);
+        if ((top == NULL) || (top->child == NULL) || (top->child->string == NULL))
+        {
+            fprintf(stderr, "%s: skipping bad message: %.60s\n", path, line);
+            cJSON_Delete(top);
+            continue;
+        }
+        msgs[n_msgs].text = (char *)malloc(len + 1);
+        memcpy(msgs[n_msgs].text, line, len + 1);
+        msgs[n_msgs].len = len;
+        strncpy(msgs[n_msgs].type, top->child->string, sizeof(msgs[n_msgs].type) - 1);
+        cJSON_Delete(top);
+        n_msgs++;
+    }
+    fclose(f);
+    return (n_msgs > 0);
+}
+
+static int check(cJSON_Arena *arena)
+{
+    char buf[BENCH_MAX_MSG_BYTES];
+    size_t i = 0;
+    int ok = 1;
+    for (i = 0; i < n_msgs; i++)
+    {
+        cJSON *heap = cJSON_Parse(msgs[i].text);
+        cJSON *arena_top = NULL;
+        memcpy(buf, msgs[i].text, msgs[i].len);
+        arena_top = cJSON_ArenaParse(arena, buf, msgs[i].len);
+        if ((arena_top == NULL) || !cJSON_Compare(heap, arena_top, 1))
+        {
+            fprintf(stderr, "message %lu: arena parse differs (error at %lu)\n",
+                    (unsigned long)i, (unsigned long)cJSON_ArenaError(arena));
+            ok = 0;
+        }
+        cJSON_Delete(heap);
+        cJSON_ArenaReset(arena);
+    }
+    return ok;
+}
+
+static double run(cJSON_Arena *arena, const char *type, unsigned long iterations, unsigned long *n_parsed, unsigned long *n_mallocs)
+{
+    char buf[BENCH_MAX_MSG_BYTES + 1];
+    size_t sum = 0;
+    unsigned long it = 0;
+    clock_t start;
+    size_t i = 0;
+
+    *n_parsed = 0;
+    mallocs = 0;
+    start = clock();
+    for (it = 0; it < iterations; it++)
+    {
+        for (i = 0; i < n_msgs; i++)
+        {
+            cJSON *top = NULL;
+            if ((type != NULL) && (strcmp(type, msgs[i].type) != 0))
+            {
+                continue;
+            }
+            /* both modes start from a fresh copy,  as readJSON() reads each datagram */
+            memcpy(buf, msgs[i].text, msgs[i].len);
+            buf[msgs[i].len] = '\0';
+            if (arena != NULL)
+            {
+                top = cJSON_ArenaParse(arena, buf, msgs[i].len);
+                sum += walk(top);
+                cJSON_ArenaReset(arena);
+            }
+            else
+            {
+                top = cJSON_Parse(buf);
+                sum += walk(top);
+                cJSON_Delete(top);
+            }
+            (*n_parsed)++;
+        }
+    }
+    *n_mallocs = mallocs;
+    if (sum == 0)
+    {
+        fprintf(stderr, "nothing parsed\n");
+    }
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void report(cJSON_Arena *arena, const char *type, unsigned long iterations)
+{
+    unsigned long n_heap = 0;
+    unsigned long n_arena = 0;
+    unsigned long m_heap = 0;
+    unsigned long m_arena = 0;
+    double t_heap = run(NULL, type, iterations, &n_heap, &m_heap);
+    double t_arena = run(arena, type, iterations, &n_arena, &m_arena);
+
+    if ((n_heap == 0) || (n_arena == 0))
+    {
+        return;
+    }
+    printf("%-16s %9lu %10.1f %13.1f %10.1f %13.1f %8.2fx\n",
+           type ? type : "all",
+           n_heap,
+           (t_heap * 1e9) / (double)n_heap,
+           (double)m_heap / (double)n_heap,
+           (t_arena * 1e9) / (double)n_arena,
+           (double)m_arena / (double)n_arena,
+           (t_arena > 0) ? (t_heap / t_arena) : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    cJSON_Hooks hooks;
+    cJSON_Arena *arena = NULL;
+    unsigned long iterations = 100000;
+    const char *types[BENCH_MAX_MSGS];
+    size_t n_types = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <messages file> [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (argc > 2)
+    {
+        iterations = strtoul(argv[2], NULL, 0);
+    }
+
+    hooks.malloc_fn = count_malloc;
+    hooks.free_fn = count_free;
+    cJSON_InitHooks(&hooks);
+
+    if (!load(argv[1]))
+    {
+        return EXIT_FAILURE;
+    }
+    arena = cJSON_ArenaNew(0);
+    if ((arena == NULL) || !check(arena))
+    {
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < n_msgs; i++)
+    {
+        for (j = 0; (j < n_types) && (strcmp(types[j], msgs[i].type) != 0); j++)
+        {
+        }
+        if (j == n_types)
+        {
+            types[n_types++] = msgs[i].type;
+        }
+    }
+
+    printf("%lu messages,  %lu iterations\n", (unsigned long)n_msgs, iterations);
+    printf("%-16s %9s %10s %13s %10s %13s %9s\n", "type", "parsed", "heap_ns", "heap_mallocs", "arena_ns", "arena_mallocs", "speedup");
+    for (i = 0; i < n_types; i++)
+    {
+        report(arena, types[i], iterations);
+    }
+    report(arena, NULL, iterations);
+    printf("arena: %lu bytes held,  peak %lu bytes per message\n",
+           (unsigned long)cJSON_ArenaSize(arena), (unsigned long)cJSON_ArenaPeak(arena));
+
+    cJSON_ArenaFree(arena);
+    return EXIT_SUCCESS;
+}
@@ -95,6 +95,9 @@ typedef struct _SFLSampleCollector {
   uint32_t pktlen; /* accumulated size */
   uint32_t packetSeqNo;
   uint32_t numSamples;
+  /* agent 'now' when the first sample went in */
+  time_t firstSample_S;
+  time_t firstSample_nS;
 } SFLSampleCollector;
 
 struct _SFLAgent;  /* forward decl */
@@ -392,6 +395,8 @@ int sfl_receiver_writeCountersSample(SFLReceiver *receiver, SFL_COUNTERS_SAMPLE_
 int sfl_receiver_writeEventSample(SFLReceiver *receiver, SFLEvent_discarded_packet *es);
 int sfl_receiver_writeEncoded(SFLReceiver *receiver, uint32_t samples, uint32_t *data, int packedSize);
 void sfl_receiver_flush(SFLReceiver *receiver);
+/* when the first sample was written into the datagram being filled */
+void sfl_receiver_get_firstSampleTime(SFLReceiver *receiver, time_t *p_S, time_t *p_nS);
 
 void sfl_agent_resetReceiver(SFLAgent *agent, SFLReceiver *receiver);
 
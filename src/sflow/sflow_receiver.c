@@ -142,6 +142,17 @@ void sfl_receiver_flush(SFLReceiver *receiver)
   if(receiver->sampleCollector.numSamples > 0) sendSample(receiver);
 }
 
+/*_________________---------------------------__________________
+  _________________ sfl_receiver_get_firstSampleTime __________________
+  -----------------___________________________------------------
+*/
+
+void sfl_receiver_get_firstSampleTime(SFLReceiver *receiver, time_t *p_S, time_t *p_nS)
+{
+  *p_S = receiver->sampleCollector.firstSample_S;
+  *p_nS = receiver->sampleCollector.firstSample_nS;
+}
+
 /*_________________---------------------------__________________
   _________________   sfl_receiver_tick       __________________
   -----------------___________________________------------------
@@ -162,6 +173,16 @@ void sfl_receiver_tick(SFLReceiver *receiver, time_t now)
   -----------------_____________________________------------------
 */
  
+/* remember when this datagram started filling, so the
+   sendFn can tell how long the first sample waited */
+static void markFirstSample(SFLReceiver *receiver)
+{
+  if(receiver->sampleCollector.numSamples == 0) {
+    receiver->sampleCollector.firstSample_S = receiver->agent->now;
+    receiver->sampleCollector.firstSample_nS = receiver->agent->now_nS;
+  }
+}
+
 static void put32(SFLReceiver *receiver, uint32_t val)
 {
   *receiver->sampleCollector.datap++ = val;
@@ -843,6 +864,7 @@ int sfl_receiver_writeFlowSample(SFLReceiver *receiver, SFL_FLOW_SAMPLE_TYPE *fs
   if((receiver->sampleCollector.pktlen + packedSize) >= receiver->sFlowRcvrMaximumDatagramSize)
     sendSample(receiver);
     
+  markFirstSample(receiver);
   receiver->sampleCollector.numSamples++;
 
 #ifdef SFL_USE_32BIT_INDEX
@@ -938,6 +960,7 @@ int sfl_receiver_writeEventSample(SFLReceiver *receiver, SFLEvent_discarded_pack
   if((receiver->sampleCollector.pktlen + packedSize) >= receiver->sFlowRcvrMaximumDatagramSize)
     sendSample(receiver);
     
+  markFirstSample(receiver);
   receiver->sampleCollector.numSamples++;
 
   putNet32(receiver, SFLEVENT_DISCARDED_PACKET);
@@ -1071,6 +1094,7 @@ int sfl_receiver_writeCountersSample(SFLReceiver *receiver, SFL_COUNTERS_SAMPLE_
   if((receiver->sampleCollector.pktlen + packedSize) >= receiver->sFlowRcvrMaximumDatagramSize)
     sendSample(receiver);
   
+  markFirstSample(receiver);
   receiver->sampleCollector.numSamples++;
   
 #ifdef SFL_USE_32BIT_INDEX
@@ -1367,6 +1391,7 @@ int sfl_receiver_writeEncoded(SFLReceiver *receiver, uint32_t samples, uint32_t
   if((receiver->sampleCollector.pktlen + packedSize) >= receiver->sFlowRcvrMaximumDatagramSize)
     sendSample(receiver);
     
+  markFirstSample(receiver);
   receiver->sampleCollector.numSamples += samples;
   
   memcpy(receiver->sampleCollector.datap, xdr, packedSize);